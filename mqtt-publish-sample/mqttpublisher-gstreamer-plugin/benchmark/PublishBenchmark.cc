@@ -0,0 +1,222 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * Drives a PublishWorker with synthetic inference results as fast as they can be enqueued and reports, per backend,
+ * the results published per second and the latency of Enqueue, which is what the streaming thread pays per result.
+ *
+ *   PublishBenchmark [--results N] [--queue-size N] [--batch-max N] [--payload-format text|json|cbor|protobuf]
+ *                    [--backends counting,unix-socket,local,iot-core]
+ *
+ * The local and iot-core backends need a Greengrass Core IPC connection, so they are only run when listed and the
+ * benchmark is deployed as a component. The unix-socket backend is served by a reader thread of the benchmark itself.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <gst/gst.h>
+#include "publish-worker/PublishWorker.h"
+#include "publisher-backends/CountingPublisher.h"
+#include "publisher-backends/GreengrassPublisher.h"
+#include "publisher-backends/UnixSocketPublisher.h"
+
+typedef struct _BenchmarkOptions {
+    guint64 results;
+    size_t queue_size;
+    guint batch_max;
+    PayloadSerializer::Format payload_format;
+    std::vector<std::string> backends;
+} BenchmarkOptions;
+
+/**
+ * Forwards to the measured backend and counts the completed messages.
+ */
+class MeasuringPublisher : public PublisherBackend {
+public:
+    MeasuringPublisher(PublisherBackend* backend) : backend(backend) {}
+
+    void PublishAsync(const std::string& topic, const uint8_t* payload, size_t payload_size,
+                      PublishCallback on_complete) override {
+        backend->PublishAsync(topic, payload, payload_size, [this, on_complete](OperationStatus status) {
+            (status == OperationStatus::SUCCESSFUL ? succeeded : failed).fetch_add(1);
+            on_complete(status);
+        });
+    }
+
+    bool IsConnected() override {
+        return backend->IsConnected();
+    }
+
+    std::atomic<guint64> succeeded{0};
+    std::atomic<guint64> failed{0};
+
+private:
+    PublisherBackend* backend;
+};
+
+/**
+ * Accepts connections on a unix socket and discards everything it reads.
+ */
+class SocketReader {
+public:
+    SocketReader(const std::string& path) : path(path) {
+        struct sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+        unlink(path.c_str());
+        listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listen_fd < 0 || bind(listen_fd, (struct sockaddr*) &address, sizeof(address)) != 0
+                || listen(listen_fd, 1) != 0) {
+            throw std::runtime_error("failed to listen on " + path);
+        }
+        reader_thread = std::thread([this] {
+            int fd = accept(listen_fd, NULL, NULL);
+            if (fd < 0) {
+                return;
+            }
+            std::vector<uint8_t> buffer(64 * 1024);
+            while (read(fd, buffer.data(), buffer.size()) > 0) {
+            }
+            close(fd);
+        });
+    }
+
+    ~SocketReader() {
+        // Unblocks accept if the publisher never connected
+        shutdown(listen_fd, SHUT_RDWR);
+        reader_thread.join();
+        close(listen_fd);
+        unlink(path.c_str());
+    }
+
+private:
+    std::string path;
+    int listen_fd;
+    std::thread reader_thread;
+};
+
+static guint64 percentile(std::vector<guint64>& sorted, double fraction) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = std::min(sorted.size() - 1, (size_t) (fraction * sorted.size()));
+    return sorted[index];
+}
+
+static void runBenchmark(const std::string& name, PublisherBackend* backend, const BenchmarkOptions& options) {
+    MeasuringPublisher publisher(backend);
+    PublishWorker::Config config = {"lookoutvision/benchmark", options.queue_size,
+                                    PublishWorker::OverflowPolicy::DROP_OLDEST, 8, options.batch_max, 0, false,
+                                    options.payload_format, "benchmark", "", 0, 1};
+    std::unique_ptr<PublishWorker> worker(new PublishWorker(&publisher, config));
+
+    std::vector<guint64> latencies;
+    latencies.reserve(options.results);
+    PublishRequest request = {0, 0, 0, 25 * GST_MSECOND, false, 0.5f, "BenchmarkModel"};
+    auto start = std::chrono::steady_clock::now();
+    for (guint64 i = 0; i < options.results; i++) {
+        request.frame_id = i;
+        request.pts = i * GST_SECOND / 30;
+        request.wall_time = g_get_real_time();
+        request.is_anomalous = i % 100 == 0;
+        auto enqueue_start = std::chrono::steady_clock::now();
+        worker->Enqueue(request);
+        auto enqueue_end = std::chrono::steady_clock::now();
+        latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(enqueue_end - enqueue_start).count());
+    }
+    guint64 dropped = worker->GetStats().dropped;
+    // Drains the queue and waits for every publish to complete
+    worker.reset();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::sort(latencies.begin(), latencies.end());
+    guint64 published = options.results - dropped;
+    printf("%-12s %12.0f %12.0f %10" G_GUINT64_FORMAT " %10" G_GUINT64_FORMAT " %12" G_GUINT64_FORMAT
+           " %12" G_GUINT64_FORMAT " %12" G_GUINT64_FORMAT "\n",
+           name.c_str(), published / seconds, publisher.succeeded.load() / seconds, dropped, publisher.failed.load(),
+           percentile(latencies, 0.5), percentile(latencies, 0.99), latencies.empty() ? 0 : latencies.back());
+}
+
+static bool parseOptions(int argc, char* argv[], BenchmarkOptions& options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string name = argv[i];
+        std::string value = argv[i + 1];
+        if (name == "--results") {
+            options.results = std::stoull(value);
+        } else if (name == "--queue-size") {
+            options.queue_size = std::stoul(value);
+        } else if (name == "--batch-max") {
+            options.batch_max = std::stoul(value);
+        } else if (name == "--payload-format") {
+            if (value == "text") {
+                options.payload_format = PayloadSerializer::Format::TEXT;
+            } else if (value == "json") {
+                options.payload_format = PayloadSerializer::Format::JSON;
+            } else if (value == "cbor") {
+                options.payload_format = PayloadSerializer::Format::CBOR;
+            } else if (value == "protobuf") {
+                options.payload_format = PayloadSerializer::Format::PROTOBUF;
+            } else {
+                return false;
+            }
+        } else if (name == "--backends") {
+            options.backends.clear();
+            std::stringstream backends(value);
+            std::string backend;
+            while (std::getline(backends, backend, ',')) {
+                options.backends.push_back(backend);
+            }
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1;
+}
+
+int main(int argc, char* argv[]) {
+    gst_init(&argc, &argv);
+    BenchmarkOptions options = {1000000, 1024, 1, PayloadSerializer::Format::JSON, {"counting", "unix-socket"}};
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [--results N] [--queue-size N] [--batch-max N] "
+                  << "[--payload-format text|json|cbor|protobuf] [--backends counting,unix-socket,local,iot-core]"
+                  << std::endl;
+        return 1;
+    }
+
+    printf("%-12s %12s %12s %10s %10s %12s %12s %12s\n", "backend", "results/s", "messages/s", "dropped", "failed",
+           "p50 enq ns", "p99 enq ns", "max enq ns");
+    for (const std::string& backend : options.backends) {
+        if (backend == "counting") {
+            CountingPublisher publisher;
+            runBenchmark(backend, &publisher, options);
+        } else if (backend == "unix-socket") {
+            std::string path = "/tmp/mqttpublisher-benchmark-" + std::to_string(getpid()) + ".sock";
+            SocketReader reader(path);
+            UnixSocketPublisher publisher(path);
+            runBenchmark(backend, &publisher, options);
+        } else if (backend == "local") {
+            GreengrassPublisher publisher(GreengrassPublisher::Destination::LOCAL, 1);
+            runBenchmark(backend, &publisher, options);
+        } else if (backend == "iot-core") {
+            GreengrassPublisher publisher(GreengrassPublisher::Destination::IOT_CORE, 1);
+            runBenchmark(backend, &publisher, options);
+        } else {
+            std::cerr << "Unknown backend " << backend << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -1,6 +1,7 @@
 // Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
 // SPDX-License-Identifier: Apache-2.0
 
+#include <algorithm>
 #include <iostream>
 #include <aws/crt/Api.h>
 #include <aws/greengrass/GreengrassCoreIpcClient.h>
@@ -9,24 +10,161 @@
 using namespace Aws::Crt;
 using namespace Aws::Greengrass;
 
-ApiHandle api_handle;
-
 const int GreengrassClient::TIMEOUT_IN_SECONDS = 10;
+const int GreengrassClient::MIN_RECONNECT_BACKOFF_IN_MILLISECONDS = 500;
+const int GreengrassClient::MAX_RECONNECT_BACKOFF_IN_MILLISECONDS = 60000;
+
+std::mutex GreengrassClient::shared_mutex;
+GreengrassClient* GreengrassClient::shared_client = nullptr;
+int GreengrassClient::shared_references = 0;
+
+GreengrassClient* GreengrassClient::Acquire(int event_loop_threads) {
+    std::lock_guard<std::mutex> lock(shared_mutex);
+    if (!shared_client) {
+        // The CRT is initialized once per process and cleaned up at exit, after every client is gone
+        static ApiHandle api_handle;
+        shared_client = new GreengrassClient(event_loop_threads);
+    }
+    shared_references++;
+    return shared_client;
+}
+
+void GreengrassClient::Release(GreengrassClient* client) {
+    std::lock_guard<std::mutex> lock(shared_mutex);
+    if (!client || client != shared_client) {
+        return;
+    }
+    if (--shared_references == 0) {
+        delete shared_client;
+        shared_client = nullptr;
+    }
+}
 
-GreengrassClient::GreengrassClient() {
-    event_loop_group = new Io::EventLoopGroup(1);
-    socket_resolver = new Io::DefaultHostResolver(*event_loop_group, 64, 30);
-    bootstrap = new Io::ClientBootstrap(*event_loop_group, *socket_resolver);
-    ipc_lifecycle_handler = new IpcClientLifecycleHandler();
-    ipc_client = new GreengrassCoreIpcClient(*bootstrap);
-    auto connection_status = ipc_client->Connect(*ipc_lifecycle_handler).get();
-    if (!connection_status) {
-        std::cerr << "Failed to establish IPC connection: " << connection_status.StatusToString() << std::endl;
-        throw std::runtime_error("greengrass IPC connection failed");
+GreengrassClient::GreengrassClient(int event_loop_threads)
+        : connected(false), reconnect_backoff(MIN_RECONNECT_BACKOFF_IN_MILLISECONDS) {
+    event_loop_group.reset(new Io::EventLoopGroup(std::max(event_loop_threads, 1)));
+    socket_resolver.reset(new Io::DefaultHostResolver(*event_loop_group, 1, 30));
+    bootstrap.reset(new Io::ClientBootstrap(*event_loop_group, *socket_resolver));
+    ipc_lifecycle_handler.reset(new IpcClientLifecycleHandler([this](bool is_connected) {
+        onConnectionChange(is_connected);
+    }));
+    ipc_client.reset(new GreengrassCoreIpcClient(*bootstrap));
+    next_connect = std::chrono::steady_clock::now();
+    connection_thread = std::thread(&GreengrassClient::maintainConnection, this);
+}
+
+/**
+ * Closing the IPC client fails a connection attempt and the outstanding publishes, so the threads below finish
+ * quickly. It is closed while the mutexes and threads are still alive, since the disconnect callback takes
+ * connection_mutex.
+ */
+GreengrassClient::~GreengrassClient() {
+    {
+        std::lock_guard<std::mutex> lock(connection_mutex);
+        connection_stopping = true;
+        connection_cv.notify_all();
+    }
+    ipc_client->Close();
+    connection_thread.join();
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        stopping = true;
+        pending_cv.notify_one();
+    }
+    if (completion_thread.joinable()) {
+        completion_thread.join();
+    }
+    ipc_client.reset();
+}
+
+bool GreengrassClient::IsConnected() {
+    if (connected.load()) {
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(connection_mutex);
+    if (!connect_requested) {
+        connect_requested = true;
+        connection_cv.notify_all();
+    }
+    return connected.load();
+}
+
+/**
+ * Requests the connection and, unless earlier attempts already failed, waits for the first attempt to finish so the
+ * first publish is not failed just because the connection is made lazily.
+ */
+bool GreengrassClient::waitForConnection() {
+    if (connected.load()) {
+        return true;
+    }
+    std::unique_lock<std::mutex> lock(connection_mutex);
+    connect_requested = true;
+    connection_cv.notify_all();
+    if (!connect_attempted || connecting) {
+        connection_cv.wait_for(lock, std::chrono::seconds(TIMEOUT_IN_SECONDS), [this] {
+            return connection_stopping || connected.load() || (connect_attempted && !connecting);
+        });
+    }
+    return connected.load();
+}
+
+void GreengrassClient::onConnectionChange(bool is_connected) {
+    std::lock_guard<std::mutex> lock(connection_mutex);
+    connected.store(is_connected);
+    connection_cv.notify_all();
+}
+
+/**
+ * Connects once the connection is first needed and reconnects whenever it drops, doubling the delay between failed
+ * attempts up to MAX_RECONNECT_BACKOFF_IN_MILLISECONDS.
+ */
+void GreengrassClient::maintainConnection() {
+    std::unique_lock<std::mutex> lock(connection_mutex);
+    for (;;) {
+        connection_cv.wait(lock, [this] { return connection_stopping || (connect_requested && !connected.load()); });
+        if (connection_stopping) {
+            return;
+        }
+        if (std::chrono::steady_clock::now() < next_connect) {
+            connection_cv.wait_until(lock, next_connect, [this] { return connection_stopping; });
+            continue;
+        }
+
+        connecting = true;
+        lock.unlock();
+        auto connect_future = ipc_client->Connect(*ipc_lifecycle_handler);
+        bool is_connected = false;
+        if (connect_future.wait_for(std::chrono::seconds(TIMEOUT_IN_SECONDS)) == std::future_status::timeout) {
+            std::cerr << "Timed out establishing IPC connection" << std::endl;
+        } else {
+            auto connection_status = connect_future.get();
+            if (connection_status) {
+                is_connected = true;
+            } else {
+                std::cerr << "Failed to establish IPC connection: " << connection_status.StatusToString()
+                          << std::endl;
+            }
+        }
+        lock.lock();
+
+        connecting = false;
+        connect_attempted = true;
+        if (is_connected) {
+            connected.store(true);
+            reconnect_backoff = MIN_RECONNECT_BACKOFF_IN_MILLISECONDS;
+        } else {
+            next_connect = std::chrono::steady_clock::now() + std::chrono::milliseconds(reconnect_backoff);
+            reconnect_backoff = std::min(reconnect_backoff * 2, MAX_RECONNECT_BACKOFF_IN_MILLISECONDS);
+        }
+        connection_cv.notify_all();
     }
 }
 
 GreengrassClient::OperationStatus GreengrassClient::PublishToIoTMQTT(std::string topic, std::string payload) {
+    if (!waitForConnection()) {
+        std::cout << "Not connected, failed to publish to topic: " << topic << std::endl;
+        return OperationStatus::FAILED;
+    }
     String publish_payload(payload.c_str());
     String publish_topic(topic.c_str());
 
@@ -47,12 +185,121 @@ GreengrassClient::OperationStatus GreengrassClient::PublishToIoTMQTT(std::string
     }
 
     auto response = response_future.get();
+    return publishStatus(topic, response);
+}
+
+void GreengrassClient::PublishToIoTCoreAsync(const std::string& topic, const uint8_t* payload, size_t payload_size,
+                                             PublishCallback on_complete) {
+    if (!waitForConnection()) {
+        std::cout << "Not connected, failed to publish to topic: " << topic << std::endl;
+        on_complete(OperationStatus::FAILED);
+        return;
+    }
+
+    PublishToIoTCoreRequest request;
+    request.SetTopicName(String(topic.c_str(), topic.size()));
+    request.SetPayload(Vector<uint8_t>(payload, payload + payload_size));
+    request.SetQos(QOS_AT_LEAST_ONCE);
+
+    auto operation = std::shared_ptr<PublishToIoTCoreOperation>(
+            new PublishToIoTCoreOperation(ipc_client->NewPublishToIoTCore()));
+    auto activate_future = operation->Activate(request, nullptr);
+    addPendingPublish(operation, std::move(activate_future), topic, on_complete);
+}
+
+void GreengrassClient::PublishToTopicAsync(const std::string& topic, const uint8_t* payload, size_t payload_size,
+                                           PublishCallback on_complete) {
+    if (!waitForConnection()) {
+        std::cout << "Not connected, failed to publish to local topic: " << topic << std::endl;
+        on_complete(OperationStatus::FAILED);
+        return;
+    }
+
+    BinaryMessage binary_message;
+    binary_message.SetMessage(Vector<uint8_t>(payload, payload + payload_size));
+    PublishMessage publish_message;
+    publish_message.SetBinaryMessage(binary_message);
+    PublishToTopicRequest request;
+    request.SetTopic(String(topic.c_str(), topic.size()));
+    request.SetPublishMessage(publish_message);
+
+    auto operation = std::shared_ptr<PublishToTopicOperation>(
+            new PublishToTopicOperation(ipc_client->NewPublishToTopic()));
+    auto activate_future = operation->Activate(request, nullptr);
+    addPendingPublish(operation, std::move(activate_future), topic, on_complete);
+}
+
+/**
+ * Queues an activated operation for the completion thread. The response future is shared with the waiter so
+ * PendingPublish does not depend on the operation's result type.
+ */
+template <typename Operation>
+void GreengrassClient::addPendingPublish(std::shared_ptr<Operation> operation, std::future<RpcError> activate_future,
+                                         const std::string& topic, PublishCallback on_complete) {
+    auto response_future = std::make_shared<decltype(operation->GetResult())>(operation->GetResult());
+
+    PendingPublish pending;
+    pending.operation = operation;
+    pending.activate_future = std::move(activate_future);
+    pending.wait_for_response = [response_future, topic](std::chrono::steady_clock::time_point deadline) {
+        if (response_future->wait_until(deadline) == std::future_status::timeout) {
+            std::cerr << "Operation timed out while waiting for response from Greengrass Core." << std::endl;
+            return OperationStatus::FAILED;
+        }
+        auto response = response_future->get();
+        return publishStatus(topic, response);
+    };
+    pending.deadline = std::chrono::steady_clock::now() + std::chrono::seconds(TIMEOUT_IN_SECONDS);
+    pending.topic = topic;
+    pending.on_complete = on_complete;
+
+    std::lock_guard<std::mutex> lock(pending_mutex);
+    if (!completion_thread.joinable()) {
+        completion_thread = std::thread(&GreengrassClient::completePublishes, this);
+    }
+    pending_publishes.push_back(std::move(pending));
+    pending_cv.notify_one();
+}
+
+/**
+ * The IPC client reports QoS1 results through futures only, so a single thread waits on them in publish order and
+ * hands each result to the callback registered with the publish.
+ */
+void GreengrassClient::completePublishes() {
+    std::unique_lock<std::mutex> lock(pending_mutex);
+    for (;;) {
+        pending_cv.wait(lock, [this] { return stopping || !pending_publishes.empty(); });
+        if (pending_publishes.empty()) {
+            return;
+        }
+        PendingPublish pending = std::move(pending_publishes.front());
+        pending_publishes.pop_front();
+        lock.unlock();
+
+        OperationStatus status = OperationStatus::FAILED;
+        if (pending.activate_future.wait_until(pending.deadline) == std::future_status::timeout) {
+            std::cerr << "Operation timed out while waiting for response from Greengrass Core." << std::endl;
+        } else if (!pending.activate_future.get()) {
+            std::cout << "Failed to activate publish to topic: " << pending.topic << std::endl;
+        } else {
+            status = pending.wait_for_response(pending.deadline);
+        }
+        if (pending.on_complete) {
+            pending.on_complete(status);
+        }
+
+        lock.lock();
+    }
+}
+
+template <typename Result>
+GreengrassClient::OperationStatus GreengrassClient::publishStatus(const std::string& topic, Result& response) {
     if (response) {
-        std::cout << "Successfully published to topic: " << publish_topic << std::endl;
+        std::cout << "Successfully published to topic: " << topic << std::endl;
         return OperationStatus::SUCCESSFUL;
     } else {
         // An error occurred.
-        std::cout << "Failed to publish to topic: " << publish_topic << std::endl;
+        std::cout << "Failed to publish to topic: " << topic << std::endl;
         auto error_type = response.GetResultType();
         if (error_type == OPERATION_ERROR) {
             auto *error = response.GetOperationError();
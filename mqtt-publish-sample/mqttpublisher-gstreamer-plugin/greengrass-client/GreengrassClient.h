@@ -4,19 +4,38 @@
 #ifndef __GREENGRASS_CLIENT_H__
 #define __GREENGRASS_CLIENT_H__
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <aws/crt/Api.h>
 #include <aws/greengrass/GreengrassCoreIpcClient.h>
+#include "publish-worker/PublisherBackend.h"
 
 using namespace Aws::Crt;
 using namespace Aws::Greengrass;
 
 class IpcClientLifecycleHandler : public ConnectionLifecycleHandler {
+public:
+    typedef std::function<void(bool)> ConnectionCallback;
+
+    IpcClientLifecycleHandler(ConnectionCallback on_connection_change) : on_connection_change(on_connection_change) {}
+
+private:
+    ConnectionCallback on_connection_change;
+
     void OnConnectCallback() override {
         std::cout << "OnConnectCallback" << std::endl;
+        on_connection_change(true);
     }
 
     void OnDisconnectCallback(RpcError error) override {
         std::cout << "OnDisconnectCallback: " << error.StatusToString() << std::endl;
+        on_connection_change(false);
     }
 
     bool OnErrorCallback(RpcError error) override {
@@ -25,23 +44,84 @@ class IpcClientLifecycleHandler : public ConnectionLifecycleHandler {
     }
 };
 
-class GreengrassClient{
+/**
+ * Greengrass IPC client shared by every mqttpublisher in the process. Acquire returns the shared instance, creating it
+ * on first use, and Release destroys it once the last user is gone. The IPC connection is established on the first
+ * publish or connection check and re-established with exponential backoff whenever it drops.
+ *
+ * Messages go either to AWS IoT Core (PublishToIoTCoreAsync) or to the local publish/subscribe broker of Greengrass
+ * Core (PublishToTopicAsync), which reaches components on the same device without a round trip to the cloud.
+ */
+class GreengrassClient {
 public:
-    typedef enum _OperationStatus {
-        SUCCESSFUL = 0,
-        FAILED = -1
-    } OperationStatus;
+    typedef PublisherBackend::OperationStatus OperationStatus;
+    typedef PublisherBackend::PublishCallback PublishCallback;
+
+    static GreengrassClient* Acquire(int event_loop_threads);
+    static void Release(GreengrassClient* client);
 
-    GreengrassClient();
     OperationStatus PublishToIoTMQTT(std::string topic, std::string payload);
+    void PublishToIoTCoreAsync(const std::string& topic, const uint8_t* payload, size_t payload_size,
+                               PublishCallback on_complete);
+    void PublishToTopicAsync(const std::string& topic, const uint8_t* payload, size_t payload_size,
+                             PublishCallback on_complete);
+    bool IsConnected();
 
 private:
+    typedef std::function<OperationStatus(std::chrono::steady_clock::time_point)> ResponseWaiter;
+
+    typedef struct _PendingPublish {
+        std::shared_ptr<ClientOperation> operation;
+        std::future<RpcError> activate_future;
+        ResponseWaiter wait_for_response;
+        std::chrono::steady_clock::time_point deadline;
+        std::string topic;
+        PublishCallback on_complete;
+    } PendingPublish;
+
     static const int TIMEOUT_IN_SECONDS;
-    Io::EventLoopGroup* event_loop_group;
-    Io::DefaultHostResolver* socket_resolver;
-    Io::ClientBootstrap* bootstrap;
-    IpcClientLifecycleHandler* ipc_lifecycle_handler;
-    GreengrassCoreIpcClient* ipc_client;
+    static const int MIN_RECONNECT_BACKOFF_IN_MILLISECONDS;
+    static const int MAX_RECONNECT_BACKOFF_IN_MILLISECONDS;
+    static std::mutex shared_mutex;
+    static GreengrassClient* shared_client;
+    static int shared_references;
+
+    std::unique_ptr<Io::EventLoopGroup> event_loop_group;
+    std::unique_ptr<Io::DefaultHostResolver> socket_resolver;
+    std::unique_ptr<Io::ClientBootstrap> bootstrap;
+    std::unique_ptr<IpcClientLifecycleHandler> ipc_lifecycle_handler;
+
+    std::mutex connection_mutex;
+    std::condition_variable connection_cv;
+    std::atomic<bool> connected;
+    bool connect_requested = false;
+    bool connect_attempted = false;
+    bool connecting = false;
+    bool connection_stopping = false;
+    int reconnect_backoff;
+    std::chrono::steady_clock::time_point next_connect;
+    std::thread connection_thread;
+
+    std::mutex pending_mutex;
+    std::condition_variable pending_cv;
+    std::deque<PendingPublish> pending_publishes;
+    std::thread completion_thread;
+    bool stopping = false;
+
+    // Declared last so it is destroyed first: its callbacks use the members above
+    std::unique_ptr<GreengrassCoreIpcClient> ipc_client;
+
+    GreengrassClient(int event_loop_threads);
+    ~GreengrassClient();
+    bool waitForConnection();
+    void maintainConnection();
+    void onConnectionChange(bool is_connected);
+    template <typename Operation>
+    void addPendingPublish(std::shared_ptr<Operation> operation, std::future<RpcError> activate_future,
+                           const std::string& topic, PublishCallback on_complete);
+    void completePublishes();
+    template <typename Result>
+    static OperationStatus publishStatus(const std::string& topic, Result& response);
 };
 
 #endif //__GREENGRASS_CLIENT_H__
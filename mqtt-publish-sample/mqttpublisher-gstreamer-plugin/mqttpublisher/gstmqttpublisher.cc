@@ -4,7 +4,10 @@
 /**
  * SECTION:element-mqttpublisher
  *
- * Extracts inference results from frames and publishes to IoT MQTT topic
+ * Extracts inference results from frames and publishes to IoT MQTT topic, or with the backend property set, to a
+ * Greengrass local publish/subscribe topic, a unix socket or a counting sink. With thumbnail enabled, a downscaled
+ * JPEG of anomalous frames is published to a companion topic. With summary-interval set, periodic summaries of the
+ * results are published to a companion topic, optionally instead of the results themselves.
  *
  * <refsect2>
  * <title>Example launch line</title>
@@ -14,39 +17,119 @@
  *   ! 'video/x-raw, format=RGB, width=1280, height=720'
  *   ! videoconvert
  *   ! lookoutvision server-socket="unix:///tmp/aws.iot.lookoutvision.EdgeAgent.sock" model-component="SampleModel"
- *   ! mqttpublisher publish-topic="lookoutvision/anomalydetection/result"
- *   ! videoconvert
- *   ! jpegenc
- *   ! filesink location=./anomaly.jpg
+ *   ! mqttpublisher publish-topic="lookoutvision/anomalydetection/result" thumbnail=true
+ *   ! fakesink
  * ]|
  * </refsect2>
  */
 
-#include <iostream>
+#include <stdexcept>
 #include <gst/gst.h>
 #include "gstmqttpublisher.h"
 #include "gst/lookoutvisionmeta/gstlookoutvisionmeta.h"
-#include "greengrass-client/GreengrassClient.h"
+#include "publisher-backends/CountingPublisher.h"
+#include "publisher-backends/GreengrassPublisher.h"
+#include "publisher-backends/UnixSocketPublisher.h"
 
 GST_DEBUG_CATEGORY_STATIC(gst_mqtt_publisher_debug);
 #define GST_CAT_DEFAULT gst_mqtt_publisher_debug
 
 enum {
     PROP_0,
-    PROP_PUBLISH_TOPIC
+    PROP_PUBLISH_TOPIC,
+    PROP_QUEUE_SIZE,
+    PROP_OVERFLOW_POLICY,
+    PROP_MAX_INFLIGHT,
+    PROP_BATCH_MAX,
+    PROP_BATCH_INTERVAL,
+    PROP_FLUSH_ON_ANOMALY,
+    PROP_PUBLISH_ON_CHANGE,
+    PROP_CONFIDENCE_DELTA,
+    PROP_HEARTBEAT_INTERVAL,
+    PROP_HYSTERESIS_N,
+    PROP_HYSTERESIS_M,
+    PROP_PAYLOAD_FORMAT,
+    PROP_CAMERA_ID,
+    PROP_SPOOL_LOCATION,
+    PROP_SPOOL_MAX_SIZE,
+    PROP_REPLAY_RATE,
+    PROP_EVENT_LOOP_THREADS,
+    PROP_BACKEND,
+    PROP_SOCKET_PATH,
+    PROP_THUMBNAIL,
+    PROP_THUMBNAIL_TOPIC,
+    PROP_THUMBNAIL_MAX_WIDTH,
+    PROP_THUMBNAIL_MAX_HEIGHT,
+    PROP_THUMBNAIL_QUALITY,
+    PROP_THUMBNAIL_MAX_SIZE,
+    PROP_THUMBNAIL_INTERVAL,
+    PROP_THUMBNAIL_THREADS,
+    PROP_SUMMARY_INTERVAL,
+    PROP_SUMMARY_TOPIC,
+    PROP_PUBLISH_RESULTS,
+    PROP_STATS
 };
 
+#define GST_TYPE_MQTT_PUBLISHER_OVERFLOW_POLICY (gst_mqtt_publisher_overflow_policy_get_type())
+static GType gst_mqtt_publisher_overflow_policy_get_type(void) {
+    static GType overflow_policy_type = 0;
+    static const GEnumValue overflow_policies[] = {
+        {PublishWorker::OverflowPolicy::DROP_OLDEST, "Drop the oldest queued result", "drop-oldest"},
+        {PublishWorker::OverflowPolicy::DROP_NEWEST, "Drop the newest result", "drop-newest"},
+        {0, NULL, NULL}
+    };
+
+    if (!overflow_policy_type) {
+        overflow_policy_type = g_enum_register_static("GstMqttPublisherOverflowPolicy", overflow_policies);
+    }
+    return overflow_policy_type;
+}
+
+#define GST_TYPE_MQTT_PUBLISHER_PAYLOAD_FORMAT (gst_mqtt_publisher_payload_format_get_type())
+static GType gst_mqtt_publisher_payload_format_get_type(void) {
+    static GType payload_format_type = 0;
+    static const GEnumValue payload_formats[] = {
+        {PayloadSerializer::Format::TEXT, "Human readable text", "text"},
+        {PayloadSerializer::Format::JSON, "JSON", "json"},
+        {PayloadSerializer::Format::CBOR, "CBOR", "cbor"},
+        {PayloadSerializer::Format::PROTOBUF, "Protocol Buffers", "protobuf"},
+        {0, NULL, NULL}
+    };
+
+    if (!payload_format_type) {
+        payload_format_type = g_enum_register_static("GstMqttPublisherPayloadFormat", payload_formats);
+    }
+    return payload_format_type;
+}
+
+#define GST_TYPE_MQTT_PUBLISHER_BACKEND (gst_mqtt_publisher_backend_get_type())
+static GType gst_mqtt_publisher_backend_get_type(void) {
+    static GType backend_type = 0;
+    static const GEnumValue backends[] = {
+        {GST_MQTT_PUBLISHER_BACKEND_IOT_CORE, "AWS IoT Core through Greengrass Core", "iot-core"},
+        {GST_MQTT_PUBLISHER_BACKEND_LOCAL, "Greengrass Core local publish/subscribe", "local"},
+        {GST_MQTT_PUBLISHER_BACKEND_UNIX_SOCKET, "Length prefixed frames on a unix socket", "unix-socket"},
+        {GST_MQTT_PUBLISHER_BACKEND_COUNTING, "Count messages without sending them", "counting"},
+        {0, NULL, NULL}
+    };
+
+    if (!backend_type) {
+        backend_type = g_enum_register_static("GstMqttPublisherBackend", backends);
+    }
+    return backend_type;
+}
+
 /* Inputs and outputs */
 static GstStaticPadTemplate sink_factory = GST_STATIC_PAD_TEMPLATE("sink",
                                                                    GST_PAD_SINK,
                                                                    GST_PAD_ALWAYS,
-                                                                   GST_STATIC_CAPS("video/x-raw, format={RGB}")
+                                                                   GST_STATIC_CAPS_ANY
 );
 
 static GstStaticPadTemplate src_factory = GST_STATIC_PAD_TEMPLATE("src",
                                                                   GST_PAD_SRC,
                                                                   GST_PAD_ALWAYS,
-                                                                  GST_STATIC_CAPS("video/x-raw, format={RGB}")
+                                                                  GST_STATIC_CAPS_ANY
 );
 
 #define gst_mqtt_publisher_parent_class parent_class
@@ -57,6 +140,7 @@ static void gst_mqtt_publisher_set_property(GObject * object, guint prop_id,
 static void gst_mqtt_publisher_get_property(GObject * object, guint prop_id,
                                             GValue * value, GParamSpec * pspec);
 static void gst_mqtt_publisher_finalize(GObject *object);
+static GstStateChangeReturn gst_mqtt_publisher_change_state(GstElement *element, GstStateChange transition);
 
 static gboolean gst_mqtt_publisher_sink_event(GstPad * pad, GstObject * parent, GstEvent * event);
 static GstFlowReturn gst_mqtt_publisher_chain(GstPad * pad, GstObject * parent, GstBuffer * buf);
@@ -72,11 +156,149 @@ static void gst_mqtt_publisher_class_init(GstMqttPublisherClass * klass) {
     gobject_class->set_property = gst_mqtt_publisher_set_property;
     gobject_class->get_property = gst_mqtt_publisher_get_property;
     gobject_class->finalize = gst_mqtt_publisher_finalize;
+    gstelement_class->change_state = gst_mqtt_publisher_change_state;
 
     g_object_class_install_property(gobject_class, PROP_PUBLISH_TOPIC,
                                     g_param_spec_string("publish-topic", "Publish Topic", "MQTT topic to publish",
                                                         "lookoutvision/anomalydetection/result",
                                                         G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_QUEUE_SIZE,
+                                    g_param_spec_uint("queue-size", "Queue Size",
+                                                      "Number of results waiting to be published before the "
+                                                      "overflow policy applies", 1, 65536, 64,
+                                                      G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_OVERFLOW_POLICY,
+                                    g_param_spec_enum("overflow-policy", "Overflow Policy",
+                                                      "Result to drop when the queue is full",
+                                                      GST_TYPE_MQTT_PUBLISHER_OVERFLOW_POLICY,
+                                                      PublishWorker::OverflowPolicy::DROP_OLDEST,
+                                                      G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_MAX_INFLIGHT,
+                                    g_param_spec_uint("max-inflight", "Max Inflight",
+                                                      "Number of QoS1 publishes awaiting acknowledgement at once",
+                                                      1, 1024, 8, G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_BATCH_MAX,
+                                    g_param_spec_uint("batch-max", "Batch Max",
+                                                      "Number of results published together as one message "
+                                                      "(1 publishes each result on its own)",
+                                                      1, 65536, 1, G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_BATCH_INTERVAL,
+                                    g_param_spec_uint("batch-interval", "Batch Interval",
+                                                      "Milliseconds a batch may collect results before it is "
+                                                      "published (0 disables the time window)",
+                                                      0, G_MAXUINT, 0, G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_FLUSH_ON_ANOMALY,
+                                    g_param_spec_boolean("flush-on-anomaly", "Flush On Anomaly",
+                                                         "Publish the pending batch as soon as an anomalous "
+                                                         "result arrives", TRUE, G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_PUBLISH_ON_CHANGE,
+                                    g_param_spec_boolean("publish-on-change", "Publish On Change",
+                                                         "Only publish results that change the anomaly state, move "
+                                                         "the confidence by confidence-delta or are due for a "
+                                                         "heartbeat", FALSE, G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_CONFIDENCE_DELTA,
+                                    g_param_spec_float("confidence-delta", "Confidence Delta",
+                                                       "Confidence change since the last published result that "
+                                                       "triggers a publish (0 disables)", 0, 1, 0.05,
+                                                       G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_HEARTBEAT_INTERVAL,
+                                    g_param_spec_uint("heartbeat-interval", "Heartbeat Interval",
+                                                      "Milliseconds after which a result is published even if "
+                                                      "nothing changed (0 disables)", 0, G_MAXUINT, 60000,
+                                                      G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_HYSTERESIS_N,
+                                    g_param_spec_uint("hysteresis-n", "Hysteresis N",
+                                                      "Number of the last hysteresis-m results that must disagree "
+                                                      "with the current anomaly state to change it", 1,
+                                                      PublishPolicy::MAX_HYSTERESIS_WINDOW, 1, G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_HYSTERESIS_M,
+                                    g_param_spec_uint("hysteresis-m", "Hysteresis M",
+                                                      "Number of recent results considered for hysteresis", 1,
+                                                      PublishPolicy::MAX_HYSTERESIS_WINDOW, 1, G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_PAYLOAD_FORMAT,
+                                    g_param_spec_enum("payload-format", "Payload Format",
+                                                      "Encoding of published results (text is sent as json when "
+                                                      "batching)", GST_TYPE_MQTT_PUBLISHER_PAYLOAD_FORMAT,
+                                                      PayloadSerializer::Format::TEXT, G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_CAMERA_ID,
+                                    g_param_spec_string("camera-id", "Camera ID",
+                                                        "Camera identifier included in structured payloads", "",
+                                                        G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_SPOOL_LOCATION,
+                                    g_param_spec_string("spool-location", "Spool Location",
+                                                        "Directory to keep messages in while Greengrass Core is "
+                                                        "unreachable (unset disables spooling)", NULL,
+                                                        G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_SPOOL_MAX_SIZE,
+                                    g_param_spec_uint64("spool-max-size", "Spool Max Size",
+                                                        "Bytes of disk the spool may use before its oldest "
+                                                        "messages are dropped", 0, G_MAXUINT64,
+                                                        64 * 1024 * 1024, G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_REPLAY_RATE,
+                                    g_param_spec_uint("replay-rate", "Replay Rate",
+                                                      "Spooled messages replayed per second once reconnected",
+                                                      1, 10000, 10, G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_EVENT_LOOP_THREADS,
+                                    g_param_spec_uint("event-loop-threads", "Event Loop Threads",
+                                                      "Threads of the Greengrass IPC client shared by every "
+                                                      "mqttpublisher in the process, set by the first element to "
+                                                      "start", 1, 64, 1, G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_BACKEND,
+                                    g_param_spec_enum("backend", "Backend", "Where results are published",
+                                                      GST_TYPE_MQTT_PUBLISHER_BACKEND,
+                                                      GST_MQTT_PUBLISHER_BACKEND_IOT_CORE, G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_SOCKET_PATH,
+                                    g_param_spec_string("socket-path", "Socket Path",
+                                                        "Unix socket the unix-socket backend connects to",
+                                                        "/tmp/mqttpublisher.sock", G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_THUMBNAIL,
+                                    g_param_spec_boolean("thumbnail", "Thumbnail",
+                                                         "Publish a JPEG thumbnail of frames with a published "
+                                                         "anomalous result", FALSE, G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_THUMBNAIL_TOPIC,
+                                    g_param_spec_string("thumbnail-topic", "Thumbnail Topic",
+                                                        "Topic thumbnails are published to (unset uses "
+                                                        "<publish-topic>/thumbnail)", NULL, G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_THUMBNAIL_MAX_WIDTH,
+                                    g_param_spec_uint("thumbnail-max-width", "Thumbnail Max Width",
+                                                      "Width thumbnails are scaled down to fit", 16, 4096, 320,
+                                                      G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_THUMBNAIL_MAX_HEIGHT,
+                                    g_param_spec_uint("thumbnail-max-height", "Thumbnail Max Height",
+                                                      "Height thumbnails are scaled down to fit", 16, 4096, 240,
+                                                      G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_THUMBNAIL_QUALITY,
+                                    g_param_spec_uint("thumbnail-quality", "Thumbnail Quality",
+                                                      "JPEG quality of thumbnails", JpegThumbnail::MIN_QUALITY, 100,
+                                                      75, G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_THUMBNAIL_MAX_SIZE,
+                                    g_param_spec_uint("thumbnail-max-size", "Thumbnail Max Size",
+                                                      "Bytes a thumbnail may take; larger ones are encoded again at "
+                                                      "lower quality or skipped", 1024, G_MAXUINT, 65536,
+                                                      G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_THUMBNAIL_INTERVAL,
+                                    g_param_spec_uint("thumbnail-interval", "Thumbnail Interval",
+                                                      "Minimum milliseconds between two thumbnails", 0, G_MAXUINT,
+                                                      1000, G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_THUMBNAIL_THREADS,
+                                    g_param_spec_uint("thumbnail-threads", "Thumbnail Threads",
+                                                      "Threads encoding thumbnails", 1, 16, 1, G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_SUMMARY_INTERVAL,
+                                    g_param_spec_uint("summary-interval", "Summary Interval",
+                                                      "Milliseconds of results aggregated into one summary "
+                                                      "(0 disables summaries)", 0, G_MAXUINT, 0,
+                                                      G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_SUMMARY_TOPIC,
+                                    g_param_spec_string("summary-topic", "Summary Topic",
+                                                        "Topic summaries are published to (unset uses "
+                                                        "<publish-topic>/summary)", NULL, G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_PUBLISH_RESULTS,
+                                    g_param_spec_boolean("publish-results", "Publish Results",
+                                                         "Publish individual results; disable to publish only "
+                                                         "summaries", TRUE, G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_STATS,
+                                    g_param_spec_boxed("stats", "Statistics", "Publish queue statistics",
+                                                       GST_TYPE_STRUCTURE, G_PARAM_READABLE));
 
     gst_element_class_set_details_simple(gstelement_class,
                                          "MqttPublisher",
@@ -109,7 +331,46 @@ static void gst_mqtt_publisher_init(GstMqttPublisher * filter) {
 
     // Set default properties
     filter->publish_topic = g_strdup("lookoutvision/anomalydetection/result");
-    filter->greengrass_client = new GreengrassClient();
+    filter->queue_size = 64;
+    filter->overflow_policy = PublishWorker::OverflowPolicy::DROP_OLDEST;
+    filter->max_inflight = 8;
+    filter->batch_max = 1;
+    filter->batch_interval = 0;
+    filter->flush_on_anomaly = TRUE;
+    filter->publish_on_change = FALSE;
+    filter->confidence_delta = 0.05;
+    filter->heartbeat_interval = 60000;
+    filter->hysteresis_n = 1;
+    filter->hysteresis_m = 1;
+    filter->payload_format = PayloadSerializer::Format::TEXT;
+    filter->camera_id = g_strdup("");
+    filter->spool_location = NULL;
+    filter->spool_max_size = 64 * 1024 * 1024;
+    filter->replay_rate = 10;
+    filter->event_loop_threads = 1;
+    filter->backend = GST_MQTT_PUBLISHER_BACKEND_IOT_CORE;
+    filter->socket_path = g_strdup("/tmp/mqttpublisher.sock");
+    filter->thumbnail = FALSE;
+    filter->thumbnail_topic = NULL;
+    filter->thumbnail_max_width = 320;
+    filter->thumbnail_max_height = 240;
+    filter->thumbnail_quality = 75;
+    filter->thumbnail_max_size = 65536;
+    filter->thumbnail_interval = 1000;
+    filter->thumbnail_threads = 1;
+    filter->summary_interval = 0;
+    filter->summary_topic = NULL;
+    filter->publish_results = TRUE;
+    gst_video_info_init(&filter->video_info);
+    filter->video_info_valid = FALSE;
+    filter->frame_duration = GST_CLOCK_TIME_NONE;
+    filter->last_pts = GST_CLOCK_TIME_NONE;
+    filter->frame_id = 0;
+    filter->publisher_backend = NULL;
+    filter->thumbnail_publisher = NULL;
+    filter->publish_worker = NULL;
+    filter->publish_policy = NULL;
+    filter->result_aggregator = NULL;
 }
 
 static void gst_mqtt_publisher_set_property(GObject * object, guint prop_id, const GValue * value, GParamSpec * pspec) {
@@ -119,6 +380,106 @@ static void gst_mqtt_publisher_set_property(GObject * object, guint prop_id, con
         case PROP_PUBLISH_TOPIC:
             g_free(filter->publish_topic);
             filter->publish_topic = g_strdup(g_value_get_string(value));
+            GST_OBJECT_LOCK(filter);
+            if (filter->publish_worker) {
+                filter->publish_worker->SetTopic(filter->publish_topic);
+            }
+            GST_OBJECT_UNLOCK(filter);
+            break;
+        case PROP_QUEUE_SIZE:
+            filter->queue_size = g_value_get_uint(value);
+            break;
+        case PROP_OVERFLOW_POLICY:
+            filter->overflow_policy = (PublishWorker::OverflowPolicy) g_value_get_enum(value);
+            break;
+        case PROP_MAX_INFLIGHT:
+            filter->max_inflight = g_value_get_uint(value);
+            break;
+        case PROP_BATCH_MAX:
+            filter->batch_max = g_value_get_uint(value);
+            break;
+        case PROP_BATCH_INTERVAL:
+            filter->batch_interval = g_value_get_uint(value);
+            break;
+        case PROP_FLUSH_ON_ANOMALY:
+            filter->flush_on_anomaly = g_value_get_boolean(value);
+            break;
+        case PROP_PUBLISH_ON_CHANGE:
+            filter->publish_on_change = g_value_get_boolean(value);
+            break;
+        case PROP_CONFIDENCE_DELTA:
+            filter->confidence_delta = g_value_get_float(value);
+            break;
+        case PROP_HEARTBEAT_INTERVAL:
+            filter->heartbeat_interval = g_value_get_uint(value);
+            break;
+        case PROP_HYSTERESIS_N:
+            filter->hysteresis_n = g_value_get_uint(value);
+            break;
+        case PROP_HYSTERESIS_M:
+            filter->hysteresis_m = g_value_get_uint(value);
+            break;
+        case PROP_PAYLOAD_FORMAT:
+            filter->payload_format = (PayloadSerializer::Format) g_value_get_enum(value);
+            break;
+        case PROP_CAMERA_ID:
+            g_free(filter->camera_id);
+            filter->camera_id = g_strdup(g_value_get_string(value));
+            break;
+        case PROP_SPOOL_LOCATION:
+            g_free(filter->spool_location);
+            filter->spool_location = g_value_dup_string(value);
+            break;
+        case PROP_SPOOL_MAX_SIZE:
+            filter->spool_max_size = g_value_get_uint64(value);
+            break;
+        case PROP_REPLAY_RATE:
+            filter->replay_rate = g_value_get_uint(value);
+            break;
+        case PROP_EVENT_LOOP_THREADS:
+            filter->event_loop_threads = g_value_get_uint(value);
+            break;
+        case PROP_BACKEND:
+            filter->backend = (GstMqttPublisherBackend) g_value_get_enum(value);
+            break;
+        case PROP_SOCKET_PATH:
+            g_free(filter->socket_path);
+            filter->socket_path = g_strdup(g_value_get_string(value));
+            break;
+        case PROP_THUMBNAIL:
+            filter->thumbnail = g_value_get_boolean(value);
+            break;
+        case PROP_THUMBNAIL_TOPIC:
+            g_free(filter->thumbnail_topic);
+            filter->thumbnail_topic = g_value_dup_string(value);
+            break;
+        case PROP_THUMBNAIL_MAX_WIDTH:
+            filter->thumbnail_max_width = g_value_get_uint(value);
+            break;
+        case PROP_THUMBNAIL_MAX_HEIGHT:
+            filter->thumbnail_max_height = g_value_get_uint(value);
+            break;
+        case PROP_THUMBNAIL_QUALITY:
+            filter->thumbnail_quality = g_value_get_uint(value);
+            break;
+        case PROP_THUMBNAIL_MAX_SIZE:
+            filter->thumbnail_max_size = g_value_get_uint(value);
+            break;
+        case PROP_THUMBNAIL_INTERVAL:
+            filter->thumbnail_interval = g_value_get_uint(value);
+            break;
+        case PROP_THUMBNAIL_THREADS:
+            filter->thumbnail_threads = g_value_get_uint(value);
+            break;
+        case PROP_SUMMARY_INTERVAL:
+            filter->summary_interval = g_value_get_uint(value);
+            break;
+        case PROP_SUMMARY_TOPIC:
+            g_free(filter->summary_topic);
+            filter->summary_topic = g_value_dup_string(value);
+            break;
+        case PROP_PUBLISH_RESULTS:
+            filter->publish_results = g_value_get_boolean(value);
             break;
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
@@ -133,6 +494,133 @@ static void gst_mqtt_publisher_get_property(GObject * object, guint prop_id, GVa
         case PROP_PUBLISH_TOPIC:
             g_value_set_string(value, filter->publish_topic);
             break;
+        case PROP_QUEUE_SIZE:
+            g_value_set_uint(value, filter->queue_size);
+            break;
+        case PROP_OVERFLOW_POLICY:
+            g_value_set_enum(value, filter->overflow_policy);
+            break;
+        case PROP_MAX_INFLIGHT:
+            g_value_set_uint(value, filter->max_inflight);
+            break;
+        case PROP_BATCH_MAX:
+            g_value_set_uint(value, filter->batch_max);
+            break;
+        case PROP_BATCH_INTERVAL:
+            g_value_set_uint(value, filter->batch_interval);
+            break;
+        case PROP_FLUSH_ON_ANOMALY:
+            g_value_set_boolean(value, filter->flush_on_anomaly);
+            break;
+        case PROP_PUBLISH_ON_CHANGE:
+            g_value_set_boolean(value, filter->publish_on_change);
+            break;
+        case PROP_CONFIDENCE_DELTA:
+            g_value_set_float(value, filter->confidence_delta);
+            break;
+        case PROP_HEARTBEAT_INTERVAL:
+            g_value_set_uint(value, filter->heartbeat_interval);
+            break;
+        case PROP_HYSTERESIS_N:
+            g_value_set_uint(value, filter->hysteresis_n);
+            break;
+        case PROP_HYSTERESIS_M:
+            g_value_set_uint(value, filter->hysteresis_m);
+            break;
+        case PROP_PAYLOAD_FORMAT:
+            g_value_set_enum(value, filter->payload_format);
+            break;
+        case PROP_CAMERA_ID:
+            g_value_set_string(value, filter->camera_id);
+            break;
+        case PROP_SPOOL_LOCATION:
+            g_value_set_string(value, filter->spool_location);
+            break;
+        case PROP_SPOOL_MAX_SIZE:
+            g_value_set_uint64(value, filter->spool_max_size);
+            break;
+        case PROP_REPLAY_RATE:
+            g_value_set_uint(value, filter->replay_rate);
+            break;
+        case PROP_EVENT_LOOP_THREADS:
+            g_value_set_uint(value, filter->event_loop_threads);
+            break;
+        case PROP_BACKEND:
+            g_value_set_enum(value, filter->backend);
+            break;
+        case PROP_SOCKET_PATH:
+            g_value_set_string(value, filter->socket_path);
+            break;
+        case PROP_THUMBNAIL:
+            g_value_set_boolean(value, filter->thumbnail);
+            break;
+        case PROP_THUMBNAIL_TOPIC:
+            g_value_set_string(value, filter->thumbnail_topic);
+            break;
+        case PROP_THUMBNAIL_MAX_WIDTH:
+            g_value_set_uint(value, filter->thumbnail_max_width);
+            break;
+        case PROP_THUMBNAIL_MAX_HEIGHT:
+            g_value_set_uint(value, filter->thumbnail_max_height);
+            break;
+        case PROP_THUMBNAIL_QUALITY:
+            g_value_set_uint(value, filter->thumbnail_quality);
+            break;
+        case PROP_THUMBNAIL_MAX_SIZE:
+            g_value_set_uint(value, filter->thumbnail_max_size);
+            break;
+        case PROP_THUMBNAIL_INTERVAL:
+            g_value_set_uint(value, filter->thumbnail_interval);
+            break;
+        case PROP_THUMBNAIL_THREADS:
+            g_value_set_uint(value, filter->thumbnail_threads);
+            break;
+        case PROP_SUMMARY_INTERVAL:
+            g_value_set_uint(value, filter->summary_interval);
+            break;
+        case PROP_SUMMARY_TOPIC:
+            g_value_set_string(value, filter->summary_topic);
+            break;
+        case PROP_PUBLISH_RESULTS:
+            g_value_set_boolean(value, filter->publish_results);
+            break;
+        case PROP_STATS: {
+            // The object lock keeps change_state from deleting the workers while they are read
+            GST_OBJECT_LOCK(filter);
+            PublishStats stats = {};
+            if (filter->publish_worker) {
+                stats = filter->publish_worker->GetStats();
+            }
+            guint64 suppressed = 0;
+            if (filter->publish_policy) {
+                suppressed = filter->publish_policy->GetSuppressed();
+            }
+            ThumbnailStats thumbnail_stats = {};
+            if (filter->thumbnail_publisher) {
+                thumbnail_stats = filter->thumbnail_publisher->GetStats();
+            }
+            GST_OBJECT_UNLOCK(filter);
+            g_value_take_boxed(value, gst_structure_new("stats",
+                                                        "enqueued", G_TYPE_UINT64, stats.enqueued,
+                                                        "suppressed", G_TYPE_UINT64, suppressed,
+                                                        "dropped", G_TYPE_UINT64, stats.dropped,
+                                                        "published", G_TYPE_UINT64, stats.published,
+                                                        "failed", G_TYPE_UINT64, stats.failed,
+                                                        "messages", G_TYPE_UINT64, stats.messages,
+                                                        "spooled", G_TYPE_UINT64, stats.spooled,
+                                                        "replayed", G_TYPE_UINT64, stats.replayed,
+                                                        "spool-pending", G_TYPE_UINT64, stats.spool_pending,
+                                                        "spool-dropped", G_TYPE_UINT64, stats.spool_dropped,
+                                                        "inflight", G_TYPE_UINT64, stats.inflight,
+                                                        "thumbnails-published", G_TYPE_UINT64,
+                                                        thumbnail_stats.published,
+                                                        "thumbnails-failed", G_TYPE_UINT64, thumbnail_stats.failed,
+                                                        "thumbnails-skipped", G_TYPE_UINT64,
+                                                        thumbnail_stats.skipped,
+                                                        "summaries", G_TYPE_UINT64, stats.summaries,
+                                                        NULL));
+            break;
+        }
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
             break;
@@ -143,37 +631,226 @@ static void gst_mqtt_publisher_finalize(GObject *object) {
     GstMqttPublisher *filter = GST_MQTTPUBLISHER(object);
     if (filter) {
         GST_DEBUG_OBJECT(filter, "finalize");
+        delete filter->thumbnail_publisher;
+        filter->thumbnail_publisher = NULL;
+        delete filter->publish_worker;
+        filter->publish_worker = NULL;
+        delete filter->publish_policy;
+        filter->publish_policy = NULL;
+        delete filter->result_aggregator;
+        filter->result_aggregator = NULL;
         g_free(filter->publish_topic);
         filter->publish_topic = NULL;
+        g_free(filter->camera_id);
+        filter->camera_id = NULL;
+        g_free(filter->spool_location);
+        filter->spool_location = NULL;
+        g_free(filter->socket_path);
+        filter->socket_path = NULL;
+        g_free(filter->thumbnail_topic);
+        filter->thumbnail_topic = NULL;
+        g_free(filter->summary_topic);
+        filter->summary_topic = NULL;
+        delete filter->publisher_backend;
+        filter->publisher_backend = NULL;
     }
     G_OBJECT_CLASS(parent_class)->finalize(object);
 }
 
+static PublisherBackend* gst_mqtt_publisher_create_backend(GstMqttPublisher *filter) {
+    switch (filter->backend) {
+        case GST_MQTT_PUBLISHER_BACKEND_LOCAL:
+            return new GreengrassPublisher(GreengrassPublisher::Destination::LOCAL, filter->event_loop_threads);
+        case GST_MQTT_PUBLISHER_BACKEND_UNIX_SOCKET:
+            return new UnixSocketPublisher(filter->socket_path ? filter->socket_path : "");
+        case GST_MQTT_PUBLISHER_BACKEND_COUNTING:
+            return new CountingPublisher();
+        case GST_MQTT_PUBLISHER_BACKEND_IOT_CORE:
+        default:
+            return new GreengrassPublisher(GreengrassPublisher::Destination::IOT_CORE, filter->event_loop_threads);
+    }
+}
+
+static GstStateChangeReturn gst_mqtt_publisher_change_state(GstElement *element, GstStateChange transition) {
+    GstMqttPublisher *filter = GST_MQTTPUBLISHER(element);
+
+    if (transition == GST_STATE_CHANGE_NULL_TO_READY) {
+        filter->publisher_backend = gst_mqtt_publisher_create_backend(filter);
+    }
+    if (transition == GST_STATE_CHANGE_READY_TO_PAUSED) {
+        PublishWorker::Config config = {filter->publish_topic, filter->queue_size, filter->overflow_policy,
+                                        filter->max_inflight, filter->batch_max, filter->batch_interval,
+                                        (bool) filter->flush_on_anomaly, filter->payload_format,
+                                        filter->camera_id ? filter->camera_id : "",
+                                        filter->spool_location ? filter->spool_location : "",
+                                        filter->spool_max_size, filter->replay_rate, filter->summary_interval,
+                                        filter->summary_topic ? filter->summary_topic
+                                                              : std::string(filter->publish_topic) + "/summary"};
+        if (filter->summary_interval > 0) {
+            filter->result_aggregator = new ResultAggregator(g_get_real_time());
+        }
+        PublishWorker *publish_worker;
+        try {
+            publish_worker = new PublishWorker(filter->publisher_backend, config, filter->result_aggregator);
+        } catch (std::runtime_error& e) {
+            GST_ELEMENT_ERROR(filter, RESOURCE, OPEN_READ_WRITE, ("Failed to open publish spool"), ("%s", e.what()));
+            delete filter->result_aggregator;
+            filter->result_aggregator = NULL;
+            return GST_STATE_CHANGE_FAILURE;
+        }
+        PublishPolicy::Config policy_config = {(bool) filter->publish_on_change, filter->confidence_delta,
+                                               filter->heartbeat_interval, filter->hysteresis_n,
+                                               filter->hysteresis_m};
+        PublishPolicy *publish_policy = new PublishPolicy(policy_config);
+        ThumbnailPublisher *thumbnail_publisher = NULL;
+        if (filter->thumbnail) {
+            std::string topic = filter->thumbnail_topic ? filter->thumbnail_topic
+                                                        : std::string(filter->publish_topic) + "/thumbnail";
+            ThumbnailPublisher::Config thumbnail_config = {topic, filter->camera_id ? filter->camera_id : "",
+                                                           {filter->thumbnail_max_width, filter->thumbnail_max_height,
+                                                            (int) filter->thumbnail_quality,
+                                                            filter->thumbnail_max_size},
+                                                           filter->thumbnail_interval, filter->thumbnail_threads,
+                                                           2 * filter->thumbnail_threads};
+            thumbnail_publisher = new ThumbnailPublisher(filter->publisher_backend, thumbnail_config);
+        }
+        // Published under the object lock, which the stats property reads them with
+        GST_OBJECT_LOCK(filter);
+        filter->publish_worker = publish_worker;
+        filter->publish_policy = publish_policy;
+        filter->thumbnail_publisher = thumbnail_publisher;
+        GST_OBJECT_UNLOCK(filter);
+        filter->frame_id = 0;
+        filter->last_pts = GST_CLOCK_TIME_NONE;
+    }
+
+    GstStateChangeReturn ret = GST_ELEMENT_CLASS(parent_class)->change_state(element, transition);
+
+    if (transition == GST_STATE_CHANGE_PAUSED_TO_READY) {
+        // Unpublished under the object lock, then deleted without it so reading stats doesn't wait for the drain
+        GST_OBJECT_LOCK(filter);
+        PublishWorker *publish_worker = filter->publish_worker;
+        PublishPolicy *publish_policy = filter->publish_policy;
+        ThumbnailPublisher *thumbnail_publisher = filter->thumbnail_publisher;
+        filter->publish_worker = NULL;
+        filter->publish_policy = NULL;
+        filter->thumbnail_publisher = NULL;
+        GST_OBJECT_UNLOCK(filter);
+        // Drains queued results and publishes the last summary before returning
+        delete publish_worker;
+        delete filter->result_aggregator;
+        filter->result_aggregator = NULL;
+        delete publish_policy;
+        // Waits for thumbnails being encoded or published
+        delete thumbnail_publisher;
+        filter->video_info_valid = FALSE;
+    }
+    if (transition == GST_STATE_CHANGE_READY_TO_NULL) {
+        delete filter->publisher_backend;
+        filter->publisher_backend = NULL;
+    }
+    return ret;
+}
+
 /* this function handles sink events */
 static gboolean gst_mqtt_publisher_sink_event(GstPad * pad, GstObject * parent, GstEvent * event) {
-    GST_LOG_OBJECT(GST_MQTTPUBLISHER(parent), "Received %s event: %" GST_PTR_FORMAT, GST_EVENT_TYPE_NAME(event), event);
+    GstMqttPublisher *filter = GST_MQTTPUBLISHER(parent);
+    GST_LOG_OBJECT(filter, "Received %s event: %" GST_PTR_FORMAT, GST_EVENT_TYPE_NAME(event), event);
+
+    if (GST_EVENT_TYPE(event) == GST_EVENT_CAPS) {
+        GstCaps *caps;
+        gst_event_parse_caps(event, &caps);
+        // Any caps are passed through; thumbnails are only made from raw video the encoder can read
+        gboolean is_video = gst_video_info_from_caps(&filter->video_info, caps);
+        filter->video_info_valid = is_video && ThumbnailPublisher::IsSupported(&filter->video_info);
+        if (filter->thumbnail && !filter->video_info_valid) {
+            GST_WARNING_OBJECT(filter, "No thumbnails for caps %" GST_PTR_FORMAT, caps);
+        }
+        // Dropped frames are estimated from timestamp gaps, which needs a fixed frame rate
+        if (is_video && GST_VIDEO_INFO_FPS_N(&filter->video_info) > 0) {
+            filter->frame_duration = gst_util_uint64_scale_int(GST_SECOND, GST_VIDEO_INFO_FPS_D(&filter->video_info),
+                                                               GST_VIDEO_INFO_FPS_N(&filter->video_info));
+        } else {
+            filter->frame_duration = GST_CLOCK_TIME_NONE;
+        }
+    }
+    if (GST_EVENT_TYPE(event) == GST_EVENT_FLUSH_STOP || GST_EVENT_TYPE(event) == GST_EVENT_SEGMENT) {
+        filter->last_pts = GST_CLOCK_TIME_NONE;
+    }
     return gst_pad_event_default(pad, parent, event);
 }
 
+/*
+ * Counts the frames missing between the previous buffer and one with the given PTS, rounding the gap to whole frame
+ * durations so timestamp jitter is not counted as a drop
+ */
+static void gst_mqtt_publisher_count_dropped_frames(GstMqttPublisher *filter, GstClockTime pts) {
+    if (!GST_CLOCK_TIME_IS_VALID(pts)) {
+        return;
+    }
+    if (GST_CLOCK_TIME_IS_VALID(filter->last_pts) && GST_CLOCK_TIME_IS_VALID(filter->frame_duration)
+            && pts > filter->last_pts) {
+        guint64 frames = (pts - filter->last_pts + filter->frame_duration / 2) / filter->frame_duration;
+        if (frames > 1) {
+            filter->result_aggregator->AddDroppedFrames(frames - 1);
+        }
+    }
+    filter->last_pts = pts;
+}
+
 /* chain function */
 static GstFlowReturn gst_mqtt_publisher_chain(GstPad * pad, GstObject * parent, GstBuffer * buf) {
     GstMqttPublisher *filter;
     filter = GST_MQTTPUBLISHER(parent);
 
+    guint64 frame_id = filter->frame_id++;
+    if (filter->result_aggregator) {
+        gst_mqtt_publisher_count_dropped_frames(filter, GST_BUFFER_PTS(buf));
+    }
     GstLookoutVisionMeta* lookoutvision_meta = gst_buffer_get_lookout_vision_meta(buf);
     if (lookoutvision_meta) {
         GstLookoutVisionResult* inference_result = lookoutvision_meta->result;
         if (inference_result && inference_result->result_status == GstLookoutVisionResultStatus::SUCCESSFUL) {
-            std::string result_message = "Detect Anomaly Result - Is Anomalous? "
-                    + std::to_string(inference_result->is_anomalous) + ", Confidence: "
-                    + std::to_string(inference_result->confidence);
-            filter->greengrass_client->PublishToIoTMQTT(filter->publish_topic, result_message);
-            g_print("Published to MQTT topic %s\n", filter->publish_topic);
+            if (filter->result_aggregator) {
+                filter->result_aggregator->AddResult(inference_result->is_anomalous, inference_result->confidence,
+                                                     inference_result->inference_latency,
+                                                     inference_result->model_component);
+            }
+            if (!filter->publish_results) {
+                return gst_pad_push(filter->srcpad, buf);
+            }
+            if (!filter->publish_policy->ShouldPublish(inference_result->is_anomalous,
+                                                       inference_result->confidence, g_get_monotonic_time())) {
+                return gst_pad_push(filter->srcpad, buf);
+            }
+            PublishRequest request = {frame_id, GST_BUFFER_PTS(buf), g_get_real_time(),
+                                      inference_result->inference_latency, inference_result->is_anomalous,
+                                      inference_result->confidence};
+            g_strlcpy(request.model, inference_result->model_component.c_str(), sizeof(request.model));
+            if (!filter->publish_worker->Enqueue(request)) {
+                GST_LOG_OBJECT(filter, "Publish queue full, dropped result");
+            }
+            if (filter->thumbnail_publisher && inference_result->is_anomalous && filter->video_info_valid) {
+                filter->thumbnail_publisher->Submit(buf, &filter->video_info, frame_id, g_get_monotonic_time());
+            }
+        } else if (!inference_result) {
+            GST_LOG_OBJECT(filter, "No result in metadata");
+        } else if (inference_result->result_status == GstLookoutVisionResultStatus::SKIPPED_QUALITY) {
+            // Never sent for inference, so neither a frame of the summary nor a failure
+            GST_LOG_OBJECT(filter, "Frame skipped by the image-quality thresholds");
+        } else if (inference_result->result_status == GstLookoutVisionResultStatus::TIMEOUT) {
+            if (filter->result_aggregator) {
+                filter->result_aggregator->AddTimeout();
+            }
+            GST_LOG_OBJECT(filter, "Inference call timed out");
         } else {
-            std::cout << "Inference call failed / No result in metadata" << std::endl;
+            if (filter->result_aggregator) {
+                filter->result_aggregator->AddFailure();
+            }
+            GST_LOG_OBJECT(filter, "Inference call failed");
         }
     } else {
-        std::cout << "Failed to read metadata" << std::endl;
+        GST_LOG_OBJECT(filter, "Failed to read metadata");
     }
 
     return gst_pad_push(filter->srcpad, buf);
@@ -5,10 +5,22 @@
 #define __GST_MQTTPUBLISHER_H__
 
 #include <gst/gst.h>
-#include "greengrass-client/GreengrassClient.h"
+#include <gst/video/video.h>
+#include "publish-worker/PublishPolicy.h"
+#include "publish-worker/PublishWorker.h"
+#include "publish-worker/PublisherBackend.h"
+#include "publish-worker/ResultAggregator.h"
+#include "thumbnail/ThumbnailPublisher.h"
 
 G_BEGIN_DECLS
 
+typedef enum {
+    GST_MQTT_PUBLISHER_BACKEND_IOT_CORE = 0,
+    GST_MQTT_PUBLISHER_BACKEND_LOCAL = 1,
+    GST_MQTT_PUBLISHER_BACKEND_UNIX_SOCKET = 2,
+    GST_MQTT_PUBLISHER_BACKEND_COUNTING = 3
+} GstMqttPublisherBackend;
+
 #define GST_TYPE_MQTTPUBLISHER \
   (gst_mqtt_publisher_get_type())
 #define GST_MQTTPUBLISHER(obj) \
@@ -28,7 +40,46 @@ struct _GstMqttPublisher
     GstElement element;
     GstPad *sinkpad, *srcpad;
     gchar* publish_topic;
-    GreengrassClient* greengrass_client;
+    guint queue_size;
+    PublishWorker::OverflowPolicy overflow_policy;
+    guint max_inflight;
+    guint batch_max;
+    guint batch_interval;
+    gboolean flush_on_anomaly;
+    gboolean publish_on_change;
+    gfloat confidence_delta;
+    guint heartbeat_interval;
+    guint hysteresis_n;
+    guint hysteresis_m;
+    PayloadSerializer::Format payload_format;
+    gchar* camera_id;
+    gchar* spool_location;
+    guint64 spool_max_size;
+    guint replay_rate;
+    guint event_loop_threads;
+    GstMqttPublisherBackend backend;
+    gchar* socket_path;
+    gboolean thumbnail;
+    gchar* thumbnail_topic;
+    guint thumbnail_max_width;
+    guint thumbnail_max_height;
+    guint thumbnail_quality;
+    guint thumbnail_max_size;
+    guint thumbnail_interval;
+    guint thumbnail_threads;
+    guint summary_interval;
+    gchar* summary_topic;
+    gboolean publish_results;
+    GstVideoInfo video_info;
+    gboolean video_info_valid;
+    GstClockTime frame_duration;
+    GstClockTime last_pts;
+    guint64 frame_id;
+    PublisherBackend* publisher_backend;
+    ThumbnailPublisher* thumbnail_publisher;
+    PublishWorker* publish_worker;
+    PublishPolicy* publish_policy;
+    ResultAggregator* result_aggregator;
 };
 
 struct _GstMqttPublisherClass
@@ -0,0 +1,397 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include "PayloadSerializer.h"
+
+static void append(std::vector<uint8_t>& buffer, const char* data, size_t size) {
+    buffer.insert(buffer.end(), (const uint8_t*) data, (const uint8_t*) data + size);
+}
+
+static void append(std::vector<uint8_t>& buffer, const char* data) {
+    append(buffer, data, strlen(data));
+}
+
+static size_t modelLength(const PublishRequest& request) {
+    return strnlen(request.model, PUBLISH_REQUEST_MODEL_SIZE);
+}
+
+static size_t modelLength(const ResultSummary& summary) {
+    return strnlen(summary.model, SUMMARY_MODEL_SIZE);
+}
+
+static float anomalyRate(const ResultSummary& summary) {
+    return summary.results > 0 ? (float) summary.anomalies / summary.results : 0;
+}
+
+static void appendJsonString(std::vector<uint8_t>& buffer, const char* data, size_t size) {
+    buffer.push_back('"');
+    for (size_t i = 0; i < size; i++) {
+        unsigned char c = data[i];
+        if (c == '"' || c == '\\') {
+            buffer.push_back('\\');
+            buffer.push_back(c);
+        } else if (c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            append(buffer, escaped);
+        } else {
+            buffer.push_back(c);
+        }
+    }
+    buffer.push_back('"');
+}
+
+static void appendBigEndian(std::vector<uint8_t>& buffer, uint64_t value, int size) {
+    for (int shift = (size - 1) * 8; shift >= 0; shift -= 8) {
+        buffer.push_back(value >> shift);
+    }
+}
+
+// CBOR (RFC 8949) head: major type in the top three bits followed by the argument in the shortest encoding
+static void appendCborHead(std::vector<uint8_t>& buffer, uint8_t major_type, uint64_t argument) {
+    uint8_t type = major_type << 5;
+    if (argument < 24) {
+        buffer.push_back(type | argument);
+    } else if (argument <= UINT8_MAX) {
+        buffer.push_back(type | 24);
+        buffer.push_back(argument);
+    } else if (argument <= UINT16_MAX) {
+        buffer.push_back(type | 25);
+        appendBigEndian(buffer, argument, 2);
+    } else if (argument <= UINT32_MAX) {
+        buffer.push_back(type | 26);
+        appendBigEndian(buffer, argument, 4);
+    } else {
+        buffer.push_back(type | 27);
+        appendBigEndian(buffer, argument, 8);
+    }
+}
+
+static void appendCborString(std::vector<uint8_t>& buffer, const char* data, size_t size) {
+    appendCborHead(buffer, 3, size);
+    append(buffer, data, size);
+}
+
+static void appendCborKey(std::vector<uint8_t>& buffer, const char* key) {
+    appendCborString(buffer, key, strlen(key));
+}
+
+static void appendCborFloat(std::vector<uint8_t>& buffer, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    buffer.push_back(0xfa);
+    appendBigEndian(buffer, bits, 4);
+}
+
+static void appendCborInt(std::vector<uint8_t>& buffer, int64_t value) {
+    if (value >= 0) {
+        appendCborHead(buffer, 0, value);
+    } else {
+        appendCborHead(buffer, 1, -1 - value);
+    }
+}
+
+static void appendVarint(std::vector<uint8_t>& buffer, uint64_t value) {
+    while (value >= 0x80) {
+        buffer.push_back((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    buffer.push_back(value);
+}
+
+// Protobuf field key: field number and wire type (0 varint, 2 length delimited, 5 fixed32)
+static void appendProtobufKey(std::vector<uint8_t>& buffer, uint32_t field, uint8_t wire_type) {
+    appendVarint(buffer, (field << 3) | wire_type);
+}
+
+static void appendProtobufString(std::vector<uint8_t>& buffer, uint32_t field, const char* data, size_t size) {
+    appendProtobufKey(buffer, field, 2);
+    appendVarint(buffer, size);
+    append(buffer, data, size);
+}
+
+static void appendProtobufVarint(std::vector<uint8_t>& buffer, uint32_t field, uint64_t value) {
+    appendProtobufKey(buffer, field, 0);
+    appendVarint(buffer, value);
+}
+
+static void appendProtobufFloat(std::vector<uint8_t>& buffer, uint32_t field, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    appendProtobufKey(buffer, field, 5);
+    for (int shift = 0; shift < 32; shift += 8) {
+        buffer.push_back(bits >> shift);
+    }
+}
+
+static void appendJsonNumber(std::vector<uint8_t>& buffer, const char* key, uint64_t value) {
+    char number[48];
+    snprintf(number, sizeof(number), ",\"%s\":%" G_GUINT64_FORMAT, key, (guint64) value);
+    append(buffer, number);
+}
+
+PayloadSerializer::PayloadSerializer(Format format, const std::string& camera_id)
+        : format(format), camera_id(camera_id) {
+}
+
+void PayloadSerializer::Serialize(const PublishRequest* requests, size_t count, bool batch,
+                                  std::vector<uint8_t>& buffer) {
+    buffer.clear();
+    Format payload_format = (batch && format == Format::TEXT) ? Format::JSON : format;
+    switch (payload_format) {
+        case Format::TEXT:
+            writeText(requests[0], buffer);
+            break;
+        case Format::JSON:
+            if (!batch) {
+                writeJson(requests[0], buffer);
+                break;
+            }
+            buffer.push_back('[');
+            for (size_t i = 0; i < count; i++) {
+                if (i > 0) {
+                    buffer.push_back(',');
+                }
+                writeJson(requests[i], buffer);
+            }
+            buffer.push_back(']');
+            break;
+        case Format::CBOR:
+            if (batch) {
+                appendCborHead(buffer, 4, count);
+            }
+            for (size_t i = 0; i < (batch ? count : 1); i++) {
+                writeCbor(requests[i], buffer);
+            }
+            break;
+        case Format::PROTOBUF:
+            if (!batch) {
+                writeProtobuf(requests[0], buffer);
+                break;
+            }
+            // InferenceResultBatch.results: the length prefix is only known once the message is written
+            for (size_t i = 0; i < count; i++) {
+                size_t start = buffer.size();
+                writeProtobuf(requests[i], buffer);
+                size_t length = buffer.size() - start;
+                appendProtobufKey(buffer, 1, 2);
+                appendVarint(buffer, length);
+                std::rotate(buffer.begin() + start, buffer.begin() + start + length, buffer.end());
+            }
+            break;
+    }
+}
+
+void PayloadSerializer::writeText(const PublishRequest& request, std::vector<uint8_t>& buffer) {
+    char text[96];
+    int size = snprintf(text, sizeof(text), "Detect Anomaly Result - Is Anomalous? %d, Confidence: %f",
+                        request.is_anomalous, request.confidence);
+    append(buffer, text, size);
+}
+
+void PayloadSerializer::writeJson(const PublishRequest& request, std::vector<uint8_t>& buffer) {
+    char number[32];
+    append(buffer, "{\"camera_id\":");
+    appendJsonString(buffer, camera_id.data(), camera_id.size());
+    snprintf(number, sizeof(number), "%" G_GUINT64_FORMAT, request.frame_id);
+    append(buffer, ",\"frame_id\":");
+    append(buffer, number);
+    append(buffer, ",\"pts\":");
+    if (GST_CLOCK_TIME_IS_VALID(request.pts)) {
+        snprintf(number, sizeof(number), "%" G_GUINT64_FORMAT, request.pts);
+        append(buffer, number);
+    } else {
+        append(buffer, "null");
+    }
+    snprintf(number, sizeof(number), "%" G_GINT64_FORMAT, request.wall_time);
+    append(buffer, ",\"wall_time\":");
+    append(buffer, number);
+    append(buffer, ",\"model\":");
+    appendJsonString(buffer, request.model, modelLength(request));
+    snprintf(number, sizeof(number), "%" G_GUINT64_FORMAT, request.inference_latency);
+    append(buffer, ",\"inference_latency\":");
+    append(buffer, number);
+    append(buffer, request.is_anomalous ? ",\"is_anomalous\":true" : ",\"is_anomalous\":false");
+    snprintf(number, sizeof(number), "%f", request.confidence);
+    append(buffer, ",\"confidence\":");
+    append(buffer, number);
+    buffer.push_back('}');
+}
+
+void PayloadSerializer::writeCbor(const PublishRequest& request, std::vector<uint8_t>& buffer) {
+    appendCborHead(buffer, 5, 8);
+    appendCborString(buffer, "camera_id", 9);
+    appendCborString(buffer, camera_id.data(), camera_id.size());
+    appendCborString(buffer, "frame_id", 8);
+    appendCborHead(buffer, 0, request.frame_id);
+    appendCborString(buffer, "pts", 3);
+    if (GST_CLOCK_TIME_IS_VALID(request.pts)) {
+        appendCborHead(buffer, 0, request.pts);
+    } else {
+        buffer.push_back(0xf6);
+    }
+    appendCborString(buffer, "wall_time", 9);
+    appendCborInt(buffer, request.wall_time);
+    appendCborString(buffer, "model", 5);
+    appendCborString(buffer, request.model, modelLength(request));
+    appendCborString(buffer, "inference_latency", 17);
+    appendCborHead(buffer, 0, request.inference_latency);
+    appendCborString(buffer, "is_anomalous", 12);
+    buffer.push_back(request.is_anomalous ? 0xf5 : 0xf4);
+    appendCborString(buffer, "confidence", 10);
+    uint32_t bits;
+    memcpy(&bits, &request.confidence, sizeof(bits));
+    buffer.push_back(0xfa);
+    appendBigEndian(buffer, bits, 4);
+}
+
+void PayloadSerializer::writeProtobuf(const PublishRequest& request, std::vector<uint8_t>& buffer) {
+    // Field numbers follow inference_result.proto
+    appendProtobufString(buffer, 1, camera_id.data(), camera_id.size());
+    appendProtobufKey(buffer, 2, 0);
+    appendVarint(buffer, request.frame_id);
+    if (GST_CLOCK_TIME_IS_VALID(request.pts)) {
+        appendProtobufKey(buffer, 3, 0);
+        appendVarint(buffer, request.pts);
+    }
+    appendProtobufKey(buffer, 4, 0);
+    appendVarint(buffer, request.wall_time);
+    appendProtobufString(buffer, 5, request.model, modelLength(request));
+    appendProtobufKey(buffer, 6, 0);
+    appendVarint(buffer, request.inference_latency);
+    appendProtobufKey(buffer, 7, 0);
+    appendVarint(buffer, request.is_anomalous ? 1 : 0);
+    uint32_t bits;
+    memcpy(&bits, &request.confidence, sizeof(bits));
+    appendProtobufKey(buffer, 8, 5);
+    for (int shift = 0; shift < 32; shift += 8) {
+        buffer.push_back(bits >> shift);
+    }
+}
+
+void PayloadSerializer::SerializeSummary(const ResultSummary& summary, std::vector<uint8_t>& buffer) {
+    buffer.clear();
+    switch (format) {
+        case Format::TEXT:
+        case Format::JSON:
+            writeSummaryJson(summary, buffer);
+            break;
+        case Format::CBOR:
+            writeSummaryCbor(summary, buffer);
+            break;
+        case Format::PROTOBUF:
+            writeSummaryProtobuf(summary, buffer);
+            break;
+    }
+}
+
+void PayloadSerializer::writeSummaryJson(const ResultSummary& summary, std::vector<uint8_t>& buffer) {
+    char number[32];
+    append(buffer, "{\"camera_id\":");
+    appendJsonString(buffer, camera_id.data(), camera_id.size());
+    snprintf(number, sizeof(number), "%" G_GINT64_FORMAT, summary.window_start);
+    append(buffer, ",\"window_start\":");
+    append(buffer, number);
+    snprintf(number, sizeof(number), "%" G_GINT64_FORMAT, summary.window_end);
+    append(buffer, ",\"window_end\":");
+    append(buffer, number);
+    append(buffer, ",\"model\":");
+    appendJsonString(buffer, summary.model, modelLength(summary));
+    appendJsonNumber(buffer, "frames", summary.frames);
+    appendJsonNumber(buffer, "results", summary.results);
+    appendJsonNumber(buffer, "anomalies", summary.anomalies);
+    snprintf(number, sizeof(number), "%f", anomalyRate(summary));
+    append(buffer, ",\"anomaly_rate\":");
+    append(buffer, number);
+    appendJsonNumber(buffer, "failures", summary.failures);
+    appendJsonNumber(buffer, "timeouts", summary.timeouts);
+    appendJsonNumber(buffer, "dropped_frames", summary.dropped_frames);
+    snprintf(number, sizeof(number), "%f", summary.confidence_mean);
+    append(buffer, ",\"confidence_mean\":");
+    append(buffer, number);
+    append(buffer, ",\"confidence_histogram\":[");
+    for (int i = 0; i < SUMMARY_CONFIDENCE_BINS; i++) {
+        snprintf(number, sizeof(number), i > 0 ? ",%" G_GUINT64_FORMAT : "%" G_GUINT64_FORMAT,
+                 summary.confidence_histogram[i]);
+        append(buffer, number);
+    }
+    buffer.push_back(']');
+    appendJsonNumber(buffer, "latency_p50", summary.latency_p50);
+    appendJsonNumber(buffer, "latency_p90", summary.latency_p90);
+    appendJsonNumber(buffer, "latency_p99", summary.latency_p99);
+    appendJsonNumber(buffer, "latency_max", summary.latency_max);
+    buffer.push_back('}');
+}
+
+void PayloadSerializer::writeSummaryCbor(const ResultSummary& summary, std::vector<uint8_t>& buffer) {
+    appendCborHead(buffer, 5, 17);
+    appendCborKey(buffer, "camera_id");
+    appendCborString(buffer, camera_id.data(), camera_id.size());
+    appendCborKey(buffer, "window_start");
+    appendCborInt(buffer, summary.window_start);
+    appendCborKey(buffer, "window_end");
+    appendCborInt(buffer, summary.window_end);
+    appendCborKey(buffer, "model");
+    appendCborString(buffer, summary.model, modelLength(summary));
+    appendCborKey(buffer, "frames");
+    appendCborHead(buffer, 0, summary.frames);
+    appendCborKey(buffer, "results");
+    appendCborHead(buffer, 0, summary.results);
+    appendCborKey(buffer, "anomalies");
+    appendCborHead(buffer, 0, summary.anomalies);
+    appendCborKey(buffer, "anomaly_rate");
+    appendCborFloat(buffer, anomalyRate(summary));
+    appendCborKey(buffer, "failures");
+    appendCborHead(buffer, 0, summary.failures);
+    appendCborKey(buffer, "timeouts");
+    appendCborHead(buffer, 0, summary.timeouts);
+    appendCborKey(buffer, "dropped_frames");
+    appendCborHead(buffer, 0, summary.dropped_frames);
+    appendCborKey(buffer, "confidence_mean");
+    appendCborFloat(buffer, summary.confidence_mean);
+    appendCborKey(buffer, "confidence_histogram");
+    appendCborHead(buffer, 4, SUMMARY_CONFIDENCE_BINS);
+    for (int i = 0; i < SUMMARY_CONFIDENCE_BINS; i++) {
+        appendCborHead(buffer, 0, summary.confidence_histogram[i]);
+    }
+    appendCborKey(buffer, "latency_p50");
+    appendCborHead(buffer, 0, summary.latency_p50);
+    appendCborKey(buffer, "latency_p90");
+    appendCborHead(buffer, 0, summary.latency_p90);
+    appendCborKey(buffer, "latency_p99");
+    appendCborHead(buffer, 0, summary.latency_p99);
+    appendCborKey(buffer, "latency_max");
+    appendCborHead(buffer, 0, summary.latency_max);
+}
+
+void PayloadSerializer::writeSummaryProtobuf(const ResultSummary& summary, std::vector<uint8_t>& buffer) {
+    // Field numbers follow InferenceSummary in inference_result.proto
+    appendProtobufString(buffer, 1, camera_id.data(), camera_id.size());
+    appendProtobufVarint(buffer, 2, summary.window_start);
+    appendProtobufVarint(buffer, 3, summary.window_end);
+    appendProtobufString(buffer, 4, summary.model, modelLength(summary));
+    appendProtobufVarint(buffer, 5, summary.frames);
+    appendProtobufVarint(buffer, 6, summary.results);
+    appendProtobufVarint(buffer, 7, summary.anomalies);
+    appendProtobufFloat(buffer, 8, anomalyRate(summary));
+    appendProtobufVarint(buffer, 9, summary.failures);
+    appendProtobufVarint(buffer, 10, summary.dropped_frames);
+    appendProtobufFloat(buffer, 11, summary.confidence_mean);
+    // Packed repeated field: the length prefix is only known once the values are written
+    size_t start = buffer.size();
+    for (int i = 0; i < SUMMARY_CONFIDENCE_BINS; i++) {
+        appendVarint(buffer, summary.confidence_histogram[i]);
+    }
+    size_t length = buffer.size() - start;
+    appendProtobufKey(buffer, 12, 2);
+    appendVarint(buffer, length);
+    std::rotate(buffer.begin() + start, buffer.begin() + start + length, buffer.end());
+    appendProtobufVarint(buffer, 13, summary.latency_p50);
+    appendProtobufVarint(buffer, 14, summary.latency_p90);
+    appendProtobufVarint(buffer, 15, summary.latency_p99);
+    appendProtobufVarint(buffer, 16, summary.latency_max);
+    appendProtobufVarint(buffer, 17, summary.timeouts);
+}
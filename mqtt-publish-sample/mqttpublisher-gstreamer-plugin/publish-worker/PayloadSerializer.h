@@ -0,0 +1,60 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __PAYLOAD_SERIALIZER_H__
+#define __PAYLOAD_SERIALIZER_H__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <gst/gst.h>
+#include "ResultAggregator.h"
+
+#define PUBLISH_REQUEST_MODEL_SIZE 32
+
+typedef struct _PublishRequest {
+    guint64 frame_id;
+    GstClockTime pts;
+    gint64 wall_time;
+    GstClockTime inference_latency;
+    bool is_anomalous;
+    float confidence;
+    char model[PUBLISH_REQUEST_MODEL_SIZE];
+} PublishRequest;
+
+/**
+ * Serializes inference results into a caller owned buffer that is cleared but never shrunk, so once it has grown to
+ * the largest payload no further allocation happens. Every format carries the camera id, frame id, PTS, wall time
+ * (microseconds since the epoch), model component, inference latency (nanoseconds), anomaly flag and confidence.
+ * Batches are written as a JSON or CBOR array, or as an InferenceResultBatch message for protobuf (see
+ * inference_result.proto). The text format is the original human readable message and is only used for single results.
+ *
+ * Summaries are written as a JSON object, a CBOR map or an InferenceSummary message; text is written as JSON.
+ */
+class PayloadSerializer {
+public:
+    typedef enum _Format {
+        TEXT = 0,
+        JSON = 1,
+        CBOR = 2,
+        PROTOBUF = 3
+    } Format;
+
+    PayloadSerializer(Format format, const std::string& camera_id);
+    void Serialize(const PublishRequest* requests, size_t count, bool batch, std::vector<uint8_t>& buffer);
+    void SerializeSummary(const ResultSummary& summary, std::vector<uint8_t>& buffer);
+
+private:
+    Format format;
+    std::string camera_id;
+
+    void writeText(const PublishRequest& request, std::vector<uint8_t>& buffer);
+    void writeJson(const PublishRequest& request, std::vector<uint8_t>& buffer);
+    void writeCbor(const PublishRequest& request, std::vector<uint8_t>& buffer);
+    void writeProtobuf(const PublishRequest& request, std::vector<uint8_t>& buffer);
+    void writeSummaryJson(const ResultSummary& summary, std::vector<uint8_t>& buffer);
+    void writeSummaryCbor(const ResultSummary& summary, std::vector<uint8_t>& buffer);
+    void writeSummaryProtobuf(const ResultSummary& summary, std::vector<uint8_t>& buffer);
+};
+
+#endif //__PAYLOAD_SERIALIZER_H__
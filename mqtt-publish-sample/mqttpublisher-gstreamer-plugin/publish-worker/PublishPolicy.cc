@@ -0,0 +1,59 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+#include <cmath>
+#include "PublishPolicy.h"
+
+const guint PublishPolicy::MAX_HYSTERESIS_WINDOW = 64;
+
+PublishPolicy::PublishPolicy(const Config& config) : config(config), suppressed(0) {
+    this->config.hysteresis_m = std::min(std::max(config.hysteresis_m, 1u), MAX_HYSTERESIS_WINDOW);
+    this->config.hysteresis_n = std::min(std::max(config.hysteresis_n, 1u), this->config.hysteresis_m);
+    window_mask = this->config.hysteresis_m == 64 ? UINT64_MAX : (((uint64_t) 1 << this->config.hysteresis_m) - 1);
+}
+
+bool PublishPolicy::ShouldPublish(bool is_anomalous, float confidence, gint64 monotonic_time) {
+    bool state_changed = updateAnomalyState(is_anomalous);
+    if (!config.publish_on_change) {
+        return true;
+    }
+
+    bool publish = !published_once || state_changed;
+    if (!publish && config.confidence_delta > 0) {
+        publish = std::fabs(confidence - published_confidence) >= config.confidence_delta;
+    }
+    if (!publish && config.heartbeat_interval > 0) {
+        publish = monotonic_time - published_time >= (gint64) config.heartbeat_interval * 1000;
+    }
+
+    if (!publish) {
+        suppressed++;
+        return false;
+    }
+    published_once = true;
+    published_confidence = confidence;
+    published_time = monotonic_time;
+    return true;
+}
+
+guint64 PublishPolicy::GetSuppressed() {
+    return suppressed.load();
+}
+
+bool PublishPolicy::updateAnomalyState(bool is_anomalous) {
+    window = ((window << 1) | (is_anomalous ? 1 : 0)) & window_mask;
+    window_fill = std::min(window_fill + 1, config.hysteresis_m);
+
+    // Count results disagreeing with the current state among the ones seen so far in the window
+    guint anomalous = __builtin_popcountll(window);
+    guint disagreeing = anomaly_state ? window_fill - anomalous : anomalous;
+    if (disagreeing < config.hysteresis_n) {
+        return false;
+    }
+    // Forget the results that led here, so switching back takes another hysteresis_n disagreeing results
+    anomaly_state = !anomaly_state;
+    window = anomaly_state ? window_mask : 0;
+    window_fill = config.hysteresis_m;
+    return true;
+}
@@ -0,0 +1,49 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __PUBLISH_POLICY_H__
+#define __PUBLISH_POLICY_H__
+
+#include <atomic>
+#include <cstdint>
+#include <gst/gst.h>
+
+/**
+ * Decides which inference results are worth publishing. With publish-on-change enabled a result is published when the
+ * anomaly state changes, when its confidence moved by at least confidence_delta since the last published result, or
+ * when heartbeat_interval milliseconds passed without a publish. The anomaly state only changes once hysteresis_n of
+ * the last hysteresis_m results agree, so a single flapping frame does not trigger a publish.
+ *
+ * ShouldPublish is called from the streaming thread only and does not allocate.
+ */
+class PublishPolicy {
+public:
+    static const guint MAX_HYSTERESIS_WINDOW;
+
+    typedef struct _Config {
+        bool publish_on_change;
+        float confidence_delta;
+        guint heartbeat_interval;
+        guint hysteresis_n;
+        guint hysteresis_m;
+    } Config;
+
+    PublishPolicy(const Config& config);
+    bool ShouldPublish(bool is_anomalous, float confidence, gint64 monotonic_time);
+    guint64 GetSuppressed();
+
+private:
+    Config config;
+    uint64_t window_mask;
+    uint64_t window = 0;
+    guint window_fill = 0;
+    bool anomaly_state = false;
+    bool published_once = false;
+    float published_confidence = 0;
+    gint64 published_time = 0;
+    std::atomic<guint64> suppressed;
+
+    bool updateAnomalyState(bool is_anomalous);
+};
+
+#endif //__PUBLISH_POLICY_H__
@@ -0,0 +1,294 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "PublishSpool.h"
+
+static const char SEGMENT_MAGIC[8] = {'L', 'V', 'S', 'P', 'O', 'O', 'L', '1'};
+static const uint32_t SEGMENT_VERSION = 1;
+static const uint64_t MIN_SEGMENT_SIZE = 4096;
+
+const uint64_t PublishSpool::DEFAULT_SEGMENT_SIZE = 1024 * 1024;
+
+static uint64_t entrySize(uint64_t length) {
+    return (sizeof(PublishSpoolEntryHeader) + length + 7) & ~(uint64_t) 7;
+}
+
+static uint32_t crc32(const uint8_t* data, size_t size) {
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < size; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+// CRC of an entry: everything after the length and CRC fields
+static uint32_t entryCrc(const uint8_t* entry, uint32_t length) {
+    size_t covered = offsetof(PublishSpoolEntryHeader, topic_length);
+    return crc32(entry + covered, sizeof(PublishSpoolEntryHeader) - covered + length);
+}
+
+static std::string segmentPath(const std::string& location, uint64_t sequence) {
+    char name[64];
+    snprintf(name, sizeof(name), "/spool-%020" PRIu64 ".lvspool", sequence);
+    return location + name;
+}
+
+static std::vector<uint64_t> listSegments(const std::string& location) {
+    std::vector<uint64_t> sequences;
+    DIR* dir = opendir(location.c_str());
+    if (!dir) {
+        return sequences;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        uint64_t sequence;
+        char suffix[8] = {};
+        if (sscanf(entry->d_name, "spool-%" SCNu64 ".%7s", &sequence, suffix) == 2
+                && strcmp(suffix, "lvspool") == 0) {
+            sequences.push_back(sequence);
+        }
+    }
+    closedir(dir);
+    std::sort(sequences.begin(), sequences.end());
+    return sequences;
+}
+
+PublishSpool::PublishSpool(std::string location, uint64_t max_size, uint64_t segment_size)
+        : location(location), segment_size(std::max(segment_size, MIN_SEGMENT_SIZE)) {
+    max_segments = std::max<uint64_t>(max_size / this->segment_size, 2);
+    if (mkdir(location.c_str(), 0755) != 0 && errno != EEXIST) {
+        throw std::runtime_error("failed to create publish spool directory " + location);
+    }
+
+    for (uint64_t sequence : listSegments(location)) {
+        segments.push_back(openSegment(sequence, false));
+        recoverSegment(segments.back());
+        pending += segments.back().entries;
+    }
+    while (segments.size() > max_segments) {
+        dropped += segments.front().entries;
+        pending -= segments.front().entries;
+        closeSegment(segments.front(), true);
+        segments.pop_front();
+    }
+    if (segments.empty()) {
+        segments.push_back(openSegment(0, true));
+    }
+    if (pending > 0) {
+        std::cout << "Recovered " << pending << " spooled publishes from " << location << std::endl;
+    }
+}
+
+PublishSpool::~PublishSpool() {
+    for (Segment& segment : segments) {
+        msync(segment.data, segment.size, MS_SYNC);
+        closeSegment(segment, false);
+    }
+}
+
+PublishSpoolSegmentHeader* PublishSpool::header(const Segment& segment) {
+    return (PublishSpoolSegmentHeader*) segment.data;
+}
+
+PublishSpool::Segment PublishSpool::openSegment(uint64_t sequence, bool create) {
+    std::string path = segmentPath(location, sequence);
+    Segment segment = {sequence, -1, nullptr, 0, sizeof(PublishSpoolSegmentHeader), 0};
+    segment.fd = open(path.c_str(), create ? (O_CREAT | O_EXCL | O_RDWR) : O_RDWR, 0644);
+    if (segment.fd < 0) {
+        throw std::runtime_error("failed to open publish spool segment " + path);
+    }
+
+    if (create) {
+        segment.size = segment_size;
+        if (ftruncate(segment.fd, segment.size) != 0) {
+            close(segment.fd);
+            throw std::runtime_error("failed to allocate publish spool segment " + path);
+        }
+    } else {
+        struct stat segment_stat;
+        if (fstat(segment.fd, &segment_stat) != 0
+                || (uint64_t) segment_stat.st_size < sizeof(PublishSpoolSegmentHeader)) {
+            close(segment.fd);
+            throw std::runtime_error("invalid publish spool segment " + path);
+        }
+        segment.size = segment_stat.st_size;
+    }
+
+    segment.data = (uint8_t*) mmap(0, segment.size, PROT_READ | PROT_WRITE, MAP_SHARED, segment.fd, 0);
+    if (segment.data == MAP_FAILED) {
+        close(segment.fd);
+        throw std::runtime_error("failed to map publish spool segment " + path);
+    }
+
+    PublishSpoolSegmentHeader* segment_header = header(segment);
+    bool initialized = memcmp(segment_header->magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) == 0;
+    if (!initialized && segment_header->version == 0) {
+        // Fresh segment, or one whose header never reached the disk
+        segment_header->version = SEGMENT_VERSION;
+        segment_header->sequence = sequence;
+        segment_header->capacity = segment.size - sizeof(PublishSpoolSegmentHeader);
+        segment_header->read_offset = sizeof(PublishSpoolSegmentHeader);
+        memcpy(segment_header->magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+        msync(segment.data, sizeof(PublishSpoolSegmentHeader), MS_SYNC);
+    } else if (!initialized || segment_header->version != SEGMENT_VERSION) {
+        closeSegment(segment, false);
+        throw std::runtime_error("unsupported publish spool segment " + path);
+    }
+    return segment;
+}
+
+void PublishSpool::closeSegment(Segment& segment, bool remove) {
+    if (segment.data) {
+        munmap(segment.data, segment.size);
+        segment.data = nullptr;
+    }
+    if (segment.fd >= 0) {
+        close(segment.fd);
+        segment.fd = -1;
+    }
+    if (remove) {
+        unlink(segmentPath(location, segment.sequence).c_str());
+    }
+}
+
+/**
+ * Finds the end of the committed entries and counts the unconsumed ones. A torn entry and everything after it is
+ * cleared, so entries written after a restart are never followed by stale data.
+ */
+void PublishSpool::recoverSegment(Segment& segment) {
+    uint64_t read_offset = header(segment)->read_offset;
+    uint64_t offset = sizeof(PublishSpoolSegmentHeader);
+    while (offset + sizeof(PublishSpoolEntryHeader) <= segment.size) {
+        PublishSpoolEntryHeader* entry = (PublishSpoolEntryHeader*) (segment.data + offset);
+        uint32_t length = __atomic_load_n(&entry->length, __ATOMIC_ACQUIRE);
+        if (length == 0) {
+            break;
+        }
+        if (offset + entrySize(length) > segment.size || entryCrc(segment.data + offset, length) != entry->crc) {
+            std::cout << "Discarding torn entries in publish spool segment " << segment.sequence << std::endl;
+            memset(segment.data + offset, 0, segment.size - offset);
+            break;
+        }
+        if (offset >= read_offset) {
+            segment.entries++;
+        }
+        offset += entrySize(length);
+    }
+    segment.write_offset = offset;
+    if (read_offset < sizeof(PublishSpoolSegmentHeader) || read_offset > offset) {
+        header(segment)->read_offset = std::min(std::max<uint64_t>(read_offset, sizeof(PublishSpoolSegmentHeader)),
+                                                offset);
+    }
+}
+
+void PublishSpool::removeConsumedSegments() {
+    while (segments.size() > 1 && header(segments.front())->read_offset >= segments.front().write_offset) {
+        closeSegment(segments.front(), true);
+        segments.pop_front();
+    }
+}
+
+bool PublishSpool::Push(const std::string& topic, const uint8_t* payload, size_t payload_size) {
+    uint64_t length = topic.size() + payload_size;
+    uint64_t size = entrySize(length);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (topic.size() > UINT16_MAX || sizeof(PublishSpoolSegmentHeader) + size > segment_size) {
+        dropped++;
+        return false;
+    }
+
+    if (segments.back().write_offset + size > segments.back().size) {
+        if (segments.size() >= max_segments) {
+            std::cout << "Publish spool full, dropping " << segments.front().entries << " oldest publishes"
+                      << std::endl;
+            dropped += segments.front().entries;
+            pending -= segments.front().entries;
+            closeSegment(segments.front(), true);
+            segments.pop_front();
+        }
+        uint64_t sequence = segments.empty() ? 0 : segments.back().sequence + 1;
+        segments.push_back(openSegment(sequence, true));
+        removeConsumedSegments();
+    }
+
+    Segment& segment = segments.back();
+    uint8_t* entry_data = segment.data + segment.write_offset;
+    PublishSpoolEntryHeader* entry = (PublishSpoolEntryHeader*) entry_data;
+    entry->topic_length = topic.size();
+    entry->reserved = 0;
+    memcpy(entry_data + sizeof(PublishSpoolEntryHeader), topic.data(), topic.size());
+    memcpy(entry_data + sizeof(PublishSpoolEntryHeader) + topic.size(), payload, payload_size);
+    entry->crc = entryCrc(entry_data, length);
+    __atomic_store_n(&entry->length, (uint32_t) length, __ATOMIC_RELEASE);
+
+    // Spooling only happens while publishing fails, so every entry is made durable right away
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    uint64_t start = segment.write_offset - segment.write_offset % page_size;
+    msync(segment.data + start, segment.write_offset + size - start, MS_SYNC);
+
+    segment.write_offset += size;
+    segment.entries++;
+    pending++;
+    return true;
+}
+
+bool PublishSpool::Front(EntryId& id, std::string& topic, std::vector<uint8_t>& payload) {
+    std::lock_guard<std::mutex> lock(mutex);
+    removeConsumedSegments();
+    const Segment& segment = segments.front();
+    uint64_t read_offset = header(segment)->read_offset;
+    if (read_offset >= segment.write_offset) {
+        return false;
+    }
+
+    const uint8_t* entry_data = segment.data + read_offset;
+    const PublishSpoolEntryHeader* entry = (const PublishSpoolEntryHeader*) entry_data;
+    const uint8_t* data = entry_data + sizeof(PublishSpoolEntryHeader);
+    topic.assign((const char*) data, entry->topic_length);
+    payload.assign(data + entry->topic_length, data + entry->length);
+    id = EntryId{segment.sequence, read_offset};
+    return true;
+}
+
+void PublishSpool::Pop(const EntryId& id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Segment& segment = segments.front();
+    PublishSpoolSegmentHeader* segment_header = header(segment);
+    // The entry may already be gone if its segment was dropped to make room
+    if (segment.sequence != id.sequence || segment_header->read_offset != id.offset) {
+        return;
+    }
+
+    const PublishSpoolEntryHeader* entry = (const PublishSpoolEntryHeader*) (segment.data + id.offset);
+    segment_header->read_offset = id.offset + entrySize(entry->length);
+    msync(segment.data, sizeof(PublishSpoolSegmentHeader), MS_ASYNC);
+    segment.entries--;
+    pending--;
+    removeConsumedSegments();
+}
+
+uint64_t PublishSpool::Pending() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return pending;
+}
+
+uint64_t PublishSpool::GetDropped() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return dropped;
+}
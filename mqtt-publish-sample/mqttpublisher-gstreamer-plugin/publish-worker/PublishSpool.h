@@ -0,0 +1,87 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __PUBLISH_SPOOL_H__
+#define __PUBLISH_SPOOL_H__
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+ * Disk-backed FIFO of payloads that could not be published.
+ *
+ * The spool is a directory of preallocated, memory-mapped segment files (spool-<sequence>.lvspool). Each segment has
+ * a header holding the offset of the first unconsumed entry, followed by 8 byte aligned entries: a length, a CRC-32
+ * of the entry, the topic and the payload. The length is stored last, so an entry interrupted by a crash reads back
+ * as the end of the segment; entries torn by a power loss fail the CRC check and are discarded with the rest of
+ * their segment.
+ *
+ * When the spool would exceed max_size, its oldest segment is dropped.
+ */
+
+typedef struct _PublishSpoolSegmentHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved0;
+    uint64_t sequence;
+    uint64_t capacity;
+    uint64_t read_offset;
+    uint8_t reserved[24];
+} PublishSpoolSegmentHeader;
+
+typedef struct _PublishSpoolEntryHeader {
+    uint32_t length;
+    uint32_t crc;
+    uint16_t topic_length;
+    uint16_t reserved;
+} PublishSpoolEntryHeader;
+
+static_assert(sizeof(PublishSpoolSegmentHeader) == 64, "PublishSpoolSegmentHeader must stay 64 bytes");
+
+class PublishSpool {
+public:
+    typedef struct _EntryId {
+        uint64_t sequence;
+        uint64_t offset;
+    } EntryId;
+
+    static const uint64_t DEFAULT_SEGMENT_SIZE;
+
+    PublishSpool(std::string location, uint64_t max_size, uint64_t segment_size = DEFAULT_SEGMENT_SIZE);
+    ~PublishSpool();
+    bool Push(const std::string& topic, const uint8_t* payload, size_t payload_size);
+    bool Front(EntryId& id, std::string& topic, std::vector<uint8_t>& payload);
+    void Pop(const EntryId& id);
+    uint64_t Pending();
+    uint64_t GetDropped();
+
+private:
+    typedef struct _Segment {
+        uint64_t sequence;
+        int fd;
+        uint8_t* data;
+        uint64_t size;
+        uint64_t write_offset;
+        uint64_t entries;
+    } Segment;
+
+    std::string location;
+    uint64_t segment_size;
+    uint64_t max_segments;
+
+    std::mutex mutex;
+    std::deque<Segment> segments;
+    uint64_t pending = 0;
+    uint64_t dropped = 0;
+
+    Segment openSegment(uint64_t sequence, bool create);
+    void closeSegment(Segment& segment, bool remove);
+    void recoverSegment(Segment& segment);
+    void removeConsumedSegments();
+    static PublishSpoolSegmentHeader* header(const Segment& segment);
+};
+
+#endif //__PUBLISH_SPOOL_H__
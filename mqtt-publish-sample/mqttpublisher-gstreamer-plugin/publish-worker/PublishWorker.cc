@@ -0,0 +1,270 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include "PublishWorker.h"
+
+const int PublishWorker::DRAIN_TIMEOUT_IN_SECONDS = 10;
+const int PublishWorker::IDLE_WAIT_IN_MILLISECONDS = 100;
+
+PublishWorker::PublishWorker(PublisherBackend* backend, const Config& config, ResultAggregator* aggregator)
+        : backend(backend), config(config), queue(config.queue_size),
+          serializer(config.payload_format, config.camera_id),
+          aggregator(config.summary_interval > 0 ? aggregator : nullptr), waiting(false), enqueued(0), dropped(0),
+          published(0), failed(0), messages(0), spooled(0), replayed(0), summaries(0) {
+    this->config.max_inflight = std::max(config.max_inflight, 1u);
+    this->config.batch_max = std::max(config.batch_max, 1u);
+    this->config.replay_rate = std::max(config.replay_rate, 1u);
+    batching = this->config.batch_max > 1 || this->config.batch_interval > 0;
+    batch.reserve(std::min((size_t) this->config.batch_max, queue.Capacity()));
+    if (!config.spool_location.empty()) {
+        spool.reset(new PublishSpool(config.spool_location, config.spool_max_size));
+    }
+    next_replay = std::chrono::steady_clock::now();
+    if (this->aggregator) {
+        scheduleSummary();
+    }
+    worker_thread = std::thread(&PublishWorker::run, this);
+}
+
+PublishWorker::~PublishWorker() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        drain_deadline = std::chrono::steady_clock::now() + std::chrono::seconds(DRAIN_TIMEOUT_IN_SECONDS);
+        cv.notify_all();
+    }
+    worker_thread.join();
+}
+
+bool PublishWorker::Enqueue(const PublishRequest& request) {
+    bool queued = queue.TryPush(request);
+    if (!queued && config.overflow_policy == OverflowPolicy::DROP_OLDEST) {
+        PublishRequest oldest;
+        while (!queued) {
+            if (queue.TryPop(oldest)) {
+                dropped++;
+            }
+            queued = queue.TryPush(request);
+        }
+    }
+
+    if (!queued) {
+        dropped++;
+        return false;
+    }
+    enqueued++;
+    if (waiting.load()) {
+        std::lock_guard<std::mutex> lock(mutex);
+        cv.notify_all();
+    }
+    return true;
+}
+
+void PublishWorker::SetTopic(std::string topic) {
+    std::lock_guard<std::mutex> lock(mutex);
+    config.topic = topic;
+}
+
+PublishStats PublishWorker::GetStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return PublishStats{enqueued.load(), dropped.load(), published.load(), failed.load(), messages.load(),
+                        spooled.load(), replayed.load(), spool ? spool->Pending() : 0,
+                        spool ? spool->GetDropped() : 0, inflight, summaries.load()};
+}
+
+void PublishWorker::run() {
+    PublishRequest request;
+    for (;;) {
+        if (queue.TryPop(request)) {
+            if (batch.empty() && config.batch_interval > 0) {
+                batch_deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(config.batch_interval);
+            }
+            batch.push_back(request);
+            if (!batching || batch.size() >= config.batch_max || (config.flush_on_anomaly && request.is_anomalous)) {
+                flushBatch();
+            }
+            continue;
+        }
+
+        if (!batch.empty() && config.batch_interval > 0 && std::chrono::steady_clock::now() >= batch_deadline) {
+            flushBatch();
+        }
+        if (aggregator && std::chrono::steady_clock::now() >= summary_deadline) {
+            publishSummary();
+        }
+        replaySpool();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if (stopping) {
+            if (!batch.empty() || aggregator) {
+                lock.unlock();
+                if (!batch.empty()) {
+                    flushBatch();
+                }
+                if (aggregator) {
+                    publishSummary();
+                }
+                lock.lock();
+            }
+            // Completion callbacks reference this worker, so wait for every outstanding publish
+            cv.wait(lock, [this] { return inflight == 0; });
+            return;
+        }
+        waiting.store(true);
+        if (queue.Empty()) {
+            auto wake_time = std::chrono::steady_clock::now() + std::chrono::milliseconds(IDLE_WAIT_IN_MILLISECONDS);
+            if (!batch.empty() && config.batch_interval > 0) {
+                wake_time = std::min(wake_time, batch_deadline);
+            }
+            if (aggregator) {
+                wake_time = std::min(wake_time, summary_deadline);
+            }
+            if (spool && !replay_inflight && inflight < config.max_inflight && backend->IsConnected()
+                    && spool->Pending() > 0) {
+                wake_time = std::min(wake_time, next_replay);
+            }
+            cv.wait_until(lock, wake_time);
+        }
+        waiting.store(false);
+    }
+}
+
+void PublishWorker::flushBatch() {
+    size_t result_count = batch.size();
+    serializer.Serialize(batch.data(), result_count, batching, payload);
+    batch.clear();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // Assigning only on change keeps the topic's storage, so steady state publishing does not allocate
+        if (publish_topic != config.topic) {
+            publish_topic = config.topic;
+        }
+    }
+    publishPayload(publish_topic, result_count, false);
+}
+
+void PublishWorker::scheduleSummary() {
+    // Windows end on multiples of the interval in wall clock time, so summaries of different cameras line up
+    gint64 interval_us = (gint64) config.summary_interval * 1000;
+    gint64 now_us = g_get_real_time();
+    gint64 next_us = (now_us / interval_us + 1) * interval_us;
+    summary_deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(next_us - now_us);
+}
+
+void PublishWorker::publishSummary() {
+    aggregator->TakeSummary(g_get_real_time(), summary);
+    serializer.SerializeSummary(summary, payload);
+    publishPayload(config.summary_topic, 0, true);
+    scheduleSummary();
+}
+
+/**
+ * Publishes the message in payload, or spools it while the backend is disconnected. result_count results are
+ * accounted as published, failed or dropped with it.
+ */
+void PublishWorker::publishPayload(const std::string& topic, size_t result_count, bool is_summary) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (spool && !backend->IsConnected()) {
+        lock.unlock();
+        if (!spoolPayload(topic, payload.data(), payload.size())) {
+            dropped += result_count;
+        }
+        return;
+    }
+
+    cv.wait(lock, [this] { return inflight < config.max_inflight; });
+    if (stopping && std::chrono::steady_clock::now() >= drain_deadline) {
+        lock.unlock();
+        if (!spool || !spoolPayload(topic, payload.data(), payload.size())) {
+            dropped += result_count;
+        }
+        return;
+    }
+    inflight++;
+    lock.unlock();
+
+    if (!spool) {
+        backend->PublishAsync(topic, payload.data(), payload.size(),
+                              [this, result_count, is_summary](PublisherBackend::OperationStatus status) {
+            onPublishComplete(status, result_count, is_summary);
+        });
+        return;
+    }
+
+    // Keep a copy of the message so it can be spooled if the publish fails
+    std::string copied_topic = topic;
+    std::vector<uint8_t> data = payload;
+    auto on_complete = [this, result_count, is_summary, copied_topic, data](PublisherBackend::OperationStatus status) {
+        if (status != PublisherBackend::OperationStatus::SUCCESSFUL
+                && spoolPayload(copied_topic, data.data(), data.size())) {
+            // Spooled results are published later, so they do not count as failed
+            onPublishComplete(status, 0, false);
+            return;
+        }
+        onPublishComplete(status, result_count, is_summary);
+    };
+    backend->PublishAsync(topic, payload.data(), payload.size(), on_complete);
+}
+
+void PublishWorker::replaySpool() {
+    auto now = std::chrono::steady_clock::now();
+    if (!spool || now < next_replay || !backend->IsConnected()) {
+        return;
+    }
+
+    PublishSpool::EntryId id;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping || replay_inflight || inflight >= config.max_inflight) {
+            return;
+        }
+        if (!spool->Front(id, replay_topic, replay_payload)) {
+            return;
+        }
+        replay_inflight = true;
+        inflight++;
+    }
+    next_replay = now + std::chrono::microseconds(1000000 / config.replay_rate);
+
+    backend->PublishAsync(replay_topic, replay_payload.data(), replay_payload.size(),
+                          [this, id](PublisherBackend::OperationStatus status) {
+        // A failed replay leaves the message at the head of the spool to be retried
+        if (status == PublisherBackend::OperationStatus::SUCCESSFUL) {
+            spool->Pop(id);
+            replayed++;
+            messages++;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        replay_inflight = false;
+        inflight--;
+        cv.notify_all();
+    });
+}
+
+bool PublishWorker::spoolPayload(const std::string& topic, const uint8_t* data, size_t size) {
+    if (!spool->Push(topic, data, size)) {
+        return false;
+    }
+    spooled++;
+    return true;
+}
+
+void PublishWorker::onPublishComplete(PublisherBackend::OperationStatus status, size_t result_count,
+                                      bool is_summary) {
+    if (status == PublisherBackend::OperationStatus::SUCCESSFUL) {
+        published += result_count;
+        messages++;
+        if (is_summary) {
+            summaries++;
+        }
+    } else {
+        failed += result_count;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    inflight--;
+    cv.notify_all();
+}
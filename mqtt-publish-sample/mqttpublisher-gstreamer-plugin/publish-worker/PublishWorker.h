@@ -0,0 +1,133 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __PUBLISH_WORKER_H__
+#define __PUBLISH_WORKER_H__
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gst/gst.h>
+#include "BoundedQueue.h"
+#include "PayloadSerializer.h"
+#include "PublishSpool.h"
+#include "PublisherBackend.h"
+#include "ResultAggregator.h"
+
+typedef struct _PublishStats {
+    guint64 enqueued;
+    guint64 dropped;
+    guint64 published;
+    guint64 failed;
+    guint64 messages;
+    guint64 spooled;
+    guint64 replayed;
+    guint64 spool_pending;
+    guint64 spool_dropped;
+    guint64 inflight;
+    guint64 summaries;
+} PublishStats;
+
+/**
+ * Publishes inference results from a dedicated thread so the streaming thread only pays for an enqueue. Results
+ * wait in a bounded lock-free queue; when it is full the overflow policy decides whether the oldest queued result
+ * or the new one is dropped. Up to max_inflight QoS1 publishes are outstanding at once, each completed by a callback.
+ *
+ * With batching enabled (batch_max > 1 or batch_interval > 0) results are collected and published as one message
+ * once batch_max results are pending, batch_interval milliseconds have passed since the first one, or an anomalous
+ * result arrives and flush_on_anomaly is set.
+ *
+ * With a spool location set, messages are written to a PublishSpool instead of being published while the backend is
+ * disconnected, and so are messages whose publish failed. Once the backend is connected again, spooled messages are
+ * replayed one at a time, at most replay_rate per second, alongside live traffic.
+ *
+ * With an aggregator and a summary interval, a summary of the aggregated results is published to summary_topic at
+ * every multiple of summary_interval milliseconds of wall clock time, and once more when the worker stops.
+ */
+class PublishWorker {
+public:
+    typedef enum _OverflowPolicy {
+        DROP_OLDEST = 0,
+        DROP_NEWEST = 1
+    } OverflowPolicy;
+
+    typedef struct _Config {
+        std::string topic;
+        size_t queue_size;
+        OverflowPolicy overflow_policy;
+        guint max_inflight;
+        guint batch_max;
+        guint batch_interval;
+        bool flush_on_anomaly;
+        PayloadSerializer::Format payload_format;
+        std::string camera_id;
+        std::string spool_location;
+        guint64 spool_max_size;
+        guint replay_rate;
+        guint summary_interval;
+        std::string summary_topic;
+    } Config;
+
+    PublishWorker(PublisherBackend* backend, const Config& config, ResultAggregator* aggregator = nullptr);
+    ~PublishWorker();
+    bool Enqueue(const PublishRequest& request);
+    void SetTopic(std::string topic);
+    PublishStats GetStats();
+
+private:
+    static const int DRAIN_TIMEOUT_IN_SECONDS;
+    static const int IDLE_WAIT_IN_MILLISECONDS;
+
+    PublisherBackend* backend;
+    Config config;
+    bool batching;
+    BoundedQueue<PublishRequest> queue;
+    std::vector<PublishRequest> batch;
+    std::chrono::steady_clock::time_point batch_deadline;
+    PayloadSerializer serializer;
+    std::vector<uint8_t> payload;
+    std::string publish_topic;
+
+    std::unique_ptr<PublishSpool> spool;
+    bool replay_inflight = false;
+    std::chrono::steady_clock::time_point next_replay;
+    std::string replay_topic;
+    std::vector<uint8_t> replay_payload;
+
+    ResultAggregator* aggregator;
+    std::chrono::steady_clock::time_point summary_deadline;
+    ResultSummary summary;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    guint inflight = 0;
+    bool stopping = false;
+    std::chrono::steady_clock::time_point drain_deadline;
+    std::atomic<bool> waiting;
+    std::thread worker_thread;
+
+    std::atomic<guint64> enqueued;
+    std::atomic<guint64> dropped;
+    std::atomic<guint64> published;
+    std::atomic<guint64> failed;
+    std::atomic<guint64> messages;
+    std::atomic<guint64> spooled;
+    std::atomic<guint64> replayed;
+    std::atomic<guint64> summaries;
+
+    void run();
+    void flushBatch();
+    void publishSummary();
+    void publishPayload(const std::string& topic, size_t result_count, bool is_summary);
+    void scheduleSummary();
+    void replaySpool();
+    bool spoolPayload(const std::string& topic, const uint8_t* data, size_t size);
+    void onPublishComplete(PublisherBackend::OperationStatus status, size_t result_count, bool is_summary);
+};
+
+#endif //__PUBLISH_WORKER_H__
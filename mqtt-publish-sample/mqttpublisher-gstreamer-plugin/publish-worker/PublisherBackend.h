@@ -0,0 +1,32 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __PUBLISHER_BACKEND_H__
+#define __PUBLISHER_BACKEND_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+/**
+ * Transport the publish worker hands serialized results to. PublishAsync must copy the payload before returning, and
+ * calls on_complete exactly once, from any thread, when the publish is acknowledged or has failed. It may be called
+ * from several threads at once.
+ */
+class PublisherBackend {
+public:
+    typedef enum _OperationStatus {
+        SUCCESSFUL = 0,
+        FAILED = -1
+    } OperationStatus;
+
+    typedef std::function<void(OperationStatus)> PublishCallback;
+
+    virtual ~PublisherBackend() {}
+    virtual void PublishAsync(const std::string& topic, const uint8_t* payload, size_t payload_size,
+                              PublishCallback on_complete) = 0;
+    virtual bool IsConnected() = 0;
+};
+
+#endif //__PUBLISHER_BACKEND_H__
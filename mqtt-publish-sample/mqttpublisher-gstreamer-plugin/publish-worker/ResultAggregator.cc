@@ -0,0 +1,106 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+#include <cstring>
+#include "ResultAggregator.h"
+
+ResultAggregator::ResultAggregator(gint64 window_start) {
+    reset(window_start);
+}
+
+void ResultAggregator::reset(gint64 window_start) {
+    memset(&current, 0, sizeof(current));
+    current.window_start = window_start;
+    confidence_sum = 0;
+    memset(latency_histogram, 0, sizeof(latency_histogram));
+}
+
+/*
+ * Latencies are bucketed in microseconds: values below LATENCY_SUB_BUCKETS get a bucket each, every octave above is
+ * split into LATENCY_SUB_BUCKETS equal buckets.
+ */
+int ResultAggregator::latencyBucket(guint64 latency_us) {
+    if (latency_us < (guint64) LATENCY_SUB_BUCKETS) {
+        return latency_us;
+    }
+    int octave = 63 - __builtin_clzll(latency_us);
+    int sub_bucket_bits = __builtin_ctz(LATENCY_SUB_BUCKETS);
+    int sub_bucket = (latency_us >> (octave - sub_bucket_bits)) - LATENCY_SUB_BUCKETS;
+    int bucket = (octave - sub_bucket_bits + 1) * LATENCY_SUB_BUCKETS + sub_bucket;
+    return std::min(bucket, LATENCY_OCTAVES * LATENCY_SUB_BUCKETS - 1);
+}
+
+// Midpoint of a bucket in microseconds
+guint64 ResultAggregator::latencyBucketValue(int bucket) {
+    if (bucket < LATENCY_SUB_BUCKETS) {
+        return bucket;
+    }
+    int shift = bucket / LATENCY_SUB_BUCKETS - 1;
+    guint64 lower = (guint64) (LATENCY_SUB_BUCKETS + bucket % LATENCY_SUB_BUCKETS) << shift;
+    return lower + ((1ull << shift) >> 1);
+}
+
+GstClockTime ResultAggregator::latencyPercentile(double fraction) {
+    if (current.results == 0) {
+        return 0;
+    }
+    guint64 rank = std::max<guint64>(1, (guint64) (fraction * current.results + 0.5));
+    guint64 seen = 0;
+    for (int bucket = 0; bucket < LATENCY_OCTAVES * LATENCY_SUB_BUCKETS; bucket++) {
+        seen += latency_histogram[bucket];
+        if (seen >= rank) {
+            return std::min<GstClockTime>(latencyBucketValue(bucket) * GST_USECOND, current.latency_max);
+        }
+    }
+    return current.latency_max;
+}
+
+void ResultAggregator::AddResult(bool is_anomalous, float confidence, GstClockTime inference_latency,
+                                 const std::string& model) {
+    int confidence_bin = std::min(std::max((int) (confidence * SUMMARY_CONFIDENCE_BINS), 0),
+                                  SUMMARY_CONFIDENCE_BINS - 1);
+    int latency_bucket = latencyBucket(inference_latency / GST_USECOND);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    current.frames++;
+    current.results++;
+    if (is_anomalous) {
+        current.anomalies++;
+    }
+    current.confidence_histogram[confidence_bin]++;
+    confidence_sum += confidence;
+    latency_histogram[latency_bucket]++;
+    current.latency_max = std::max(current.latency_max, inference_latency);
+    if (model.compare(current.model) != 0) {
+        strncpy(current.model, model.c_str(), sizeof(current.model) - 1);
+    }
+}
+
+void ResultAggregator::AddFailure() {
+    std::lock_guard<std::mutex> lock(mutex);
+    current.frames++;
+    current.failures++;
+}
+
+void ResultAggregator::AddTimeout() {
+    std::lock_guard<std::mutex> lock(mutex);
+    current.frames++;
+    current.timeouts++;
+}
+
+void ResultAggregator::AddDroppedFrames(guint64 frames) {
+    std::lock_guard<std::mutex> lock(mutex);
+    current.dropped_frames += frames;
+}
+
+void ResultAggregator::TakeSummary(gint64 window_end, ResultSummary& summary) {
+    std::lock_guard<std::mutex> lock(mutex);
+    current.window_end = window_end;
+    current.confidence_mean = current.results > 0 ? confidence_sum / current.results : 0;
+    current.latency_p50 = latencyPercentile(0.5);
+    current.latency_p90 = latencyPercentile(0.9);
+    current.latency_p99 = latencyPercentile(0.99);
+    summary = current;
+    reset(window_end);
+}
@@ -0,0 +1,66 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __RESULT_AGGREGATOR_H__
+#define __RESULT_AGGREGATOR_H__
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <gst/gst.h>
+
+#define SUMMARY_CONFIDENCE_BINS 20
+#define SUMMARY_MODEL_SIZE 32
+
+typedef struct _ResultSummary {
+    // Microseconds since the Unix epoch
+    gint64 window_start;
+    gint64 window_end;
+    guint64 frames;
+    guint64 results;
+    guint64 anomalies;
+    guint64 failures;
+    guint64 timeouts;
+    guint64 dropped_frames;
+    // Results per confidence range of 1 / SUMMARY_CONFIDENCE_BINS, the last bin includes 1.0
+    guint64 confidence_histogram[SUMMARY_CONFIDENCE_BINS];
+    float confidence_mean;
+    // Inference latency in nanoseconds, 0 without results
+    GstClockTime latency_p50;
+    GstClockTime latency_p90;
+    GstClockTime latency_p99;
+    GstClockTime latency_max;
+    char model[SUMMARY_MODEL_SIZE];
+} ResultSummary;
+
+/**
+ * Accumulates inference results of one camera into constant size sketches until a summary is taken: counts of
+ * frames, anomalies, failed and timed out inferences and dropped frames, a fixed histogram of confidences and a log-linear histogram
+ * of inference latencies. Latency percentiles are accurate to within 1 / LATENCY_SUB_BUCKETS of the true value.
+ * Results are added from the streaming thread while summaries are taken from the publish worker.
+ */
+class ResultAggregator {
+public:
+    static const int LATENCY_SUB_BUCKETS = 16;
+    static const int LATENCY_OCTAVES = 32;
+
+    ResultAggregator(gint64 window_start);
+    void AddResult(bool is_anomalous, float confidence, GstClockTime inference_latency, const std::string& model);
+    void AddFailure();
+    void AddTimeout();
+    void AddDroppedFrames(guint64 frames);
+    void TakeSummary(gint64 window_end, ResultSummary& summary);
+
+private:
+    std::mutex mutex;
+    ResultSummary current;
+    double confidence_sum;
+    uint32_t latency_histogram[LATENCY_OCTAVES * LATENCY_SUB_BUCKETS];
+
+    void reset(gint64 window_start);
+    GstClockTime latencyPercentile(double fraction);
+    static int latencyBucket(guint64 latency_us);
+    static guint64 latencyBucketValue(int bucket);
+};
+
+#endif //__RESULT_AGGREGATOR_H__
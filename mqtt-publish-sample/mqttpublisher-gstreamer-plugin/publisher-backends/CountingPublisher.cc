@@ -0,0 +1,23 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "CountingPublisher.h"
+
+void CountingPublisher::PublishAsync(const std::string& topic, const uint8_t* payload, size_t payload_size,
+                                     PublishCallback on_complete) {
+    messages.fetch_add(1, std::memory_order_relaxed);
+    bytes.fetch_add(payload_size, std::memory_order_relaxed);
+    on_complete(OperationStatus::SUCCESSFUL);
+}
+
+bool CountingPublisher::IsConnected() {
+    return true;
+}
+
+uint64_t CountingPublisher::GetMessages() {
+    return messages.load(std::memory_order_relaxed);
+}
+
+uint64_t CountingPublisher::GetBytes() {
+    return bytes.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,27 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __COUNTING_PUBLISHER_H__
+#define __COUNTING_PUBLISHER_H__
+
+#include <atomic>
+#include "publish-worker/PublisherBackend.h"
+
+/**
+ * Sink that only counts what it is given. Every publish succeeds immediately, which makes it a baseline for the cost
+ * of the element and the publish worker themselves.
+ */
+class CountingPublisher : public PublisherBackend {
+public:
+    void PublishAsync(const std::string& topic, const uint8_t* payload, size_t payload_size,
+                      PublishCallback on_complete) override;
+    bool IsConnected() override;
+    uint64_t GetMessages();
+    uint64_t GetBytes();
+
+private:
+    std::atomic<uint64_t> messages{0};
+    std::atomic<uint64_t> bytes{0};
+};
+
+#endif //__COUNTING_PUBLISHER_H__
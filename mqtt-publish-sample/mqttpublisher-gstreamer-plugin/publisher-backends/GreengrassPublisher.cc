@@ -0,0 +1,25 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "GreengrassPublisher.h"
+
+GreengrassPublisher::GreengrassPublisher(Destination destination, int event_loop_threads)
+        : destination(destination), client(GreengrassClient::Acquire(event_loop_threads)) {
+}
+
+GreengrassPublisher::~GreengrassPublisher() {
+    GreengrassClient::Release(client);
+}
+
+void GreengrassPublisher::PublishAsync(const std::string& topic, const uint8_t* payload, size_t payload_size,
+                                       PublishCallback on_complete) {
+    if (destination == Destination::LOCAL) {
+        client->PublishToTopicAsync(topic, payload, payload_size, on_complete);
+    } else {
+        client->PublishToIoTCoreAsync(topic, payload, payload_size, on_complete);
+    }
+}
+
+bool GreengrassPublisher::IsConnected() {
+    return client->IsConnected();
+}
@@ -0,0 +1,32 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __GREENGRASS_PUBLISHER_H__
+#define __GREENGRASS_PUBLISHER_H__
+
+#include "greengrass-client/GreengrassClient.h"
+#include "publish-worker/PublisherBackend.h"
+
+/**
+ * Publishes through the process wide GreengrassClient, either to AWS IoT Core or to the local publish/subscribe
+ * broker of Greengrass Core. The shared client is acquired for the lifetime of the publisher.
+ */
+class GreengrassPublisher : public PublisherBackend {
+public:
+    typedef enum _Destination {
+        IOT_CORE = 0,
+        LOCAL = 1
+    } Destination;
+
+    GreengrassPublisher(Destination destination, int event_loop_threads);
+    ~GreengrassPublisher();
+    void PublishAsync(const std::string& topic, const uint8_t* payload, size_t payload_size,
+                      PublishCallback on_complete) override;
+    bool IsConnected() override;
+
+private:
+    Destination destination;
+    GreengrassClient* client;
+};
+
+#endif //__GREENGRASS_PUBLISHER_H__
@@ -0,0 +1,119 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "UnixSocketPublisher.h"
+
+const int UnixSocketPublisher::RECONNECT_INTERVAL_IN_MILLISECONDS = 1000;
+
+static void writeBigEndian32(uint8_t* buffer, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        buffer[i] = value >> (24 - i * 8);
+    }
+}
+
+UnixSocketPublisher::UnixSocketPublisher(std::string socket_path)
+        : socket_path(socket_path), next_connect(std::chrono::steady_clock::now()) {
+}
+
+UnixSocketPublisher::~UnixSocketPublisher() {
+    disconnect();
+}
+
+bool UnixSocketPublisher::ensureConnected() {
+    if (socket_fd >= 0) {
+        return true;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (now < next_connect) {
+        return false;
+    }
+    next_connect = now + std::chrono::milliseconds(RECONNECT_INTERVAL_IN_MILLISECONDS);
+
+    struct sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Unix socket path too long: " << socket_path << std::endl;
+        return false;
+    }
+    strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        std::cerr << "Failed to create unix socket: " << strerror(errno) << std::endl;
+        return false;
+    }
+    if (connect(fd, (struct sockaddr*) &address, sizeof(address)) != 0) {
+        std::cerr << "Failed to connect to " << socket_path << ": " << strerror(errno) << std::endl;
+        close(fd);
+        return false;
+    }
+    socket_fd = fd;
+    return true;
+}
+
+void UnixSocketPublisher::disconnect() {
+    if (socket_fd >= 0) {
+        close(socket_fd);
+        socket_fd = -1;
+    }
+}
+
+void UnixSocketPublisher::PublishAsync(const std::string& topic, const uint8_t* payload, size_t payload_size,
+                                       PublishCallback on_complete) {
+    OperationStatus status = OperationStatus::FAILED;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (ensureConnected()) {
+            uint8_t header[8];
+            writeBigEndian32(header, topic.size());
+            writeBigEndian32(header + 4, payload_size);
+            struct iovec frame[3] = {
+                {header, sizeof(header)},
+                {(void*) topic.data(), topic.size()},
+                {(void*) payload, payload_size}
+            };
+
+            struct msghdr message = {};
+            message.msg_iov = frame;
+            message.msg_iovlen = 3;
+            while (message.msg_iovlen > 0) {
+                ssize_t written = sendmsg(socket_fd, &message, MSG_NOSIGNAL);
+                if (written < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (written < 0) {
+                    break;
+                }
+                // Skip what a partial write already sent
+                while (message.msg_iovlen > 0 && (size_t) written >= message.msg_iov->iov_len) {
+                    written -= message.msg_iov->iov_len;
+                    message.msg_iov++;
+                    message.msg_iovlen--;
+                }
+                if (message.msg_iovlen > 0) {
+                    message.msg_iov->iov_base = (uint8_t*) message.msg_iov->iov_base + written;
+                    message.msg_iov->iov_len -= written;
+                }
+            }
+            if (message.msg_iovlen == 0) {
+                status = OperationStatus::SUCCESSFUL;
+            } else {
+                std::cerr << "Failed to write to " << socket_path << ": " << strerror(errno) << std::endl;
+                disconnect();
+            }
+        }
+    }
+    on_complete(status);
+}
+
+bool UnixSocketPublisher::IsConnected() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return ensureConnected();
+}
@@ -0,0 +1,38 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __UNIX_SOCKET_PUBLISHER_H__
+#define __UNIX_SOCKET_PUBLISHER_H__
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include "publish-worker/PublisherBackend.h"
+
+/**
+ * Writes messages to a unix stream socket, standing in for a broker during development and benchmarking. Each
+ * message is framed as the big endian 32 bit topic length, the big endian 32 bit payload length, the topic and the
+ * payload. A publish completes once the frame is written; a failed write closes the socket and it is reconnected at
+ * most once per RECONNECT_INTERVAL_IN_MILLISECONDS.
+ */
+class UnixSocketPublisher : public PublisherBackend {
+public:
+    UnixSocketPublisher(std::string socket_path);
+    ~UnixSocketPublisher();
+    void PublishAsync(const std::string& topic, const uint8_t* payload, size_t payload_size,
+                      PublishCallback on_complete) override;
+    bool IsConnected() override;
+
+private:
+    static const int RECONNECT_INTERVAL_IN_MILLISECONDS;
+
+    std::string socket_path;
+    std::mutex mutex;
+    int socket_fd = -1;
+    std::chrono::steady_clock::time_point next_connect;
+
+    bool ensureConnected();
+    void disconnect();
+};
+
+#endif //__UNIX_SOCKET_PUBLISHER_H__
@@ -0,0 +1,168 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <jpeglib.h>
+#include "JpegThumbnail.h"
+
+// Samples read per box axis; larger boxes are subsampled so scaling cost does not grow with the frame size
+static const unsigned int MAX_BOX_SAMPLES = 4;
+
+const int JpegThumbnail::MIN_QUALITY = 20;
+
+typedef struct _JpegErrorManager {
+    struct jpeg_error_mgr manager;
+    jmp_buf jump_buffer;
+} JpegErrorManager;
+
+// libjpeg exits the process on errors by default
+static void jpegErrorExit(j_common_ptr info) {
+    char message[JMSG_LENGTH_MAX];
+    (*info->err->format_message)(info, message);
+    std::cerr << "Failed to encode thumbnail: " << message << std::endl;
+    longjmp(((JpegErrorManager*) info->err)->jump_buffer, 1);
+}
+
+static uint8_t expandRange(unsigned int value, int component) {
+    int expanded = component == 0 ? ((int) value - 16) * 255 / 219 : ((int) value - 128) * 255 / 224 + 128;
+    return std::min(std::max(expanded, 0), 255);
+}
+
+/*
+ * Only holds trivially destructible locals, as an error longjmps out of it. The encoded image is malloc'd by libjpeg
+ * and returned in output.
+ */
+static bool compress(const uint8_t* pixels, unsigned int width, unsigned int height, int components,
+                     J_COLOR_SPACE color_space, int quality, const std::string& comment, unsigned char** output,
+                     unsigned long* output_size) {
+    struct jpeg_compress_struct info;
+    JpegErrorManager error_manager;
+    info.err = jpeg_std_error(&error_manager.manager);
+    error_manager.manager.error_exit = jpegErrorExit;
+    if (setjmp(error_manager.jump_buffer)) {
+        jpeg_destroy_compress(&info);
+        return false;
+    }
+
+    jpeg_create_compress(&info);
+    jpeg_mem_dest(&info, output, output_size);
+    info.image_width = width;
+    info.image_height = height;
+    info.input_components = components;
+    info.in_color_space = color_space;
+    jpeg_set_defaults(&info);
+    jpeg_set_quality(&info, quality, TRUE);
+    jpeg_start_compress(&info, TRUE);
+    if (!comment.empty()) {
+        jpeg_write_marker(&info, JPEG_COM, (const JOCTET*) comment.data(), comment.size());
+    }
+    while (info.next_scanline < info.image_height) {
+        JSAMPROW row = (JSAMPROW) pixels + (size_t) info.next_scanline * width * components;
+        jpeg_write_scanlines(&info, &row, 1);
+    }
+    jpeg_finish_compress(&info);
+    jpeg_destroy_compress(&info);
+    return true;
+}
+
+static int componentCount(const ThumbnailSource& source) {
+    return source.color_space == ThumbnailSource::ColorSpace::GRAY ? 1 : 3;
+}
+
+JpegThumbnail::JpegThumbnail(const Config& config) : config(config) {
+}
+
+void JpegThumbnail::ScaledSize(unsigned int width, unsigned int height, unsigned int max_width,
+                               unsigned int max_height, unsigned int& scaled_width, unsigned int& scaled_height) {
+    scaled_width = width;
+    scaled_height = height;
+    if (width > max_width || height > max_height) {
+        // Whichever side is the tighter fit sets the scale
+        if ((uint64_t) width * max_height >= (uint64_t) height * max_width) {
+            scaled_width = max_width;
+            scaled_height = (uint64_t) height * max_width / width;
+        } else {
+            scaled_height = max_height;
+            scaled_width = (uint64_t) width * max_height / height;
+        }
+    }
+    scaled_width = std::max(scaled_width, 1u);
+    scaled_height = std::max(scaled_height, 1u);
+}
+
+void JpegThumbnail::scale(const ThumbnailSource& source, unsigned int width, unsigned int height) {
+    int components = componentCount(source);
+    pixels.resize((size_t) width * height * components);
+    uint8_t* output = pixels.data();
+    for (unsigned int y = 0; y < height; y++) {
+        unsigned int y0 = (uint64_t) y * source.height / height;
+        unsigned int y1 = std::max<unsigned int>((uint64_t) (y + 1) * source.height / height, y0 + 1);
+        unsigned int y_step = std::max((y1 - y0) / MAX_BOX_SAMPLES, 1u);
+        for (unsigned int x = 0; x < width; x++) {
+            unsigned int x0 = (uint64_t) x * source.width / width;
+            unsigned int x1 = std::max<unsigned int>((uint64_t) (x + 1) * source.width / width, x0 + 1);
+            unsigned int x_step = std::max((x1 - x0) / MAX_BOX_SAMPLES, 1u);
+            for (int c = 0; c < components; c++) {
+                unsigned int sum = 0;
+                unsigned int count = 0;
+                for (unsigned int sy = y0; sy < y1; sy += y_step) {
+                    const uint8_t* row = source.data[c] + (size_t) (sy >> source.y_shift[c]) * source.stride[c];
+                    for (unsigned int sx = x0; sx < x1; sx += x_step) {
+                        sum += row[(size_t) (sx >> source.x_shift[c]) * source.pixel_stride[c]];
+                        count++;
+                    }
+                }
+                unsigned int value = (sum + count / 2) / count;
+                *output++ = source.limited_range ? expandRange(value, c) : value;
+            }
+        }
+    }
+}
+
+bool JpegThumbnail::encode(const ThumbnailSource& source, unsigned int width, unsigned int height, int quality,
+                           const std::string& comment, std::vector<uint8_t>& jpeg) {
+    J_COLOR_SPACE color_space = JCS_RGB;
+    if (source.color_space == ThumbnailSource::ColorSpace::YCBCR) {
+        color_space = JCS_YCbCr;
+    } else if (source.color_space == ThumbnailSource::ColorSpace::GRAY) {
+        color_space = JCS_GRAYSCALE;
+    }
+
+    unsigned char* output = NULL;
+    unsigned long output_size = 0;
+    bool encoded = compress(pixels.data(), width, height, componentCount(source), color_space, quality, comment,
+                            &output, &output_size);
+    if (encoded) {
+        jpeg.assign(output, output + output_size);
+    }
+    free(output);
+    return encoded;
+}
+
+bool JpegThumbnail::Create(const ThumbnailSource& source, const std::string& comment, std::vector<uint8_t>& jpeg) {
+    if (source.width == 0 || source.height == 0) {
+        return false;
+    }
+    unsigned int width, height;
+    ScaledSize(source.width, source.height, config.max_width, config.max_height, width, height);
+    scale(source, width, height);
+
+    int quality = std::min(std::max(config.quality, MIN_QUALITY), 100);
+    for (;;) {
+        if (!encode(source, width, height, quality, comment, jpeg)) {
+            return false;
+        }
+        if (config.max_size == 0 || jpeg.size() <= config.max_size) {
+            return true;
+        }
+        if (quality == MIN_QUALITY) {
+            return false;
+        }
+        // Size falls roughly linearly with quality in the range that matters here
+        quality = std::max(MIN_QUALITY, quality * 2 / 3);
+    }
+}
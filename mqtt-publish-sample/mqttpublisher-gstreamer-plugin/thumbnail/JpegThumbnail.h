@@ -0,0 +1,67 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __JPEG_THUMBNAIL_H__
+#define __JPEG_THUMBNAIL_H__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define THUMBNAIL_MAX_COMPONENTS 3
+
+/**
+ * Frame the thumbnail is made from, described per component so packed, planar and semi-planar 8 bit layouts are read
+ * the same way: the sample of component c for pixel (x, y) is at
+ * data[c] + (y >> y_shift[c]) * stride[c] + (x >> x_shift[c]) * pixel_stride[c].
+ */
+typedef struct _ThumbnailSource {
+    typedef enum _ColorSpace {
+        RGB = 0,
+        YCBCR = 1,
+        GRAY = 2
+    } ColorSpace;
+
+    unsigned int width;
+    unsigned int height;
+    ColorSpace color_space;
+    // Y in 16-235 and Cb/Cr in 16-240, as is usual for video, rather than the full range JPEG expects
+    bool limited_range;
+    const uint8_t* data[THUMBNAIL_MAX_COMPONENTS];
+    int stride[THUMBNAIL_MAX_COMPONENTS];
+    int pixel_stride[THUMBNAIL_MAX_COMPONENTS];
+    int x_shift[THUMBNAIL_MAX_COMPONENTS];
+    int y_shift[THUMBNAIL_MAX_COMPONENTS];
+} ThumbnailSource;
+
+/**
+ * Downscales a frame with a box filter to fit max_width x max_height, keeping its aspect ratio, and encodes it as a
+ * JPEG. If the image exceeds max_size it is encoded again at lower quality; Create fails if even MIN_QUALITY does
+ * not fit. The scaled pixels are kept between calls, so an instance should be reused by one thread at a time.
+ */
+class JpegThumbnail {
+public:
+    typedef struct _Config {
+        unsigned int max_width;
+        unsigned int max_height;
+        int quality;
+        size_t max_size;
+    } Config;
+
+    static const int MIN_QUALITY;
+
+    JpegThumbnail(const Config& config);
+    bool Create(const ThumbnailSource& source, const std::string& comment, std::vector<uint8_t>& jpeg);
+    static void ScaledSize(unsigned int width, unsigned int height, unsigned int max_width, unsigned int max_height,
+                           unsigned int& scaled_width, unsigned int& scaled_height);
+
+private:
+    Config config;
+    std::vector<uint8_t> pixels;
+
+    void scale(const ThumbnailSource& source, unsigned int width, unsigned int height);
+    bool encode(const ThumbnailSource& source, unsigned int width, unsigned int height, int quality,
+                const std::string& comment, std::vector<uint8_t>& jpeg);
+};
+
+#endif //__JPEG_THUMBNAIL_H__
@@ -0,0 +1,123 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include "ThumbnailPublisher.h"
+
+ThumbnailPublisher::ThumbnailPublisher(PublisherBackend* backend, const Config& config)
+        : backend(backend), config(config), published(0), failed(0), skipped(0) {
+    this->config.threads = std::max(config.threads, 1u);
+    this->config.max_pending = std::max(config.max_pending, this->config.threads);
+    thread_pool = g_thread_pool_new(encodeJob, this, this->config.threads, FALSE, NULL);
+}
+
+ThumbnailPublisher::~ThumbnailPublisher() {
+    // Runs the queued jobs, then waits for their publishes, whose callbacks reference this publisher
+    g_thread_pool_free(thread_pool, FALSE, TRUE);
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this] { return pending == 0; });
+}
+
+/**
+ * 8 bit RGB, YUV and gray formats without a palette or tiling are read directly, which covers the formats decoders
+ * and cameras usually produce.
+ */
+bool ThumbnailPublisher::IsSupported(const GstVideoInfo* info) {
+    const GstVideoFormatInfo* format_info = info->finfo;
+    if (!format_info || GST_VIDEO_FORMAT_INFO_FORMAT(format_info) == GST_VIDEO_FORMAT_UNKNOWN
+            || GST_VIDEO_FORMAT_INFO_FORMAT(format_info) == GST_VIDEO_FORMAT_ENCODED
+            || GST_VIDEO_FORMAT_INFO_HAS_PALETTE(format_info) || GST_VIDEO_FORMAT_INFO_IS_TILED(format_info)) {
+        return false;
+    }
+    for (guint c = 0; c < GST_VIDEO_FORMAT_INFO_N_COMPONENTS(format_info); c++) {
+        if (GST_VIDEO_FORMAT_INFO_DEPTH(format_info, c) != 8 || GST_VIDEO_FORMAT_INFO_SHIFT(format_info, c) != 0) {
+            return false;
+        }
+    }
+    return GST_VIDEO_FORMAT_INFO_IS_RGB(format_info) || GST_VIDEO_FORMAT_INFO_IS_YUV(format_info)
+            || GST_VIDEO_FORMAT_INFO_IS_GRAY(format_info);
+}
+
+bool ThumbnailPublisher::Submit(GstBuffer* buffer, const GstVideoInfo* info, guint64 frame_id,
+                                gint64 monotonic_time_us) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (monotonic_time_us < next_thumbnail_us || pending >= config.max_pending) {
+            skipped++;
+            return false;
+        }
+        next_thumbnail_us = monotonic_time_us + (gint64) config.min_interval * 1000;
+        pending++;
+    }
+
+    ThumbnailJob* job = new ThumbnailJob{gst_buffer_ref(buffer), *info, frame_id};
+    g_thread_pool_push(thread_pool, job, NULL);
+    return true;
+}
+
+ThumbnailStats ThumbnailPublisher::GetStats() {
+    return ThumbnailStats{published.load(), failed.load(), skipped.load()};
+}
+
+void ThumbnailPublisher::encodeJob(gpointer data, gpointer user_data) {
+    ((ThumbnailPublisher*) user_data)->encode((ThumbnailJob*) data);
+}
+
+void ThumbnailPublisher::encode(ThumbnailJob* job) {
+    GstVideoFrame frame;
+    std::vector<uint8_t> jpeg;
+    bool created = false;
+    if (gst_video_frame_map(&frame, &job->info, job->buffer, GST_MAP_READ)) {
+        const GstVideoFormatInfo* format_info = job->info.finfo;
+        ThumbnailSource source = {};
+        source.width = GST_VIDEO_FRAME_WIDTH(&frame);
+        source.height = GST_VIDEO_FRAME_HEIGHT(&frame);
+        if (GST_VIDEO_FORMAT_INFO_IS_GRAY(format_info)) {
+            source.color_space = ThumbnailSource::ColorSpace::GRAY;
+        } else if (GST_VIDEO_FORMAT_INFO_IS_YUV(format_info)) {
+            source.color_space = ThumbnailSource::ColorSpace::YCBCR;
+        } else {
+            source.color_space = ThumbnailSource::ColorSpace::RGB;
+        }
+        source.limited_range = !GST_VIDEO_FORMAT_INFO_IS_RGB(format_info)
+                && job->info.colorimetry.range != GST_VIDEO_COLOR_RANGE_0_255;
+        for (guint c = 0; c < std::min<guint>(GST_VIDEO_FRAME_N_COMPONENTS(&frame), THUMBNAIL_MAX_COMPONENTS); c++) {
+            source.data[c] = (const uint8_t*) GST_VIDEO_FRAME_COMP_DATA(&frame, c);
+            source.stride[c] = GST_VIDEO_FRAME_COMP_STRIDE(&frame, c);
+            source.pixel_stride[c] = GST_VIDEO_FRAME_COMP_PSTRIDE(&frame, c);
+            source.x_shift[c] = GST_VIDEO_FORMAT_INFO_W_SUB(format_info, c);
+            source.y_shift[c] = GST_VIDEO_FORMAT_INFO_H_SUB(format_info, c);
+        }
+
+        gchar* comment = g_strdup_printf("camera_id=%s frame_id=%" G_GUINT64_FORMAT " pts=%" G_GUINT64_FORMAT,
+                                         config.camera_id.c_str(), job->frame_id, GST_BUFFER_PTS(job->buffer));
+        JpegThumbnail thumbnail(config.jpeg);
+        created = thumbnail.Create(source, comment, jpeg);
+        g_free(comment);
+        gst_video_frame_unmap(&frame);
+    }
+    gst_buffer_unref(job->buffer);
+    delete job;
+
+    if (!created) {
+        skipped++;
+        finishJob();
+        return;
+    }
+    backend->PublishAsync(config.topic, jpeg.data(), jpeg.size(), [this](PublisherBackend::OperationStatus status) {
+        if (status == PublisherBackend::OperationStatus::SUCCESSFUL) {
+            published++;
+        } else {
+            failed++;
+        }
+        finishJob();
+    });
+}
+
+void ThumbnailPublisher::finishJob() {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending--;
+    cv.notify_all();
+}
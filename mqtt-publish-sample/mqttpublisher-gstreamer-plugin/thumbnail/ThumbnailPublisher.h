@@ -0,0 +1,73 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __THUMBNAIL_PUBLISHER_H__
+#define __THUMBNAIL_PUBLISHER_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <gst/gst.h>
+#include <gst/video/video.h>
+#include "publish-worker/PublisherBackend.h"
+#include "JpegThumbnail.h"
+
+typedef struct _ThumbnailStats {
+    guint64 published;
+    guint64 failed;
+    guint64 skipped;
+} ThumbnailStats;
+
+/**
+ * Publishes JPEG thumbnails of frames to a companion topic. Submit only takes a reference on the buffer; mapping,
+ * scaling and encoding happen on a GThreadPool. A thumbnail is skipped when one was submitted less than
+ * min_interval milliseconds ago, when max_pending thumbnails are already waiting or being published, or when it
+ * cannot be made to fit max_size.
+ *
+ * Thumbnails are best effort and are neither queued by the publish worker nor spooled. Each carries a JPEG comment
+ * with the camera id, frame id and PTS of its frame so it can be matched with the published result.
+ */
+class ThumbnailPublisher {
+public:
+    typedef struct _Config {
+        std::string topic;
+        std::string camera_id;
+        JpegThumbnail::Config jpeg;
+        guint min_interval;
+        guint threads;
+        guint max_pending;
+    } Config;
+
+    ThumbnailPublisher(PublisherBackend* backend, const Config& config);
+    ~ThumbnailPublisher();
+    bool Submit(GstBuffer* buffer, const GstVideoInfo* info, guint64 frame_id, gint64 monotonic_time_us);
+    ThumbnailStats GetStats();
+    static bool IsSupported(const GstVideoInfo* info);
+
+private:
+    typedef struct _ThumbnailJob {
+        GstBuffer* buffer;
+        GstVideoInfo info;
+        guint64 frame_id;
+    } ThumbnailJob;
+
+    PublisherBackend* backend;
+    Config config;
+    GThreadPool* thread_pool;
+    gint64 next_thumbnail_us = 0;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    guint pending = 0;
+
+    std::atomic<guint64> published;
+    std::atomic<guint64> failed;
+    std::atomic<guint64> skipped;
+
+    static void encodeJob(gpointer data, gpointer user_data);
+    void encode(ThumbnailJob* job);
+    void finishJob();
+};
+
+#endif //__THUMBNAIL_PUBLISHER_H__
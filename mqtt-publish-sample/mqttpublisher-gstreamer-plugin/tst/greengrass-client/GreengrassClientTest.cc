@@ -0,0 +1,71 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <gst/gst.h>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <string>
+#include <unistd.h>
+#include "greengrass-client/GreengrassClient.h"
+
+/*
+ * Runs without Greengrass Core: the IPC socket points at a path nobody listens on, so every connection attempt
+ * fails. This covers sharing the client and tearing it down while it is connecting or reconnecting.
+ */
+class GreengrassClientTest : public testing::Test {
+protected:
+    void SetUp() override {
+        std::string path = "/tmp/greengrass-client-" + std::to_string(getpid()) + ".sock";
+        unlink(path.c_str());
+        setenv("AWS_GG_NUCLEUS_DOMAIN_SOCKET_FILEPATH_FOR_COMPONENT", path.c_str(), 1);
+        setenv("SVCUID", "test", 1);
+    }
+};
+
+TEST_F(GreengrassClientTest, shares_one_client_test) {
+    GreengrassClient* client = GreengrassClient::Acquire(1);
+    ASSERT_NE(client, nullptr);
+    ASSERT_EQ(GreengrassClient::Acquire(2), client);
+    GreengrassClient::Release(client);
+    GreengrassClient::Release(client);
+
+    // Releasing an unknown client is ignored
+    client = GreengrassClient::Acquire(1);
+    GreengrassClient::Release(nullptr);
+    GreengrassClient::Release(client);
+}
+
+TEST_F(GreengrassClientTest, fails_publish_without_core_test) {
+    GreengrassClient* client = GreengrassClient::Acquire(1);
+    std::promise<GreengrassClient::OperationStatus> completed;
+    std::string payload = "payload";
+    client->PublishToTopicAsync("topic", (const uint8_t*) payload.data(), payload.size(),
+                                [&](GreengrassClient::OperationStatus status) { completed.set_value(status); });
+    auto status = completed.get_future();
+    ASSERT_EQ(status.wait_for(std::chrono::seconds(15)), std::future_status::ready);
+    ASSERT_EQ(status.get(), GreengrassClient::OperationStatus::FAILED);
+    ASSERT_FALSE(client->IsConnected());
+    GreengrassClient::Release(client);
+}
+
+TEST_F(GreengrassClientTest, release_while_connecting_test) {
+    for (int i = 0; i < 10; i++) {
+        GreengrassClient* client = GreengrassClient::Acquire(1);
+        // Starts a connection attempt on the connection thread
+        client->IsConnected();
+        auto start = std::chrono::steady_clock::now();
+        GreengrassClient::Release(client);
+        ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(10));
+    }
+}
+
+int main(int argc, char *argv[]) {
+    gst_init(&argc, &argv);
+
+    testing::InitGoogleTest();
+    RUN_ALL_TESTS();
+
+    return 0;
+}
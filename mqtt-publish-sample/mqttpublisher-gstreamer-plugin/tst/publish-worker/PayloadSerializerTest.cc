@@ -0,0 +1,229 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <gst/gst.h>
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "publish-worker/PayloadSerializer.h"
+
+/*
+ * The golden CBOR and protobuf bytes below were checked with independent decoders: protoc --decode against
+ * inference_result.proto, and an RFC 8949 decoder for CBOR. Heads and tags are written in hex, strings as text.
+ */
+
+/* Bytes from hex digits, spaces ignored */
+static std::string hex(const char* digits) {
+    std::string bytes;
+    for (const char* c = digits; *c; c++) {
+        if (*c == ' ') {
+            continue;
+        }
+        unsigned int byte;
+        sscanf(c, "%2x", &byte);
+        bytes.push_back((char) byte);
+        c++;
+    }
+    return bytes;
+}
+
+/* Renders bytes as hex so that a mismatch shows where the payloads differ */
+static std::string toHex(const std::string& bytes) {
+    std::string digits;
+    char byte[3];
+    for (unsigned char c : bytes) {
+        snprintf(byte, sizeof(byte), "%02x", c);
+        digits += byte;
+    }
+    return digits;
+}
+
+static std::string toHex(const std::vector<uint8_t>& buffer) {
+    return toHex(std::string(buffer.begin(), buffer.end()));
+}
+
+static std::string toString(const std::vector<uint8_t>& buffer) {
+    return std::string(buffer.begin(), buffer.end());
+}
+
+class PayloadSerializerTest : public testing::Test {
+protected:
+    // Frame 42 is anomalous and needs every integer width; frame 43 has no PTS and a negative wall time
+    PublishRequest requests[2] = {
+            {42, 1500000000, 1700000000123456, 25000000, true, 0.75f, "SampleModel"},
+            {43, GST_CLOCK_TIME_NONE, -1, 300, false, 0.5f, "M"}
+    };
+    std::vector<uint8_t> buffer;
+
+    const std::string json_42 = "{\"camera_id\":\"cam-1\",\"frame_id\":42,\"pts\":1500000000,"
+                                "\"wall_time\":1700000000123456,\"model\":\"SampleModel\","
+                                "\"inference_latency\":25000000,\"is_anomalous\":true,\"confidence\":0.750000}";
+    const std::string json_43 = "{\"camera_id\":\"cam-1\",\"frame_id\":43,\"pts\":null,\"wall_time\":-1,"
+                                "\"model\":\"M\",\"inference_latency\":300,\"is_anomalous\":false,"
+                                "\"confidence\":0.500000}";
+
+    // Map of 8 pairs
+    const std::string cbor_42 = hex("a8") + hex("69") + "camera_id" + hex("65") + "cam-1"
+                                + hex("68") + "frame_id" + hex("18 2a")
+                                + hex("63") + "pts" + hex("1a 59682f00")
+                                + hex("69") + "wall_time" + hex("1b 00060a2418202240")
+                                + hex("65") + "model" + hex("6b") + "SampleModel"
+                                + hex("71") + "inference_latency" + hex("1a 017d7840")
+                                + hex("6c") + "is_anomalous" + hex("f5")
+                                + hex("6a") + "confidence" + hex("fa 3f400000");
+    // null PTS, -1 as major type 1, a two byte unsigned and false
+    const std::string cbor_43 = hex("a8") + hex("69") + "camera_id" + hex("65") + "cam-1"
+                                + hex("68") + "frame_id" + hex("18 2b")
+                                + hex("63") + "pts" + hex("f6")
+                                + hex("69") + "wall_time" + hex("20")
+                                + hex("65") + "model" + hex("61") + "M"
+                                + hex("71") + "inference_latency" + hex("19 012c")
+                                + hex("6c") + "is_anomalous" + hex("f4")
+                                + hex("6a") + "confidence" + hex("fa 3f000000");
+
+    const std::string protobuf_42 = hex("0a 05") + "cam-1" + hex("10 2a") + hex("18 80dea0cb05")
+                                    + hex("20 c0c480c1c1c48203") + hex("2a 0b") + "SampleModel"
+                                    + hex("30 c0f0f50b") + hex("38 01") + hex("45 0000403f");
+    // No PTS field, -1 as a ten byte varint
+    const std::string protobuf_43 = hex("0a 05") + "cam-1" + hex("10 2b") + hex("20 ffffffffffffffffff01")
+                                    + hex("2a 01") + "M" + hex("30 ac02") + hex("38 00") + hex("45 0000003f");
+
+    ResultSummary makeSummary() {
+        ResultSummary summary = {};
+        summary.window_start = 1700000000000000;
+        summary.window_end = 1700000060000000;
+        summary.frames = 301;
+        summary.results = 298;
+        summary.anomalies = 3;
+        summary.failures = 2;
+        summary.timeouts = 1;
+        summary.dropped_frames = 1;
+        summary.confidence_histogram[0] = 1;
+        summary.confidence_histogram[18] = 200;
+        summary.confidence_histogram[19] = 97;
+        summary.confidence_mean = 0.5f;
+        summary.latency_p50 = 20 * GST_MSECOND;
+        summary.latency_p90 = 30 * GST_MSECOND;
+        summary.latency_p99 = 45 * GST_MSECOND;
+        summary.latency_max = 50 * GST_MSECOND;
+        strcpy(summary.model, "SampleModel");
+        return summary;
+    }
+};
+
+TEST_F(PayloadSerializerTest, text_test) {
+    PayloadSerializer(PayloadSerializer::Format::TEXT, "cam-1").Serialize(requests, 1, false, buffer);
+    ASSERT_EQ(toString(buffer), "Detect Anomaly Result - Is Anomalous? 1, Confidence: 0.750000");
+
+    // Batches of the text format are written as JSON
+    PayloadSerializer(PayloadSerializer::Format::TEXT, "cam-1").Serialize(requests, 2, true, buffer);
+    ASSERT_EQ(toString(buffer), "[" + json_42 + "," + json_43 + "]");
+}
+
+TEST_F(PayloadSerializerTest, json_test) {
+    PayloadSerializer serializer(PayloadSerializer::Format::JSON, "cam-1");
+    serializer.Serialize(requests, 1, false, buffer);
+    ASSERT_EQ(toString(buffer), json_42);
+    serializer.Serialize(requests, 2, true, buffer);
+    ASSERT_EQ(toString(buffer), "[" + json_42 + "," + json_43 + "]");
+}
+
+TEST_F(PayloadSerializerTest, json_escapes_strings_test) {
+    PublishRequest request = requests[1];
+    strcpy(request.model, "a\"b\\c\n");
+    PayloadSerializer(PayloadSerializer::Format::JSON, "cam\t1").Serialize(&request, 1, false, buffer);
+    std::string payload = toString(buffer);
+    ASSERT_NE(payload.find("\"camera_id\":\"cam\\u00091\""), std::string::npos);
+    ASSERT_NE(payload.find("\"model\":\"a\\\"b\\\\c\\u000a\""), std::string::npos);
+}
+
+TEST_F(PayloadSerializerTest, cbor_test) {
+    PayloadSerializer serializer(PayloadSerializer::Format::CBOR, "cam-1");
+    serializer.Serialize(&requests[0], 1, false, buffer);
+    ASSERT_EQ(toHex(buffer), toHex(cbor_42));
+    serializer.Serialize(&requests[1], 1, false, buffer);
+    ASSERT_EQ(toHex(buffer), toHex(cbor_43));
+
+    // Array of 2 maps
+    serializer.Serialize(requests, 2, true, buffer);
+    ASSERT_EQ(toHex(buffer), toHex(hex("82") + cbor_42 + cbor_43));
+}
+
+TEST_F(PayloadSerializerTest, protobuf_test) {
+    PayloadSerializer serializer(PayloadSerializer::Format::PROTOBUF, "cam-1");
+    serializer.Serialize(&requests[0], 1, false, buffer);
+    ASSERT_EQ(toHex(buffer), toHex(protobuf_42));
+    serializer.Serialize(&requests[1], 1, false, buffer);
+    ASSERT_EQ(toHex(buffer), toHex(protobuf_43));
+
+    // InferenceResultBatch: each result is field 1, prefixed with its length of 49 and 33 bytes
+    serializer.Serialize(requests, 2, true, buffer);
+    ASSERT_EQ(toHex(buffer), toHex(hex("0a 31") + protobuf_42 + hex("0a 21") + protobuf_43));
+}
+
+TEST_F(PayloadSerializerTest, buffer_is_reused_test) {
+    PayloadSerializer serializer(PayloadSerializer::Format::PROTOBUF, "cam-1");
+    serializer.Serialize(requests, 2, true, buffer);
+    size_t capacity = buffer.capacity();
+    serializer.Serialize(&requests[1], 1, false, buffer);
+    ASSERT_EQ(toHex(buffer), toHex(protobuf_43));
+    ASSERT_EQ(buffer.capacity(), capacity);
+}
+
+TEST_F(PayloadSerializerTest, summary_json_test) {
+    PayloadSerializer(PayloadSerializer::Format::JSON, "cam-1").SerializeSummary(makeSummary(), buffer);
+    ASSERT_EQ(toString(buffer), "{\"camera_id\":\"cam-1\",\"window_start\":1700000000000000,"
+                                "\"window_end\":1700000060000000,\"model\":\"SampleModel\",\"frames\":301,"
+                                "\"results\":298,\"anomalies\":3,\"anomaly_rate\":0.010067,\"failures\":2,"
+                                "\"timeouts\":1,\"dropped_frames\":1,\"confidence_mean\":0.500000,"
+                                "\"confidence_histogram\":[1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,200,97],"
+                                "\"latency_p50\":20000000,\"latency_p90\":30000000,\"latency_p99\":45000000,"
+                                "\"latency_max\":50000000}");
+}
+
+TEST_F(PayloadSerializerTest, summary_cbor_test) {
+    PayloadSerializer(PayloadSerializer::Format::CBOR, "cam-1").SerializeSummary(makeSummary(), buffer);
+    // Map of 17 pairs; the histogram is an array of 20
+    std::string expected = hex("b1") + hex("69") + "camera_id" + hex("65") + "cam-1"
+                           + hex("6c") + "window_start" + hex("1b 00060a24181e4000")
+                           + hex("6a") + "window_end" + hex("1b 00060a241bb1c700")
+                           + hex("65") + "model" + hex("6b") + "SampleModel"
+                           + hex("66") + "frames" + hex("19 012d")
+                           + hex("67") + "results" + hex("19 012a")
+                           + hex("69") + "anomalies" + hex("03")
+                           + hex("6c") + "anomaly_rate" + hex("fa 3c24f089")
+                           + hex("68") + "failures" + hex("02")
+                           + hex("68") + "timeouts" + hex("01")
+                           + hex("6e") + "dropped_frames" + hex("01")
+                           + hex("6f") + "confidence_mean" + hex("fa 3f000000")
+                           + hex("74") + "confidence_histogram"
+                           + hex("94 01 0000000000000000000000000000000000 18c8 1861")
+                           + hex("6b") + "latency_p50" + hex("1a 01312d00")
+                           + hex("6b") + "latency_p90" + hex("1a 01c9c380")
+                           + hex("6b") + "latency_p99" + hex("1a 02aea540")
+                           + hex("6b") + "latency_max" + hex("1a 02faf080");
+    ASSERT_EQ(toHex(buffer), toHex(expected));
+}
+
+TEST_F(PayloadSerializerTest, summary_protobuf_test) {
+    PayloadSerializer(PayloadSerializer::Format::PROTOBUF, "cam-1").SerializeSummary(makeSummary(), buffer);
+    // The packed histogram is field 12 with a length of 21 bytes; fields 16 and 17 need a two byte key
+    std::string expected = hex("0a 05") + "cam-1" + hex("10 8080f9c0c1c48203") + hex("18 808ec7ddc1c48203")
+                           + hex("22 0b") + "SampleModel" + hex("28 ad02") + hex("30 aa02") + hex("38 03")
+                           + hex("45 89f0243c") + hex("48 02") + hex("50 01") + hex("5d 0000003f")
+                           + hex("62 15 01 0000000000000000000000000000000000 c801 61")
+                           + hex("68 80dac409") + hex("70 8087a70e") + hex("78 c0caba15") + hex("8001 80e1eb17")
+                           + hex("8801 01");
+    ASSERT_EQ(toHex(buffer), toHex(expected));
+}
+
+int main(int argc, char *argv[]) {
+    gst_init(&argc, &argv);
+
+    testing::InitGoogleTest();
+    RUN_ALL_TESTS();
+
+    return 0;
+}
@@ -0,0 +1,78 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <gst/gst.h>
+#include <gtest/gtest.h>
+#include "publish-worker/PublishPolicy.h"
+
+TEST(PublishPolicyTest, publishes_everything_without_publish_on_change_test) {
+    PublishPolicy policy({false, 0.1f, 1000, 2, 3});
+    for (int i = 0; i < 10; i++) {
+        ASSERT_TRUE(policy.ShouldPublish(i % 2, 0.5, i));
+    }
+    ASSERT_EQ(policy.GetSuppressed(), 0u);
+}
+
+TEST(PublishPolicyTest, publishes_first_result_and_state_changes_test) {
+    PublishPolicy policy({true, 0, 0, 1, 1});
+    ASSERT_TRUE(policy.ShouldPublish(false, 0.9, 0));
+    ASSERT_FALSE(policy.ShouldPublish(false, 0.8, 1));
+    ASSERT_TRUE(policy.ShouldPublish(true, 0.7, 2));
+    ASSERT_FALSE(policy.ShouldPublish(true, 0.6, 3));
+    ASSERT_TRUE(policy.ShouldPublish(false, 0.9, 4));
+    ASSERT_EQ(policy.GetSuppressed(), 2u);
+}
+
+TEST(PublishPolicyTest, state_changes_after_n_of_m_test) {
+    // 2 of the last 3 results have to disagree with the current state
+    PublishPolicy policy({true, 0, 0, 2, 3});
+    ASSERT_TRUE(policy.ShouldPublish(false, 0.9, 0));
+    ASSERT_FALSE(policy.ShouldPublish(true, 0.9, 1));
+    ASSERT_FALSE(policy.ShouldPublish(false, 0.9, 2));
+    ASSERT_TRUE(policy.ShouldPublish(true, 0.9, 3));
+
+    // The results that switched to anomalous are forgotten, a single normal one doesn't switch back
+    ASSERT_FALSE(policy.ShouldPublish(false, 0.9, 4));
+    ASSERT_FALSE(policy.ShouldPublish(true, 0.9, 5));
+    ASSERT_TRUE(policy.ShouldPublish(false, 0.9, 6));
+    ASSERT_EQ(policy.GetSuppressed(), 4u);
+}
+
+TEST(PublishPolicyTest, full_window_test) {
+    // Windows are clamped to MAX_HYSTERESIS_WINDOW results, all of which have to agree
+    PublishPolicy policy({true, 0, 0, 100, 100});
+    ASSERT_TRUE(policy.ShouldPublish(false, 0.9, 0));
+    for (guint i = 1; i < PublishPolicy::MAX_HYSTERESIS_WINDOW; i++) {
+        ASSERT_FALSE(policy.ShouldPublish(true, 0.9, i));
+    }
+    ASSERT_TRUE(policy.ShouldPublish(true, 0.9, 64));
+}
+
+TEST(PublishPolicyTest, publishes_confidence_changes_test) {
+    PublishPolicy policy({true, 0.1f, 0, 1, 1});
+    ASSERT_TRUE(policy.ShouldPublish(false, 0.5, 0));
+    ASSERT_FALSE(policy.ShouldPublish(false, 0.55, 1));
+    ASSERT_TRUE(policy.ShouldPublish(false, 0.61, 2));
+    // Measured from the last published confidence, not the last result
+    ASSERT_FALSE(policy.ShouldPublish(false, 0.65, 3));
+    ASSERT_TRUE(policy.ShouldPublish(false, 0.5, 4));
+}
+
+TEST(PublishPolicyTest, publishes_heartbeats_test) {
+    // Times are microseconds, the heartbeat interval milliseconds
+    PublishPolicy policy({true, 0, 1000, 1, 1});
+    ASSERT_TRUE(policy.ShouldPublish(false, 0.5, 0));
+    ASSERT_FALSE(policy.ShouldPublish(false, 0.5, 999999));
+    ASSERT_TRUE(policy.ShouldPublish(false, 0.5, 1000000));
+    ASSERT_FALSE(policy.ShouldPublish(false, 0.5, 1500000));
+    ASSERT_EQ(policy.GetSuppressed(), 2u);
+}
+
+int main(int argc, char *argv[]) {
+    gst_init(&argc, &argv);
+
+    testing::InitGoogleTest();
+    RUN_ALL_TESTS();
+
+    return 0;
+}
@@ -0,0 +1,153 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <gst/gst.h>
+#include <glib/gstdio.h>
+#include <gtest/gtest.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "publish-worker/PublishSpool.h"
+
+class PublishSpoolTest : public testing::Test {
+protected:
+    std::string location;
+
+    void SetUp() override {
+        gchar* dir = g_dir_make_tmp("publish-spool-XXXXXX", NULL);
+        ASSERT_NE(dir, nullptr);
+        location = dir;
+        g_free(dir);
+    }
+
+    void TearDown() override {
+        GDir* dir = g_dir_open(location.c_str(), 0, NULL);
+        if (dir) {
+            const gchar* name;
+            while ((name = g_dir_read_name(dir)) != NULL) {
+                std::string path = location + "/" + name;
+                g_remove(path.c_str());
+            }
+            g_dir_close(dir);
+        }
+        g_rmdir(location.c_str());
+    }
+
+    void push(PublishSpool& spool, const std::string& payload) {
+        ASSERT_TRUE(spool.Push("topic", (const uint8_t*) payload.data(), payload.size()));
+    }
+
+    std::string pop(PublishSpool& spool) {
+        PublishSpool::EntryId id;
+        std::string topic;
+        std::vector<uint8_t> payload;
+        if (!spool.Front(id, topic, payload)) {
+            return "";
+        }
+        spool.Pop(id);
+        return std::string(payload.begin(), payload.end());
+    }
+};
+
+TEST_F(PublishSpoolTest, push_and_pop_in_order_test) {
+    PublishSpool spool(location, 1024 * 1024, 4096);
+    for (int i = 0; i < 100; i++) {
+        push(spool, "message " + std::to_string(i));
+    }
+    ASSERT_EQ(spool.Pending(), 100u);
+
+    PublishSpool::EntryId id;
+    std::string topic;
+    std::vector<uint8_t> payload;
+    ASSERT_TRUE(spool.Front(id, topic, payload));
+    ASSERT_EQ(topic, "topic");
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(pop(spool), "message " + std::to_string(i));
+    }
+    ASSERT_EQ(spool.Pending(), 0u);
+    ASSERT_FALSE(spool.Front(id, topic, payload));
+}
+
+TEST_F(PublishSpoolTest, reopen_recovers_pending_test) {
+    {
+        PublishSpool spool(location, 1024 * 1024, 4096);
+        for (int i = 0; i < 50; i++) {
+            push(spool, "message " + std::to_string(i));
+        }
+        for (int i = 0; i < 20; i++) {
+            pop(spool);
+        }
+    }
+
+    PublishSpool spool(location, 1024 * 1024, 4096);
+    ASSERT_EQ(spool.Pending(), 30u);
+    ASSERT_EQ(pop(spool), "message 20");
+    push(spool, "message 50");
+    ASSERT_EQ(spool.Pending(), 30u);
+}
+
+TEST_F(PublishSpoolTest, torn_entry_is_discarded_test) {
+    {
+        PublishSpool spool(location, 1024 * 1024, 4096);
+        push(spool, "first");
+        push(spool, "second");
+        push(spool, "third");
+    }
+
+    // Corrupt the payload of the last entry as a power loss in the middle of the write would
+    std::string path = location + "/spool-00000000000000000000.lvspool";
+    int fd = open(path.c_str(), O_RDWR);
+    ASSERT_GE(fd, 0);
+    // "first" and "second" each take 24 bytes: the entry header, the topic and the payload rounded up to 8 bytes
+    off_t third_payload = sizeof(PublishSpoolSegmentHeader) + 2 * 24 + sizeof(PublishSpoolEntryHeader) + 5;
+    ASSERT_EQ(pwrite(fd, "X", 1, third_payload), 1);
+    close(fd);
+
+    PublishSpool spool(location, 1024 * 1024, 4096);
+    ASSERT_EQ(spool.Pending(), 2u);
+    push(spool, "fourth");
+    ASSERT_EQ(pop(spool), "first");
+    ASSERT_EQ(pop(spool), "second");
+    ASSERT_EQ(pop(spool), "fourth");
+    ASSERT_EQ(pop(spool), "");
+}
+
+TEST_F(PublishSpoolTest, max_size_drops_oldest_segment_test) {
+    PublishSpool spool(location, 3 * 4096, 4096);
+    std::string payload(500, 'p');
+    for (int i = 0; i < 100; i++) {
+        push(spool, payload + std::to_string(i));
+    }
+
+    ASSERT_GT(spool.GetDropped(), 0u);
+    ASSERT_EQ(spool.Pending() + spool.GetDropped(), 100u);
+    ASSERT_NE(pop(spool), payload + "0");
+}
+
+TEST_F(PublishSpoolTest, oversized_payload_rejected_test) {
+    PublishSpool spool(location, 3 * 4096, 4096);
+    std::string payload(8192, 'p');
+    ASSERT_FALSE(spool.Push("topic", (const uint8_t*) payload.data(), payload.size()));
+    ASSERT_EQ(spool.GetDropped(), 1u);
+    ASSERT_EQ(spool.Pending(), 0u);
+}
+
+TEST_F(PublishSpoolTest, invalid_location_test) {
+    std::string error;
+    try {
+        PublishSpool spool("/proc/publish-spool", 1024 * 1024);
+    } catch (std::runtime_error& e) {
+        error = e.what();
+    }
+    ASSERT_FALSE(error.empty());
+}
+
+int main(int argc, char *argv[]) {
+    gst_init(&argc, &argv);
+
+    testing::InitGoogleTest();
+    RUN_ALL_TESTS();
+
+    return 0;
+}
@@ -0,0 +1,234 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <gst/gst.h>
+#include <glib/gstdio.h>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "publish-worker/PublishWorker.h"
+#include "utils/test-publisher/TestPublisher.h"
+
+class PublishWorkerTest : public testing::Test {
+protected:
+    std::string location;
+    TestPublisher publisher;
+
+    void SetUp() override {
+        gchar* dir = g_dir_make_tmp("publish-worker-XXXXXX", NULL);
+        ASSERT_NE(dir, nullptr);
+        location = dir;
+        g_free(dir);
+    }
+
+    void TearDown() override {
+        GDir* dir = g_dir_open(location.c_str(), 0, NULL);
+        if (dir) {
+            const gchar* name;
+            while ((name = g_dir_read_name(dir)) != NULL) {
+                std::string path = location + "/" + name;
+                g_remove(path.c_str());
+            }
+            g_dir_close(dir);
+        }
+        g_rmdir(location.c_str());
+    }
+
+    PublishWorker::Config makeConfig(bool spool) {
+        return PublishWorker::Config{"topic", 64, PublishWorker::OverflowPolicy::DROP_OLDEST, 8, 1, 0, true,
+                                     PayloadSerializer::Format::JSON, "camera", spool ? location : "",
+                                     1024 * 1024, 1000};
+    }
+
+    PublishRequest makeRequest(guint64 frame_id) {
+        return PublishRequest{frame_id, frame_id * GST_SECOND, 0, 0, false, 0.5, "SampleModel"};
+    }
+
+    bool waitFor(std::function<bool()> condition) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!condition()) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return true;
+    }
+
+    bool containsFrame(const std::string& payload, guint64 frame_id) {
+        return payload.find("\"frame_id\":" + std::to_string(frame_id) + ",") != std::string::npos;
+    }
+};
+
+TEST_F(PublishWorkerTest, publishes_results_test) {
+    {
+        PublishWorker worker(&publisher, makeConfig(false));
+        for (guint64 i = 0; i < 10; i++) {
+            ASSERT_TRUE(worker.Enqueue(makeRequest(i)));
+        }
+    }
+
+    std::vector<std::string> payloads = publisher.GetPayloads();
+    ASSERT_EQ(payloads.size(), 10u);
+    ASSERT_TRUE(containsFrame(payloads[0], 0));
+    ASSERT_TRUE(containsFrame(payloads[9], 9));
+}
+
+TEST_F(PublishWorkerTest, flushes_batch_on_size_test) {
+    PublishWorker::Config config = makeConfig(false);
+    config.batch_max = 4;
+    {
+        PublishWorker worker(&publisher, config);
+        for (guint64 i = 0; i < 10; i++) {
+            ASSERT_TRUE(worker.Enqueue(makeRequest(i)));
+        }
+        ASSERT_TRUE(waitFor([&] { return worker.GetStats().messages == 2; }));
+        ASSERT_EQ(worker.GetStats().published, 8u);
+    }
+
+    // The last two results are flushed on stop
+    std::vector<std::string> payloads = publisher.GetPayloads();
+    ASSERT_EQ(payloads.size(), 3u);
+    ASSERT_EQ(payloads[0].front(), '[');
+    ASSERT_TRUE(containsFrame(payloads[0], 0));
+    ASSERT_TRUE(containsFrame(payloads[0], 3));
+    ASSERT_FALSE(containsFrame(payloads[0], 4));
+    ASSERT_TRUE(containsFrame(payloads[1], 4));
+    ASSERT_TRUE(containsFrame(payloads[1], 7));
+    ASSERT_TRUE(containsFrame(payloads[2], 8));
+    ASSERT_TRUE(containsFrame(payloads[2], 9));
+}
+
+TEST_F(PublishWorkerTest, flushes_batch_on_interval_test) {
+    PublishWorker::Config config = makeConfig(false);
+    config.batch_max = 100;
+    config.batch_interval = 50;
+    PublishWorker worker(&publisher, config);
+    auto start = std::chrono::steady_clock::now();
+    for (guint64 i = 0; i < 3; i++) {
+        ASSERT_TRUE(worker.Enqueue(makeRequest(i)));
+    }
+    ASSERT_TRUE(waitFor([&] { return worker.GetStats().messages == 1; }));
+    ASSERT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(50));
+
+    std::vector<std::string> payloads = publisher.GetPayloads();
+    ASSERT_EQ(payloads.size(), 1u);
+    for (guint64 i = 0; i < 3; i++) {
+        ASSERT_TRUE(containsFrame(payloads[0], i));
+    }
+}
+
+TEST_F(PublishWorkerTest, flushes_batch_on_anomaly_test) {
+    PublishWorker::Config config = makeConfig(false);
+    config.batch_max = 100;
+    PublishWorker worker(&publisher, config);
+    PublishRequest anomalous = makeRequest(2);
+    anomalous.is_anomalous = true;
+    ASSERT_TRUE(worker.Enqueue(makeRequest(0)));
+    ASSERT_TRUE(worker.Enqueue(makeRequest(1)));
+    ASSERT_TRUE(worker.Enqueue(anomalous));
+    ASSERT_TRUE(waitFor([&] { return worker.GetStats().messages == 1; }));
+
+    // Without an interval a normal result waits for the batch to fill
+    ASSERT_TRUE(worker.Enqueue(makeRequest(3)));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    PublishStats stats = worker.GetStats();
+    ASSERT_EQ(stats.messages, 1u);
+    ASSERT_EQ(stats.published, 3u);
+
+    std::vector<std::string> payloads = publisher.GetPayloads();
+    ASSERT_EQ(payloads.size(), 1u);
+    ASSERT_TRUE(containsFrame(payloads[0], 0));
+    ASSERT_TRUE(containsFrame(payloads[0], 2));
+    ASSERT_FALSE(containsFrame(payloads[0], 3));
+}
+
+TEST_F(PublishWorkerTest, spools_while_disconnected_and_replays_test) {
+    PublishWorker worker(&publisher, makeConfig(true));
+    publisher.SetConnected(false);
+    for (guint64 i = 0; i < 5; i++) {
+        ASSERT_TRUE(worker.Enqueue(makeRequest(i)));
+    }
+    ASSERT_TRUE(waitFor([&] { return worker.GetStats().spooled == 5; }));
+    ASSERT_EQ(publisher.GetPayloads().size(), 0u);
+
+    publisher.SetConnected(true);
+    ASSERT_TRUE(waitFor([&] { return worker.GetStats().replayed == 5; }));
+    ASSERT_TRUE(worker.Enqueue(makeRequest(5)));
+    ASSERT_TRUE(waitFor([&] { return worker.GetStats().published == 1; }));
+
+    PublishStats stats = worker.GetStats();
+    ASSERT_EQ(stats.spool_pending, 0u);
+    ASSERT_EQ(stats.failed, 0u);
+    std::vector<std::string> payloads = publisher.GetPayloads();
+    ASSERT_EQ(payloads.size(), 6u);
+    for (guint64 i = 0; i < 5; i++) {
+        ASSERT_TRUE(containsFrame(payloads[i], i));
+    }
+}
+
+TEST_F(PublishWorkerTest, spool_survives_restart_test) {
+    publisher.SetConnected(false);
+    {
+        PublishWorker worker(&publisher, makeConfig(true));
+        for (guint64 i = 0; i < 3; i++) {
+            ASSERT_TRUE(worker.Enqueue(makeRequest(i)));
+        }
+    }
+
+    publisher.SetConnected(true);
+    PublishWorker worker(&publisher, makeConfig(true));
+    ASSERT_TRUE(waitFor([&] { return worker.GetStats().replayed == 3; }));
+    std::vector<std::string> payloads = publisher.GetPayloads();
+    ASSERT_EQ(payloads.size(), 3u);
+    ASSERT_TRUE(containsFrame(payloads[0], 0));
+}
+
+TEST_F(PublishWorkerTest, replay_is_rate_limited_test) {
+    PublishWorker::Config config = makeConfig(true);
+    config.replay_rate = 20;
+    publisher.SetConnected(false);
+    {
+        PublishWorker worker(&publisher, config);
+        for (guint64 i = 0; i < 10; i++) {
+            ASSERT_TRUE(worker.Enqueue(makeRequest(i)));
+        }
+    }
+
+    publisher.SetConnected(true);
+    auto start = std::chrono::steady_clock::now();
+    PublishWorker worker(&publisher, config);
+    ASSERT_TRUE(waitFor([&] { return worker.GetStats().replayed == 10; }));
+    // Ten messages at 20 per second take at least 9 intervals of 50 ms
+    ASSERT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(450));
+}
+
+TEST_F(PublishWorkerTest, publishes_summaries_test) {
+    PublishWorker::Config config = makeConfig(false);
+    config.summary_interval = 50;
+    config.summary_topic = "topic/summary";
+    ResultAggregator aggregator(g_get_real_time());
+    aggregator.AddResult(true, 0.5, GST_MSECOND, "SampleModel");
+    {
+        PublishWorker worker(&publisher, config, &aggregator);
+        ASSERT_TRUE(waitFor([&] { return worker.GetStats().summaries >= 1; }));
+    }
+
+    // Every window after the first is empty, and one more summary is published on stop
+    std::vector<std::string> payloads = publisher.GetPayloads();
+    ASSERT_GE(payloads.size(), 2u);
+    ASSERT_NE(payloads[0].find("\"anomalies\":1,"), std::string::npos);
+    ASSERT_NE(payloads.back().find("\"anomalies\":0,"), std::string::npos);
+}
+
+int main(int argc, char *argv[]) {
+    gst_init(&argc, &argv);
+
+    testing::InitGoogleTest();
+    RUN_ALL_TESTS();
+
+    return 0;
+}
@@ -0,0 +1,88 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <gst/gst.h>
+#include <gtest/gtest.h>
+#include <string>
+#include "publish-worker/ResultAggregator.h"
+
+TEST(ResultAggregatorTest, counts_results_test) {
+    ResultAggregator aggregator(1000);
+    aggregator.AddResult(false, 0.9, 10 * GST_MSECOND, "SampleModel");
+    aggregator.AddResult(true, 0.7, 20 * GST_MSECOND, "SampleModel");
+    aggregator.AddResult(false, 1.0, 30 * GST_MSECOND, "SampleModel");
+    aggregator.AddFailure();
+    aggregator.AddTimeout();
+    aggregator.AddDroppedFrames(3);
+
+    ResultSummary summary;
+    aggregator.TakeSummary(2000, summary);
+    ASSERT_EQ(summary.window_start, 1000);
+    ASSERT_EQ(summary.window_end, 2000);
+    ASSERT_EQ(summary.frames, 5u);
+    ASSERT_EQ(summary.results, 3u);
+    ASSERT_EQ(summary.anomalies, 1u);
+    ASSERT_EQ(summary.failures, 1u);
+    ASSERT_EQ(summary.timeouts, 1u);
+    ASSERT_EQ(summary.dropped_frames, 3u);
+    ASSERT_NEAR(summary.confidence_mean, (0.9 + 0.7 + 1.0) / 3, 1e-6);
+    ASSERT_EQ(summary.confidence_histogram[18], 1u);
+    ASSERT_EQ(summary.confidence_histogram[14], 1u);
+    // 1.0 falls into the last bin
+    ASSERT_EQ(summary.confidence_histogram[SUMMARY_CONFIDENCE_BINS - 1], 1u);
+    ASSERT_EQ(summary.latency_max, 30 * GST_MSECOND);
+    ASSERT_EQ(std::string(summary.model), "SampleModel");
+}
+
+TEST(ResultAggregatorTest, resets_after_summary_test) {
+    ResultAggregator aggregator(0);
+    aggregator.AddResult(true, 0.5, GST_MSECOND, "SampleModel");
+
+    ResultSummary summary;
+    aggregator.TakeSummary(1000, summary);
+    aggregator.TakeSummary(2000, summary);
+    ASSERT_EQ(summary.window_start, 1000);
+    ASSERT_EQ(summary.frames, 0u);
+    ASSERT_EQ(summary.anomalies, 0u);
+    ASSERT_EQ(summary.confidence_mean, 0);
+    ASSERT_EQ(summary.latency_p50, 0u);
+    ASSERT_EQ(summary.latency_max, 0u);
+}
+
+TEST(ResultAggregatorTest, latency_percentiles_test) {
+    ResultAggregator aggregator(0);
+    // 1 to 1000 milliseconds
+    for (int i = 1; i <= 1000; i++) {
+        aggregator.AddResult(false, 0.5, i * GST_MSECOND, "SampleModel");
+    }
+
+    ResultSummary summary;
+    aggregator.TakeSummary(1000, summary);
+    // Buckets are 1/16 of an octave wide, so the midpoint is within 1/32 of the true value
+    ASSERT_NEAR((double) summary.latency_p50, 500.0 * GST_MSECOND, 500.0 * GST_MSECOND / 32);
+    ASSERT_NEAR((double) summary.latency_p90, 900.0 * GST_MSECOND, 900.0 * GST_MSECOND / 32);
+    ASSERT_NEAR((double) summary.latency_p99, 990.0 * GST_MSECOND, 990.0 * GST_MSECOND / 32);
+    ASSERT_LE(summary.latency_p99, summary.latency_max);
+    ASSERT_EQ(summary.latency_max, 1000 * GST_MSECOND);
+}
+
+TEST(ResultAggregatorTest, small_latencies_are_exact_test) {
+    ResultAggregator aggregator(0);
+    for (int i = 0; i < 10; i++) {
+        aggregator.AddResult(false, 0.5, 5 * GST_USECOND, "SampleModel");
+    }
+
+    ResultSummary summary;
+    aggregator.TakeSummary(1000, summary);
+    ASSERT_EQ(summary.latency_p50, 5 * GST_USECOND);
+    ASSERT_EQ(summary.latency_p99, 5 * GST_USECOND);
+}
+
+int main(int argc, char *argv[]) {
+    gst_init(&argc, &argv);
+
+    testing::InitGoogleTest();
+    RUN_ALL_TESTS();
+
+    return 0;
+}
@@ -0,0 +1,94 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <gst/gst.h>
+#include <gtest/gtest.h>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "publisher-backends/UnixSocketPublisher.h"
+
+class UnixSocketPublisherTest : public testing::Test {
+protected:
+    std::string path;
+    int listen_fd = -1;
+
+    void SetUp() override {
+        path = "/tmp/unix-socket-publisher-" + std::to_string(getpid()) + ".sock";
+        unlink(path.c_str());
+    }
+
+    void TearDown() override {
+        if (listen_fd >= 0) {
+            close(listen_fd);
+        }
+        unlink(path.c_str());
+    }
+
+    void listenOnSocket() {
+        struct sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+        listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        ASSERT_GE(listen_fd, 0);
+        ASSERT_EQ(bind(listen_fd, (struct sockaddr*) &address, sizeof(address)), 0);
+        ASSERT_EQ(listen(listen_fd, 1), 0);
+    }
+
+    std::vector<uint8_t> readExactly(int fd, size_t size) {
+        std::vector<uint8_t> data(size);
+        size_t offset = 0;
+        while (offset < size) {
+            ssize_t count = read(fd, data.data() + offset, size - offset);
+            if (count <= 0) {
+                break;
+            }
+            offset += count;
+        }
+        data.resize(offset);
+        return data;
+    }
+};
+
+TEST_F(UnixSocketPublisherTest, writes_length_prefixed_frames_test) {
+    listenOnSocket();
+    UnixSocketPublisher publisher(path);
+    ASSERT_TRUE(publisher.IsConnected());
+    int fd = accept(listen_fd, NULL, NULL);
+    ASSERT_GE(fd, 0);
+
+    const uint8_t payload[] = {'{', '}', 0, 0xff};
+    PublisherBackend::OperationStatus status = PublisherBackend::OperationStatus::FAILED;
+    publisher.PublishAsync("a/b", payload, sizeof(payload), [&](PublisherBackend::OperationStatus result) {
+        status = result;
+    });
+    EXPECT_EQ(status, PublisherBackend::OperationStatus::SUCCESSFUL);
+
+    std::vector<uint8_t> expected = {0, 0, 0, 3, 0, 0, 0, 4, 'a', '/', 'b', '{', '}', 0, 0xff};
+    EXPECT_EQ(readExactly(fd, expected.size()), expected);
+    close(fd);
+}
+
+TEST_F(UnixSocketPublisherTest, fails_without_listener_test) {
+    UnixSocketPublisher publisher(path);
+    EXPECT_FALSE(publisher.IsConnected());
+
+    const uint8_t payload[] = {1};
+    PublisherBackend::OperationStatus status = PublisherBackend::OperationStatus::SUCCESSFUL;
+    publisher.PublishAsync("topic", payload, sizeof(payload), [&](PublisherBackend::OperationStatus result) {
+        status = result;
+    });
+    EXPECT_EQ(status, PublisherBackend::OperationStatus::FAILED);
+}
+
+int main(int argc, char *argv[]) {
+    gst_init(&argc, &argv);
+
+    testing::InitGoogleTest();
+    RUN_ALL_TESTS();
+
+    return 0;
+}
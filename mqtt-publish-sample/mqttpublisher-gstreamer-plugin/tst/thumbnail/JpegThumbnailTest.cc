@@ -0,0 +1,157 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <gst/gst.h>
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <jpeglib.h>
+#include "thumbnail/JpegThumbnail.h"
+
+typedef struct _DecodedImage {
+    unsigned int width;
+    unsigned int height;
+    std::vector<uint8_t> rgb;
+} DecodedImage;
+
+static DecodedImage decode(const std::vector<uint8_t>& jpeg) {
+    struct jpeg_decompress_struct info;
+    struct jpeg_error_mgr error_manager;
+    info.err = jpeg_std_error(&error_manager);
+    jpeg_create_decompress(&info);
+    jpeg_mem_src(&info, (unsigned char*) jpeg.data(), jpeg.size());
+    jpeg_read_header(&info, TRUE);
+    info.out_color_space = JCS_RGB;
+    jpeg_start_decompress(&info);
+
+    DecodedImage image = {info.output_width, info.output_height, {}};
+    image.rgb.resize((size_t) image.width * image.height * 3);
+    while (info.output_scanline < info.output_height) {
+        JSAMPROW row = image.rgb.data() + (size_t) info.output_scanline * image.width * 3;
+        jpeg_read_scanlines(&info, &row, 1);
+    }
+    jpeg_finish_decompress(&info);
+    jpeg_destroy_decompress(&info);
+    return image;
+}
+
+static ThumbnailSource packedRgb(const std::vector<uint8_t>& pixels, unsigned int width, unsigned int height) {
+    ThumbnailSource source = {};
+    source.width = width;
+    source.height = height;
+    source.color_space = ThumbnailSource::ColorSpace::RGB;
+    for (int c = 0; c < 3; c++) {
+        source.data[c] = pixels.data() + c;
+        source.stride[c] = width * 3;
+        source.pixel_stride[c] = 3;
+    }
+    return source;
+}
+
+TEST(JpegThumbnailTest, scaled_size_keeps_aspect_ratio_test) {
+    unsigned int width, height;
+    JpegThumbnail::ScaledSize(1280, 720, 320, 240, width, height);
+    EXPECT_EQ(width, 320u);
+    EXPECT_EQ(height, 180u);
+
+    JpegThumbnail::ScaledSize(720, 1280, 320, 240, width, height);
+    EXPECT_EQ(width, 135u);
+    EXPECT_EQ(height, 240u);
+
+    // Never upscales
+    JpegThumbnail::ScaledSize(160, 120, 320, 240, width, height);
+    EXPECT_EQ(width, 160u);
+    EXPECT_EQ(height, 120u);
+}
+
+TEST(JpegThumbnailTest, encodes_scaled_rgb_with_comment_test) {
+    unsigned int width = 640, height = 480;
+    std::vector<uint8_t> pixels((size_t) width * height * 3);
+    for (size_t i = 0; i < pixels.size(); i += 3) {
+        // Left half red, right half blue
+        bool left = (i / 3) % width < width / 2;
+        pixels[i] = left ? 255 : 0;
+        pixels[i + 1] = 0;
+        pixels[i + 2] = left ? 0 : 255;
+    }
+
+    JpegThumbnail thumbnail({320, 240, 90, 0});
+    std::vector<uint8_t> jpeg;
+    ASSERT_TRUE(thumbnail.Create(packedRgb(pixels, width, height), "frame_id=7", jpeg));
+    ASSERT_GT(jpeg.size(), 4u);
+    EXPECT_EQ(jpeg[0], 0xff);
+    EXPECT_EQ(jpeg[1], 0xd8);
+    EXPECT_NE(std::string(jpeg.begin(), jpeg.end()).find("frame_id=7"), std::string::npos);
+
+    DecodedImage image = decode(jpeg);
+    EXPECT_EQ(image.width, 320u);
+    EXPECT_EQ(image.height, 240u);
+    const uint8_t* left = &image.rgb[(120 * 320 + 40) * 3];
+    const uint8_t* right = &image.rgb[(120 * 320 + 280) * 3];
+    EXPECT_GT(left[0], 200);
+    EXPECT_LT(left[2], 60);
+    EXPECT_LT(right[0], 60);
+    EXPECT_GT(right[2], 200);
+}
+
+TEST(JpegThumbnailTest, expands_limited_range_planar_yuv_test) {
+    unsigned int width = 64, height = 48;
+    // I420 with limited range white: Y 235, Cb and Cr 128
+    std::vector<uint8_t> y_plane(width * height, 235);
+    std::vector<uint8_t> chroma_plane(width / 2 * height / 2, 128);
+    ThumbnailSource source = {};
+    source.width = width;
+    source.height = height;
+    source.color_space = ThumbnailSource::ColorSpace::YCBCR;
+    source.limited_range = true;
+    const uint8_t* planes[3] = {y_plane.data(), chroma_plane.data(), chroma_plane.data()};
+    for (int c = 0; c < 3; c++) {
+        source.data[c] = planes[c];
+        source.stride[c] = c == 0 ? width : width / 2;
+        source.pixel_stride[c] = 1;
+        source.x_shift[c] = c == 0 ? 0 : 1;
+        source.y_shift[c] = c == 0 ? 0 : 1;
+    }
+
+    JpegThumbnail thumbnail({320, 240, 90, 0});
+    std::vector<uint8_t> jpeg;
+    ASSERT_TRUE(thumbnail.Create(source, "", jpeg));
+    DecodedImage image = decode(jpeg);
+    EXPECT_EQ(image.width, width);
+    EXPECT_GT(image.rgb[0], 250);
+    EXPECT_GT(image.rgb[1], 250);
+    EXPECT_GT(image.rgb[2], 250);
+}
+
+TEST(JpegThumbnailTest, lowers_quality_to_fit_max_size_test) {
+    unsigned int width = 320, height = 240;
+    std::vector<uint8_t> pixels((size_t) width * height * 3);
+    srand(1);
+    for (uint8_t& value : pixels) {
+        value = rand();
+    }
+    ThumbnailSource source = packedRgb(pixels, width, height);
+
+    std::vector<uint8_t> full_quality;
+    JpegThumbnail unlimited({320, 240, 95, 0});
+    ASSERT_TRUE(unlimited.Create(source, "", full_quality));
+
+    std::vector<uint8_t> limited_quality;
+    JpegThumbnail limited({320, 240, 95, full_quality.size() / 2});
+    ASSERT_TRUE(limited.Create(source, "", limited_quality));
+    EXPECT_LE(limited_quality.size(), full_quality.size() / 2);
+
+    JpegThumbnail impossible({320, 240, 95, 1024});
+    EXPECT_FALSE(impossible.Create(source, "", limited_quality));
+}
+
+int main(int argc, char *argv[]) {
+    gst_init(&argc, &argv);
+
+    testing::InitGoogleTest();
+    RUN_ALL_TESTS();
+
+    return 0;
+}
@@ -0,0 +1,30 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "TestPublisher.h"
+
+void TestPublisher::PublishAsync(const std::string& topic, const uint8_t* payload, size_t payload_size,
+                                 PublishCallback on_complete) {
+    if (!connected.load()) {
+        on_complete(OperationStatus::FAILED);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        payloads.emplace_back((const char*) payload, payload_size);
+    }
+    on_complete(OperationStatus::SUCCESSFUL);
+}
+
+bool TestPublisher::IsConnected() {
+    return connected.load();
+}
+
+void TestPublisher::SetConnected(bool connected) {
+    this->connected.store(connected);
+}
+
+std::vector<std::string> TestPublisher::GetPayloads() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return payloads;
+}
@@ -0,0 +1,31 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __TESTPUBLISHER_H__
+#define __TESTPUBLISHER_H__
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "publish-worker/PublisherBackend.h"
+
+/**
+ * Local stand-in for Greengrass Core. Publishes complete immediately and are recorded; while disconnected every
+ * publish fails.
+ */
+class TestPublisher : public PublisherBackend {
+public:
+    void PublishAsync(const std::string& topic, const uint8_t* payload, size_t payload_size,
+                      PublishCallback on_complete) override;
+    bool IsConnected() override;
+    void SetConnected(bool connected);
+    std::vector<std::string> GetPayloads();
+
+private:
+    std::atomic<bool> connected{true};
+    std::mutex mutex;
+    std::vector<std::string> payloads;
+};
+
+#endif //__TESTPUBLISHER_H__
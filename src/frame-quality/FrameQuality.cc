@@ -0,0 +1,60 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "FrameQuality.h"
+
+const size_t FrameQuality::GRID_STEP = 8;
+const uint8_t FrameQuality::DARK_CLIP = 5;
+const uint8_t FrameQuality::BRIGHT_CLIP = 250;
+
+FrameQuality::FrameQuality(size_t width, size_t height, size_t stride) : width(width), height(height), stride(stride) {
+    // Grid points keep one pixel away from the borders, their neighbours are always inside the frame
+    for (size_t x = 1; x + 1 < width; x += GRID_STEP) {
+        columns.push_back(x * 3);
+    }
+}
+
+/* BT.601 luma with 8 bit weights summing to 256 */
+static inline int32_t luma(const uint8_t* pixel) {
+    return (77 * pixel[0] + 150 * pixel[1] + 29 * pixel[2] + 128) >> 8;
+}
+
+FrameQuality::Statistics FrameQuality::Measure(const uint8_t* frame) const {
+    Statistics statistics = {0, 0, 0};
+    size_t count = columns.size();
+    std::vector<int32_t> center(count), laplacian(count);
+    int64_t luma_sum = 0, laplacian_sum = 0, laplacian_squares = 0, clipped = 0, points = 0;
+
+    for (size_t y = 1; y + 1 < height; y += GRID_STEP) {
+        const uint8_t* row = frame + y * stride;
+        // Gathering the five pixels of every point is the only strided access, the sums below vectorize
+        for (size_t i = 0; i < count; i++) {
+            const uint8_t* pixel = row + columns[i];
+            int32_t c = luma(pixel);
+            center[i] = c;
+            laplacian[i] = 4 * c - luma(pixel - 3) - luma(pixel + 3) - luma(pixel - stride) - luma(pixel + stride);
+        }
+        int32_t row_luma = 0, row_laplacian = 0, row_clipped = 0;
+        int64_t row_squares = 0;
+        for (size_t i = 0; i < count; i++) {
+            row_luma += center[i];
+            row_laplacian += laplacian[i];
+            row_squares += laplacian[i] * laplacian[i];
+            row_clipped += (center[i] <= DARK_CLIP) | (center[i] >= BRIGHT_CLIP);
+        }
+        luma_sum += row_luma;
+        laplacian_sum += row_laplacian;
+        laplacian_squares += row_squares;
+        clipped += row_clipped;
+        points += count;
+    }
+
+    if (points == 0) {
+        return statistics;
+    }
+    double mean = (double) laplacian_sum / points;
+    statistics.sharpness = (double) laplacian_squares / points - mean * mean;
+    statistics.brightness = (double) luma_sum / points;
+    statistics.clipped = (double) clipped / points;
+    return statistics;
+}
@@ -0,0 +1,49 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __FRAME_QUALITY_H__
+#define __FRAME_QUALITY_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Measures how usable a packed RGB frame is for inference: its sharpness, brightness and how much of it is clipped.
+ *
+ * Only a grid of every GRID_STEP-th pixel of every GRID_STEP-th row is measured. At each grid point the luma is
+ * taken together with its four direct neighbours; sharpness is the variance of the Laplacian over those points, so it
+ * still sees edges one pixel wide while a 1080p frame costs about 32000 points. Blur, a blocked lens or a defocused
+ * camera make it collapse towards 0. Brightness is the mean luma of the grid points, and clipped the fraction of them
+ * at or below DARK_CLIP or at or above BRIGHT_CLIP.
+ *
+ * Sharpness depends on the resolution and the scene, so thresholds on it have to be set per camera.
+ *
+ * Measure may be called from several threads at once.
+ */
+class FrameQuality {
+public:
+    static const size_t GRID_STEP;
+    static const uint8_t DARK_CLIP;
+    static const uint8_t BRIGHT_CLIP;
+
+    typedef struct _Statistics {
+        double sharpness;
+        // Mean luma, 0 to 255
+        double brightness;
+        // Fraction of the grid points, 0 to 1
+        double clipped;
+    } Statistics;
+
+    FrameQuality(size_t width, size_t height, size_t stride);
+    Statistics Measure(const uint8_t* frame) const;
+
+private:
+    size_t width;
+    size_t height;
+    size_t stride;
+    // Byte offsets of the grid columns within a row
+    std::vector<uint32_t> columns;
+};
+
+#endif //__FRAME_QUALITY_H__
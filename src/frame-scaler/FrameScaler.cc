@@ -0,0 +1,106 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+#include <cmath>
+#include "FrameScaler.h"
+
+const int FrameScaler::WEIGHT_BITS = 12;
+
+FrameScaler::FrameScaler(size_t src_width, size_t src_height, size_t src_stride, size_t dst_width,
+                         size_t dst_height)
+        : src_width(src_width), src_height(src_height), src_stride(src_stride), dst_width(dst_width),
+          dst_height(dst_height), horizontal(computeTaps(src_width, dst_width)),
+          vertical(computeTaps(src_height, dst_height)) {}
+
+size_t FrameScaler::DestinationSize() const {
+    return dst_width * dst_height * 3;
+}
+
+FrameScaler::Taps FrameScaler::computeTaps(size_t src_size, size_t dst_size) {
+    Taps taps;
+    double scale = (double) src_size / dst_size;
+    std::vector<double> weights;
+    for (size_t i = 0; i < dst_size; i++) {
+        size_t first;
+        weights.clear();
+        if (scale >= 1) {
+            // Every source pixel weighs as much as it overlaps [start, end)
+            double start = i * scale;
+            double end = std::min((i + 1) * scale, (double) src_size);
+            first = (size_t) start;
+            size_t last = std::min((size_t) std::ceil(end), src_size);
+            for (size_t j = first; j < last; j++) {
+                weights.push_back((std::min(end, (double) j + 1) - std::max(start, (double) j)) / scale);
+            }
+        } else {
+            double center = (i + 0.5) * scale - 0.5;
+            if (center <= 0) {
+                first = 0;
+                weights.push_back(1);
+            } else if (center >= src_size - 1) {
+                first = src_size - 1;
+                weights.push_back(1);
+            } else {
+                first = (size_t) center;
+                weights.push_back(1 - (center - first));
+                weights.push_back(center - first);
+            }
+        }
+
+        // Rounding must not change the sum, or flat areas would brighten or darken
+        taps.first.push_back(first);
+        taps.count.push_back(weights.size());
+        taps.offset.push_back(taps.weights.size());
+        uint32_t sum = 0;
+        size_t largest = taps.weights.size();
+        for (double weight : weights) {
+            uint32_t fixed = (uint32_t) std::lround(weight * (1 << WEIGHT_BITS));
+            if (largest == taps.weights.size() || fixed > taps.weights[largest]) {
+                largest = taps.weights.size();
+            }
+            taps.weights.push_back(fixed);
+            sum += fixed;
+        }
+        taps.weights[largest] = taps.weights[largest] + (1 << WEIGHT_BITS) - sum;
+    }
+    return taps;
+}
+
+void FrameScaler::Scale(const uint8_t* src, uint8_t* dst) const {
+    size_t row_size = src_width * 3;
+    std::vector<uint32_t> row(row_size);
+    // 255 << (2 * WEIGHT_BITS) plus the rounding term still fits in 32 bits
+    const uint32_t half = 1u << (2 * WEIGHT_BITS - 1);
+
+    for (size_t y = 0; y < dst_height; y++) {
+        const uint32_t* weights_y = &vertical.weights[vertical.offset[y]];
+        uint32_t* acc = row.data();
+        const uint8_t* src_row = src + vertical.first[y] * src_stride;
+        for (size_t x = 0; x < row_size; x++) {
+            acc[x] = src_row[x] * weights_y[0];
+        }
+        for (uint32_t k = 1; k < vertical.count[y]; k++) {
+            src_row += src_stride;
+            uint32_t weight = weights_y[k];
+            for (size_t x = 0; x < row_size; x++) {
+                acc[x] += src_row[x] * weight;
+            }
+        }
+
+        uint8_t* dst_row = dst + y * dst_width * 3;
+        for (size_t x = 0; x < dst_width; x++) {
+            const uint32_t* weights_x = &horizontal.weights[horizontal.offset[x]];
+            const uint32_t* pixel = acc + horizontal.first[x] * 3;
+            uint32_t r = half, g = half, b = half;
+            for (uint32_t k = 0; k < horizontal.count[x]; k++) {
+                r += pixel[3 * k] * weights_x[k];
+                g += pixel[3 * k + 1] * weights_x[k];
+                b += pixel[3 * k + 2] * weights_x[k];
+            }
+            dst_row[3 * x] = r >> (2 * WEIGHT_BITS);
+            dst_row[3 * x + 1] = g >> (2 * WEIGHT_BITS);
+            dst_row[3 * x + 2] = b >> (2 * WEIGHT_BITS);
+        }
+    }
+}
@@ -0,0 +1,51 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __FRAME_SCALER_H__
+#define __FRAME_SCALER_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Resamples packed RGB frames to a fixed resolution.
+ *
+ * Downscaling averages the source pixels each destination pixel covers (area resampling), upscaling interpolates
+ * linearly between the two nearest ones. Both axes are resampled separately with 12 bit fixed point weights computed
+ * once per scaler. The vertical pass runs over whole source rows and the horizontal pass over one intermediate row
+ * per destination row, so both are straight loops the compiler vectorizes.
+ *
+ * Scale may be called from several threads at once.
+ */
+class FrameScaler {
+public:
+    static const int WEIGHT_BITS;
+
+    FrameScaler(size_t src_width, size_t src_height, size_t src_stride, size_t dst_width, size_t dst_height);
+    // Writes dst_width * dst_height * 3 bytes, rows without padding
+    void Scale(const uint8_t* src, uint8_t* dst) const;
+    size_t DestinationSize() const;
+
+private:
+    typedef struct _Taps {
+        // First source pixel or row and how many follow it
+        std::vector<uint32_t> first;
+        std::vector<uint32_t> count;
+        // count[i] weights per destination pixel or row, each set summing to 1 << WEIGHT_BITS
+        std::vector<uint32_t> offset;
+        std::vector<uint32_t> weights;
+    } Taps;
+
+    size_t src_width;
+    size_t src_height;
+    size_t src_stride;
+    size_t dst_width;
+    size_t dst_height;
+    Taps horizontal;
+    Taps vertical;
+
+    static Taps computeTaps(size_t src_size, size_t dst_size);
+};
+
+#endif //__FRAME_SCALER_H__
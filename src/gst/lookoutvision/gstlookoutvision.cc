@@ -4,7 +4,55 @@
 /**
  * SECTION:element-lookoutvision
  *
- * Performs inference on frames using the Lookout for Vision Edge Agent
+ * Performs inference on frames using the Lookout for Vision Edge Agent. server-socket and model-component take comma
+ * separated lists to balance frames over several agents or model components; with max-inflight above 1, that many
+ * frames are inferred at once on a thread pool and pushed downstream in their original order.
+ *
+ * The Edge Agent is first contacted when the element goes to READY, and the model is started on the way to PAUSED.
+ * Setting model-component while streaming starts the new model in the background. Frames keep going to the previous
+ * model until the new one is RUNNING, then switch over between two frames; stop-previous-model also stops the
+ * previous model once its last inference returned. Either way a lookoutvision-model-swap element message reports
+ * whether the swap happened.
+ *
+ * With inference-timeout set, a frame whose inference misses the deadline is pushed with a TIMEOUT result instead of
+ * stalling the stream; adaptive-timeout derives the deadline from the latency of recent frames.
+ *
+ * A flush or going down to READY cancels the inferences in flight and drops their frames, so seeking and stopping
+ * don't wait for the Edge Agent.
+ *
+ * With inference-width or inference-height set, the element downscales each frame to that resolution while writing it
+ * into the request, and the frame pushed downstream keeps its full resolution.
+ *
+ * image/jpeg frames, from MJPEG cameras for instance, are pushed downstream still compressed. For inference they are
+ * decoded in the element, scaled down in the DCT domain as far as the inference resolution allows.
+ *
+ * Parsed H.264 and H.265 streams also pass through untouched, for recording. Only their keyframes, or every
+ * keyframe-interval-th one, are decoded and inferred, and the result is attached to that access unit; the other
+ * access units are pushed without a result.
+ *
+ * With min-sharpness, min-brightness, max-brightness or max-clipped set, each frame is first measured on a sparse grid
+ * of pixels. Blurred, dark, overexposed or blocked frames that fail a threshold are not sent for inference and are
+ * pushed with a SKIPPED_QUALITY result.
+ *
+ * With screening-model-component set, the element runs a cascade: each frame is first inferred by that fast model at
+ * screening-width by screening-height, and only goes on to model-component at the inference resolution when the
+ * screening verdict is anomalous, failed, or normal with less than screening-confidence. The result carries both
+ * verdicts, and the stats property counts the frames each stage ran on.
+ *
+ * With trigger-mode=external, frames pass through without inference and the last trigger-history of them are kept.
+ * A trigger, either a custom lookoutvision-trigger event from upstream or downstream or the trigger action signal,
+ * names a running time; the kept frame closest to it is inferred, waiting for the next frame when the trigger is
+ * ahead of the stream, and its result is posted as a lookoutvision-result element message.
+ *
+ * With infer-regions, only the GstVideoRegionOfInterestMeta regions an upstream detector attached to a frame are
+ * inferred, optionally only those of region-type. Each region is cropped straight into its request, scaled up to at
+ * least MIN_REGION_SIZE on both sides, and the regions of a frame are inferred in parallel. The result lists the
+ * verdict of every region with the id of its meta; frames without a region are pushed without a result.
+ *
+ * With warmup-frames set, that many blank frames at the inference resolution, or with infer-regions at the size of
+ * each region of the first frame, are inferred whenever a model becomes ready, before the first real frame goes to it,
+ * so the first real frame sees steady state latency. The screening model is warmed up at the screening resolution.
+ * Without a resolution in the caps, it is taken from the first JPEG header or decoded keyframe.
  *
  * <refsect2>
  * <title>Example launch line</title>
@@ -22,8 +70,17 @@
  */
 
 #include <gst/gst.h>
+#include <gst/video/video.h>
+#include <cmath>
+#include <functional>
+#include <vector>
 #include "gstlookoutvision.h"
 #include "gst/lookoutvisionmeta/gstlookoutvisionmeta.h"
+#include "gst/lookoutvisionlog/gstlookoutvisionlog.h"
+#include "frame-scaler/FrameScaler.h"
+#include "frame-quality/FrameQuality.h"
+#include "jpeg-decoder/JpegDecoder.h"
+#include "gstlookoutvisiondecoder.h"
 #include "lookoutvision-client/LookoutVisionInferenceClient.h"
 
 GST_DEBUG_CATEGORY_STATIC(gst_lookout_vision_debug);
@@ -33,20 +90,148 @@ enum {
     PROP_0,
     PROP_SERVER_SOCKET,
     PROP_MODEL_COMPONENT,
-    PROP_MODEL_STATUS_TIMEOUT
+    PROP_MODEL_STATUS_TIMEOUT,
+    PROP_MAX_INFLIGHT,
+    PROP_HEALTH_CHECK_INTERVAL,
+    PROP_STOP_PREVIOUS_MODEL,
+    PROP_WARMUP_FRAMES,
+    PROP_INFERENCE_TIMEOUT,
+    PROP_ADAPTIVE_TIMEOUT,
+    PROP_INFERENCE_WIDTH,
+    PROP_INFERENCE_HEIGHT,
+    PROP_KEYFRAME_INTERVAL,
+    PROP_MIN_SHARPNESS,
+    PROP_MIN_BRIGHTNESS,
+    PROP_MAX_BRIGHTNESS,
+    PROP_MAX_CLIPPED,
+    PROP_SCREENING_MODEL_COMPONENT,
+    PROP_SCREENING_WIDTH,
+    PROP_SCREENING_HEIGHT,
+    PROP_SCREENING_CONFIDENCE,
+    PROP_TRIGGER_MODE,
+    PROP_TRIGGER_HISTORY,
+    PROP_INFER_REGIONS,
+    PROP_REGION_TYPE,
+    PROP_MAX_REGIONS_INFLIGHT,
+    PROP_STATS
+};
+
+enum {
+    SIGNAL_TRIGGER,
+    LAST_SIGNAL
 };
 
+static guint gst_lookout_vision_signals[LAST_SIGNAL] = {0};
+
+#define TRIGGER_EVENT_NAME "lookoutvision-trigger"
+#define RESULT_MESSAGE_NAME "lookoutvision-result"
+#define MODEL_SWAP_MESSAGE_NAME "lookoutvision-model-swap"
+// The Edge Agent rejects images with a side shorter than this
+#define MIN_REGION_SIZE 64
+
+/*
+ * Never modified once published. Setting a property publishes a modified copy; the previous snapshot is freed when the
+ * last frame or model swap holding a reference lets go of it.
+ */
+struct _GstLookoutVisionConfig {
+    gint ref_count;
+    gchar* server_socket;
+    gchar* model_component;
+    guint model_status_timeout;
+    gboolean stop_previous_model;
+    guint warmup_frames;
+    guint inference_width;
+    guint inference_height;
+    guint keyframe_interval;
+    gdouble min_sharpness;
+    gdouble min_brightness;
+    gdouble max_brightness;
+    gdouble max_clipped;
+    gchar* screening_model_component;
+    guint screening_width;
+    guint screening_height;
+    gdouble screening_confidence;
+    guint trigger_history;
+    gchar* region_type;
+    guint health_check_interval;
+    guint inference_timeout;
+    gboolean adaptive_timeout;
+};
+
+typedef struct _GstLookoutVisionJob {
+    GstBuffer* buffer;
+    GstLookoutVisionConfig* config;
+    int width;
+    int height;
+    GstLookoutVisionInput input;
+    GstLookoutVisionResult* result;
+    gboolean done;
+} GstLookoutVisionJob;
+
+typedef struct _GstLookoutVisionSize {
+    int width;
+    int height;
+} GstLookoutVisionSize;
+
+/* An idle keyframe decoder, made for the coded caps of caps_generation */
+typedef struct _GstLookoutVisionIdleDecoder {
+    GstLookoutVisionDecoder* decoder;
+    guint caps_generation;
+} GstLookoutVisionIdleDecoder;
+
+/* A frame already pushed in external trigger mode, kept in case a trigger names it */
+typedef struct _GstLookoutVisionFrame {
+    GstBuffer* buffer;
+    GstClockTime running_time;
+    int width;
+    int height;
+    GstLookoutVisionInput input;
+} GstLookoutVisionFrame;
+
+typedef struct _GstLookoutVisionTrigger {
+    GstClockTime running_time;
+    // Monotonic time the trigger arrived at
+    gint64 received;
+} GstLookoutVisionTrigger;
+
+typedef struct _GstLookoutVisionTriggerJob {
+    GstLookoutVisionFrame frame;
+    GstLookoutVisionTrigger trigger;
+    GstLookoutVisionConfig* config;
+} GstLookoutVisionTriggerJob;
+
+/* One region of a frame, cropped out of the frame the inferring thread keeps mapped until every region returned */
+typedef struct _GstLookoutVisionRegionJob {
+    const GstLookoutVisionConfig* config;
+    // First pixel of the region, rows stride bytes apart
+    guint8* frame;
+    int width;
+    int height;
+    int stride;
+    int inference_width;
+    int inference_height;
+    GstLookoutVisionResult* result;
+    // Regions of the frame still being inferred, guarded by pending_lock
+    guint* remaining;
+} GstLookoutVisionRegionJob;
+
 /* Inputs and outputs */
 static GstStaticPadTemplate sink_factory = GST_STATIC_PAD_TEMPLATE("sink",
                                                                    GST_PAD_SINK,
                                                                    GST_PAD_ALWAYS,
-                                                                   GST_STATIC_CAPS("video/x-raw, format={RGB}")
+                                                                   GST_STATIC_CAPS("video/x-raw, format={RGB}; "
+                                                                                   "image/jpeg; "
+                                                                                   "video/x-h264, parsed=true; "
+                                                                                   "video/x-h265, parsed=true")
 );
 
 static GstStaticPadTemplate src_factory = GST_STATIC_PAD_TEMPLATE("src",
                                                                   GST_PAD_SRC,
                                                                   GST_PAD_ALWAYS,
-                                                                  GST_STATIC_CAPS("video/x-raw, format={RGB}")
+                                                                  GST_STATIC_CAPS("video/x-raw, format={RGB}; "
+                                                                                  "image/jpeg; "
+                                                                                  "video/x-h264, parsed=true; "
+                                                                                  "video/x-h265, parsed=true")
 );
 
 #define gst_lookout_vision_parent_class parent_class
@@ -57,10 +242,30 @@ static void gst_lookout_vision_set_property(GObject * object, guint prop_id,
 static void gst_lookout_vision_get_property(GObject * object, guint prop_id,
                                             GValue * value, GParamSpec * pspec);
 static void gst_lookout_vision_finalize(GObject *object);
+static GstStateChangeReturn gst_lookout_vision_change_state(GstElement *element, GstStateChange transition);
+static void gst_lookout_vision_swap_model(gpointer data, gpointer user_data);
 
 static gboolean gst_lookout_vision_sink_event(GstPad * pad, GstObject * parent, GstEvent * event);
+static gboolean gst_lookout_vision_src_event(GstPad * pad, GstObject * parent, GstEvent * event);
+static void gst_lookout_vision_trigger(GstLookoutVision *filter, GstClockTime running_time);
+static void gst_lookout_vision_set_coded_caps(GstLookoutVision *filter, GstCaps *caps);
 static GstFlowReturn gst_lookout_vision_chain(GstPad * pad, GstObject * parent, GstBuffer * buf);
 
+GType gst_lookout_vision_trigger_mode_get_type(void) {
+    static volatile GType type = 0;
+    static const GEnumValue modes[] = {
+        {GST_LOOKOUT_VISION_TRIGGER_CONTINUOUS, "Infer every frame", "continuous"},
+        {GST_LOOKOUT_VISION_TRIGGER_EXTERNAL, "Infer the frames closest to trigger events and signals", "external"},
+        {0, NULL, NULL}
+    };
+
+    if (g_once_init_enter(&type)) {
+        GType _type = g_enum_register_static("GstLookoutVisionTriggerMode", modes);
+        g_once_init_leave(&type, _type);
+    }
+    return type;
+}
+
 /* initialize the lookoutvision class */
 static void gst_lookout_vision_class_init(GstLookoutVisionClass * klass) {
     GObjectClass *gobject_class;
@@ -72,18 +277,133 @@ static void gst_lookout_vision_class_init(GstLookoutVisionClass * klass) {
     gobject_class->set_property = gst_lookout_vision_set_property;
     gobject_class->get_property = gst_lookout_vision_get_property;
     gobject_class->finalize = gst_lookout_vision_finalize;
+    gstelement_class->change_state = gst_lookout_vision_change_state;
+    klass->trigger = gst_lookout_vision_trigger;
 
     g_object_class_install_property(gobject_class, PROP_SERVER_SOCKET,
-                                    g_param_spec_string("server-socket", "Server Socket", "Socket for gRPC server ?",
+                                    g_param_spec_string("server-socket", "Server Socket",
+                                                        "Socket of the Edge Agent gRPC server, or a comma separated "
+                                                        "list of agents to balance over",
                                                         "unix:///tmp/aws.iot.lookoutvision.EdgeAgent.sock",
                                                         G_PARAM_READWRITE));
     g_object_class_install_property(gobject_class, PROP_MODEL_COMPONENT,
-                                    g_param_spec_string("model-component", "Model Component", "Model Component", "foo",
-                                                        G_PARAM_READWRITE));
+                                    g_param_spec_string("model-component", "Model Component",
+                                                        "Model component, or a comma separated list of components "
+                                                        "serving the same model", "foo", G_PARAM_READWRITE));
     g_object_class_install_property(gobject_class, PROP_MODEL_STATUS_TIMEOUT,
                                     g_param_spec_uint("model-status-timeout", "Model Status Timeout",
                                                       "Timeout in seconds to wait for Model Status", 0, 600, 180,
                                                       G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_MAX_INFLIGHT,
+                                    g_param_spec_uint("max-inflight", "Max Inflight",
+                                                      "Frames sent for inference at once (1 infers on the streaming "
+                                                      "thread)", 1, 64, 1,
+                                                      (GParamFlags) (G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_HEALTH_CHECK_INTERVAL,
+                                    g_param_spec_uint("health-check-interval", "Health Check Interval",
+                                                      "Seconds between DescribeModel health checks of pooled "
+                                                      "endpoints", 1, 3600, 5, G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_STOP_PREVIOUS_MODEL,
+                                    g_param_spec_boolean("stop-previous-model", "Stop Previous Model",
+                                                         "Stop the previous model after model-component changed "
+                                                         "while streaming", FALSE, G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_WARMUP_FRAMES,
+                                    g_param_spec_uint("warmup-frames", "Warm-up Frames",
+                                                      "Blank frames inferred when a model becomes ready, before the "
+                                                      "first real frame", 0, 100, 0, G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_INFERENCE_TIMEOUT,
+                                    g_param_spec_uint("inference-timeout", "Inference Timeout",
+                                                      "Deadline in milliseconds of every Edge Agent call (0 waits "
+                                                      "forever)", 0, 600000, 0, G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_ADAPTIVE_TIMEOUT,
+                                    g_param_spec_boolean("adaptive-timeout", "Adaptive Timeout",
+                                                         "Derive the inference deadline from recent latencies of "
+                                                         "each model, bounded by inference-timeout", FALSE,
+                                                         G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_INFERENCE_WIDTH,
+                                    g_param_spec_uint("inference-width", "Inference Width",
+                                                      "Width frames are scaled to for inference (0 keeps the "
+                                                      "negotiated width or aspect ratio)", 0, 8192, 0,
+                                                      G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_INFERENCE_HEIGHT,
+                                    g_param_spec_uint("inference-height", "Inference Height",
+                                                      "Height frames are scaled to for inference (0 keeps the "
+                                                      "negotiated height or aspect ratio)", 0, 8192, 0,
+                                                      G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_KEYFRAME_INTERVAL,
+                                    g_param_spec_uint("keyframe-interval", "Keyframe Interval",
+                                                      "Infer every Nth keyframe of H.264 and H.265 streams", 1, 10000,
+                                                      1, G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_MIN_SHARPNESS,
+                                    g_param_spec_double("min-sharpness", "Min Sharpness",
+                                                        "Frames whose Laplacian variance is below this are not "
+                                                        "inferred (0 disables)", 0, G_MAXDOUBLE, 0,
+                                                        G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_MIN_BRIGHTNESS,
+                                    g_param_spec_double("min-brightness", "Min Brightness",
+                                                        "Frames whose mean luma is below this are not inferred", 0,
+                                                        255, 0, G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_MAX_BRIGHTNESS,
+                                    g_param_spec_double("max-brightness", "Max Brightness",
+                                                        "Frames whose mean luma is above this are not inferred", 0,
+                                                        255, 255, G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_MAX_CLIPPED,
+                                    g_param_spec_double("max-clipped", "Max Clipped",
+                                                        "Frames with a larger fraction of black or white clipped "
+                                                        "pixels are not inferred", 0, 1, 1, G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_SCREENING_MODEL_COMPONENT,
+                                    g_param_spec_string("screening-model-component", "Screening Model Component",
+                                                        "Fast model frames are first inferred with at the screening "
+                                                        "resolution (NULL infers with model-component only)", NULL,
+                                                        G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_SCREENING_WIDTH,
+                                    g_param_spec_uint("screening-width", "Screening Width",
+                                                      "Width frames are scaled to for screening (0 keeps the "
+                                                      "negotiated width or aspect ratio)", 0, 8192, 0,
+                                                      G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_SCREENING_HEIGHT,
+                                    g_param_spec_uint("screening-height", "Screening Height",
+                                                      "Height frames are scaled to for screening (0 keeps the "
+                                                      "negotiated height or aspect ratio)", 0, 8192, 0,
+                                                      G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_SCREENING_CONFIDENCE,
+                                    g_param_spec_double("screening-confidence", "Screening Confidence",
+                                                        "Normal screening verdicts less confident than this are "
+                                                        "inferred again with model-component", 0, 1, 0.9,
+                                                        G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_TRIGGER_MODE,
+                                    g_param_spec_enum("trigger-mode", "Trigger Mode",
+                                                      "Infer every frame, or only the frames triggered by events or "
+                                                      "the trigger signal", GST_TYPE_LOOKOUT_VISION_TRIGGER_MODE,
+                                                      GST_LOOKOUT_VISION_TRIGGER_CONTINUOUS,
+                                                      (GParamFlags) (G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_TRIGGER_HISTORY,
+                                    g_param_spec_uint("trigger-history", "Trigger History",
+                                                      "Frames kept in external trigger mode for the triggers to pick "
+                                                      "from", 1, 256, 8, G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_INFER_REGIONS,
+                                    g_param_spec_boolean("infer-regions", "Infer Regions",
+                                                         "Infer only the GstVideoRegionOfInterestMeta regions of each "
+                                                         "frame", FALSE,
+                                                         (GParamFlags) (G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_REGION_TYPE,
+                                    g_param_spec_string("region-type", "Region Type",
+                                                        "With infer-regions, only infer the regions of this type "
+                                                        "(all regions when unset)", NULL, G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_MAX_REGIONS_INFLIGHT,
+                                    g_param_spec_uint("max-regions-inflight", "Max Regions Inflight",
+                                                      "With infer-regions, regions sent for inference at once", 1, 64,
+                                                      4, (GParamFlags) (G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_STATS,
+                                    g_param_spec_boxed("stats", "Statistics",
+                                                       "Latencies of the last warm-up and the first frame after it, "
+                                                       "and the frames each cascade stage ran on",
+                                                       GST_TYPE_STRUCTURE, G_PARAM_READABLE));
+
+    gst_lookout_vision_signals[SIGNAL_TRIGGER] =
+            g_signal_new("trigger", G_TYPE_FROM_CLASS(klass), (GSignalFlags) (G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION),
+                         G_STRUCT_OFFSET(GstLookoutVisionClass, trigger), NULL, NULL, NULL, G_TYPE_NONE, 1,
+                         G_TYPE_UINT64);
 
     gst_element_class_set_details_simple(gstelement_class,
                                          "LookoutVision",
@@ -97,6 +417,14 @@ static void gst_lookout_vision_class_init(GstLookoutVisionClass * klass) {
                                        gst_static_pad_template_get(&sink_factory));
 }
 
+static void gst_lookout_vision_free_decoders(GstLookoutVision *filter) {
+    GstLookoutVisionIdleDecoder *idle;
+    while ((idle = (GstLookoutVisionIdleDecoder*) g_async_queue_try_pop(filter->decoders))) {
+        gst_lookout_vision_decoder_free(idle->decoder);
+        g_free(idle);
+    }
+}
+
 static GstPadProbeReturn pad_probe(GstPad *pad, GstPadProbeInfo *info, gpointer user_data) {
     GstEvent *event = GST_PAD_PROBE_INFO_EVENT(info);
     if (GST_EVENT_CAPS == GST_EVENT_TYPE(event)) {
@@ -104,12 +432,30 @@ static GstPadProbeReturn pad_probe(GstPad *pad, GstPadProbeInfo *info, gpointer
         int width, height;
         gst_event_parse_caps(event, &caps);
         GstStructure *s = gst_caps_get_structure(caps, 0);
+        GstLookoutVision* filter = (GstLookoutVision*) user_data;
+        if (gst_structure_has_name(s, "image/jpeg")) {
+            filter->input = GST_LOOKOUT_VISION_INPUT_JPEG;
+        } else if (gst_structure_has_name(s, "video/x-h264") || gst_structure_has_name(s, "video/x-h265")) {
+            filter->input = GST_LOOKOUT_VISION_INPUT_CODED;
+            gst_lookout_vision_set_coded_caps(filter, caps);
+            filter->keyframes = 0;
+        } else {
+            filter->input = GST_LOOKOUT_VISION_INPUT_RGB;
+        }
         if (!gst_structure_get_int(s, "width", &width)
             || !gst_structure_get_int(s, "height", &height)) {
+            if (filter->input != GST_LOOKOUT_VISION_INPUT_RGB) {
+                // Every frame carries its own dimensions
+                filter->width = 0;
+                filter->height = 0;
+                return GST_PAD_PROBE_OK;
+            }
             g_print("no dimensions\n");
             return GST_PAD_PROBE_REMOVE;
         }
-        GstLookoutVision* filter = (GstLookoutVision*) user_data;
+        if (width != filter->width || height != filter->height) {
+            filter->warmed_up = FALSE;
+        }
         filter->width = width;
         filter->height = height;
     }
@@ -130,124 +476,1718 @@ static void gst_lookout_vision_init(GstLookoutVision * filter) {
     gst_element_add_pad(GST_ELEMENT (filter), filter->sinkpad);
 
     filter->srcpad = gst_pad_new_from_static_template(&src_factory, "src");
+    gst_pad_set_event_function(filter->srcpad, GST_DEBUG_FUNCPTR(gst_lookout_vision_src_event));
     GST_PAD_SET_PROXY_CAPS(filter->srcpad);
     gst_element_add_pad(GST_ELEMENT (filter), filter->srcpad);
 
     gst_pad_add_probe(filter->sinkpad, GST_PAD_PROBE_TYPE_EVENT_BOTH, pad_probe, filter, nullptr);
 
     // Set default properties
-    filter->model_component = NULL;
-    filter->model_status_timeout = 180;
-    filter->server_socket = g_strdup("unix:///tmp/aws.iot.lookoutvision.EdgeAgent.sock");
-    filter->inference_client = new LookoutVisionInferenceClient(filter->server_socket);
+    filter->config = new GstLookoutVisionConfig{1, g_strdup("unix:///tmp/aws.iot.lookoutvision.EdgeAgent.sock"), NULL,
+                                                180, FALSE, 0, 0, 0, 1, 0, 0, 255, 1, NULL, 0, 0, 0.9, 8, NULL, 5, 0,
+                                                FALSE};
+    filter->config_readers = 0;
+    g_mutex_init(&filter->config_lock);
+    filter->requested_model_component = NULL;
+    filter->swap_pool = NULL;
+    filter->warmed_up = FALSE;
+    filter->first_frame_pending = FALSE;
+    g_mutex_init(&filter->stats_lock);
+    filter->warmup_latencies = g_array_new(FALSE, FALSE, sizeof(guint64));
+    filter->warmup_sizes = g_array_new(FALSE, FALSE, sizeof(GstLookoutVisionSize));
+    filter->first_frame_latency = 0;
+    filter->screened_frames = 0;
+    filter->escalated_frames = 0;
+    filter->max_inflight = 1;
+    filter->thread_pool = NULL;
+    g_queue_init(&filter->pending);
+    g_mutex_init(&filter->pending_lock);
+    g_cond_init(&filter->pending_cond);
+    filter->flushing = FALSE;
+    filter->input = GST_LOOKOUT_VISION_INPUT_RGB;
+    filter->coded_caps = NULL;
+    filter->caps_generation = 0;
+    filter->parameter_sets = NULL;
+    filter->decoders = g_async_queue_new();
+    filter->keyframes = 0;
+    filter->trigger_mode = GST_LOOKOUT_VISION_TRIGGER_CONTINUOUS;
+    gst_segment_init(&filter->segment, GST_FORMAT_TIME);
+    g_queue_init(&filter->history);
+    filter->pending_triggers = g_array_new(FALSE, FALSE, sizeof(GstLookoutVisionTrigger));
+    g_mutex_init(&filter->history_lock);
+    filter->trigger_pool = NULL;
+    filter->triggers_inflight = 0;
+    filter->infer_regions = FALSE;
+    filter->max_regions_inflight = 4;
+    filter->region_pool = NULL;
+    filter->inference_client = NULL;
+}
+
+static GstLookoutVisionConfig* gst_lookout_vision_config_copy(const GstLookoutVisionConfig *config) {
+    return new GstLookoutVisionConfig{1, g_strdup(config->server_socket), g_strdup(config->model_component),
+                                      config->model_status_timeout, config->stop_previous_model,
+                                      config->warmup_frames, config->inference_width,
+                                      config->inference_height, config->keyframe_interval,
+                                      config->min_sharpness, config->min_brightness, config->max_brightness,
+                                      config->max_clipped, g_strdup(config->screening_model_component),
+                                      config->screening_width, config->screening_height,
+                                      config->screening_confidence, config->trigger_history,
+                                      g_strdup(config->region_type), config->health_check_interval,
+                                      config->inference_timeout, config->adaptive_timeout};
+}
+
+static void gst_lookout_vision_config_unref(GstLookoutVisionConfig *config) {
+    if (g_atomic_int_dec_and_test(&config->ref_count)) {
+        g_free(config->server_socket);
+        g_free(config->model_component);
+        g_free(config->screening_model_component);
+        g_free(config->region_type);
+        delete config;
+    }
+}
+
+/*
+ * Wait-free: takes a reference on the current snapshot without locking. config_readers covers the window between
+ * loading the pointer and taking the reference, so a writer never frees a snapshot that is about to be referenced.
+ */
+static GstLookoutVisionConfig* gst_lookout_vision_acquire_config(GstLookoutVision *filter) {
+    g_atomic_int_inc(&filter->config_readers);
+    GstLookoutVisionConfig *config = (GstLookoutVisionConfig*) g_atomic_pointer_get(&filter->config);
+    g_atomic_int_inc(&config->ref_count);
+    g_atomic_int_add(&filter->config_readers, -1);
+    return config;
+}
+
+/* Must be called with config_lock held. Takes ownership of config */
+static void gst_lookout_vision_publish_config(GstLookoutVision *filter, GstLookoutVisionConfig *config) {
+    GstLookoutVisionConfig *previous = filter->config;
+    g_atomic_pointer_set(&filter->config, config);
+    // Readers that loaded previous before the swap are done with the pointer after a few instructions
+    while (g_atomic_int_get(&filter->config_readers) > 0) {
+        g_thread_yield();
+    }
+    gst_lookout_vision_config_unref(previous);
+}
+
+/* Publishes a copy of the current snapshot with mutate applied to it; mutate runs with config_lock held */
+static void gst_lookout_vision_update_config(GstLookoutVision *filter,
+                                             const std::function<void(GstLookoutVisionConfig*)> &mutate) {
+    g_mutex_lock(&filter->config_lock);
+    GstLookoutVisionConfig *config = gst_lookout_vision_config_copy(filter->config);
+    mutate(config);
+    gst_lookout_vision_publish_config(filter, config);
+    g_mutex_unlock(&filter->config_lock);
+}
+
+/* PAUSED or PLAYING, or on the way there */
+static gboolean gst_lookout_vision_is_streaming(GstLookoutVision *filter) {
+    GST_OBJECT_LOCK(filter);
+    gboolean streaming = GST_STATE(filter) >= GST_STATE_PAUSED || GST_STATE_PENDING(filter) >= GST_STATE_PAUSED;
+    GST_OBJECT_UNLOCK(filter);
+    return streaming;
+}
+
+/*
+ * The plain fields of the element size the pools created on READY to PAUSED and are read without a snapshot, so they
+ * only change in NULL or READY.
+ */
+static gboolean gst_lookout_vision_check_mutable(GstLookoutVision *filter, GParamSpec *pspec) {
+    if (gst_lookout_vision_is_streaming(filter)) {
+        GST_WARNING_OBJECT(filter, "%s can only be changed in the NULL or READY state, keeping its value",
+                           g_param_spec_get_name(pspec));
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* Either target dimension left at 0 follows the aspect ratio of the frame, both at 0 keep its resolution */
+static void gst_lookout_vision_scaled_size(guint target_width, guint target_height, int width, int height,
+                                           int *scaled_width, int *scaled_height) {
+    *scaled_width = target_width;
+    *scaled_height = target_height;
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+    if (*scaled_width == 0 && *scaled_height == 0) {
+        *scaled_width = width;
+        *scaled_height = height;
+    } else if (*scaled_width == 0) {
+        *scaled_width = MAX(1, (int) gst_util_uint64_scale_int_round(*scaled_height, width, height));
+    } else if (*scaled_height == 0) {
+        *scaled_height = MAX(1, (int) gst_util_uint64_scale_int_round(*scaled_width, height, width));
+    }
+}
+
+/* Frames are inferred at inference-width by inference-height */
+static void gst_lookout_vision_inference_size(const GstLookoutVisionConfig *config, int width, int height,
+                                              int *inference_width, int *inference_height) {
+    gst_lookout_vision_scaled_size(config->inference_width, config->inference_height, width, height, inference_width,
+                                   inference_height);
+}
+
+/*
+ * The first calls to a model that just became ready are much slower than the ones after; blank frames at each of the
+ * sizes frames are inferred at absorb them. The latency of every warm-up call is appended to latencies.
+ */
+static void gst_lookout_vision_warm_up(GstLookoutVision *filter, const gchar *model_component, guint frames,
+                                       const GArray *sizes, GArray *latencies) {
+    if (!model_component || frames == 0 || sizes->len == 0) {
+        return;
+    }
+
+    guint first = latencies->len;
+    gboolean serving = TRUE;
+    for (guint s = 0; s < sizes->len && serving; s++) {
+        const GstLookoutVisionSize &size = g_array_index(sizes, GstLookoutVisionSize, s);
+        size_t bytes_size = (size_t) size.width * size.height * 3;
+        guint8 *frame = (guint8*) g_malloc0(bytes_size);
+        for (guint i = 0; i < frames && serving; i++) {
+            gint64 start = g_get_monotonic_time();
+            GstLookoutVisionResult *result = filter->inference_client->DetectAnomalies(model_component, frame,
+                                                                                       bytes_size, size.width,
+                                                                                       size.height, true);
+            guint64 latency = (g_get_monotonic_time() - start) * GST_USECOND;
+            g_array_append_val(latencies, latency);
+            // When the model is not serving, real frames will report the failure
+            serving = result->result_status == GstLookoutVisionResultStatus::SUCCESSFUL;
+            delete result;
+        }
+        g_free(frame);
+    }
+    GST_INFO_OBJECT(filter, "Warmed up %s with %u frames, last took %" G_GUINT64_FORMAT " ms", model_component,
+                    latencies->len - first, g_array_index(latencies, guint64, latencies->len - 1) / GST_MSECOND);
+}
+
+/* Takes latencies for the stats property, when any warm-up call was made */
+static void gst_lookout_vision_keep_warmup_latencies(GstLookoutVision *filter, GArray *latencies) {
+    if (latencies->len == 0) {
+        g_array_unref(latencies);
+        return;
+    }
+    g_mutex_lock(&filter->stats_lock);
+    g_array_unref(filter->warmup_latencies);
+    filter->warmup_latencies = latencies;
+    g_mutex_unlock(&filter->stats_lock);
+    g_atomic_int_set(&filter->first_frame_pending, TRUE);
+}
+
+/* Must be called with config_lock held. The swap to model_component is over, whether it happened or not */
+static void gst_lookout_vision_swap_done(GstLookoutVision *filter, const gchar *model_component) {
+    if (g_strcmp0(filter->requested_model_component, model_component) == 0) {
+        g_free(filter->requested_model_component);
+        filter->requested_model_component = NULL;
+    }
+}
+
+static void gst_lookout_vision_post_swap(GstLookoutVision *filter, const gchar *model_component,
+                                         const gchar *previous_model_component, gboolean swapped) {
+    GstStructure *swap = gst_structure_new(MODEL_SWAP_MESSAGE_NAME,
+                                           "model-component", G_TYPE_STRING, model_component,
+                                           "previous-model-component", G_TYPE_STRING, previous_model_component,
+                                           "swapped", G_TYPE_BOOLEAN, swapped,
+                                           NULL);
+    gst_element_post_message(GST_ELEMENT(filter), gst_message_new_element(GST_OBJECT(filter), swap));
+}
+
+/*
+ * Runs on swap_pool. The previous model keeps serving until the new one is RUNNING, and is released once the frames
+ * already sent to it returned. The outcome is posted as a lookoutvision-model-swap element message.
+ */
+static void gst_lookout_vision_swap_model(gpointer data, gpointer user_data) {
+    GstLookoutVision *filter = (GstLookoutVision*) user_data;
+    gchar *model_component = (gchar*) data;
+
+    GstLookoutVisionConfig *started = gst_lookout_vision_acquire_config(filter);
+    LookoutVisionInferenceClient::OperationStatus status = filter->inference_client->StartModel(
+            model_component, started->model_status_timeout);
+    if (status != LookoutVisionInferenceClient::OperationStatus::SUCCESSFUL) {
+        GST_ELEMENT_WARNING(filter, LIBRARY, FAILED, (NULL),
+                            ("Failed to start model %s, keeping the previous model", model_component));
+        g_mutex_lock(&filter->config_lock);
+        gst_lookout_vision_swap_done(filter, model_component);
+        g_mutex_unlock(&filter->config_lock);
+        gst_lookout_vision_post_swap(filter, model_component, started->model_component, FALSE);
+        gst_lookout_vision_config_unref(started);
+        g_free(model_component);
+        return;
+    }
+    // Frames keep going to the previous model meanwhile, at the sizes the current model was warmed up at
+    g_mutex_lock(&filter->stats_lock);
+    GArray *warmup_sizes = g_array_ref(filter->warmup_sizes);
+    g_mutex_unlock(&filter->stats_lock);
+    GArray *latencies = g_array_new(FALSE, FALSE, sizeof(guint64));
+    gst_lookout_vision_warm_up(filter, model_component, started->warmup_frames, warmup_sizes, latencies);
+    gst_lookout_vision_keep_warmup_latencies(filter, latencies);
+    g_array_unref(warmup_sizes);
+    gst_lookout_vision_config_unref(started);
+
+    g_mutex_lock(&filter->config_lock);
+    GstLookoutVisionConfig *previous = filter->config;
+    g_atomic_int_inc(&previous->ref_count);
+    GstLookoutVisionConfig *config = gst_lookout_vision_config_copy(previous);
+    g_free(config->model_component);
+    config->model_component = model_component;
+    gst_lookout_vision_publish_config(filter, config);
+    gst_lookout_vision_swap_done(filter, model_component);
+    GST_INFO_OBJECT(filter, "Switched model-component from %s to %s", GST_STR_NULL(previous->model_component),
+                    model_component);
+    gboolean release = previous->model_component && g_strcmp0(previous->model_component, model_component) != 0;
+    gboolean stop_previous_model = config->stop_previous_model;
+    g_mutex_unlock(&filter->config_lock);
+
+    gst_lookout_vision_post_swap(filter, model_component, previous->model_component, TRUE);
+    if (release) {
+        filter->inference_client->ReleaseModel(previous->model_component, stop_previous_model);
+    }
+    gst_lookout_vision_config_unref(previous);
 }
 
 static void gst_lookout_vision_set_property(GObject * object, guint prop_id, const GValue * value, GParamSpec * pspec) {
     GstLookoutVision *filter = GST_LOOKOUTVISION(object);
+    GstLookoutVisionConfig *current = gst_lookout_vision_acquire_config(filter);
 
     switch (prop_id) {
         case PROP_SERVER_SOCKET:
-            g_free(filter->server_socket);
-            filter->server_socket = g_strdup(g_value_get_string(value));
-            filter->inference_client->setServerSocket(filter->server_socket);
-            if (filter->model_component) {
-                if (filter->inference_client->StartModel(filter->model_component, filter->model_status_timeout)
-                        != LookoutVisionInferenceClient::OperationStatus::SUCCESSFUL) {
-                    GST_ELEMENT_ERROR(filter, LIBRARY, FAILED, (NULL), ("Failed to start model"));
+            gst_lookout_vision_update_config(filter, [filter, value](GstLookoutVisionConfig *config) {
+                g_free(config->server_socket);
+                config->server_socket = g_value_dup_string(value);
+                if (filter->inference_client) {
+                    // The client keeps the channels of calls in flight alive
+                    filter->inference_client->setServerSocket(config->server_socket);
                 }
+            });
+            if (current->model_component && gst_lookout_vision_is_streaming(filter)) {
+                // Starts the model on the new agents without stalling the stream
+                g_thread_pool_push(filter->swap_pool, g_strdup(current->model_component), NULL);
             }
             break;
         case PROP_MODEL_COMPONENT:
-            if (filter->inference_client->StartModel(g_value_get_string(value), filter->model_status_timeout)
-                    != LookoutVisionInferenceClient::OperationStatus::SUCCESSFUL) {
-                GST_ELEMENT_ERROR(filter, LIBRARY, FAILED, (NULL), ("Failed to start model"));
+            if (gst_lookout_vision_is_streaming(filter)) {
+                // Swapping while streaming must not stall the caller or the stream
+                g_mutex_lock(&filter->config_lock);
+                g_free(filter->requested_model_component);
+                filter->requested_model_component = g_value_dup_string(value);
+                g_mutex_unlock(&filter->config_lock);
+                g_thread_pool_push(filter->swap_pool, g_value_dup_string(value), NULL);
             } else {
-                g_free(filter->model_component);
-                filter->model_component = g_strdup(g_value_get_string(value));
+                // Started on the way to PAUSED
+                gst_lookout_vision_update_config(filter, [filter, value](GstLookoutVisionConfig *config) {
+                    g_free(config->model_component);
+                    config->model_component = g_value_dup_string(value);
+                    g_free(filter->requested_model_component);
+                    filter->requested_model_component = NULL;
+                });
             }
             break;
         case PROP_MODEL_STATUS_TIMEOUT:
-            filter->model_status_timeout = g_value_get_uint(value);
+            gst_lookout_vision_update_config(filter, [value](GstLookoutVisionConfig *config) {
+                config->model_status_timeout = g_value_get_uint(value);
+            });
+            break;
+        case PROP_MAX_INFLIGHT:
+            if (gst_lookout_vision_check_mutable(filter, pspec)) {
+                filter->max_inflight = g_value_get_uint(value);
+            }
+            break;
+        case PROP_TRIGGER_MODE:
+            if (gst_lookout_vision_check_mutable(filter, pspec)) {
+                filter->trigger_mode = (GstLookoutVisionTriggerMode) g_value_get_enum(value);
+            }
+            break;
+        case PROP_TRIGGER_HISTORY:
+            gst_lookout_vision_update_config(filter, [value](GstLookoutVisionConfig *config) {
+                config->trigger_history = g_value_get_uint(value);
+            });
+            break;
+        case PROP_INFER_REGIONS:
+            if (gst_lookout_vision_check_mutable(filter, pspec)) {
+                filter->infer_regions = g_value_get_boolean(value);
+            }
+            break;
+        case PROP_REGION_TYPE:
+            gst_lookout_vision_update_config(filter, [value](GstLookoutVisionConfig *config) {
+                g_free(config->region_type);
+                config->region_type = g_value_dup_string(value);
+            });
+            break;
+        case PROP_MAX_REGIONS_INFLIGHT:
+            if (gst_lookout_vision_check_mutable(filter, pspec)) {
+                filter->max_regions_inflight = g_value_get_uint(value);
+            }
+            break;
+        case PROP_HEALTH_CHECK_INTERVAL:
+            gst_lookout_vision_update_config(filter, [filter, value](GstLookoutVisionConfig *config) {
+                config->health_check_interval = g_value_get_uint(value);
+                if (filter->inference_client) {
+                    filter->inference_client->setHealthCheckInterval(config->health_check_interval);
+                }
+            });
+            break;
+        case PROP_INFERENCE_TIMEOUT:
+            gst_lookout_vision_update_config(filter, [filter, value](GstLookoutVisionConfig *config) {
+                config->inference_timeout = g_value_get_uint(value);
+                if (filter->inference_client) {
+                    filter->inference_client->setInferenceTimeout(config->inference_timeout, config->adaptive_timeout);
+                }
+            });
+            break;
+        case PROP_ADAPTIVE_TIMEOUT:
+            gst_lookout_vision_update_config(filter, [filter, value](GstLookoutVisionConfig *config) {
+                config->adaptive_timeout = g_value_get_boolean(value);
+                if (filter->inference_client) {
+                    filter->inference_client->setInferenceTimeout(config->inference_timeout, config->adaptive_timeout);
+                }
+            });
+            break;
+        case PROP_STOP_PREVIOUS_MODEL:
+            gst_lookout_vision_update_config(filter, [value](GstLookoutVisionConfig *config) {
+                config->stop_previous_model = g_value_get_boolean(value);
+            });
+            break;
+        case PROP_WARMUP_FRAMES:
+            gst_lookout_vision_update_config(filter, [value](GstLookoutVisionConfig *config) {
+                config->warmup_frames = g_value_get_uint(value);
+            });
+            break;
+        case PROP_INFERENCE_WIDTH:
+            gst_lookout_vision_update_config(filter, [value](GstLookoutVisionConfig *config) {
+                config->inference_width = g_value_get_uint(value);
+            });
+            break;
+        case PROP_INFERENCE_HEIGHT:
+            gst_lookout_vision_update_config(filter, [value](GstLookoutVisionConfig *config) {
+                config->inference_height = g_value_get_uint(value);
+            });
+            break;
+        case PROP_KEYFRAME_INTERVAL:
+            gst_lookout_vision_update_config(filter, [value](GstLookoutVisionConfig *config) {
+                config->keyframe_interval = g_value_get_uint(value);
+            });
+            break;
+        case PROP_MIN_SHARPNESS:
+            gst_lookout_vision_update_config(filter, [value](GstLookoutVisionConfig *config) {
+                config->min_sharpness = g_value_get_double(value);
+            });
+            break;
+        case PROP_MIN_BRIGHTNESS:
+            gst_lookout_vision_update_config(filter, [value](GstLookoutVisionConfig *config) {
+                config->min_brightness = g_value_get_double(value);
+            });
+            break;
+        case PROP_MAX_BRIGHTNESS:
+            gst_lookout_vision_update_config(filter, [value](GstLookoutVisionConfig *config) {
+                config->max_brightness = g_value_get_double(value);
+            });
+            break;
+        case PROP_MAX_CLIPPED:
+            gst_lookout_vision_update_config(filter, [value](GstLookoutVisionConfig *config) {
+                config->max_clipped = g_value_get_double(value);
+            });
+            break;
+        case PROP_SCREENING_MODEL_COMPONENT:
+            // Started on the way to PAUSED, like model-component
+            gst_lookout_vision_update_config(filter, [value](GstLookoutVisionConfig *config) {
+                g_free(config->screening_model_component);
+                config->screening_model_component = g_value_dup_string(value);
+            });
+            break;
+        case PROP_SCREENING_WIDTH:
+            gst_lookout_vision_update_config(filter, [value](GstLookoutVisionConfig *config) {
+                config->screening_width = g_value_get_uint(value);
+            });
+            break;
+        case PROP_SCREENING_HEIGHT:
+            gst_lookout_vision_update_config(filter, [value](GstLookoutVisionConfig *config) {
+                config->screening_height = g_value_get_uint(value);
+            });
+            break;
+        case PROP_SCREENING_CONFIDENCE:
+            gst_lookout_vision_update_config(filter, [value](GstLookoutVisionConfig *config) {
+                config->screening_confidence = g_value_get_double(value);
+            });
             break;
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
             break;
     }
+    gst_lookout_vision_config_unref(current);
 }
 
 static void gst_lookout_vision_get_property(GObject * object, guint prop_id, GValue * value, GParamSpec * pspec) {
     GstLookoutVision *filter = GST_LOOKOUTVISION(object);
+    GstLookoutVisionConfig *config = gst_lookout_vision_acquire_config(filter);
 
     switch (prop_id) {
         case PROP_SERVER_SOCKET:
-            g_value_set_string(value, filter->server_socket);
+            g_value_set_string(value, config->server_socket);
             break;
         case PROP_MODEL_COMPONENT:
-            g_value_set_string(value, filter->model_component);
+            // The last value set, even while it is still being started
+            g_mutex_lock(&filter->config_lock);
+            g_value_set_string(value, filter->requested_model_component ? filter->requested_model_component
+                                                                        : filter->config->model_component);
+            g_mutex_unlock(&filter->config_lock);
             break;
         case PROP_MODEL_STATUS_TIMEOUT:
-            g_value_set_uint(value, filter->model_status_timeout);
+            g_value_set_uint(value, config->model_status_timeout);
+            break;
+        case PROP_MAX_INFLIGHT:
+            g_value_set_uint(value, filter->max_inflight);
+            break;
+        case PROP_TRIGGER_MODE:
+            g_value_set_enum(value, filter->trigger_mode);
+            break;
+        case PROP_TRIGGER_HISTORY:
+            g_value_set_uint(value, config->trigger_history);
+            break;
+        case PROP_INFER_REGIONS:
+            g_value_set_boolean(value, filter->infer_regions);
+            break;
+        case PROP_REGION_TYPE:
+            g_value_set_string(value, config->region_type);
             break;
+        case PROP_MAX_REGIONS_INFLIGHT:
+            g_value_set_uint(value, filter->max_regions_inflight);
+            break;
+        case PROP_HEALTH_CHECK_INTERVAL:
+            g_value_set_uint(value, config->health_check_interval);
+            break;
+        case PROP_INFERENCE_TIMEOUT:
+            g_value_set_uint(value, config->inference_timeout);
+            break;
+        case PROP_ADAPTIVE_TIMEOUT:
+            g_value_set_boolean(value, config->adaptive_timeout);
+            break;
+        case PROP_STOP_PREVIOUS_MODEL:
+            g_value_set_boolean(value, config->stop_previous_model);
+            break;
+        case PROP_WARMUP_FRAMES:
+            g_value_set_uint(value, config->warmup_frames);
+            break;
+        case PROP_INFERENCE_WIDTH:
+            g_value_set_uint(value, config->inference_width);
+            break;
+        case PROP_INFERENCE_HEIGHT:
+            g_value_set_uint(value, config->inference_height);
+            break;
+        case PROP_KEYFRAME_INTERVAL:
+            g_value_set_uint(value, config->keyframe_interval);
+            break;
+        case PROP_MIN_SHARPNESS:
+            g_value_set_double(value, config->min_sharpness);
+            break;
+        case PROP_MIN_BRIGHTNESS:
+            g_value_set_double(value, config->min_brightness);
+            break;
+        case PROP_MAX_BRIGHTNESS:
+            g_value_set_double(value, config->max_brightness);
+            break;
+        case PROP_MAX_CLIPPED:
+            g_value_set_double(value, config->max_clipped);
+            break;
+        case PROP_SCREENING_MODEL_COMPONENT:
+            g_value_set_string(value, config->screening_model_component);
+            break;
+        case PROP_SCREENING_WIDTH:
+            g_value_set_uint(value, config->screening_width);
+            break;
+        case PROP_SCREENING_HEIGHT:
+            g_value_set_uint(value, config->screening_height);
+            break;
+        case PROP_SCREENING_CONFIDENCE:
+            g_value_set_double(value, config->screening_confidence);
+            break;
+        case PROP_STATS: {
+            GValue latencies = G_VALUE_INIT;
+            gst_value_array_init(&latencies, 0);
+            g_mutex_lock(&filter->stats_lock);
+            for (guint i = 0; i < filter->warmup_latencies->len; i++) {
+                GValue latency = G_VALUE_INIT;
+                g_value_init(&latency, G_TYPE_UINT64);
+                g_value_set_uint64(&latency, g_array_index(filter->warmup_latencies, guint64, i));
+                gst_value_array_append_and_take_value(&latencies, &latency);
+            }
+            guint64 first_frame_latency = filter->first_frame_latency;
+            guint64 screened_frames = filter->screened_frames;
+            guint64 escalated_frames = filter->escalated_frames;
+            g_mutex_unlock(&filter->stats_lock);
+            GstStructure *stats = gst_structure_new("stats",
+                                                    "first-frame-latency", G_TYPE_UINT64, first_frame_latency,
+                                                    "screened-frames", G_TYPE_UINT64, screened_frames,
+                                                    "escalated-frames", G_TYPE_UINT64, escalated_frames,
+                                                    NULL);
+            gst_structure_take_value(stats, "warmup-latencies", &latencies);
+            g_value_take_boxed(value, stats);
+            break;
+        }
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
             break;
     }
+    gst_lookout_vision_config_unref(config);
 }
 
 static void gst_lookout_vision_finalize(GObject *object) {
     GstLookoutVision *filter = GST_LOOKOUTVISION(object);
     if (filter) {
         GST_DEBUG_OBJECT(filter, "finalize");
-        delete filter->inference_client;
-        filter->inference_client = NULL;
-        g_free(filter->server_socket);
-        filter->server_socket = NULL;
-        g_free(filter->model_component);
-        filter->model_component = NULL;
+        gst_lookout_vision_config_unref(filter->config);
+        filter->config = NULL;
+        g_free(filter->requested_model_component);
+        filter->requested_model_component = NULL;
+        g_mutex_clear(&filter->config_lock);
+        g_array_unref(filter->warmup_latencies);
+        filter->warmup_latencies = NULL;
+        g_array_unref(filter->warmup_sizes);
+        filter->warmup_sizes = NULL;
+        g_mutex_clear(&filter->stats_lock);
+        g_mutex_clear(&filter->pending_lock);
+        g_cond_clear(&filter->pending_cond);
+        gst_lookout_vision_free_decoders(filter);
+        g_async_queue_unref(filter->decoders);
+        gst_caps_replace(&filter->coded_caps, NULL);
+        gst_buffer_replace(&filter->parameter_sets, NULL);
+        g_array_unref(filter->pending_triggers);
+        filter->pending_triggers = NULL;
+        g_mutex_clear(&filter->history_lock);
     }
     G_OBJECT_CLASS(parent_class)->finalize(object);
 }
 
-/* this function handles sink events */
-static gboolean gst_lookout_vision_sink_event(GstPad * pad, GstObject * parent, GstEvent * event) {
-    GST_LOG_OBJECT(GST_LOOKOUTVISION(parent), "Received %s event: %" GST_PTR_FORMAT, GST_EVENT_TYPE_NAME(event), event);
-    return gst_pad_event_default(pad, parent, event);
+static gboolean gst_lookout_vision_quality_gated(const GstLookoutVisionConfig *config) {
+    return config->min_sharpness > 0 || config->min_brightness > 0 || config->max_brightness < 255
+           || config->max_clipped < 1;
 }
 
-/* chain function */
-static GstFlowReturn gst_lookout_vision_chain(GstPad * pad, GstObject * parent, GstBuffer * buf) {
-    GstLookoutVision *filter;
-    filter = GST_LOOKOUTVISION(parent);
+/*
+ * Measures the frame at the resolution it arrived or was decoded at, before any scaling. Returns the SKIPPED_QUALITY
+ * result of a frame failing a threshold, NULL for a frame to infer.
+ */
+static GstLookoutVisionResult* gst_lookout_vision_check_quality(const GstLookoutVisionConfig *config,
+                                                                const guint8 *frame, int width, int height,
+                                                                int stride) {
+    if (!gst_lookout_vision_quality_gated(config)) {
+        return NULL;
+    }
+    FrameQuality::Statistics statistics = FrameQuality(width, height, stride).Measure(frame);
+    gchar *reason = NULL;
+    if (statistics.sharpness < config->min_sharpness) {
+        reason = g_strdup_printf("Sharpness %.1f below min-sharpness", statistics.sharpness);
+    } else if (statistics.brightness < config->min_brightness) {
+        reason = g_strdup_printf("Brightness %.1f below min-brightness", statistics.brightness);
+    } else if (statistics.brightness > config->max_brightness) {
+        reason = g_strdup_printf("Brightness %.1f above max-brightness", statistics.brightness);
+    } else if (statistics.clipped > config->max_clipped) {
+        reason = g_strdup_printf("Clipped fraction %.3f above max-clipped", statistics.clipped);
+    }
+    if (!reason) {
+        return NULL;
+    }
+    GstLookoutVisionResult *result = new GstLookoutVisionResult{0, 0, GstLookoutVisionResultStatus::SKIPPED_QUALITY,
+                                                                reason};
+    g_free(reason);
+    return result;
+}
+
+/*
+ * Sends the frame as it is when it already has the requested resolution and its own rows, otherwise scaled straight
+ * into the request. A region cropped out of a wider frame has the rows of the frame, so it always goes to the scaler.
+ */
+static GstLookoutVisionResult* gst_lookout_vision_detect(GstLookoutVision *filter, const gchar *model_component,
+                                                         guint8 *frame, gsize size, int width, int height, int stride,
+                                                         int inference_width, int inference_height) {
+    if (inference_width == width && inference_height == height && stride == GST_ROUND_UP_4(width * 3)) {
+        return filter->inference_client->DetectAnomalies(model_component, frame, size, width, height);
+    }
+    // The frame itself is only read
+    FrameScaler scaler(width, height, stride, inference_width, inference_height);
+    return filter->inference_client->DetectAnomalies(
+            model_component, [&scaler, frame](guint8* request_frame) {
+                scaler.Scale(frame, request_frame);
+                return true;
+            }, scaler.DestinationSize(), inference_width, inference_height);
+}
+
+/*
+ * Without screening-model-component, the frame goes to model-component at the inference resolution. With it, the frame
+ * is first screened at the screening resolution; only anomalous, failed or less than screening-confidence confident
+ * normal verdicts are sent on to model-component, whose result then carries the screening verdict along.
+ */
+static GstLookoutVisionResult* gst_lookout_vision_cascade(GstLookoutVision *filter,
+                                                          const GstLookoutVisionConfig *config, guint8 *frame,
+                                                          gsize size, int width, int height, int stride,
+                                                          int inference_width, int inference_height) {
+    if (!config->screening_model_component) {
+        return gst_lookout_vision_detect(filter, config->model_component, frame, size, width, height, stride,
+                                         inference_width, inference_height);
+    }
+    int screening_width, screening_height;
+    gst_lookout_vision_scaled_size(config->screening_width, config->screening_height, width, height,
+                                   &screening_width, &screening_height);
+    GstLookoutVisionResult *screening = gst_lookout_vision_detect(filter, config->screening_model_component, frame,
+                                                                  size, width, height, stride, screening_width,
+                                                                  screening_height);
+    gboolean escalate = screening->result_status != GstLookoutVisionResultStatus::SUCCESSFUL
+                        || screening->is_anomalous || screening->confidence < config->screening_confidence;
+    g_mutex_lock(&filter->stats_lock);
+    filter->screened_frames++;
+    if (escalate) {
+        filter->escalated_frames++;
+    }
+    g_mutex_unlock(&filter->stats_lock);
+
+    GstLookoutVisionScreening verdict = {true, (bool) escalate, screening->is_anomalous, screening->confidence,
+                                         screening->result_status, screening->inference_latency};
+    if (!escalate) {
+        screening->screening = verdict;
+        return screening;
+    }
+    delete screening;
+    GstLookoutVisionResult *result;
+    if (g_atomic_int_get(&filter->flushing)) {
+        // The frame is dropped, don't start a call that would only be cancelled
+        result = new GstLookoutVisionResult{0, 0, GstLookoutVisionResultStatus::FAILED, "Flushing"};
+    } else {
+        result = gst_lookout_vision_detect(filter, config->model_component, frame, size, width, height, stride,
+                                           inference_width, inference_height);
+    }
+    result->screening = verdict;
+    return result;
+}
+
+/* Regions are inferred at their own resolution, scaled up keeping their aspect ratio when a side is too short */
+static void gst_lookout_vision_region_size(int width, int height, int *inference_width, int *inference_height) {
+    *inference_width = width;
+    *inference_height = height;
+    if (width >= MIN_REGION_SIZE && height >= MIN_REGION_SIZE) {
+        return;
+    }
+    gdouble factor = MAX((gdouble) MIN_REGION_SIZE / width, (gdouble) MIN_REGION_SIZE / height);
+    *inference_width = MAX(MIN_REGION_SIZE, (int) ceil(width * factor));
+    *inference_height = MAX(MIN_REGION_SIZE, (int) ceil(height * factor));
+}
+
+/* Runs on region_pool */
+static void gst_lookout_vision_region_job(gpointer data, gpointer user_data) {
+    GstLookoutVision *filter = (GstLookoutVision*) user_data;
+    GstLookoutVisionRegionJob *job = (GstLookoutVisionRegionJob*) data;
+    GstLookoutVisionResult *result;
+    if (g_atomic_int_get(&filter->flushing)) {
+        // The frame is dropped, don't start a call that would only be cancelled
+        result = new GstLookoutVisionResult{0, 0, GstLookoutVisionResultStatus::FAILED, "Flushing"};
+    } else {
+        result = gst_lookout_vision_cascade(filter, job->config, job->frame, (gsize) job->stride * job->height,
+                                            job->width, job->height, job->stride, job->inference_width,
+                                            job->inference_height);
+    }
 
-    // Extract image from gstbuffer
+    g_mutex_lock(&filter->pending_lock);
+    job->result = result;
+    (*job->remaining)--;
+    g_cond_broadcast(&filter->pending_cond);
+    g_mutex_unlock(&filter->pending_lock);
+}
+
+/* Collects the regions of interest of region-type attached to the frame; their verdicts are filled in once inferred */
+static std::vector<GstLookoutVisionRegion> gst_lookout_vision_regions(const GstLookoutVisionConfig *config,
+                                                                      GstBuffer *buf) {
+    std::vector<GstLookoutVisionRegion> regions;
+    gpointer state = NULL;
+    GstMeta *meta;
+    while ((meta = gst_buffer_iterate_meta_filtered(buf, &state, GST_VIDEO_REGION_OF_INTEREST_META_API_TYPE))) {
+        GstVideoRegionOfInterestMeta *roi = (GstVideoRegionOfInterestMeta*) meta;
+        if (config->region_type && roi->roi_type != g_quark_try_string(config->region_type)) {
+            continue;
+        }
+        regions.push_back(GstLookoutVisionRegion{roi->id, roi->x, roi->y, roi->w, roi->h});
+    }
+    return regions;
+}
+
+/* Outside infer-regions every frame is inferred, with it only the frames carrying a region */
+static gboolean gst_lookout_vision_has_regions(GstLookoutVision *filter, GstBuffer *buf) {
+    if (!filter->infer_regions) {
+        return TRUE;
+    }
+    GstLookoutVisionConfig *config = gst_lookout_vision_acquire_config(filter);
+    gboolean has_regions = !gst_lookout_vision_regions(config, buf).empty();
+    gst_lookout_vision_config_unref(config);
+    return has_regions;
+}
+
+/*
+ * Each region, clipped to the frame, is cropped and scaled straight into its request on region_pool, so at most
+ * max-regions-inflight regions of all frames are in flight at once. The frame is anomalous when any region is, with
+ * the highest confidence of its anomalous regions; otherwise it is normal with the lowest confidence of its regions,
+ * unless a region failed, whose status and error the frame then reports.
+ */
+static GstLookoutVisionResult* gst_lookout_vision_infer_regions(GstLookoutVision *filter,
+                                                                const GstLookoutVisionConfig *config,
+                                                                const std::vector<GstLookoutVisionRegion> *regions,
+                                                                guint8 *frame, int width, int height, int stride) {
+    std::vector<GstLookoutVisionRegionJob> jobs(regions->size());
+    guint remaining = 0;
+    for (size_t i = 0; i < regions->size(); i++) {
+        const GstLookoutVisionRegion &region = (*regions)[i];
+        GstLookoutVisionRegionJob *job = &jobs[i];
+        if (region.width == 0 || region.height == 0 || region.x >= (guint) width || region.y >= (guint) height) {
+            job->result = new GstLookoutVisionResult{0, 0, GstLookoutVisionResultStatus::FAILED,
+                                                     "Region outside the frame"};
+            continue;
+        }
+        job->config = config;
+        job->frame = frame + (gsize) region.y * stride + region.x * 3;
+        job->width = MIN(region.width, width - region.x);
+        job->height = MIN(region.height, height - region.y);
+        job->stride = stride;
+        gst_lookout_vision_region_size(job->width, job->height, &job->inference_width, &job->inference_height);
+        job->result = NULL;
+        job->remaining = &remaining;
+        remaining++;
+    }
+    g_mutex_lock(&filter->pending_lock);
+    for (GstLookoutVisionRegionJob &job : jobs) {
+        if (!job.result) {
+            g_thread_pool_push(filter->region_pool, &job, NULL);
+        }
+    }
+    while (remaining > 0) {
+        g_cond_wait(&filter->pending_cond, &filter->pending_lock);
+    }
+    g_mutex_unlock(&filter->pending_lock);
+
+    GstLookoutVisionResult *result = new GstLookoutVisionResult{0, 0, GstLookoutVisionResultStatus::SUCCESSFUL, ""};
+    result->regions = *regions;
+    gboolean verdict = FALSE;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        GstLookoutVisionResult *region_result = jobs[i].result;
+        GstLookoutVisionRegion &region = result->regions[i];
+        region.is_anomalous = region_result->is_anomalous;
+        region.confidence = region_result->confidence;
+        region.result_status = region_result->result_status;
+        region.error_message = region_result->error_message;
+        region.inference_latency = region_result->inference_latency;
+        result->inference_latency = MAX(result->inference_latency, region_result->inference_latency);
+        if (result->model_component.empty()) {
+            result->model_component = region_result->model_component;
+        }
+        if (region.result_status != GstLookoutVisionResultStatus::SUCCESSFUL) {
+            if (result->result_status == GstLookoutVisionResultStatus::SUCCESSFUL) {
+                result->result_status = region.result_status;
+                result->error_message = "Region " + std::to_string(region.roi_id) + ": " + region.error_message;
+            }
+        } else if (region.is_anomalous) {
+            if (!result->is_anomalous || region.confidence > result->confidence) {
+                result->confidence = region.confidence;
+            }
+            result->is_anomalous = true;
+        } else if (!result->is_anomalous && (!verdict || region.confidence < result->confidence)) {
+            result->confidence = region.confidence;
+        }
+        verdict = verdict || region.result_status == GstLookoutVisionResultStatus::SUCCESSFUL;
+        delete region_result;
+    }
+    if (result->is_anomalous) {
+        // An anomalous region settles the frame whatever happened to the others
+        result->result_status = GstLookoutVisionResultStatus::SUCCESSFUL;
+        result->error_message.clear();
+    }
+    return result;
+}
+
+/*
+ * The frame is decoded at the smallest DCT scaling covering the inference resolution, straight into the request when
+ * that lands on it exactly, otherwise into a temporary frame the scaler then resamples into the request. The quality
+ * gate and the cascade need the decoded frame before the request is made, so with either enabled the temporary frame
+ * is always used. Frames with regions are decoded at full resolution, the one the regions are given in.
+ */
+static GstLookoutVisionResult* gst_lookout_vision_infer_jpeg(GstLookoutVision *filter,
+                                                             const GstLookoutVisionConfig *config,
+                                                             const std::vector<GstLookoutVisionRegion> *regions,
+                                                             const GstMapInfo *map) {
+    JpegDecoder decoder;
+    if (!decoder.ReadHeader(map->data, map->size)) {
+        return new GstLookoutVisionResult{0, 0, GstLookoutVisionResultStatus::FAILED,
+                                          "Could not decode JPEG frame: " + decoder.Error()};
+    }
+    int inference_width, inference_height;
+    gst_lookout_vision_inference_size(config, decoder.SourceWidth(), decoder.SourceHeight(), &inference_width,
+                                      &inference_height);
+    if (!regions) {
+        decoder.ScaleToCover(inference_width, inference_height);
+    }
+
+    if ((int) decoder.Width() == inference_width && (int) decoder.Height() == inference_height
+            && !gst_lookout_vision_quality_gated(config) && !config->screening_model_component && !regions) {
+        return filter->inference_client->DetectAnomalies(
+                config->model_component, [&decoder, filter](guint8* frame) {
+                    if (!decoder.Decode(frame)) {
+                        GST_WARNING_OBJECT(filter, "Could not decode JPEG frame: %s", decoder.Error().c_str());
+                        return false;
+                    }
+                    return true;
+                }, decoder.Width() * decoder.Height() * 3, inference_width, inference_height);
+    }
+    std::vector<guint8> decoded(decoder.Width() * decoder.Height() * 3);
+    if (!decoder.Decode(decoded.data())) {
+        return new GstLookoutVisionResult{0, 0, GstLookoutVisionResultStatus::FAILED,
+                                          "Could not decode JPEG frame: " + decoder.Error()};
+    }
+    GstLookoutVisionResult *skipped = gst_lookout_vision_check_quality(config, decoded.data(), decoder.Width(),
+                                                                       decoder.Height(), decoder.Width() * 3);
+    if (skipped) {
+        return skipped;
+    }
+    if (regions) {
+        return gst_lookout_vision_infer_regions(filter, config, regions, decoded.data(), decoder.Width(),
+                                                decoder.Height(), decoder.Width() * 3);
+    }
+    return gst_lookout_vision_cascade(filter, config, decoded.data(), decoded.size(), decoder.Width(),
+                                      decoder.Height(), decoder.Width() * 3, inference_width, inference_height);
+}
+
+/*
+ * RGB frames are sent as they are, or resampled straight into the request at a different inference resolution. With
+ * regions, the regions are inferred instead of the frame.
+ */
+static GstLookoutVisionResult* gst_lookout_vision_infer_rgb(GstLookoutVision *filter,
+                                                            const GstLookoutVisionConfig *config,
+                                                            const std::vector<GstLookoutVisionRegion> *regions,
+                                                            const GstMapInfo *map, int width, int height) {
+    int inference_width, inference_height;
+    gst_lookout_vision_inference_size(config, width, height, &inference_width, &inference_height);
+    if (inference_width != width || inference_height != height || gst_lookout_vision_quality_gated(config)
+            || config->screening_model_component || regions) {
+        if (map->size < (gsize) GST_ROUND_UP_4(width * 3) * height) {
+            return new GstLookoutVisionResult{0, 0, GstLookoutVisionResultStatus::FAILED,
+                                              "Frame smaller than the negotiated resolution"};
+        }
+        GstLookoutVisionResult *skipped = gst_lookout_vision_check_quality(config, map->data, width, height,
+                                                                           GST_ROUND_UP_4(width * 3));
+        if (skipped) {
+            return skipped;
+        }
+    }
+    if (regions) {
+        return gst_lookout_vision_infer_regions(filter, config, regions, map->data, width, height,
+                                                GST_ROUND_UP_4(width * 3));
+    }
+    return gst_lookout_vision_cascade(filter, config, map->data, map->size, width, height, GST_ROUND_UP_4(width * 3),
+                                      inference_width, inference_height);
+}
+
+/*
+ * Keyframes are decoded on the calling thread, by a decoder no other frame uses meanwhile. Idle decoders made for
+ * caps that were replaced since are freed instead of reused or put back. A keyframe carrying parameter sets replaces
+ * the ones kept for the keyframes that don't.
+ */
+static GstSample* gst_lookout_vision_decode_keyframe(GstLookoutVision *filter, GstBuffer *buf, std::string *error) {
+    GST_OBJECT_LOCK(filter);
+    GstCaps *caps = filter->coded_caps ? gst_caps_ref(filter->coded_caps) : NULL;
+    guint caps_generation = filter->caps_generation;
+    GST_OBJECT_UNLOCK(filter);
+
+    GstBuffer *parameter_sets = caps ? gst_lookout_vision_decoder_parameter_sets(caps, buf) : NULL;
+    GST_OBJECT_LOCK(filter);
+    if (parameter_sets) {
+        if (caps_generation == filter->caps_generation) {
+            gst_buffer_replace(&filter->parameter_sets, parameter_sets);
+        }
+        gst_buffer_unref(parameter_sets);
+        parameter_sets = NULL;
+    } else if (filter->parameter_sets && caps_generation == filter->caps_generation) {
+        parameter_sets = gst_buffer_ref(filter->parameter_sets);
+    }
+    GST_OBJECT_UNLOCK(filter);
+
+    GstLookoutVisionDecoder *decoder = NULL;
+    GstLookoutVisionIdleDecoder *idle;
+    while (!decoder && (idle = (GstLookoutVisionIdleDecoder*) g_async_queue_try_pop(filter->decoders))) {
+        if (idle->caps_generation == caps_generation) {
+            decoder = idle->decoder;
+        } else {
+            gst_lookout_vision_decoder_free(idle->decoder);
+        }
+        g_free(idle);
+    }
+    if (!decoder && caps) {
+        decoder = gst_lookout_vision_decoder_new(caps);
+    }
+    if (caps) {
+        gst_caps_unref(caps);
+    }
+    if (!decoder) {
+        *error = "Could not create keyframe decoder";
+        return NULL;
+    }
+    GstSample *sample = gst_lookout_vision_decoder_decode(decoder, buf, parameter_sets, error);
+    if (parameter_sets) {
+        gst_buffer_unref(parameter_sets);
+    }
+
+    GST_OBJECT_LOCK(filter);
+    gboolean current = caps_generation == filter->caps_generation;
+    GST_OBJECT_UNLOCK(filter);
+    if (current) {
+        idle = g_new(GstLookoutVisionIdleDecoder, 1);
+        idle->decoder = decoder;
+        idle->caps_generation = caps_generation;
+        g_async_queue_push(filter->decoders, idle);
+    } else {
+        gst_lookout_vision_decoder_free(decoder);
+    }
+    return sample;
+}
+
+static GstLookoutVisionResult* gst_lookout_vision_infer_keyframe(GstLookoutVision *filter,
+                                                                 const GstLookoutVisionConfig *config,
+                                                                 const std::vector<GstLookoutVisionRegion> *regions,
+                                                                 GstBuffer *buf) {
+    std::string error;
+    GstSample *sample = gst_lookout_vision_decode_keyframe(filter, buf, &error);
+    if (!sample) {
+        GST_WARNING_OBJECT(filter, "Could not decode keyframe: %s", error.c_str());
+        return new GstLookoutVisionResult{0, 0, GstLookoutVisionResultStatus::FAILED,
+                                          "Could not decode keyframe: " + error};
+    }
+
+    int width = 0, height = 0;
+    GstStructure *s = gst_caps_get_structure(gst_sample_get_caps(sample), 0);
+    gst_structure_get_int(s, "width", &width);
+    gst_structure_get_int(s, "height", &height);
     GstMapInfo map;
-    gst_buffer_map(buf, &map, GST_MAP_READ);
+    gst_buffer_map(gst_sample_get_buffer(sample), &map, GST_MAP_READ);
+    GstLookoutVisionResult* inference_result = gst_lookout_vision_infer_rgb(filter, config, regions, &map, width,
+                                                                            height);
+    gst_buffer_unmap(gst_sample_get_buffer(sample), &map);
+    gst_sample_unref(sample);
+    return inference_result;
+}
+
+static GstLookoutVisionResult* gst_lookout_vision_infer(GstLookoutVision *filter, GstBuffer *buf,
+                                                        const GstLookoutVisionConfig *config, int width, int height,
+                                                        GstLookoutVisionInput input) {
+    if (!config->model_component) {
+        return new GstLookoutVisionResult{0, 0, GstLookoutVisionResultStatus::FAILED,
+                                          "No value set for model-component"};
+    }
+    if (g_atomic_int_get(&filter->flushing)) {
+        // The frame is dropped, don't start a call that would only be cancelled
+        return new GstLookoutVisionResult{0, 0, GstLookoutVisionResultStatus::FAILED, "Flushing"};
+    }
+    std::vector<GstLookoutVisionRegion> region_list;
+    const std::vector<GstLookoutVisionRegion> *regions = NULL;
+    if (filter->infer_regions) {
+        region_list = gst_lookout_vision_regions(config, buf);
+        if (region_list.empty()) {
+            return new GstLookoutVisionResult{0, 0, GstLookoutVisionResultStatus::FAILED, "No region of interest"};
+        }
+        regions = &region_list;
+    }
 
     // Send image to inference server and get response
+    gint64 start = g_get_monotonic_time();
     GstLookoutVisionResult* inference_result;
-    if (filter->model_component) {
-        inference_result = filter->inference_client->DetectAnomalies(filter->model_component, map.data, map.size,
-                                                                     filter->width, filter->height);
+    if (input == GST_LOOKOUT_VISION_INPUT_CODED) {
+        inference_result = gst_lookout_vision_infer_keyframe(filter, config, regions, buf);
     } else {
-        inference_result = new GstLookoutVisionResult{0, 0, GstLookoutVisionResultStatus::FAILED,
-                                                      "No value set for model-component"};
+        // Extract image from gstbuffer
+        GstMapInfo map;
+        gst_buffer_map(buf, &map, GST_MAP_READ);
+        if (input == GST_LOOKOUT_VISION_INPUT_JPEG) {
+            inference_result = gst_lookout_vision_infer_jpeg(filter, config, regions, &map);
+        } else {
+            inference_result = gst_lookout_vision_infer_rgb(filter, config, regions, &map, width, height);
+        }
+        gst_buffer_unmap(buf, &map);
     }
+    if (inference_result->result_status != GstLookoutVisionResultStatus::SKIPPED_QUALITY
+            && g_atomic_int_compare_and_exchange(&filter->first_frame_pending, TRUE, FALSE)) {
+        g_mutex_lock(&filter->stats_lock);
+        filter->first_frame_latency = (g_get_monotonic_time() - start) * GST_USECOND;
+        g_mutex_unlock(&filter->stats_lock);
+    }
+    return inference_result;
+}
 
-    gst_buffer_add_lookout_vision_meta(buf, inference_result);
+static void gst_lookout_vision_print_result(const GstLookoutVisionResult *inference_result) {
     if (inference_result->result_status == GstLookoutVisionResultStatus::SUCCESSFUL) {
         std::cout << "Is Anomalous? " << inference_result->is_anomalous
                 << ", Confidence: " << inference_result->confidence << std::endl;
+    } else if (inference_result->result_status == GstLookoutVisionResultStatus::TIMEOUT) {
+        std::cout << "Inference call timed out" << std::endl;
+    } else if (inference_result->result_status == GstLookoutVisionResultStatus::SKIPPED_QUALITY) {
+        std::cout << "Inference skipped: " << inference_result->error_message << std::endl;
     } else  {
         std::cout << "Inference call failed" << std::endl;
     }
+}
+
+/* A frame that wasn't inferred has no result and is pushed as it is */
+static GstFlowReturn gst_lookout_vision_push_result(GstLookoutVision *filter, GstBuffer *buf,
+                                                    GstLookoutVisionResult *inference_result) {
+    if (!inference_result) {
+        return gst_pad_push(filter->srcpad, buf);
+    }
+    gst_buffer_add_lookout_vision_meta(buf, inference_result);
+    gst_lookout_vision_print_result(inference_result);
 
     // Free memory
-    gst_buffer_unmap(buf, &map);
     delete inference_result;
 
     return gst_pad_push(filter->srcpad, buf);
 }
 
+static void gst_lookout_vision_infer_job(gpointer data, gpointer user_data) {
+    GstLookoutVision *filter = (GstLookoutVision*) user_data;
+    GstLookoutVisionJob *job = (GstLookoutVisionJob*) data;
+    GstLookoutVisionResult* inference_result = gst_lookout_vision_infer(filter, job->buffer, job->config, job->width,
+                                                                        job->height, job->input);
+
+    g_mutex_lock(&filter->pending_lock);
+    job->result = inference_result;
+    job->done = TRUE;
+    g_cond_broadcast(&filter->pending_cond);
+    g_mutex_unlock(&filter->pending_lock);
+}
+
+static void gst_lookout_vision_free_job(GstLookoutVisionJob *job) {
+    gst_lookout_vision_config_unref(job->config);
+    delete job;
+}
+
+/*
+ * Pushes finished inferences downstream in order, first waiting for the oldest while limit or more are pending.
+ * A limit of 1 drains every pending inference.
+ */
+static GstFlowReturn gst_lookout_vision_push_pending(GstLookoutVision *filter, guint limit) {
+    GstFlowReturn ret = GST_FLOW_OK;
+    g_mutex_lock(&filter->pending_lock);
+    while (!g_queue_is_empty(&filter->pending)) {
+        GstLookoutVisionJob *job = (GstLookoutVisionJob*) g_queue_peek_head(&filter->pending);
+        if (!job->done) {
+            if (g_queue_get_length(&filter->pending) < limit) {
+                break;
+            }
+            g_cond_wait(&filter->pending_cond, &filter->pending_lock);
+            continue;
+        }
+        g_queue_pop_head(&filter->pending);
+        g_mutex_unlock(&filter->pending_lock);
+
+        GstFlowReturn job_ret;
+        if (g_atomic_int_get(&filter->flushing)) {
+            // The inference may have been cancelled, its result means nothing
+            delete job->result;
+            gst_buffer_unref(job->buffer);
+            job_ret = GST_FLOW_FLUSHING;
+        } else {
+            job_ret = gst_lookout_vision_push_result(filter, job->buffer, job->result);
+        }
+        if (ret == GST_FLOW_OK) {
+            ret = job_ret;
+        }
+        gst_lookout_vision_free_job(job);
+        g_mutex_lock(&filter->pending_lock);
+    }
+    g_mutex_unlock(&filter->pending_lock);
+    return ret;
+}
+
+/* Waits for pending inferences and drops their frames */
+static void gst_lookout_vision_discard_pending(GstLookoutVision *filter) {
+    g_mutex_lock(&filter->pending_lock);
+    while (!g_queue_is_empty(&filter->pending)) {
+        GstLookoutVisionJob *job = (GstLookoutVisionJob*) g_queue_peek_head(&filter->pending);
+        if (!job->done) {
+            g_cond_wait(&filter->pending_cond, &filter->pending_lock);
+            continue;
+        }
+        g_queue_pop_head(&filter->pending);
+        gst_buffer_unref(job->buffer);
+        delete job->result;
+        gst_lookout_vision_free_job(job);
+    }
+    g_mutex_unlock(&filter->pending_lock);
+}
+
+/*
+ * The frame already went downstream when its trigger arrives, so the result can't be attached to it; it is posted on
+ * the bus instead, with the time from the trigger to the verdict.
+ */
+static void gst_lookout_vision_trigger_job(gpointer data, gpointer user_data) {
+    GstLookoutVision *filter = (GstLookoutVision*) user_data;
+    GstLookoutVisionTriggerJob *job = (GstLookoutVisionTriggerJob*) data;
+    GstLookoutVisionResult* inference_result = gst_lookout_vision_infer(filter, job->frame.buffer, job->config,
+                                                                        job->frame.width, job->frame.height,
+                                                                        job->frame.input);
+    guint64 verdict_latency = (g_get_monotonic_time() - job->trigger.received) * GST_USECOND;
+    if (!g_atomic_int_get(&filter->flushing)) {
+        gst_lookout_vision_print_result(inference_result);
+        GstStructure *result = gst_structure_new(RESULT_MESSAGE_NAME,
+                                                 "trigger-running-time", G_TYPE_UINT64, job->trigger.running_time,
+                                                 "running-time", G_TYPE_UINT64, job->frame.running_time,
+                                                 "pts", G_TYPE_UINT64, GST_BUFFER_PTS(job->frame.buffer),
+                                                 "result-status", G_TYPE_INT, (gint) inference_result->result_status,
+                                                 "is-anomalous", G_TYPE_BOOLEAN,
+                                                 (gboolean) inference_result->is_anomalous,
+                                                 "confidence", G_TYPE_FLOAT, inference_result->confidence,
+                                                 "model-component", G_TYPE_STRING,
+                                                 inference_result->model_component.c_str(),
+                                                 "error-message", G_TYPE_STRING,
+                                                 inference_result->error_message.c_str(),
+                                                 "verdict-latency", G_TYPE_UINT64, verdict_latency,
+                                                 NULL);
+        if (!inference_result->regions.empty()) {
+            GValue regions = G_VALUE_INIT;
+            gst_value_list_init(&regions, inference_result->regions.size());
+            for (const GstLookoutVisionRegion &region : inference_result->regions) {
+                GValue value = G_VALUE_INIT;
+                g_value_init(&value, GST_TYPE_STRUCTURE);
+                g_value_take_boxed(&value, gst_structure_new("region",
+                                                             "roi-id", G_TYPE_INT, region.roi_id,
+                                                             "result-status", G_TYPE_INT, (gint) region.result_status,
+                                                             "is-anomalous", G_TYPE_BOOLEAN,
+                                                             (gboolean) region.is_anomalous,
+                                                             "confidence", G_TYPE_FLOAT, region.confidence,
+                                                             NULL));
+                gst_value_list_append_and_take_value(&regions, &value);
+            }
+            gst_structure_take_value(result, "regions", &regions);
+        }
+        gst_element_post_message(GST_ELEMENT(filter), gst_message_new_element(GST_OBJECT(filter), result));
+    }
+    delete inference_result;
+    gst_buffer_unref(job->frame.buffer);
+    gst_lookout_vision_config_unref(job->config);
+    delete job;
+
+    g_mutex_lock(&filter->pending_lock);
+    filter->triggers_inflight--;
+    g_cond_broadcast(&filter->pending_cond);
+    g_mutex_unlock(&filter->pending_lock);
+}
+
+static void gst_lookout_vision_wait_triggers(GstLookoutVision *filter) {
+    g_mutex_lock(&filter->pending_lock);
+    while (filter->triggers_inflight > 0) {
+        g_cond_wait(&filter->pending_cond, &filter->pending_lock);
+    }
+    g_mutex_unlock(&filter->pending_lock);
+}
+
+/* Must be called with history_lock held. GST_CLOCK_TIME_NONE stands for the latest frame */
+static GstLookoutVisionFrame* gst_lookout_vision_closest_frame(GstLookoutVision *filter, GstClockTime running_time) {
+    GstLookoutVisionFrame *closest = NULL;
+    GstClockTime closest_distance = GST_CLOCK_TIME_NONE;
+    if (GST_CLOCK_TIME_IS_VALID(running_time)) {
+        for (GList *link = filter->history.head; link; link = link->next) {
+            GstLookoutVisionFrame *frame = (GstLookoutVisionFrame*) link->data;
+            if (!GST_CLOCK_TIME_IS_VALID(frame->running_time)) {
+                continue;
+            }
+            GstClockTime distance = frame->running_time > running_time ? frame->running_time - running_time
+                                                                        : running_time - frame->running_time;
+            if (!closest || distance < closest_distance) {
+                closest = frame;
+                closest_distance = distance;
+            }
+        }
+    }
+    return closest ? closest : (GstLookoutVisionFrame*) g_queue_peek_tail(&filter->history);
+}
+
+/* Must be called with history_lock held */
+static void gst_lookout_vision_dispatch_trigger(GstLookoutVision *filter, const GstLookoutVisionTrigger *trigger) {
+    GstLookoutVisionFrame *frame = gst_lookout_vision_closest_frame(filter, trigger->running_time);
+    if (!frame || !filter->trigger_pool) {
+        GST_WARNING_OBJECT(filter, "No frame to infer for trigger at %" GST_TIME_FORMAT,
+                           GST_TIME_ARGS(trigger->running_time));
+        return;
+    }
+    GstLookoutVisionTriggerJob *job = new GstLookoutVisionTriggerJob{*frame, *trigger,
+                                                                     gst_lookout_vision_acquire_config(filter)};
+    gst_buffer_ref(job->frame.buffer);
+    g_mutex_lock(&filter->pending_lock);
+    filter->triggers_inflight++;
+    g_mutex_unlock(&filter->pending_lock);
+    g_thread_pool_push(filter->trigger_pool, job, NULL);
+}
+
+/* Class handler of the trigger signal, also called for trigger events; may run on any thread */
+static void gst_lookout_vision_trigger(GstLookoutVision *filter, GstClockTime running_time) {
+    if (filter->trigger_mode != GST_LOOKOUT_VISION_TRIGGER_EXTERNAL) {
+        GST_DEBUG_OBJECT(filter, "Ignoring trigger outside external trigger mode");
+        return;
+    }
+    GstLookoutVisionTrigger trigger = {running_time, g_get_monotonic_time()};
+    g_mutex_lock(&filter->history_lock);
+    GstLookoutVisionFrame *latest = (GstLookoutVisionFrame*) g_queue_peek_tail(&filter->history);
+    if (!GST_CLOCK_TIME_IS_VALID(running_time)
+            || (latest && GST_CLOCK_TIME_IS_VALID(latest->running_time) && latest->running_time >= running_time)) {
+        gst_lookout_vision_dispatch_trigger(filter, &trigger);
+    } else {
+        // The frame closest to the trigger may still be on its way
+        g_array_append_val(filter->pending_triggers, trigger);
+    }
+    g_mutex_unlock(&filter->history_lock);
+}
+
+/* Takes a reference on the frame, which is pushed right after */
+static void gst_lookout_vision_remember_frame(GstLookoutVision *filter, GstBuffer *buf) {
+    GstClockTime running_time = filter->segment.format == GST_FORMAT_TIME
+            ? gst_segment_to_running_time(&filter->segment, GST_FORMAT_TIME, GST_BUFFER_PTS(buf))
+            : GST_BUFFER_PTS(buf);
+    GstLookoutVisionFrame *frame = new GstLookoutVisionFrame{gst_buffer_ref(buf), running_time, filter->width,
+                                                             filter->height, filter->input};
+    GstLookoutVisionConfig *config = gst_lookout_vision_acquire_config(filter);
+    g_mutex_lock(&filter->history_lock);
+    g_queue_push_tail(&filter->history, frame);
+    while (g_queue_get_length(&filter->history) > config->trigger_history) {
+        GstLookoutVisionFrame *oldest = (GstLookoutVisionFrame*) g_queue_pop_head(&filter->history);
+        gst_buffer_unref(oldest->buffer);
+        delete oldest;
+    }
+    guint i = 0;
+    while (i < filter->pending_triggers->len) {
+        GstLookoutVisionTrigger *trigger = &g_array_index(filter->pending_triggers, GstLookoutVisionTrigger, i);
+        if (GST_CLOCK_TIME_IS_VALID(running_time) && running_time >= trigger->running_time) {
+            // This frame or the one before is the closest
+            gst_lookout_vision_dispatch_trigger(filter, trigger);
+            g_array_remove_index(filter->pending_triggers, i);
+        } else {
+            i++;
+        }
+    }
+    g_mutex_unlock(&filter->history_lock);
+    gst_lookout_vision_config_unref(config);
+}
+
+/* Triggers still waiting for a later frame get the latest one, then every triggered inference is waited for */
+static void gst_lookout_vision_drain_triggers(GstLookoutVision *filter) {
+    g_mutex_lock(&filter->history_lock);
+    for (guint i = 0; i < filter->pending_triggers->len; i++) {
+        gst_lookout_vision_dispatch_trigger(filter, &g_array_index(filter->pending_triggers, GstLookoutVisionTrigger,
+                                                                   i));
+    }
+    g_array_set_size(filter->pending_triggers, 0);
+    g_mutex_unlock(&filter->history_lock);
+    gst_lookout_vision_wait_triggers(filter);
+}
+
+static void gst_lookout_vision_forget_frames(GstLookoutVision *filter) {
+    g_mutex_lock(&filter->history_lock);
+    GstLookoutVisionFrame *frame;
+    while ((frame = (GstLookoutVisionFrame*) g_queue_pop_head(&filter->history))) {
+        gst_buffer_unref(frame->buffer);
+        delete frame;
+    }
+    g_array_set_size(filter->pending_triggers, 0);
+    g_mutex_unlock(&filter->history_lock);
+}
+
+/*
+ * Called from the caps event, on the streaming thread. The frames of the previous caps inferring on thread_pool or
+ * trigger_pool are finished first; the remembered ones can't be decoded with the new caps, so triggers no longer get
+ * them. A decoder still out with the previous caps is freed when it returns.
+ *
+ * Decoding a keyframe takes a pipeline round trip, so keyframes are inferred on thread_pool even at max-inflight 1.
+ */
+static void gst_lookout_vision_set_coded_caps(GstLookoutVision *filter, GstCaps *caps) {
+    if (!filter->thread_pool && !filter->trigger_pool) {
+        filter->thread_pool = g_thread_pool_new(gst_lookout_vision_infer_job, filter, filter->max_inflight, FALSE,
+                                                NULL);
+    }
+    if (filter->coded_caps && gst_caps_is_equal(filter->coded_caps, caps)) {
+        return;
+    }
+    if (filter->thread_pool) {
+        gst_lookout_vision_push_pending(filter, 1);
+    }
+    if (filter->trigger_pool) {
+        gst_lookout_vision_drain_triggers(filter);
+        gst_lookout_vision_forget_frames(filter);
+        // Triggers dispatched before the frames were forgotten
+        gst_lookout_vision_wait_triggers(filter);
+    }
+    GST_OBJECT_LOCK(filter);
+    gst_caps_replace(&filter->coded_caps, caps);
+    filter->caps_generation++;
+    gst_buffer_replace(&filter->parameter_sets, NULL);
+    GST_OBJECT_UNLOCK(filter);
+    gst_lookout_vision_free_decoders(filter);
+}
+
+/* Custom lookoutvision-trigger events, carrying the running time as an optional "timestamp", are consumed */
+static gboolean gst_lookout_vision_handle_trigger_event(GstLookoutVision *filter, GstEvent *event) {
+    if (filter->trigger_mode != GST_LOOKOUT_VISION_TRIGGER_EXTERNAL || !gst_event_has_name(event, TRIGGER_EVENT_NAME)) {
+        return FALSE;
+    }
+    GstClockTime running_time = GST_CLOCK_TIME_NONE;
+    gst_structure_get_uint64(gst_event_get_structure(event), "timestamp", &running_time);
+    gst_lookout_vision_trigger(filter, running_time);
+    gst_event_unref(event);
+    return TRUE;
+}
+
+/* Diagnostics of the client go to the debug log, calls may fail once per frame */
+static void gst_lookout_vision_client_log(GstLookoutVision *filter, LookoutVisionInferenceClient::LogLevel level,
+                                          const std::string& message) {
+    switch (level) {
+        case LookoutVisionInferenceClient::LogLevel::LEVEL_DEBUG:
+            GST_DEBUG_OBJECT(filter, "%s", message.c_str());
+            break;
+        case LookoutVisionInferenceClient::LogLevel::LEVEL_INFO:
+            GST_INFO_OBJECT(filter, "%s", message.c_str());
+            break;
+        case LookoutVisionInferenceClient::LogLevel::LEVEL_WARNING:
+            GST_WARNING_OBJECT(filter, "%s", message.c_str());
+            break;
+    }
+}
+
+static GstStateChangeReturn gst_lookout_vision_change_state(GstElement *element, GstStateChange transition) {
+    GstLookoutVision *filter = GST_LOOKOUTVISION(element);
+
+    if (transition == GST_STATE_CHANGE_NULL_TO_READY) {
+        // Under config_lock, so properties set meanwhile either are in the snapshot or find the client
+        LookoutVisionInferenceClient *inference_client;
+        g_mutex_lock(&filter->config_lock);
+        try {
+            inference_client = new LookoutVisionInferenceClient(filter->config->server_socket);
+        } catch (std::exception& e) {
+            g_mutex_unlock(&filter->config_lock);
+            GST_ELEMENT_ERROR(filter, RESOURCE, OPEN_READ_WRITE, (NULL), ("%s", e.what()));
+            return GST_STATE_CHANGE_FAILURE;
+        }
+        inference_client->setLogHandler([filter](LookoutVisionInferenceClient::LogLevel level,
+                                                 const std::string& message) {
+            gst_lookout_vision_client_log(filter, level, message);
+        });
+        inference_client->setHealthCheckInterval(filter->config->health_check_interval);
+        inference_client->setInferenceTimeout(filter->config->inference_timeout, filter->config->adaptive_timeout);
+        filter->inference_client = inference_client;
+        g_mutex_unlock(&filter->config_lock);
+        filter->swap_pool = g_thread_pool_new(gst_lookout_vision_swap_model, filter, 1, FALSE, NULL);
+    }
+
+    if (transition == GST_STATE_CHANGE_READY_TO_PAUSED) {
+        // Every region inferred at once needs its own shared memory slot
+        if (!filter->inference_client->setMaxInflight(filter->infer_regions ? filter->max_regions_inflight
+                                                                            : filter->max_inflight)) {
+            GST_ELEMENT_ERROR(filter, RESOURCE, NO_SPACE_LEFT, (NULL), ("Failed to size the shared memory segment"));
+            return GST_STATE_CHANGE_FAILURE;
+        }
+        g_atomic_int_set(&filter->flushing, FALSE);
+        filter->warmed_up = FALSE;
+        filter->keyframes = 0;
+        GstLookoutVisionConfig *config = gst_lookout_vision_acquire_config(filter);
+        if (config->model_component
+                && filter->inference_client->StartModel(config->model_component, config->model_status_timeout)
+                        != LookoutVisionInferenceClient::OperationStatus::SUCCESSFUL) {
+            // Streaming goes ahead, each frame reporting its failed inference
+            GST_ELEMENT_ERROR(filter, LIBRARY, FAILED, (NULL), ("Failed to start model"));
+        }
+        if (config->screening_model_component
+                && filter->inference_client->StartModel(config->screening_model_component,
+                                                        config->model_status_timeout)
+                        != LookoutVisionInferenceClient::OperationStatus::SUCCESSFUL) {
+            // Screening fails for every frame, which model-component then infers
+            GST_ELEMENT_WARNING(filter, LIBRARY, FAILED, (NULL), ("Failed to start screening model"));
+        }
+        gst_lookout_vision_config_unref(config);
+        gst_segment_init(&filter->segment, GST_FORMAT_TIME);
+        if (filter->trigger_mode == GST_LOOKOUT_VISION_TRIGGER_EXTERNAL) {
+            // Frames are pushed as they come, max-inflight bounds the triggered frames inferred at once
+            g_mutex_lock(&filter->history_lock);
+            filter->trigger_pool = g_thread_pool_new(gst_lookout_vision_trigger_job, filter, filter->max_inflight,
+                                                     FALSE, NULL);
+            g_mutex_unlock(&filter->history_lock);
+        } else if (filter->max_inflight > 1) {
+            filter->thread_pool = g_thread_pool_new(gst_lookout_vision_infer_job, filter, filter->max_inflight, FALSE,
+                                                    NULL);
+        }
+        if (filter->infer_regions) {
+            filter->region_pool = g_thread_pool_new(gst_lookout_vision_region_job, filter,
+                                                    filter->max_regions_inflight, FALSE, NULL);
+        }
+    }
+
+    if (transition == GST_STATE_CHANGE_PAUSED_TO_READY) {
+        // Deactivating the pads waits for the streaming thread, which may be waiting for an inference
+        g_atomic_int_set(&filter->flushing, TRUE);
+        filter->inference_client->CancelInflight();
+    }
+
+    GstStateChangeReturn ret = GST_ELEMENT_CLASS(parent_class)->change_state(element, transition);
+
+    if (transition == GST_STATE_CHANGE_PAUSED_TO_READY && filter->thread_pool) {
+        // Streaming has stopped, so whatever is still pending will not be pushed
+        g_thread_pool_free(filter->thread_pool, FALSE, TRUE);
+        filter->thread_pool = NULL;
+        gst_lookout_vision_discard_pending(filter);
+    }
+
+    if (transition == GST_STATE_CHANGE_PAUSED_TO_READY && filter->trigger_pool) {
+        // Triggers arriving from now on find no pool
+        g_mutex_lock(&filter->history_lock);
+        GThreadPool *trigger_pool = filter->trigger_pool;
+        filter->trigger_pool = NULL;
+        g_mutex_unlock(&filter->history_lock);
+        g_thread_pool_free(trigger_pool, FALSE, TRUE);
+    }
+
+    if (transition == GST_STATE_CHANGE_PAUSED_TO_READY && filter->region_pool) {
+        // Only the frames inferring above wait for regions, and they all returned
+        g_thread_pool_free(filter->region_pool, FALSE, TRUE);
+        filter->region_pool = NULL;
+    }
+
+    if (transition == GST_STATE_CHANGE_PAUSED_TO_READY) {
+        gst_lookout_vision_forget_frames(filter);
+        gst_lookout_vision_free_decoders(filter);
+        // The next stream brings its own
+        GST_OBJECT_LOCK(filter);
+        gst_buffer_replace(&filter->parameter_sets, NULL);
+        GST_OBJECT_UNLOCK(filter);
+    }
+
+    if (transition == GST_STATE_CHANGE_READY_TO_NULL) {
+        // Lets a swap in progress finish before its client goes away
+        g_thread_pool_free(filter->swap_pool, FALSE, TRUE);
+        filter->swap_pool = NULL;
+        // Property setters reach the client with config_lock held
+        g_mutex_lock(&filter->config_lock);
+        LookoutVisionInferenceClient *inference_client = filter->inference_client;
+        filter->inference_client = NULL;
+        g_mutex_unlock(&filter->config_lock);
+        delete inference_client;
+    }
+    return ret;
+}
+
+/* this function handles sink events */
+static gboolean gst_lookout_vision_sink_event(GstPad * pad, GstObject * parent, GstEvent * event) {
+    GstLookoutVision *filter = GST_LOOKOUTVISION(parent);
+    GST_LOG_OBJECT(filter, "Received %s event: %" GST_PTR_FORMAT, GST_EVENT_TYPE_NAME(event), event);
+
+    if (gst_lookout_vision_handle_trigger_event(filter, event)) {
+        return TRUE;
+    }
+    if (GST_EVENT_TYPE(event) == GST_EVENT_SEGMENT) {
+        gst_event_copy_segment(event, &filter->segment);
+    }
+    if (GST_EVENT_TYPE(event) == GST_EVENT_FLUSH_START) {
+        g_atomic_int_set(&filter->flushing, TRUE);
+        if (filter->inference_client) {
+            filter->inference_client->CancelInflight();
+        }
+    } else if (GST_EVENT_TYPE(event) == GST_EVENT_FLUSH_STOP) {
+        if (filter->thread_pool) {
+            gst_lookout_vision_discard_pending(filter);
+        }
+        // Triggered frames from before the flush are neither inferred nor reported
+        gst_lookout_vision_forget_frames(filter);
+        gst_lookout_vision_wait_triggers(filter);
+        g_atomic_int_set(&filter->flushing, FALSE);
+    } else if (GST_EVENT_TYPE(event) == GST_EVENT_EOS && filter->trigger_pool) {
+        // Results of the last triggers go out before EOS
+        gst_lookout_vision_drain_triggers(filter);
+    } else if (filter->thread_pool) {
+        if (GST_EVENT_IS_SERIALIZED(event)) {
+            // Keeps serialized events such as EOS behind the frames that arrived before them
+            gst_lookout_vision_push_pending(filter, 1);
+        }
+    }
+    return gst_pad_event_default(pad, parent, event);
+}
+
+static gboolean gst_lookout_vision_src_event(GstPad * pad, GstObject * parent, GstEvent * event) {
+    GstLookoutVision *filter = GST_LOOKOUTVISION(parent);
+    if (gst_lookout_vision_handle_trigger_event(filter, event)) {
+        return TRUE;
+    }
+    return gst_pad_event_default(pad, parent, event);
+}
+
+/* Delta units are never inferred, keyframes only every keyframe-interval-th */
+static gboolean gst_lookout_vision_select_keyframe(GstLookoutVision *filter, GstBuffer *buf) {
+    if (GST_BUFFER_FLAG_IS_SET(buf, GST_BUFFER_FLAG_DELTA_UNIT)) {
+        return FALSE;
+    }
+    GstLookoutVisionConfig *config = gst_lookout_vision_acquire_config(filter);
+    gboolean selected = filter->keyframes % config->keyframe_interval == 0;
+    gst_lookout_vision_config_unref(config);
+    filter->keyframes++;
+    return selected;
+}
+
+static void gst_lookout_vision_add_size(GArray *sizes, int width, int height) {
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+    for (guint i = 0; i < sizes->len; i++) {
+        const GstLookoutVisionSize &size = g_array_index(sizes, GstLookoutVisionSize, i);
+        if (size.width == width && size.height == height) {
+            return;
+        }
+    }
+    GstLookoutVisionSize size = {width, height};
+    g_array_append_val(sizes, size);
+}
+
+/*
+ * The resolution the frame is inferred from. image/jpeg and coded caps may leave it out, then the JPEG header tells, or
+ * the keyframe is decoded; a delta unit can't tell. Returns FALSE when the resolution isn't known.
+ */
+static gboolean gst_lookout_vision_frame_size(GstLookoutVision *filter, GstBuffer *buf, int *width, int *height) {
+    *width = filter->width;
+    *height = filter->height;
+    if (*width > 0 && *height > 0) {
+        return TRUE;
+    }
+    if (filter->input == GST_LOOKOUT_VISION_INPUT_JPEG) {
+        GstMapInfo map;
+        gst_buffer_map(buf, &map, GST_MAP_READ);
+        JpegDecoder decoder;
+        gboolean known = decoder.ReadHeader(map.data, map.size);
+        gst_buffer_unmap(buf, &map);
+        *width = known ? decoder.SourceWidth() : 0;
+        *height = known ? decoder.SourceHeight() : 0;
+        return known;
+    }
+    if (filter->input == GST_LOOKOUT_VISION_INPUT_CODED && !GST_BUFFER_FLAG_IS_SET(buf, GST_BUFFER_FLAG_DELTA_UNIT)) {
+        // Only the first keyframe is decoded twice, here and when it is inferred
+        std::string error;
+        GstSample *sample = gst_lookout_vision_decode_keyframe(filter, buf, &error);
+        if (!sample) {
+            return FALSE;
+        }
+        GstStructure *s = gst_caps_get_structure(gst_sample_get_caps(sample), 0);
+        gboolean known = gst_structure_get_int(s, "width", width) && gst_structure_get_int(s, "height", height);
+        gst_sample_unref(sample);
+        return known;
+    }
+    return FALSE;
+}
+
+/*
+ * Warms up model-component, and screening-model-component with a cascade, at the sizes this frame is inferred at: the
+ * inference and screening resolutions or, with infer-regions, the sizes of each of its regions. The sizes of
+ * model-component are kept for the models swapped in later. Returns FALSE while the frame can't tell its resolution
+ * or carries no region, so the next frame tries again; RGB frames without a resolution are never inferred.
+ */
+static gboolean gst_lookout_vision_warm_up_frame(GstLookoutVision *filter, GstBuffer *buf) {
+    int frame_width, frame_height;
+    if (!gst_lookout_vision_frame_size(filter, buf, &frame_width, &frame_height)) {
+        return filter->input == GST_LOOKOUT_VISION_INPUT_RGB;
+    }
+    GstLookoutVisionConfig *config = gst_lookout_vision_acquire_config(filter);
+    GArray *sizes = g_array_new(FALSE, FALSE, sizeof(GstLookoutVisionSize));
+    GArray *screening_sizes = g_array_new(FALSE, FALSE, sizeof(GstLookoutVisionSize));
+    int width, height;
+    if (filter->infer_regions) {
+        for (const GstLookoutVisionRegion &region : gst_lookout_vision_regions(config, buf)) {
+            // Clipped to the frame like the regions inferred
+            width = region.x < (guint) frame_width ? MIN((int) region.width, frame_width - (int) region.x) : 0;
+            height = region.y < (guint) frame_height ? MIN((int) region.height, frame_height - (int) region.y) : 0;
+            if (width <= 0 || height <= 0) {
+                continue;
+            }
+            int region_width, region_height;
+            gst_lookout_vision_region_size(width, height, &region_width, &region_height);
+            gst_lookout_vision_add_size(sizes, region_width, region_height);
+            gst_lookout_vision_scaled_size(config->screening_width, config->screening_height, width, height,
+                                           &region_width, &region_height);
+            gst_lookout_vision_add_size(screening_sizes, region_width, region_height);
+        }
+    } else {
+        gst_lookout_vision_inference_size(config, frame_width, frame_height, &width, &height);
+        gst_lookout_vision_add_size(sizes, width, height);
+        gst_lookout_vision_scaled_size(config->screening_width, config->screening_height, frame_width, frame_height,
+                                       &width, &height);
+        gst_lookout_vision_add_size(screening_sizes, width, height);
+    }
+    gboolean warmed_up = !filter->infer_regions || sizes->len > 0;
+    if (sizes->len > 0) {
+        g_mutex_lock(&filter->stats_lock);
+        g_array_unref(filter->warmup_sizes);
+        filter->warmup_sizes = g_array_ref(sizes);
+        g_mutex_unlock(&filter->stats_lock);
+        GArray *latencies = g_array_new(FALSE, FALSE, sizeof(guint64));
+        gst_lookout_vision_warm_up(filter, config->model_component, config->warmup_frames, sizes, latencies);
+        gst_lookout_vision_warm_up(filter, config->screening_model_component, config->warmup_frames, screening_sizes,
+                                   latencies);
+        gst_lookout_vision_keep_warmup_latencies(filter, latencies);
+    }
+    g_array_unref(screening_sizes);
+    g_array_unref(sizes);
+    gst_lookout_vision_config_unref(config);
+    return warmed_up;
+}
+
+/* chain function */
+static GstFlowReturn gst_lookout_vision_chain(GstPad * pad, GstObject * parent, GstBuffer * buf) {
+    GstLookoutVision *filter;
+    filter = GST_LOOKOUTVISION(parent);
+
+    if (!filter->warmed_up) {
+        filter->warmed_up = gst_lookout_vision_warm_up_frame(filter, buf);
+    }
+
+    if (filter->trigger_pool) {
+        // Delta units can't be decoded on their own, only keyframes are kept for the triggers
+        if ((filter->input != GST_LOOKOUT_VISION_INPUT_CODED
+                || !GST_BUFFER_FLAG_IS_SET(buf, GST_BUFFER_FLAG_DELTA_UNIT))
+                && gst_lookout_vision_has_regions(filter, buf)) {
+            gst_lookout_vision_remember_frame(filter, buf);
+        }
+        return gst_lookout_vision_push_result(filter, buf, NULL);
+    }
+
+    if (!gst_lookout_vision_has_regions(filter, buf)
+            || (filter->input == GST_LOOKOUT_VISION_INPUT_CODED && !gst_lookout_vision_select_keyframe(filter, buf))) {
+        if (!filter->thread_pool) {
+            return gst_lookout_vision_push_result(filter, buf, NULL);
+        }
+        // Goes out behind the access units still being inferred
+        GstLookoutVisionJob *job = new GstLookoutVisionJob{buf, gst_lookout_vision_acquire_config(filter),
+                                                           filter->width, filter->height, filter->input, NULL, TRUE};
+        g_mutex_lock(&filter->pending_lock);
+        g_queue_push_tail(&filter->pending, job);
+        g_mutex_unlock(&filter->pending_lock);
+        return gst_lookout_vision_push_pending(filter, filter->max_inflight + 1);
+    }
+
+    if (!filter->thread_pool) {
+        GstLookoutVisionConfig *config = gst_lookout_vision_acquire_config(filter);
+        GstLookoutVisionResult* inference_result = gst_lookout_vision_infer(filter, buf, config, filter->width,
+                                                                            filter->height, filter->input);
+        gst_lookout_vision_config_unref(config);
+        if (g_atomic_int_get(&filter->flushing)) {
+            // The inference may have been cancelled, its result means nothing
+            delete inference_result;
+            gst_buffer_unref(buf);
+            return GST_FLOW_FLUSHING;
+        }
+        return gst_lookout_vision_push_result(filter, buf, inference_result);
+    }
+
+    // Makes room for this frame, pushing the frames whose inference finished
+    GstFlowReturn ret = gst_lookout_vision_push_pending(filter, filter->max_inflight);
+    if (ret != GST_FLOW_OK) {
+        gst_buffer_unref(buf);
+        return ret;
+    }
+    GstLookoutVisionJob *job = new GstLookoutVisionJob{buf, gst_lookout_vision_acquire_config(filter),
+                                                       filter->width, filter->height, filter->input, NULL, FALSE};
+    g_mutex_lock(&filter->pending_lock);
+    g_queue_push_tail(&filter->pending, job);
+    g_mutex_unlock(&filter->pending_lock);
+    g_thread_pool_push(filter->thread_pool, job, NULL);
+    return GST_FLOW_OK;
+}
+
 /* 
  * entry point to initialize the plug-in
  * initialize the plug-in itself
@@ -256,7 +2196,8 @@ static GstFlowReturn gst_lookout_vision_chain(GstPad * pad, GstObject * parent,
 static gboolean lookoutvision_init(GstPlugin * lookoutvision) {
     GST_DEBUG_CATEGORY_INIT(gst_lookout_vision_debug, "lookoutvision", 0, "Lookout for Vision inference plugin");
 
-    return gst_element_register (lookoutvision, "lookoutvision", GST_RANK_NONE, GST_TYPE_LOOKOUTVISION);
+    return gst_element_register (lookoutvision, "lookoutvision", GST_RANK_NONE, GST_TYPE_LOOKOUTVISION)
+            && gst_element_register (lookoutvision, "lookoutvisionlog", GST_RANK_NONE, GST_TYPE_LOOKOUTVISIONLOG);
 }
 
 #ifndef PACKAGE
@@ -22,23 +22,98 @@ G_BEGIN_DECLS
 
 typedef struct _GstLookoutVision GstLookoutVision;
 typedef struct _GstLookoutVisionClass GstLookoutVisionClass;
+typedef struct _GstLookoutVisionConfig GstLookoutVisionConfig;
+typedef struct _GstLookoutVisionDecoder GstLookoutVisionDecoder;
+
+typedef enum _GstLookoutVisionInput {
+    GST_LOOKOUT_VISION_INPUT_RGB,
+    // Pushed downstream compressed, decoded for inference only
+    GST_LOOKOUT_VISION_INPUT_JPEG,
+    // H.264 or H.265 access units, only the keyframes are decoded and inferred
+    GST_LOOKOUT_VISION_INPUT_CODED
+} GstLookoutVisionInput;
+
+typedef enum _GstLookoutVisionTriggerMode {
+    // Every frame is inferred
+    GST_LOOKOUT_VISION_TRIGGER_CONTINUOUS,
+    // Frames pass through, only the ones closest to a trigger event or signal are inferred
+    GST_LOOKOUT_VISION_TRIGGER_EXTERNAL
+} GstLookoutVisionTriggerMode;
+
+#define GST_TYPE_LOOKOUT_VISION_TRIGGER_MODE \
+  (gst_lookout_vision_trigger_mode_get_type())
 
 struct _GstLookoutVision {
     GstElement element;
     GstPad *sinkpad, *srcpad;
+    // Created on NULL to READY, so instances that never stream open no channel or shared memory. Set and cleared with
+    // config_lock held, which property setters hold while they reach the client
     LookoutVisionInferenceClient *inference_client;
     int width;
     int height;
-    gchar* server_socket;
-    gchar* model_component;
-    guint model_status_timeout;
+    GstLookoutVisionInput input;
+    // Caps of a coded stream, guarded by the object lock, and the idle keyframe decoders for it, each used by one frame
+    // at a time; caps_generation counts the caps replaced so decoders made for earlier ones are freed
+    GstCaps *coded_caps;
+    guint caps_generation;
+    // Last parameter sets of a byte-stream, put in front of the keyframes without any; guarded by the object lock
+    GstBuffer *parameter_sets;
+    GAsyncQueue *decoders;
+    guint64 keyframes;
+    // Current snapshot of the properties read while streaming; config_lock serializes the writers only
+    GstLookoutVisionConfig* config;
+    gint config_readers;
+    GMutex config_lock;
+    // model-component set while streaming and not swapped in or given up on yet, guarded by config_lock
+    gchar* requested_model_component;
+    // Exists from READY on, like the client its swaps use
+    GThreadPool* swap_pool;
+    // Cleared when streaming starts or the resolution changes, so the next frame first warms up the model
+    gboolean warmed_up;
+    gint first_frame_pending;
+    GMutex stats_lock;
+    GArray* warmup_latencies;
+    // Sizes the last warm-up on a real frame ran at, for the models swapped in later
+    GArray* warmup_sizes;
+    guint64 first_frame_latency;
+    // Frames the screening model inferred, and those of them also sent to model-component
+    guint64 screened_frames;
+    guint64 escalated_frames;
+    // Only changed in NULL or READY
+    guint max_inflight;
+    // Inferences in flight when max_inflight is above 1 or the input is coded, oldest first
+    GThreadPool* thread_pool;
+    GQueue pending;
+    GMutex pending_lock;
+    GCond pending_cond;
+    // Set from FLUSH_START to FLUSH_STOP and while going down to READY; inferences in flight are cancelled
+    gint flushing;
+    // Only changed in NULL or READY
+    GstLookoutVisionTriggerMode trigger_mode;
+    // In external trigger mode, the last frames pushed, oldest first, and the triggers still waiting for their frame
+    GstSegment segment;
+    GQueue history;
+    GArray* pending_triggers;
+    GMutex history_lock;
+    // Infers the triggered frames from PAUSED on; triggers_inflight is guarded by pending_lock
+    GThreadPool* trigger_pool;
+    guint triggers_inflight;
+    // With infer_regions, only the regions of interest are inferred, on region_pool from PAUSED on. Only changed in
+    // NULL or READY
+    gboolean infer_regions;
+    guint max_regions_inflight;
+    GThreadPool* region_pool;
 };
 
 struct _GstLookoutVisionClass {
     GstElementClass parent_class;
+
+    // Action signal, running_time is GST_CLOCK_TIME_NONE for the latest frame
+    void (*trigger)(GstLookoutVision *filter, GstClockTime running_time);
 };
 
 GType gst_lookout_vision_get_type(void);
+GType gst_lookout_vision_trigger_mode_get_type(void);
 
 G_END_DECLS
 
@@ -0,0 +1,133 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <gst/gst.h>
+#include <gst/app/gstappsink.h>
+#include <gst/app/gstappsrc.h>
+#include "gstlookoutvisiondecoder.h"
+
+// A keyframe that isn't decoded by then is given up on
+#define DECODE_TIMEOUT (5 * GST_SECOND)
+
+struct _GstLookoutVisionDecoder {
+    GstElement *pipeline;
+    GstAppSrc *src;
+    GstAppSink *sink;
+};
+
+GstLookoutVisionDecoder* gst_lookout_vision_decoder_new(GstCaps *caps) {
+    GError *error = NULL;
+    GstElement *pipeline = gst_parse_launch("appsrc name=src format=time ! decodebin ! videoconvert "
+                                            "! video/x-raw, format=RGB ! appsink name=sink sync=false", &error);
+    if (!pipeline) {
+        GST_WARNING("Could not create keyframe decoder: %s", error->message);
+        g_error_free(error);
+        return NULL;
+    }
+    GstLookoutVisionDecoder *decoder = new GstLookoutVisionDecoder;
+    decoder->pipeline = pipeline;
+    decoder->src = GST_APP_SRC(gst_bin_get_by_name(GST_BIN(pipeline), "src"));
+    decoder->sink = GST_APP_SINK(gst_bin_get_by_name(GST_BIN(pipeline), "sink"));
+    gst_app_src_set_caps(decoder->src, caps);
+    return decoder;
+}
+
+GstSample* gst_lookout_vision_decoder_decode(GstLookoutVisionDecoder *decoder, GstBuffer *keyframe,
+                                             GstBuffer *parameter_sets, std::string *error) {
+    if (gst_element_set_state(decoder->pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+        *error = "Could not start keyframe decoder";
+        return NULL;
+    }
+
+    // Shares the memory of the frame going downstream; its timestamps would fall outside the decoder's segment
+    GstBuffer *copy = gst_buffer_copy(keyframe);
+    if (parameter_sets) {
+        copy = gst_buffer_append(gst_buffer_copy(parameter_sets), copy);
+    }
+    GST_BUFFER_PTS(copy) = 0;
+    GST_BUFFER_DTS(copy) = 0;
+    GST_BUFFER_DURATION(copy) = GST_CLOCK_TIME_NONE;
+    gst_app_src_push_buffer(decoder->src, copy);
+    gst_app_src_end_of_stream(decoder->src);
+
+    GstSample *sample = gst_app_sink_try_pull_sample(decoder->sink, DECODE_TIMEOUT);
+    // Releases the frame and resets the decoder and the EOS for the next keyframe
+    gst_element_set_state(decoder->pipeline, GST_STATE_READY);
+
+    // Nobody watches the bus, messages would pile up over the keyframes
+    GstBus *bus = gst_element_get_bus(decoder->pipeline);
+    GstMessage *message;
+    while ((message = gst_bus_pop(bus))) {
+        if (!sample && GST_MESSAGE_TYPE(message) == GST_MESSAGE_ERROR && error->empty()) {
+            GError *decode_error = NULL;
+            gst_message_parse_error(message, &decode_error, NULL);
+            *error = decode_error->message;
+            g_error_free(decode_error);
+        }
+        gst_message_unref(message);
+    }
+    gst_object_unref(bus);
+    if (!sample && error->empty()) {
+        *error = "Keyframe decoded to nothing";
+    }
+    return sample;
+}
+
+/*
+ * Scans the Annex B start codes of the keyframe. Streams in avc or hvc format carry their parameter sets in the caps'
+ * codec_data, which the decoder gets anyway.
+ */
+GstBuffer* gst_lookout_vision_decoder_parameter_sets(GstCaps *caps, GstBuffer *keyframe) {
+    GstStructure *s = gst_caps_get_structure(caps, 0);
+    gboolean h265 = gst_structure_has_name(s, "video/x-h265");
+    if (!h265 && !gst_structure_has_name(s, "video/x-h264")) {
+        return NULL;
+    }
+    const gchar *stream_format = gst_structure_get_string(s, "stream-format");
+    if (stream_format ? g_strcmp0(stream_format, "byte-stream") != 0 : gst_structure_has_field(s, "codec_data")) {
+        return NULL;
+    }
+
+    GstMapInfo map;
+    if (!gst_buffer_map(keyframe, &map, GST_MAP_READ)) {
+        return NULL;
+    }
+    std::string parameter_sets;
+    // Offsets of the current NAL unit's start code and header, start stays at map.size before the first start code
+    gsize start = map.size;
+    gsize header = map.size;
+    auto keep_parameter_set = [&](gsize end) {
+        if (header >= end) {
+            return;
+        }
+        guint type = h265 ? (map.data[header] >> 1) & 0x3f : map.data[header] & 0x1f;
+        if (h265 ? (type >= 32 && type <= 34) : (type == 7 || type == 8)) {
+            parameter_sets.append((const char*) map.data + start, end - start);
+        }
+    };
+    for (gsize i = 0; i + 3 <= map.size; i++) {
+        if (map.data[i] == 0 && map.data[i + 1] == 0 && map.data[i + 2] == 1) {
+            keep_parameter_set(i);
+            start = i;
+            header = i + 3;
+            i += 2;
+        }
+    }
+    keep_parameter_set(map.size);
+    gst_buffer_unmap(keyframe, &map);
+
+    if (parameter_sets.empty()) {
+        return NULL;
+    }
+    GstBuffer *buffer = gst_buffer_new_allocate(NULL, parameter_sets.size(), NULL);
+    gst_buffer_fill(buffer, 0, parameter_sets.data(), parameter_sets.size());
+    return buffer;
+}
+
+void gst_lookout_vision_decoder_free(GstLookoutVisionDecoder *decoder) {
+    gst_element_set_state(decoder->pipeline, GST_STATE_NULL);
+    gst_object_unref(decoder->src);
+    gst_object_unref(decoder->sink);
+    gst_object_unref(decoder->pipeline);
+    delete decoder;
+}
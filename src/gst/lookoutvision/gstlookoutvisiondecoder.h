@@ -0,0 +1,34 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __GST_LOOKOUTVISION_DECODER_H__
+#define __GST_LOOKOUTVISION_DECODER_H__
+
+#include <gst/gst.h>
+#include <string>
+
+G_BEGIN_DECLS
+
+/*
+ * Decodes single keyframes of a compressed stream (H.264, H.265, or anything decodebin handles) to packed RGB.
+ *
+ * Each decoder is a private appsrc ! decodebin ! videoconvert ! appsink pipeline. A keyframe is decoded on its own: the
+ * pipeline goes to PLAYING, gets the frame followed by EOS so the decoder outputs it at once, and goes back to READY.
+ * Frames that depend on other frames can't be decoded this way.
+ *
+ * Going back to READY also drops the codec state, so an H.264 or H.265 byte-stream keyframe without its own parameter
+ * sets has to be given the last ones the stream carried.
+ */
+typedef struct _GstLookoutVisionDecoder GstLookoutVisionDecoder;
+
+GstLookoutVisionDecoder* gst_lookout_vision_decoder_new(GstCaps *caps);
+// Returns an RGB sample, or NULL with error set. parameter_sets, if not NULL, go in front of the keyframe
+GstSample* gst_lookout_vision_decoder_decode(GstLookoutVisionDecoder *decoder, GstBuffer *keyframe,
+                                             GstBuffer *parameter_sets, std::string *error);
+// The VPS, SPS and PPS NAL units of an H.264 or H.265 byte-stream keyframe with their start codes, NULL if it has none
+GstBuffer* gst_lookout_vision_decoder_parameter_sets(GstCaps *caps, GstBuffer *keyframe);
+void gst_lookout_vision_decoder_free(GstLookoutVisionDecoder *decoder);
+
+G_END_DECLS
+
+#endif //__GST_LOOKOUTVISION_DECODER_H__
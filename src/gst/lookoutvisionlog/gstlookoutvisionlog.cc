@@ -0,0 +1,258 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+/**
+ * SECTION:element-lookoutvisionlog
+ *
+ * Appends the Lookout for Vision inference result attached to each frame to a memory-mapped, segment-rotated binary
+ * log. Use the lookoutvision-log-query tool to read the log back.
+ *
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ *   gst-launch-1.0
+ *     videotestsrc num-buffers=1 pattern="ball"
+ *   ! 'video/x-raw, format=RGB, width=1280, height=720'
+ *   ! videoconvert
+ *   ! lookoutvision server-socket="unix:///tmp/aws.iot.lookoutvision.EdgeAgent.sock" model-component="SampleModel"
+ *   ! lookoutvisionlog location=/var/lib/lookoutvision/log sync-interval=1000
+ *   ! fakesink
+ * ]|
+ * </refsect2>
+ */
+
+#include <cstring>
+#include <gst/gst.h>
+#include "gstlookoutvisionlog.h"
+#include "gst/lookoutvisionmeta/gstlookoutvisionmeta.h"
+#include "inference-log/InferenceLog.h"
+
+GST_DEBUG_CATEGORY_STATIC(gst_lookout_vision_log_debug);
+#define GST_CAT_DEFAULT gst_lookout_vision_log_debug
+
+enum {
+    PROP_0,
+    PROP_LOCATION,
+    PROP_SEGMENT_RECORDS,
+    PROP_MAX_SEGMENTS,
+    PROP_SYNC_INTERVAL,
+    PROP_INDEX_INTERVAL
+};
+
+/* Inputs and outputs */
+static GstStaticPadTemplate sink_factory = GST_STATIC_PAD_TEMPLATE("sink",
+                                                                   GST_PAD_SINK,
+                                                                   GST_PAD_ALWAYS,
+                                                                   GST_STATIC_CAPS_ANY
+);
+
+static GstStaticPadTemplate src_factory = GST_STATIC_PAD_TEMPLATE("src",
+                                                                  GST_PAD_SRC,
+                                                                  GST_PAD_ALWAYS,
+                                                                  GST_STATIC_CAPS_ANY
+);
+
+#define gst_lookout_vision_log_parent_class parent_class
+G_DEFINE_TYPE(GstLookoutVisionLog, gst_lookout_vision_log, GST_TYPE_ELEMENT);
+
+static void gst_lookout_vision_log_set_property(GObject * object, guint prop_id,
+                                                const GValue * value, GParamSpec * pspec);
+static void gst_lookout_vision_log_get_property(GObject * object, guint prop_id,
+                                                GValue * value, GParamSpec * pspec);
+static void gst_lookout_vision_log_finalize(GObject *object);
+static GstStateChangeReturn gst_lookout_vision_log_change_state(GstElement *element, GstStateChange transition);
+
+static GstFlowReturn gst_lookout_vision_log_chain(GstPad * pad, GstObject * parent, GstBuffer * buf);
+
+/* initialize the lookoutvisionlog class */
+static void gst_lookout_vision_log_class_init(GstLookoutVisionLogClass * klass) {
+    GObjectClass *gobject_class;
+    GstElementClass *gstelement_class;
+
+    gobject_class = (GObjectClass *) klass;
+    gstelement_class = (GstElementClass *) klass;
+
+    gobject_class->set_property = gst_lookout_vision_log_set_property;
+    gobject_class->get_property = gst_lookout_vision_log_get_property;
+    gobject_class->finalize = gst_lookout_vision_log_finalize;
+    gstelement_class->change_state = gst_lookout_vision_log_change_state;
+
+    g_object_class_install_property(gobject_class, PROP_LOCATION,
+                                    g_param_spec_string("location", "Location", "Directory holding the log segments",
+                                                        "lookoutvision-log",
+                                                        G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_SEGMENT_RECORDS,
+                                    g_param_spec_uint("segment-records", "Segment Records",
+                                                      "Number of records per segment file", 1, G_MAXUINT, 65536,
+                                                      G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_MAX_SEGMENTS,
+                                    g_param_spec_uint("max-segments", "Max Segments",
+                                                      "Number of segment files to keep (0 = unlimited)", 0,
+                                                      G_MAXUINT, 0, G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_SYNC_INTERVAL,
+                                    g_param_spec_uint("sync-interval", "Sync Interval",
+                                                      "Interval in milliseconds between flushes to disk "
+                                                      "(0 = only on segment rotation and stop)", 0, G_MAXUINT, 1000,
+                                                      G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_INDEX_INTERVAL,
+                                    g_param_spec_uint("index-interval", "Index Interval",
+                                                      "Number of records between time index entries "
+                                                      "(0 = one entry per segment)", 0, G_MAXUINT, 1024,
+                                                      G_PARAM_READWRITE));
+
+    gst_element_class_set_details_simple(gstelement_class,
+                                         "LookoutVisionLog",
+                                         "GstLookoutVisionLog",
+                                         "Lookout for Vision inference result log GStreamer plugin",
+                                         "Amazon");
+
+    gst_element_class_add_pad_template(gstelement_class,
+                                       gst_static_pad_template_get(&src_factory));
+    gst_element_class_add_pad_template(gstelement_class,
+                                       gst_static_pad_template_get(&sink_factory));
+
+    GST_DEBUG_CATEGORY_INIT(gst_lookout_vision_log_debug, "lookoutvisionlog", 0,
+                            "Lookout for Vision inference result log");
+}
+
+/*
+ * initialize the new element
+ * instantiate pads and add them to element
+ * set pad callback functions
+ * initialize instance structure
+ */
+static void gst_lookout_vision_log_init(GstLookoutVisionLog * filter) {
+    filter->sinkpad = gst_pad_new_from_static_template(&sink_factory, "sink");
+    gst_pad_set_chain_function(filter->sinkpad, GST_DEBUG_FUNCPTR(gst_lookout_vision_log_chain));
+    GST_PAD_SET_PROXY_CAPS(filter->sinkpad);
+    gst_element_add_pad(GST_ELEMENT (filter), filter->sinkpad);
+
+    filter->srcpad = gst_pad_new_from_static_template(&src_factory, "src");
+    GST_PAD_SET_PROXY_CAPS(filter->srcpad);
+    gst_element_add_pad(GST_ELEMENT (filter), filter->srcpad);
+
+    // Set default properties
+    filter->location = g_strdup("lookoutvision-log");
+    filter->segment_records = 65536;
+    filter->max_segments = 0;
+    filter->sync_interval = 1000;
+    filter->index_interval = 1024;
+    filter->writer = NULL;
+}
+
+static void gst_lookout_vision_log_set_property(GObject * object, guint prop_id, const GValue * value,
+                                                GParamSpec * pspec) {
+    GstLookoutVisionLog *filter = GST_LOOKOUTVISIONLOG(object);
+
+    switch (prop_id) {
+        case PROP_LOCATION:
+            g_free(filter->location);
+            filter->location = g_value_dup_string(value);
+            break;
+        case PROP_SEGMENT_RECORDS:
+            filter->segment_records = g_value_get_uint(value);
+            break;
+        case PROP_MAX_SEGMENTS:
+            filter->max_segments = g_value_get_uint(value);
+            break;
+        case PROP_SYNC_INTERVAL:
+            filter->sync_interval = g_value_get_uint(value);
+            break;
+        case PROP_INDEX_INTERVAL:
+            filter->index_interval = g_value_get_uint(value);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+            break;
+    }
+}
+
+static void gst_lookout_vision_log_get_property(GObject * object, guint prop_id, GValue * value,
+                                                GParamSpec * pspec) {
+    GstLookoutVisionLog *filter = GST_LOOKOUTVISIONLOG(object);
+
+    switch (prop_id) {
+        case PROP_LOCATION:
+            g_value_set_string(value, filter->location);
+            break;
+        case PROP_SEGMENT_RECORDS:
+            g_value_set_uint(value, filter->segment_records);
+            break;
+        case PROP_MAX_SEGMENTS:
+            g_value_set_uint(value, filter->max_segments);
+            break;
+        case PROP_SYNC_INTERVAL:
+            g_value_set_uint(value, filter->sync_interval);
+            break;
+        case PROP_INDEX_INTERVAL:
+            g_value_set_uint(value, filter->index_interval);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+            break;
+    }
+}
+
+static void gst_lookout_vision_log_finalize(GObject *object) {
+    GstLookoutVisionLog *filter = GST_LOOKOUTVISIONLOG(object);
+    if (filter) {
+        GST_DEBUG_OBJECT(filter, "finalize");
+        delete filter->writer;
+        filter->writer = NULL;
+        g_free(filter->location);
+        filter->location = NULL;
+    }
+    G_OBJECT_CLASS(parent_class)->finalize(object);
+}
+
+static GstStateChangeReturn gst_lookout_vision_log_change_state(GstElement *element, GstStateChange transition) {
+    GstLookoutVisionLog *filter = GST_LOOKOUTVISIONLOG(element);
+
+    if (transition == GST_STATE_CHANGE_NULL_TO_READY) {
+        try {
+            filter->writer = new InferenceLogWriter(filter->location, filter->segment_records, filter->max_segments,
+                                                    filter->sync_interval, filter->index_interval);
+        } catch (std::exception& e) {
+            GST_ELEMENT_ERROR(filter, RESOURCE, OPEN_WRITE, (NULL), ("%s", e.what()));
+            return GST_STATE_CHANGE_FAILURE;
+        }
+    }
+
+    GstStateChangeReturn ret = GST_ELEMENT_CLASS(parent_class)->change_state(element, transition);
+
+    if (transition == GST_STATE_CHANGE_READY_TO_NULL) {
+        delete filter->writer;
+        filter->writer = NULL;
+    }
+    return ret;
+}
+
+/* chain function */
+static GstFlowReturn gst_lookout_vision_log_chain(GstPad * pad, GstObject * parent, GstBuffer * buf) {
+    GstLookoutVisionLog *filter;
+    filter = GST_LOOKOUTVISIONLOG(parent);
+
+    GstLookoutVisionMeta* lookoutvision_meta = gst_buffer_get_lookout_vision_meta(buf);
+    if (lookoutvision_meta && lookoutvision_meta->result && filter->writer) {
+        GstLookoutVisionResult* inference_result = lookoutvision_meta->result;
+
+        InferenceLogRecord record = {};
+        record.wall_time_ns = g_get_real_time() * 1000;
+        record.pts = GST_BUFFER_PTS(buf);
+        record.inference_latency_ns = inference_result->inference_latency;
+        record.confidence = inference_result->confidence;
+        record.is_anomalous = inference_result->is_anomalous;
+        record.result_status = inference_result->result_status;
+        strncpy(record.model_component, inference_result->model_component.c_str(), sizeof(record.model_component));
+
+        try {
+            filter->writer->Append(record);
+        } catch (std::exception& e) {
+            GST_ELEMENT_ERROR(filter, RESOURCE, WRITE, (NULL), ("%s", e.what()));
+            gst_buffer_unref(buf);
+            return GST_FLOW_ERROR;
+        }
+    }
+
+    return gst_pad_push(filter->srcpad, buf);
+}
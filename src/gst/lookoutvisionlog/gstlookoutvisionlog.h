@@ -0,0 +1,45 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __GST_LOOKOUTVISIONLOG_H__
+#define __GST_LOOKOUTVISIONLOG_H__
+
+#include <gst/gst.h>
+#include "inference-log/InferenceLog.h"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_LOOKOUTVISIONLOG \
+  (gst_lookout_vision_log_get_type())
+#define GST_LOOKOUTVISIONLOG(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_LOOKOUTVISIONLOG,GstLookoutVisionLog))
+#define GST_LOOKOUTVISIONLOG_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_LOOKOUTVISIONLOG,GstLookoutVisionLogClass))
+#define GST_IS_LOOKOUTVISIONLOG(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_LOOKOUTVISIONLOG))
+#define GST_IS_LOOKOUTVISIONLOG_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_LOOKOUTVISIONLOG))
+
+typedef struct _GstLookoutVisionLog GstLookoutVisionLog;
+typedef struct _GstLookoutVisionLogClass GstLookoutVisionLogClass;
+
+struct _GstLookoutVisionLog {
+    GstElement element;
+    GstPad *sinkpad, *srcpad;
+    gchar* location;
+    guint segment_records;
+    guint max_segments;
+    guint sync_interval;
+    guint index_interval;
+    InferenceLogWriter* writer;
+};
+
+struct _GstLookoutVisionLogClass {
+    GstElementClass parent_class;
+};
+
+GType gst_lookout_vision_log_get_type(void);
+
+G_END_DECLS
+
+#endif /* __GST_LOOKOUTVISIONLOG_H__ */
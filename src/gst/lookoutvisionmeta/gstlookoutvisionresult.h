@@ -6,19 +6,57 @@
 
 #include <gst/gst.h>
 #include <string>
+#include <vector>
 
 G_BEGIN_DECLS
 
 typedef enum _GstLookoutVisionResultStatus {
     SUCCESSFUL,
-    FAILED
+    FAILED,
+    // No reply within the inference timeout
+    TIMEOUT,
+    // Not sent for inference, the frame failed the image-quality thresholds
+    SKIPPED_QUALITY
 } GstLookoutVisionResultStatus;
 
+/* Verdict of the screening model of a cascade, kept next to the full-resolution verdict the frame may have had */
+typedef struct _GstLookoutVisionScreening {
+    // False unless the frame went through a cascade
+    bool screened;
+    // The frame was also sent to model-component, and the result's own verdict is from there
+    bool escalated;
+    bool is_anomalous;
+    float confidence;
+    GstLookoutVisionResultStatus result_status;
+    GstClockTime inference_latency;
+} GstLookoutVisionScreening;
+
+/* Verdict on one GstVideoRegionOfInterestMeta of a frame inferred region by region */
+typedef struct _GstLookoutVisionRegion {
+    // id of the region's GstVideoRegionOfInterestMeta
+    gint roi_id;
+    // As given by the meta, in pixels of the frame
+    guint x;
+    guint y;
+    guint width;
+    guint height;
+    bool is_anomalous;
+    float confidence;
+    GstLookoutVisionResultStatus result_status;
+    std::string error_message;
+    GstClockTime inference_latency;
+} GstLookoutVisionRegion;
+
 typedef struct _GstLookoutVisionResult {
     bool is_anomalous;
     float confidence;
     GstLookoutVisionResultStatus result_status;
     std::string error_message;
+    std::string model_component;
+    GstClockTime inference_latency;
+    GstLookoutVisionScreening screening;
+    // Empty unless the frame was inferred region by region; its own verdict then sums the regions up
+    std::vector<GstLookoutVisionRegion> regions;
 } GstLookoutVisionResult;
 
 G_END_DECLS
@@ -0,0 +1,373 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <stdexcept>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "InferenceLog.h"
+
+static const char SEGMENT_MAGIC[8] = {'L', 'V', 'L', 'O', 'G', 'S', 'E', 'G'};
+static const uint32_t SEGMENT_VERSION = 1;
+
+static uint64_t monotonicTimeNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static std::string segmentPath(const std::string& location, uint64_t sequence) {
+    char name[64];
+    snprintf(name, sizeof(name), "/segment-%020" PRIu64 ".lvlog", sequence);
+    return location + name;
+}
+
+static std::string indexPath(const std::string& location) {
+    return location + "/index.lvidx";
+}
+
+static std::vector<uint64_t> listSegments(const std::string& location) {
+    std::vector<uint64_t> sequences;
+    DIR* dir = opendir(location.c_str());
+    if (!dir) {
+        return sequences;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        uint64_t sequence;
+        char suffix[8] = {};
+        if (sscanf(entry->d_name, "segment-%" SCNu64 ".%7s", &sequence, suffix) == 2
+                && strcmp(suffix, "lvlog") == 0) {
+            sequences.push_back(sequence);
+        }
+    }
+    closedir(dir);
+    std::sort(sequences.begin(), sequences.end());
+    return sequences;
+}
+
+/**
+ * Number of committed records, scanning past the count persisted in the header for records that made it to the
+ * page cache but were not yet synced when the writer stopped.
+ */
+static uint64_t committedRecords(const InferenceLogSegmentHeader* header, const InferenceLogRecord* records) {
+    uint64_t count = std::min(header->record_count, header->capacity);
+    while (count < header->capacity && __atomic_load_n(&records[count].wall_time_ns, __ATOMIC_ACQUIRE) != 0) {
+        count++;
+    }
+    return count;
+}
+
+InferenceLogWriter::InferenceLogWriter(std::string location, uint64_t segment_records, uint32_t max_segments,
+                                       uint32_t sync_interval_ms, uint32_t index_interval)
+        : location(location), segment_records(std::max<uint64_t>(segment_records, 1)), max_segments(max_segments),
+          sync_interval_ns((uint64_t) sync_interval_ms * 1000000ULL), index_interval(index_interval) {
+    if (mkdir(location.c_str(), 0755) != 0 && errno != EEXIST) {
+        throw std::runtime_error("failed to create inference log directory " + location);
+    }
+
+    index_fd = open(indexPath(location).c_str(), O_CREAT | O_WRONLY | O_APPEND, 0644);
+    if (index_fd < 0) {
+        throw std::runtime_error("failed to open inference log index in " + location);
+    }
+    // Drop a partially written trailing entry left behind by a crash
+    struct stat index_stat;
+    if (fstat(index_fd, &index_stat) == 0 && index_stat.st_size % sizeof(InferenceLogIndexEntry) != 0
+            && ftruncate(index_fd, index_stat.st_size - index_stat.st_size % sizeof(InferenceLogIndexEntry)) != 0) {
+        close(index_fd);
+        index_fd = -1;
+        throw std::runtime_error("failed to truncate inference log index in " + location);
+    }
+    pending_index_entries.reserve(64);
+
+    std::vector<uint64_t> sequences = listSegments(location);
+    if (sequences.empty()) {
+        openSegment(0, true);
+    } else {
+        openSegment(sequences.back(), false);
+    }
+    last_sync_time = monotonicTimeNs();
+}
+
+InferenceLogWriter::~InferenceLogWriter() {
+    Sync();
+    closeSegment();
+    if (index_fd >= 0) {
+        close(index_fd);
+    }
+}
+
+InferenceLogSegmentHeader* InferenceLogWriter::header() {
+    return (InferenceLogSegmentHeader*) segment_data;
+}
+
+InferenceLogRecord* InferenceLogWriter::records() {
+    return (InferenceLogRecord*) (segment_data + sizeof(InferenceLogSegmentHeader));
+}
+
+void InferenceLogWriter::openSegment(uint64_t sequence, bool create) {
+    std::string path = segmentPath(location, sequence);
+    segment_fd = open(path.c_str(), create ? (O_CREAT | O_EXCL | O_RDWR) : O_RDWR, 0644);
+    if (segment_fd < 0) {
+        throw std::runtime_error("failed to open inference log segment " + path);
+    }
+
+    if (create) {
+        segment_size = sizeof(InferenceLogSegmentHeader) + segment_records * sizeof(InferenceLogRecord);
+        if (ftruncate(segment_fd, segment_size) != 0) {
+            close(segment_fd);
+            segment_fd = -1;
+            throw std::runtime_error("failed to allocate inference log segment " + path);
+        }
+    } else {
+        struct stat segment_stat;
+        if (fstat(segment_fd, &segment_stat) != 0
+                || (size_t) segment_stat.st_size < sizeof(InferenceLogSegmentHeader)) {
+            close(segment_fd);
+            segment_fd = -1;
+            throw std::runtime_error("invalid inference log segment " + path);
+        }
+        segment_size = segment_stat.st_size;
+    }
+
+    segment_data = (uint8_t*) mmap(0, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, segment_fd, 0);
+    if (segment_data == MAP_FAILED) {
+        segment_data = nullptr;
+        close(segment_fd);
+        segment_fd = -1;
+        throw std::runtime_error("failed to map inference log segment " + path);
+    }
+
+    InferenceLogSegmentHeader* segment_header = header();
+    if (memcmp(segment_header->magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) != 0) {
+        if (segment_header->version != 0) {
+            closeSegment();
+            throw std::runtime_error("corrupt inference log segment " + path);
+        }
+        // Fresh segment, or one whose header never reached the disk
+        segment_header->version = SEGMENT_VERSION;
+        segment_header->record_size = sizeof(InferenceLogRecord);
+        segment_header->sequence = sequence;
+        segment_header->capacity = (segment_size - sizeof(InferenceLogSegmentHeader)) / sizeof(InferenceLogRecord);
+        segment_header->record_count = 0;
+        memcpy(segment_header->magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+    } else if (segment_header->record_size != sizeof(InferenceLogRecord)
+            || sizeof(InferenceLogSegmentHeader) + segment_header->capacity * sizeof(InferenceLogRecord)
+                    > segment_size) {
+        closeSegment();
+        throw std::runtime_error("unsupported inference log segment " + path);
+    }
+
+    segment_sequence = sequence;
+    record_count = committedRecords(segment_header, records());
+    synced_count = std::min(segment_header->record_count, record_count);
+}
+
+void InferenceLogWriter::closeSegment() {
+    if (segment_data) {
+        munmap(segment_data, segment_size);
+        segment_data = nullptr;
+    }
+    if (segment_fd >= 0) {
+        close(segment_fd);
+        segment_fd = -1;
+    }
+}
+
+void InferenceLogWriter::rotateSegment() {
+    Sync();
+    closeSegment();
+    openSegment(segment_sequence + 1, true);
+    removeExpiredSegments();
+}
+
+void InferenceLogWriter::removeExpiredSegments() {
+    if (max_segments == 0) {
+        return;
+    }
+    std::vector<uint64_t> sequences = listSegments(location);
+    if (sequences.size() <= max_segments) {
+        return;
+    }
+    for (size_t i = 0; i + max_segments < sequences.size(); i++) {
+        unlink(segmentPath(location, sequences[i]).c_str());
+    }
+    compactIndex(sequences[sequences.size() - max_segments]);
+}
+
+/**
+ * Rewrites the index without the entries of segments older than first_sequence, so that it stays bounded by the
+ * retained segments. The new index is written beside the old one and renamed over it; on failure the old index,
+ * whose stale entries the reader tolerates, is kept.
+ */
+void InferenceLogWriter::compactIndex(uint64_t first_sequence) {
+    std::vector<InferenceLogIndexEntry> entries;
+    FILE* index_file = fopen(indexPath(location).c_str(), "rb");
+    if (!index_file) {
+        return;
+    }
+    InferenceLogIndexEntry entry;
+    while (fread(&entry, sizeof(entry), 1, index_file) == 1) {
+        if (entry.segment_sequence >= first_sequence) {
+            entries.push_back(entry);
+        }
+    }
+    fclose(index_file);
+
+    std::string compacted_path = indexPath(location) + ".tmp";
+    int compacted_fd = open(compacted_path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    if (compacted_fd < 0) {
+        std::cout << "Failed to compact inference log index" << std::endl;
+        return;
+    }
+    size_t bytes = entries.size() * sizeof(InferenceLogIndexEntry);
+    if ((bytes > 0 && write(compacted_fd, entries.data(), bytes) != (ssize_t) bytes) || fdatasync(compacted_fd) != 0
+            || rename(compacted_path.c_str(), indexPath(location).c_str()) != 0) {
+        std::cout << "Failed to compact inference log index" << std::endl;
+        close(compacted_fd);
+        unlink(compacted_path.c_str());
+        return;
+    }
+    close(compacted_fd);
+
+    int new_index_fd = open(indexPath(location).c_str(), O_WRONLY | O_APPEND);
+    if (new_index_fd < 0) {
+        std::cout << "Failed to reopen inference log index" << std::endl;
+        return;
+    }
+    close(index_fd);
+    index_fd = new_index_fd;
+}
+
+void InferenceLogWriter::Append(const InferenceLogRecord& record) {
+    if (record_count >= header()->capacity) {
+        rotateSegment();
+    }
+
+    // Zero marks an uncommitted slot, so a record must never carry a zero timestamp
+    uint64_t wall_time_ns = record.wall_time_ns ? record.wall_time_ns : 1;
+    InferenceLogRecord* slot = &records()[record_count];
+    memcpy((uint8_t*) slot + offsetof(InferenceLogRecord, pts), (const uint8_t*) &record
+           + offsetof(InferenceLogRecord, pts), sizeof(InferenceLogRecord) - offsetof(InferenceLogRecord, pts));
+    __atomic_store_n(&slot->wall_time_ns, wall_time_ns, __ATOMIC_RELEASE);
+
+    if (record_count == 0 || (index_interval > 0 && record_count % index_interval == 0)) {
+        pending_index_entries.push_back(InferenceLogIndexEntry{wall_time_ns, segment_sequence, record_count});
+    }
+    record_count++;
+
+    if (sync_interval_ns > 0 && monotonicTimeNs() - last_sync_time >= sync_interval_ns) {
+        Sync();
+    }
+}
+
+void InferenceLogWriter::Sync() {
+    last_sync_time = monotonicTimeNs();
+    if (!segment_data) {
+        return;
+    }
+
+    if (synced_count < record_count) {
+        size_t page_size = sysconf(_SC_PAGESIZE);
+        size_t start = sizeof(InferenceLogSegmentHeader) + synced_count * sizeof(InferenceLogRecord);
+        size_t end = sizeof(InferenceLogSegmentHeader) + record_count * sizeof(InferenceLogRecord);
+        start -= start % page_size;
+        // Records first, then the header count that covers them
+        if (msync(segment_data + start, end - start, MS_SYNC) != 0) {
+            std::cout << "Failed to sync inference log segment " << segment_sequence << std::endl;
+            return;
+        }
+        header()->record_count = record_count;
+        msync(segment_data, page_size, MS_SYNC);
+        synced_count = record_count;
+    }
+
+    if (!pending_index_entries.empty()) {
+        size_t bytes = pending_index_entries.size() * sizeof(InferenceLogIndexEntry);
+        if (write(index_fd, pending_index_entries.data(), bytes) == (ssize_t) bytes) {
+            fdatasync(index_fd);
+        } else {
+            std::cout << "Failed to write inference log index" << std::endl;
+        }
+        pending_index_entries.clear();
+    }
+}
+
+InferenceLogReader::InferenceLogReader(std::string location) : location(location) {}
+
+uint64_t InferenceLogReader::Query(uint64_t from_wall_time_ns, uint64_t to_wall_time_ns, RecordCallback callback) {
+    // Find the last sparse index entry at or before the start of the range
+    uint64_t start_sequence = 0;
+    uint64_t start_record = 0;
+    FILE* index_file = fopen(indexPath(location).c_str(), "rb");
+    if (index_file) {
+        InferenceLogIndexEntry entry;
+        while (fread(&entry, sizeof(entry), 1, index_file) == 1 && entry.wall_time_ns <= from_wall_time_ns) {
+            start_sequence = entry.segment_sequence;
+            start_record = entry.record_index;
+        }
+        fclose(index_file);
+    }
+
+    uint64_t matched = 0;
+    for (uint64_t sequence : listSegments(location)) {
+        if (sequence < start_sequence) {
+            continue;
+        }
+
+        std::string path = segmentPath(location, sequence);
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            continue;
+        }
+        struct stat segment_stat;
+        if (fstat(fd, &segment_stat) != 0 || (size_t) segment_stat.st_size < sizeof(InferenceLogSegmentHeader)) {
+            close(fd);
+            continue;
+        }
+        size_t size = segment_stat.st_size;
+        uint8_t* data = (uint8_t*) mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) {
+            continue;
+        }
+
+        const InferenceLogSegmentHeader* header = (const InferenceLogSegmentHeader*) data;
+        const InferenceLogRecord* records = (const InferenceLogRecord*) (data + sizeof(InferenceLogSegmentHeader));
+        bool done = false;
+        if (memcmp(header->magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) == 0
+                && header->record_size == sizeof(InferenceLogRecord)
+                && sizeof(InferenceLogSegmentHeader) + header->capacity * sizeof(InferenceLogRecord) <= size) {
+            uint64_t count = committedRecords(header, records);
+            for (uint64_t i = (sequence == start_sequence) ? start_record : 0; i < count; i++) {
+                const InferenceLogRecord& record = records[i];
+                if (record.wall_time_ns > to_wall_time_ns) {
+                    done = true;
+                    break;
+                }
+                if (record.wall_time_ns >= from_wall_time_ns) {
+                    matched++;
+                    if (!callback(record)) {
+                        done = true;
+                        break;
+                    }
+                }
+            }
+        }
+        munmap(data, size);
+        if (done) {
+            break;
+        }
+    }
+    return matched;
+}
@@ -0,0 +1,101 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __INFERENCE_LOG_H__
+#define __INFERENCE_LOG_H__
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/*
+ * Append-only log of inference results.
+ *
+ * The log is a directory of fixed-capacity segment files (segment-<sequence>.lvlog), each holding a header followed
+ * by fixed-size records, plus a sparse time index (index.lvidx). Segments are preallocated and memory-mapped so that
+ * appending a record is a copy into the page cache; durability is obtained by msync/fdatasync at sync points.
+ *
+ * A record is committed once its wall_time_ns field is non-zero: the writer stores that field last, so a record
+ * interrupted by a crash is never read back.
+ */
+
+#define INFERENCE_LOG_MODEL_COMPONENT_SIZE 32
+
+typedef struct _InferenceLogRecord {
+    uint64_t wall_time_ns;
+    uint64_t pts;
+    uint64_t inference_latency_ns;
+    float confidence;
+    uint8_t is_anomalous;
+    uint8_t result_status;
+    uint16_t reserved;
+    char model_component[INFERENCE_LOG_MODEL_COMPONENT_SIZE];
+} InferenceLogRecord;
+
+typedef struct _InferenceLogSegmentHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t sequence;
+    uint64_t capacity;
+    uint64_t record_count;
+    uint8_t reserved[24];
+} InferenceLogSegmentHeader;
+
+typedef struct _InferenceLogIndexEntry {
+    uint64_t wall_time_ns;
+    uint64_t segment_sequence;
+    uint64_t record_index;
+} InferenceLogIndexEntry;
+
+static_assert(sizeof(InferenceLogRecord) == 64, "InferenceLogRecord must stay 64 bytes");
+static_assert(sizeof(InferenceLogSegmentHeader) == 64, "InferenceLogSegmentHeader must stay 64 bytes");
+
+class InferenceLogWriter {
+public:
+    InferenceLogWriter(std::string location, uint64_t segment_records, uint32_t max_segments,
+                       uint32_t sync_interval_ms, uint32_t index_interval);
+    ~InferenceLogWriter();
+    void Append(const InferenceLogRecord& record);
+    void Sync();
+
+private:
+    std::string location;
+    uint64_t segment_records;
+    uint32_t max_segments;
+    uint64_t sync_interval_ns;
+    uint32_t index_interval;
+
+    uint64_t segment_sequence = 0;
+    int segment_fd = -1;
+    uint8_t* segment_data = nullptr;
+    size_t segment_size = 0;
+    uint64_t record_count = 0;
+    uint64_t synced_count = 0;
+    uint64_t last_sync_time = 0;
+
+    int index_fd = -1;
+    std::vector<InferenceLogIndexEntry> pending_index_entries;
+
+    InferenceLogSegmentHeader* header();
+    InferenceLogRecord* records();
+    void openSegment(uint64_t sequence, bool create);
+    void closeSegment();
+    void rotateSegment();
+    void removeExpiredSegments();
+    void compactIndex(uint64_t first_sequence);
+};
+
+class InferenceLogReader {
+public:
+    typedef std::function<bool(const InferenceLogRecord&)> RecordCallback;
+
+    InferenceLogReader(std::string location);
+    uint64_t Query(uint64_t from_wall_time_ns, uint64_t to_wall_time_ns, RecordCallback callback);
+
+private:
+    std::string location;
+};
+
+#endif //__INFERENCE_LOG_H__
@@ -0,0 +1,104 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+/**
+ * Command line tool that prints the inference results stored by the lookoutvisionlog element as CSV.
+ *
+ * Usage: lookoutvision-log-query <location> [--from <unix seconds>] [--to <unix seconds>] [--anomalous-only]
+ *                                [--count]
+ */
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include "InferenceLog.h"
+#include "gst/lookoutvisionmeta/gstlookoutvisionresult.h"
+
+static const char* resultStatusName(uint8_t result_status) {
+    switch (result_status) {
+        case GstLookoutVisionResultStatus::SUCCESSFUL:
+            return "SUCCESSFUL";
+        case GstLookoutVisionResultStatus::FAILED:
+            return "FAILED";
+        case GstLookoutVisionResultStatus::TIMEOUT:
+            return "TIMEOUT";
+        case GstLookoutVisionResultStatus::SKIPPED_QUALITY:
+            return "SKIPPED_QUALITY";
+        default:
+            return "UNKNOWN";
+    }
+}
+
+static void printUsage(const char* program) {
+    fprintf(stderr, "Usage: %s <location> [--from <unix seconds>] [--to <unix seconds>] [--anomalous-only] "
+                    "[--count]\n", program);
+}
+
+int main(int argc, char *argv[]) {
+    static const struct option options[] = {
+        {"from", required_argument, NULL, 'f'},
+        {"to", required_argument, NULL, 't'},
+        {"anomalous-only", no_argument, NULL, 'a'},
+        {"count", no_argument, NULL, 'c'},
+        {NULL, 0, NULL, 0}
+    };
+
+    uint64_t from_wall_time_ns = 0;
+    uint64_t to_wall_time_ns = UINT64_MAX;
+    bool anomalous_only = false;
+    bool count_only = false;
+
+    int option;
+    while ((option = getopt_long(argc, argv, "f:t:ac", options, NULL)) != -1) {
+        switch (option) {
+            case 'f':
+                from_wall_time_ns = (uint64_t) (strtod(optarg, NULL) * 1e9);
+                break;
+            case 't':
+                to_wall_time_ns = (uint64_t) (strtod(optarg, NULL) * 1e9);
+                break;
+            case 'a':
+                anomalous_only = true;
+                break;
+            case 'c':
+                count_only = true;
+                break;
+            default:
+                printUsage(argv[0]);
+                return 1;
+        }
+    }
+    if (optind != argc - 1) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (!count_only) {
+        printf("wall_time,pts,model_component,result_status,is_anomalous,confidence,inference_latency_ms\n");
+    }
+
+    uint64_t count = 0;
+    InferenceLogReader reader(argv[optind]);
+    reader.Query(from_wall_time_ns, to_wall_time_ns, [&](const InferenceLogRecord& record) {
+        if (anomalous_only && !record.is_anomalous) {
+            return true;
+        }
+        count++;
+        if (!count_only) {
+            printf("%" PRIu64 ".%09" PRIu64 ",%" PRIu64 ",%.*s,%s,%d,%f,%.3f\n",
+                   record.wall_time_ns / (uint64_t) 1000000000, record.wall_time_ns % (uint64_t) 1000000000,
+                   record.pts,
+                   (int) strnlen(record.model_component, sizeof(record.model_component)), record.model_component,
+                   resultStatusName(record.result_status), record.is_anomalous, record.confidence,
+                   record.inference_latency_ns / 1e6);
+        }
+        return true;
+    });
+
+    if (count_only) {
+        printf("%" PRIu64 "\n", count);
+    }
+    return 0;
+}
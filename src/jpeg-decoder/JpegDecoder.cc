@@ -0,0 +1,85 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "JpegDecoder.h"
+
+JpegDecoder::JpegDecoder() {
+    decompress.err = jpeg_std_error(&error_manager.pub);
+    error_manager.pub.error_exit = exitWithError;
+    error_manager.message[0] = '\0';
+    jpeg_create_decompress(&decompress);
+}
+
+JpegDecoder::~JpegDecoder() {
+    jpeg_destroy_decompress(&decompress);
+}
+
+/* libjpeg expects error_exit not to return; jumps back to the call that failed instead of exiting */
+void JpegDecoder::exitWithError(j_common_ptr info) {
+    ErrorManager* error_manager = (ErrorManager*) info->err;
+    (*info->err->format_message)(info, error_manager->message);
+    longjmp(error_manager->jump, 1);
+}
+
+bool JpegDecoder::ReadHeader(const uint8_t* data, size_t size) {
+    if (setjmp(error_manager.jump)) {
+        error = error_manager.message;
+        jpeg_abort_decompress(&decompress);
+        return false;
+    }
+    jpeg_mem_src(&decompress, (unsigned char*) data, size);
+    jpeg_read_header(&decompress, TRUE);
+    decompress.out_color_space = JCS_RGB;
+    jpeg_calc_output_dimensions(&decompress);
+    return true;
+}
+
+size_t JpegDecoder::SourceWidth() const {
+    return decompress.image_width;
+}
+
+size_t JpegDecoder::SourceHeight() const {
+    return decompress.image_height;
+}
+
+void JpegDecoder::ScaleToCover(size_t min_width, size_t min_height) {
+    decompress.scale_num = 1;
+    decompress.scale_denom = 1;
+    for (unsigned int denom = 8; denom >= 1; denom /= 2) {
+        // Scaled dimensions round up
+        if ((decompress.image_width + denom - 1) / denom >= min_width
+                && (decompress.image_height + denom - 1) / denom >= min_height) {
+            decompress.scale_denom = denom;
+            break;
+        }
+    }
+    jpeg_calc_output_dimensions(&decompress);
+}
+
+size_t JpegDecoder::Width() const {
+    return decompress.output_width;
+}
+
+size_t JpegDecoder::Height() const {
+    return decompress.output_height;
+}
+
+bool JpegDecoder::Decode(uint8_t* dst) {
+    if (setjmp(error_manager.jump)) {
+        error = error_manager.message;
+        jpeg_abort_decompress(&decompress);
+        return false;
+    }
+    jpeg_start_decompress(&decompress);
+    size_t row_size = decompress.output_width * 3;
+    while (decompress.output_scanline < decompress.output_height) {
+        JSAMPROW row = dst + decompress.output_scanline * row_size;
+        jpeg_read_scanlines(&decompress, &row, 1);
+    }
+    jpeg_finish_decompress(&decompress);
+    return true;
+}
+
+const std::string& JpegDecoder::Error() const {
+    return error;
+}
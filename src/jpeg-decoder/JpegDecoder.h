@@ -0,0 +1,51 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __JPEG_DECODER_H__
+#define __JPEG_DECODER_H__
+
+#include <csetjmp>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <jpeglib.h>
+
+/*
+ * Decodes one JPEG frame to packed RGB with libjpeg(-turbo).
+ *
+ * ScaleToCover picks the smallest of the scalings the decoder applies in the DCT domain (1/8, 1/4, 1/2 or none) that
+ * still covers the resolution the frame is needed at, so a frame inferred well below its native resolution never has
+ * its full resolution decoded. Decode then writes Width() x Height() pixels straight to its destination.
+ *
+ * Corrupt frames make ReadHeader or Decode return false with Error() set; they never abort the process.
+ */
+class JpegDecoder {
+public:
+    JpegDecoder();
+    ~JpegDecoder();
+    bool ReadHeader(const uint8_t* data, size_t size);
+    size_t SourceWidth() const;
+    size_t SourceHeight() const;
+    void ScaleToCover(size_t min_width, size_t min_height);
+    size_t Width() const;
+    size_t Height() const;
+    // Writes Width() * Height() * 3 bytes, rows without padding
+    bool Decode(uint8_t* dst);
+    const std::string& Error() const;
+
+private:
+    typedef struct _ErrorManager {
+        struct jpeg_error_mgr pub;
+        jmp_buf jump;
+        char message[JMSG_LENGTH_MAX];
+    } ErrorManager;
+
+    struct jpeg_decompress_struct decompress;
+    ErrorManager error_manager;
+    std::string error;
+
+    static void exitWithError(j_common_ptr info);
+};
+
+#endif //__JPEG_DECODER_H__
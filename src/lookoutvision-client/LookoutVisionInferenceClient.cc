@@ -3,6 +3,9 @@
 
 #include <grpcpp/grpcpp.h>
 #include <glib.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <string>
 #include <ctime>
 #include <unistd.h>
@@ -13,8 +16,17 @@
 #include "LookoutVisionInferenceClient.h"
 
 const int LookoutVisionInferenceClient::POLLING_INTERVAL_IN_SECONDS = 5;
+const int LookoutVisionInferenceClient::EJECT_AFTER_FAILURES = 3;
+const int LookoutVisionInferenceClient::ADAPTIVE_TIMEOUT_FLOOR_IN_MS = 10;
+const int LookoutVisionInferenceClient::ADAPTIVE_TIMEOUT_CEILING_IN_MS = 10000;
+const size_t LookoutVisionInferenceClient::ADAPTIVE_TIMEOUT_SAMPLES = 128;
+const size_t LookoutVisionInferenceClient::ADAPTIVE_TIMEOUT_MIN_SAMPLES = 32;
+const int LookoutVisionInferenceClient::CONTROL_TIMEOUT_FLOOR_IN_MS = 1000;
+const int LookoutVisionInferenceClient::BREAKER_OPEN_AFTER_FAILURES = 5;
+const int LookoutVisionInferenceClient::BREAKER_PROBE_INTERVAL_IN_MS = 1000;
 #ifdef SHARED_MEMORY
-const std::string LookoutVisionInferenceClient::SHM_NAME = "/gstreamer-lookoutvision-bitmap";
+const std::string LookoutVisionInferenceClient::SHM_NAME_PREFIX = "/gstreamer-lookoutvision-bitmap";
+std::atomic<guint> LookoutVisionInferenceClient::shm_segments{0};
 #endif
 
 LookoutVisionInferenceClient::LookoutVisionInferenceClient(std::string server_socket) {
@@ -25,111 +37,697 @@ LookoutVisionInferenceClient::LookoutVisionInferenceClient(std::string server_so
 }
 
 LookoutVisionInferenceClient::LookoutVisionInferenceClient(
-        AWS::LookoutVision::EdgeAgent::StubInterface* inference_stub) : stub(inference_stub) {
+        AWS::LookoutVision::EdgeAgent::StubInterface* inference_stub) {
+    std::shared_ptr<Agent> agent(new Agent());
+    agent->stub.reset(inference_stub);
+    agents.push_back(agent);
     #ifdef SHARED_MEMORY
     setupSHM();
     #endif
 }
 
 #ifdef SHARED_MEMORY
+/*
+ * Every client has a segment of its own, so clients in the same process never resize each other's segment.
+ */
 void LookoutVisionInferenceClient::setupSHM() {
-    shm_fd = shm_open(SHM_NAME.c_str(), O_CREAT | O_RDWR, S_IRUSR  | S_IWUSR  | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH);
+    shm_name = SHM_NAME_PREFIX + "-" + std::to_string(getpid()) + "-" + std::to_string(shm_segments++);
+    shm_fd = shm_open(shm_name.c_str(), O_CREAT | O_RDWR, S_IRUSR  | S_IWUSR  | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH);
     if (shm_fd < 0) {
         throw std::runtime_error("shm_open failed");
     }
-    ftruncate(shm_fd, shm_size);
+    shm_slot_busy.resize(1);
+    if (ftruncate(shm_fd, shm_size) != 0) {
+        close(shm_fd);
+        shm_unlink(shm_name.c_str());
+        throw std::runtime_error("ftruncate failed");
+    }
     shm_data = (uint8_t*) mmap(0, shm_size, PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    if (shm_data == MAP_FAILED) {
+        close(shm_fd);
+        shm_unlink(shm_name.c_str());
+        throw std::runtime_error("mmap failed");
+    }
+}
+
+/*
+ * Maps the segment anew with slots slots of slot_size bytes, none of which may be in use. On failure the current
+ * mapping is kept.
+ */
+bool LookoutVisionInferenceClient::resizeSHM(size_t slot_size, size_t slots) {
+    size_t size = slot_size * slots;
+    if (size > shm_size && ftruncate(shm_fd, size) != 0) {
+        log(LogLevel::LEVEL_WARNING, "Failed to grow shared memory segment " + shm_name + " to "
+            + std::to_string(size) + " bytes");
+        return false;
+    }
+    uint8_t* data = (uint8_t*) mmap(0, size, PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    if (data == MAP_FAILED) {
+        log(LogLevel::LEVEL_WARNING, "Failed to map shared memory segment " + shm_name);
+        return false;
+    }
+    munmap(shm_data, shm_size);
+    if (size < shm_size && ftruncate(shm_fd, size) != 0) {
+        // The segment is only larger than it needs to be
+        log(LogLevel::LEVEL_DEBUG, "Failed to shrink shared memory segment " + shm_name);
+    }
+    shm_data = data;
+    shm_size = size;
+    shm_slot_size = slot_size;
+    shm_slot_busy.assign(slots, false);
+    return true;
 }
 #endif
 
 LookoutVisionInferenceClient::~LookoutVisionInferenceClient() {
-    stub.reset();
-    channel.reset();
+    stopBackgroundThreads();
+    pools.clear();
+    agents.clear();
     #ifdef SHARED_MEMORY
     munmap(shm_data, shm_size);
     close(shm_fd);
-    shm_unlink(SHM_NAME.c_str());
+    shm_unlink(shm_name.c_str());
     #endif
 }
 
+std::vector<std::string> LookoutVisionInferenceClient::splitList(const std::string& list) {
+    std::vector<std::string> items;
+    gchar** tokens = g_strsplit(list.c_str(), ",", -1);
+    for (gchar** token = tokens; *token; token++) {
+        g_strstrip(*token);
+        if (**token) {
+            items.push_back(*token);
+        }
+    }
+    g_strfreev(tokens);
+    if (items.empty()) {
+        items.push_back(list);
+    }
+    return items;
+}
+
 void LookoutVisionInferenceClient::setServerSocket(std::string server_socket) {
-    this->server_socket = server_socket;
-    channel = grpc::CreateChannel(this->server_socket, grpc::InsecureChannelCredentials());
-    stub = AWS::LookoutVision::EdgeAgent::NewStub(channel);
+    // Reconnects at least as often as the circuit breaker probes, instead of backing off for up to two minutes
+    grpc::ChannelArguments channel_arguments;
+    channel_arguments.SetInt(GRPC_ARG_MAX_RECONNECT_BACKOFF_MS, BREAKER_PROBE_INTERVAL_IN_MS);
+
+    std::vector<std::shared_ptr<Agent>> new_agents;
+    for (const std::string& socket : splitList(server_socket)) {
+        std::shared_ptr<Agent> agent(new Agent());
+        agent->server_socket = socket;
+        agent->channel = grpc::CreateCustomChannel(socket, grpc::InsecureChannelCredentials(), channel_arguments);
+        agent->stub = AWS::LookoutVision::EdgeAgent::NewStub(agent->channel);
+        new_agents.push_back(agent);
+    }
+
+    // Calls in flight keep their agent alive through their endpoint
+    std::lock_guard<std::mutex> lock(mutex);
+    agents = new_agents;
+    pools.clear();
+}
+
+void LookoutVisionInferenceClient::setHealthCheckInterval(guint health_check_interval_in_seconds) {
+    std::lock_guard<std::mutex> lock(mutex);
+    health_check_interval = std::max(health_check_interval_in_seconds, 1u);
+    health_check_cv.notify_all();
+}
+
+bool LookoutVisionInferenceClient::setMaxInflight(guint max_inflight) {
+    #ifdef SHARED_MEMORY
+    std::unique_lock<std::mutex> lock(shm_mutex);
+    shm_cv.wait(lock, [this] { return shm_slots_busy == 0; });
+    return resizeSHM(shm_slot_size, std::max(max_inflight, 1u));
+    #else
+    return true;
+    #endif
+}
+
+void LookoutVisionInferenceClient::setInferenceTimeout(guint timeout_in_ms, bool adaptive) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::lock_guard<std::mutex> latency_lock(latency_mutex);
+    inference_timeout = timeout_in_ms;
+    adaptive_timeout = adaptive;
+    for (const std::shared_ptr<Pool>& pool : pools) {
+        *pool->latency_window = LatencyWindow();
+    }
+}
+
+void LookoutVisionInferenceClient::setLogHandler(LogHandler handler) {
+    log_handler = handler;
+}
+
+void LookoutVisionInferenceClient::log(LogLevel level, const std::string& message) {
+    if (log_handler) {
+        log_handler(level, message);
+    }
+}
+
+/*
+ * Deadline of the next DetectAnomalies call in nanoseconds, 0 for none. Until enough calls were seen, adaptive mode
+ * uses the inference timeout as is. adaptive is set when the deadline follows the window's latencies.
+ */
+GstClockTime LookoutVisionInferenceClient::inferenceDeadline(const LatencyWindow& window, bool* adaptive) {
+    GstClockTime timeout = inference_timeout * GST_MSECOND;
+    *adaptive = false;
+    if (!adaptive_timeout) {
+        return timeout;
+    }
+    std::lock_guard<std::mutex> lock(latency_mutex);
+    if (window.deadline == 0) {
+        return timeout;
+    }
+    *adaptive = true;
+    return window.deadline;
+}
+
+/*
+ * Keeps the adaptive deadline at twice the p99 of the recent latencies, recomputed every 16 calls, between
+ * ADAPTIVE_TIMEOUT_FLOOR_IN_MS and the inference timeout or ADAPTIVE_TIMEOUT_CEILING_IN_MS. A call that timed out is
+ * recorded at its deadline, which is doubled right away instead of waiting for the p99 to catch up.
+ */
+void LookoutVisionInferenceClient::recordLatency(LatencyWindow& window, GstClockTime latency, bool timed_out) {
+    if (!adaptive_timeout) {
+        return;
+    }
+    guint ceiling_in_ms = inference_timeout;
+    if (ceiling_in_ms == 0) {
+        ceiling_in_ms = ADAPTIVE_TIMEOUT_CEILING_IN_MS;
+    }
+    GstClockTime ceiling = ceiling_in_ms * GST_MSECOND;
+    std::lock_guard<std::mutex> lock(latency_mutex);
+    if (window.latencies.size() < ADAPTIVE_TIMEOUT_SAMPLES) {
+        window.latencies.push_back(latency);
+    } else {
+        window.latencies[window.next] = latency;
+    }
+    window.next = (window.next + 1) % ADAPTIVE_TIMEOUT_SAMPLES;
+    window.added++;
+    if (timed_out && window.deadline > 0) {
+        window.deadline = std::min(2 * window.deadline, ceiling);
+        return;
+    }
+    if (window.latencies.size() < ADAPTIVE_TIMEOUT_MIN_SAMPLES || window.added % 16 != 0) {
+        return;
+    }
+
+    std::vector<GstClockTime> sorted = window.latencies;
+    size_t p99_index = (sorted.size() * 99) / 100;
+    std::nth_element(sorted.begin(), sorted.begin() + p99_index, sorted.end());
+    window.deadline = std::min(std::max(2 * sorted[p99_index],
+                                        (GstClockTime) ADAPTIVE_TIMEOUT_FLOOR_IN_MS * GST_MSECOND), ceiling);
+}
+
+/*
+ * StartModel, StopModel and DescribeModel calls get the inference timeout too, but never less than
+ * CONTROL_TIMEOUT_FLOOR_IN_MS since they don't compete with frames.
+ */
+void LookoutVisionInferenceClient::setControlDeadline(grpc::ClientContext& context) {
+    guint timeout_in_ms = inference_timeout;
+    if (timeout_in_ms > 0) {
+        timeout_in_ms = std::max(timeout_in_ms, (guint) CONTROL_TIMEOUT_FLOOR_IN_MS);
+        context.set_deadline(std::chrono::system_clock::now() + std::chrono::milliseconds(timeout_in_ms));
+    }
+}
+
+/*
+ * Must be called with mutex held.
+ */
+std::shared_ptr<LookoutVisionInferenceClient::Pool> LookoutVisionInferenceClient::findPool(
+        const std::string& model_component) {
+    for (const std::shared_ptr<Pool>& pool : pools) {
+        if (pool->model_component == model_component) {
+            return pool;
+        }
+    }
+    return nullptr;
+}
+
+/*
+ * Must be called with mutex held. Every model component is served by every agent. Replaces the pool of the same
+ * model_component, whose calls in flight keep their endpoints alive.
+ */
+std::shared_ptr<LookoutVisionInferenceClient::Pool> LookoutVisionInferenceClient::createPool(
+        const std::string& model_component) {
+    std::shared_ptr<Pool> pool(new Pool{model_component, {}, 0, std::make_shared<LatencyWindow>()});
+    for (const std::string& component : splitList(model_component)) {
+        for (const std::shared_ptr<Agent>& agent : agents) {
+            pool->endpoints.push_back(std::shared_ptr<Endpoint>(new Endpoint{agent, component, true, 0, 0, 0, 0,
+                                                                             pool->latency_window}));
+        }
+    }
+    std::shared_ptr<Pool> previous = findPool(model_component);
+    if (previous) {
+        *std::find(pools.begin(), pools.end(), previous) = pool;
+    } else {
+        pools.push_back(pool);
+    }
+    if (pool->endpoints.size() > 1) {
+        startHealthChecks();
+    }
+    return pool;
+}
+
+/*
+ * Least outstanding requests among healthy endpoints, scanning from the one after the previous pick so ties are
+ * broken round robin. Falls back to every endpoint when none is healthy. trial is set when the call is the trial of a
+ * half-open breaker, which its release has to be told.
+ */
+std::shared_ptr<LookoutVisionInferenceClient::Endpoint> LookoutVisionInferenceClient::acquireEndpoint(
+        const std::string& model_component, bool* trial) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<Pool> pool = findPool(model_component);
+    if (!pool) {
+        pool = createPool(model_component);
+    }
+
+    std::vector<std::shared_ptr<Endpoint>>& endpoints = pool->endpoints;
+    size_t count = endpoints.size();
+    size_t chosen = count;
+    for (int pass = 0; pass < 2 && chosen == count; pass++) {
+        bool healthy_only = pass == 0;
+        for (size_t i = 0; i < count; i++) {
+            size_t index = (pool->next_endpoint + i) % count;
+            if ((healthy_only && !endpoints[index]->healthy) || !admitsCalls(*endpoints[index]->agent)) {
+                continue;
+            }
+            if (chosen == count || endpoints[index]->outstanding < endpoints[chosen]->outstanding) {
+                chosen = index;
+            }
+        }
+    }
+    if (chosen == count) {
+        return nullptr;
+    }
+    pool->next_endpoint = (chosen + 1) % count;
+    *trial = endpoints[chosen]->agent->breaker == BreakerState::HALF_OPEN;
+    if (*trial) {
+        endpoints[chosen]->agent->trial_in_flight = true;
+    }
+    endpoints[chosen]->outstanding++;
+    endpoints[chosen]->requests++;
+    return endpoints[chosen];
+}
+
+void LookoutVisionInferenceClient::releaseEndpoint(const std::shared_ptr<Endpoint>& endpoint, CallOutcome outcome,
+                                                   bool trial) {
+    std::lock_guard<std::mutex> lock(mutex);
+    endpoint->outstanding--;
+    released_cv.notify_all();
+
+    Agent& agent = *endpoint->agent;
+    if (trial) {
+        agent.trial_in_flight = false;
+    }
+    if (outcome == CallOutcome::CANCELLED) {
+        // A half-open breaker lets the next call through as its trial
+        return;
+    }
+    if ((agent.breaker == BreakerState::HALF_OPEN && !trial) || outcome == CallOutcome::MISSED_ADAPTIVE_DEADLINE) {
+        // Only the trial tells whether the agent is back, not calls sent before the breaker opened; nor does a call
+        // that missed an adaptive deadline, which may just have been too tight
+    } else if (outcome == CallOutcome::UNAVAILABLE || outcome == CallOutcome::TIMED_OUT) {
+        agent.consecutive_unavailable++;
+        if (agent.breaker == BreakerState::HALF_OPEN
+                || (agent.breaker == BreakerState::CLOSED
+                    && agent.consecutive_unavailable >= (guint) BREAKER_OPEN_AFTER_FAILURES)) {
+            setBreakerState(agent, BreakerState::OPEN);
+        }
+    } else {
+        // Any reply, even an error, shows the agent is reachable
+        agent.consecutive_unavailable = 0;
+        if (agent.breaker != BreakerState::CLOSED) {
+            setBreakerState(agent, BreakerState::CLOSED);
+        }
+    }
+
+    if (outcome == CallOutcome::SUCCEEDED) {
+        // A successful call proves the endpoint is back, also while every endpoint is ejected
+        endpoint->consecutive_failures = 0;
+        endpoint->healthy = true;
+        return;
+    }
+    endpoint->failures++;
+    if (++endpoint->consecutive_failures >= (guint) EJECT_AFTER_FAILURES && endpoint->healthy) {
+        endpoint->healthy = false;
+        log(LogLevel::LEVEL_INFO, "Ejected " + endpoint->model_component + " on " + endpoint->agent->server_socket
+            + " after " + std::to_string(endpoint->consecutive_failures) + " failed calls");
+    }
+}
+
+void LookoutVisionInferenceClient::setEndpointHealthy(const std::shared_ptr<Endpoint>& endpoint, bool healthy) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (endpoint->healthy == healthy) {
+        return;
+    }
+    endpoint->healthy = healthy;
+    endpoint->consecutive_failures = 0;
+    log(LogLevel::LEVEL_INFO, (healthy ? "Re-admitted " : "Ejected ") + endpoint->model_component + " on "
+        + endpoint->agent->server_socket + (healthy ? "" : ", model is not RUNNING"));
+}
+
+/*
+ * Must be called with mutex held. A half-open breaker lets a single trial call through.
+ */
+bool LookoutVisionInferenceClient::admitsCalls(const Agent& agent) {
+    return agent.breaker == BreakerState::CLOSED
+            || (agent.breaker == BreakerState::HALF_OPEN && !agent.trial_in_flight);
+}
+
+/*
+ * Must be called with mutex held.
+ */
+void LookoutVisionInferenceClient::setBreakerState(Agent& agent, BreakerState state) {
+    agent.breaker = state;
+    switch (state) {
+        case BreakerState::OPEN:
+            log(LogLevel::LEVEL_WARNING, "Circuit breaker opened for " + agent.server_socket + " after "
+                + std::to_string(agent.consecutive_unavailable) + " unavailable or timed out calls");
+            if (!breaker_thread.joinable()) {
+                breaker_thread = std::thread(&LookoutVisionInferenceClient::runBreakerProbes, this);
+            }
+            breaker_cv.notify_all();
+            break;
+        case BreakerState::HALF_OPEN:
+            log(LogLevel::LEVEL_INFO, "Circuit breaker half-open for " + agent.server_socket);
+            break;
+        case BreakerState::CLOSED:
+            log(LogLevel::LEVEL_INFO, "Circuit breaker closed for " + agent.server_socket);
+            break;
+    }
+}
+
+/*
+ * Half-opens the breakers of agents whose channel connected again. Watching connectivity costs the agent nothing,
+ * unlike trial inferences. Agents without a channel, built around a given stub, half-open after a probe interval.
+ */
+void LookoutVisionInferenceClient::runBreakerProbes() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        std::vector<std::shared_ptr<Agent>> open;
+        for (const std::shared_ptr<Agent>& agent : agents) {
+            if (agent->breaker == BreakerState::OPEN) {
+                open.push_back(agent);
+            }
+        }
+        if (open.empty()) {
+            breaker_cv.wait(lock);
+            continue;
+        }
+        lock.unlock();
+
+        std::vector<std::shared_ptr<Agent>> connected;
+        for (const std::shared_ptr<Agent>& agent : open) {
+            auto deadline = std::chrono::system_clock::now()
+                    + std::chrono::milliseconds(BREAKER_PROBE_INTERVAL_IN_MS / open.size());
+            if (!agent->channel) {
+                std::this_thread::sleep_until(deadline);
+                connected.push_back(agent);
+                continue;
+            }
+            grpc_connectivity_state state = agent->channel->GetState(true);
+            if (state != GRPC_CHANNEL_READY && agent->channel->WaitForStateChange(state, deadline)) {
+                state = agent->channel->GetState(false);
+            }
+            if (state == GRPC_CHANNEL_READY) {
+                connected.push_back(agent);
+            }
+        }
+
+        lock.lock();
+        for (const std::shared_ptr<Agent>& agent : connected) {
+            if (agent->breaker == BreakerState::OPEN) {
+                setBreakerState(*agent, BreakerState::HALF_OPEN);
+            }
+        }
+    }
+}
+
+/*
+ * Must be called with mutex held.
+ */
+void LookoutVisionInferenceClient::startHealthChecks() {
+    if (!health_check_thread.joinable()) {
+        health_check_thread = std::thread(&LookoutVisionInferenceClient::runHealthChecks, this);
+    }
+}
+
+void LookoutVisionInferenceClient::stopBackgroundThreads() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        health_check_cv.notify_all();
+        breaker_cv.notify_all();
+    }
+    if (health_check_thread.joinable()) {
+        health_check_thread.join();
+    }
+    if (breaker_thread.joinable()) {
+        breaker_thread.join();
+    }
+}
+
+void LookoutVisionInferenceClient::runHealthChecks() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        health_check_cv.wait_for(lock, std::chrono::seconds(health_check_interval));
+        if (stopping) {
+            break;
+        }
+        std::vector<std::shared_ptr<Endpoint>> checked;
+        for (const std::shared_ptr<Pool>& pool : pools) {
+            checked.insert(checked.end(), pool->endpoints.begin(), pool->endpoints.end());
+        }
+        lock.unlock();
+        for (const std::shared_ptr<Endpoint>& endpoint : checked) {
+            AWS::LookoutVision::ModelStatus* model_status = getModelStatus(*endpoint);
+            setEndpointHealthy(endpoint, model_status && *model_status == AWS::LookoutVision::ModelStatus::RUNNING);
+            delete model_status;
+        }
+        lock.lock();
+    }
+}
+
+std::vector<EndpointStats> LookoutVisionInferenceClient::GetEndpointStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<EndpointStats> stats;
+    for (const std::shared_ptr<Pool>& pool : pools) {
+        for (const std::shared_ptr<Endpoint>& endpoint : pool->endpoints) {
+            stats.push_back(EndpointStats{endpoint->agent->server_socket, endpoint->model_component,
+                                          endpoint->healthy, endpoint->outstanding, endpoint->requests,
+                                          endpoint->failures});
+        }
+    }
+    return stats;
 }
 
 GstLookoutVisionResult* LookoutVisionInferenceClient::DetectAnomalies(std::string model_component, guint8* buf,
-                                                                      size_t bytes_size, size_t width, size_t height) {
+                                                                      size_t bytes_size, size_t width, size_t height,
+                                                                      bool warm_up) {
+    return DetectAnomalies(model_component, [buf, bytes_size](guint8* frame) {
+        memcpy(frame, buf, bytes_size);
+        return true;
+    }, bytes_size, width, height, warm_up);
+}
+
+/*
+ * warm_up calls, the first ones to a model that just started, are much slower than the model will be and would skew
+ * its adaptive deadline.
+ */
+GstLookoutVisionResult* LookoutVisionInferenceClient::DetectAnomalies(std::string model_component,
+                                                                      const std::function<bool(guint8*)>& write_frame,
+                                                                      size_t bytes_size, size_t width, size_t height,
+                                                                      bool warm_up) {
     AWS::LookoutVision::DetectAnomaliesRequest request;
     AWS::LookoutVision::DetectAnomaliesResponse reply;
     grpc::ClientContext context;
+    guint64 generation;
+    {
+        std::lock_guard<std::mutex> lock(inflight_mutex);
+        generation = cancel_generation;
+    }
+
+    // Admitted before the frame is written, so an open breaker doesn't pay for scaling or decoding it
+    bool trial = false;
+    std::shared_ptr<Endpoint> endpoint = acquireEndpoint(model_component, &trial);
+    if (!endpoint) {
+        // Every agent's circuit breaker is open
+        return new GstLookoutVisionResult{0, 0, GstLookoutVisionResultStatus::FAILED, "Edge Agent unavailable"};
+    }
+
+    // A frame that cannot be written says nothing about the endpoint
+    #ifdef SHARED_MEMORY
+    size_t shm_offset;
+    if (!acquireSHMSlot(bytes_size, &shm_offset)) {
+        releaseEndpoint(endpoint, CallOutcome::CANCELLED, trial);
+        return new GstLookoutVisionResult{0, 0, GstLookoutVisionResultStatus::FAILED,
+                                          "Shared memory segment could not be resized"};
+    }
+    bool written = write_frame(shm_data + shm_offset);
+    #else
+    std::string* byte_data = request.mutable_bitmap()->mutable_byte_data();
+    byte_data->resize(bytes_size);
+    bool written = write_frame((guint8*) &(*byte_data)[0]);
+    #endif
+    if (!written) {
+        #ifdef SHARED_MEMORY
+        releaseSHMSlot(shm_offset);
+        #endif
+        releaseEndpoint(endpoint, CallOutcome::CANCELLED, trial);
+        return new GstLookoutVisionResult{0, 0, GstLookoutVisionResultStatus::FAILED, "Frame could not be written"};
+    }
 
+    GstLookoutVisionResult* result;
+    CallOutcome outcome = CallOutcome::ERRORED;
     try {
-        request.set_model_component(model_component);
+        request.set_model_component(endpoint->model_component);
         auto bitmap = request.mutable_bitmap();
         bitmap->set_width(width);
         bitmap->set_height(height);
 
         #ifdef SHARED_MEMORY
-        writeSHM(buf, bytes_size);
         auto shared_memory_handle = bitmap->mutable_shared_memory_handle();
         shared_memory_handle->set_size(bytes_size);
-        shared_memory_handle->set_offset(0);
-        shared_memory_handle->set_name(SHM_NAME);
-        #else
-        bitmap->set_byte_data(buf, bytes_size);
+        shared_memory_handle->set_offset(shm_offset);
+        shared_memory_handle->set_name(shm_name);
         #endif
 
-        grpc::Status status = stub->DetectAnomalies(&context, request, &reply);
+        bool adaptive_deadline;
+        GstClockTime deadline = inferenceDeadline(*endpoint->latency_window, &adaptive_deadline);
+        if (deadline > 0) {
+            context.set_deadline(std::chrono::system_clock::now() + std::chrono::nanoseconds(deadline));
+        }
+        {
+            std::lock_guard<std::mutex> lock(inflight_mutex);
+            inflight_contexts.insert(&context);
+            if (cancel_generation != generation) {
+                // Cancelled before its context could be seen, the call returns CANCELLED at once
+                context.TryCancel();
+            }
+        }
+        gint64 start_time = g_get_monotonic_time();
+        grpc::Status status = endpoint->agent->stub->DetectAnomalies(&context, request, &reply);
+        GstClockTime inference_latency = (g_get_monotonic_time() - start_time) * GST_USECOND;
 
         if (status.ok()) {
-            return new GstLookoutVisionResult{reply.detect_anomaly_result().is_anomalous(),
-                                              reply.detect_anomaly_result().confidence(),
-                                              GstLookoutVisionResultStatus::SUCCESSFUL, ""};
+            outcome = CallOutcome::SUCCEEDED;
+            if (!warm_up) {
+                recordLatency(*endpoint->latency_window, inference_latency, false);
+            }
+            result = new GstLookoutVisionResult{reply.detect_anomaly_result().is_anomalous(),
+                                                reply.detect_anomaly_result().confidence(),
+                                                GstLookoutVisionResultStatus::SUCCESSFUL, "",
+                                                endpoint->model_component, inference_latency};
+        }
+        else if (status.error_code() == grpc::StatusCode::DEADLINE_EXCEEDED) {
+            // Counts against the endpoint, a wedged model misses every deadline
+            outcome = adaptive_deadline ? CallOutcome::MISSED_ADAPTIVE_DEADLINE : CallOutcome::TIMED_OUT;
+            if (!warm_up) {
+                recordLatency(*endpoint->latency_window, deadline, true);
+            }
+            log(LogLevel::LEVEL_DEBUG, "DetectAnomalies timed out after " + std::to_string(deadline / GST_MSECOND)
+                + " ms");
+            result = new GstLookoutVisionResult{0, 0, GstLookoutVisionResultStatus::TIMEOUT,
+                                                "Timed out after " + std::to_string(deadline / GST_MSECOND) + " ms",
+                                                endpoint->model_component, inference_latency};
         }
         else {
-            std::cout << "DetectAnomalies failed with error "
-            << status.error_code() << ": " << status.error_message() << std::endl;
-            return new GstLookoutVisionResult{0, 0, GstLookoutVisionResultStatus::FAILED,
-                                              status.error_code() + ": " + status.error_message()};
+            // A bad frame or an agent that cannot keep up says nothing about the endpoint's health
+            if (status.error_code() == grpc::StatusCode::INVALID_ARGUMENT
+                    || status.error_code() == grpc::StatusCode::RESOURCE_EXHAUSTED) {
+                outcome = CallOutcome::SUCCEEDED;
+            } else if (status.error_code() == grpc::StatusCode::CANCELLED) {
+                outcome = CallOutcome::CANCELLED;
+            } else if (status.error_code() == grpc::StatusCode::UNAVAILABLE) {
+                outcome = CallOutcome::UNAVAILABLE;
+            }
+            log(LogLevel::LEVEL_DEBUG, "DetectAnomalies failed with error " + std::to_string(status.error_code())
+                + ": " + status.error_message());
+            result = new GstLookoutVisionResult{0, 0, GstLookoutVisionResultStatus::FAILED,
+                                                std::to_string(status.error_code()) + ": " + status.error_message()};
         }
     } catch (std::exception& e) {
-        std::cout << "Exception: " << e.what() << std::endl;
-        return new GstLookoutVisionResult{0, 0, GstLookoutVisionResultStatus::FAILED, e.what()};
+        log(LogLevel::LEVEL_DEBUG, std::string("DetectAnomalies threw an exception: ") + e.what());
+        result = new GstLookoutVisionResult{0, 0, GstLookoutVisionResultStatus::FAILED, e.what()};
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(inflight_mutex);
+        inflight_contexts.erase(&context);
+    }
+    #ifdef SHARED_MEMORY
+    releaseSHMSlot(shm_offset);
+    #endif
+    releaseEndpoint(endpoint, outcome, trial);
+    return result;
+}
+
+void LookoutVisionInferenceClient::CancelInflight() {
+    std::lock_guard<std::mutex> lock(inflight_mutex);
+    cancel_generation++;
+    for (grpc::ClientContext* context : inflight_contexts) {
+        context->TryCancel();
     }
 }
 
 #ifdef SHARED_MEMORY
-void LookoutVisionInferenceClient::writeSHM(guint8* buf, size_t bytes_size) {
-    if (bytes_size > shm_size) {
-        shm_size = bytes_size;
-        ftruncate(shm_fd, shm_size);
-        shm_data = (uint8_t*) mmap(0, shm_size, PROT_WRITE, MAP_SHARED, shm_fd, 0);
+/*
+ * Each request in flight writes its frame to a slot of its own. Slots are only resized while none is in use.
+ */
+bool LookoutVisionInferenceClient::acquireSHMSlot(size_t bytes_size, size_t* offset) {
+    std::unique_lock<std::mutex> lock(shm_mutex);
+    if (bytes_size > shm_slot_size) {
+        shm_cv.wait(lock, [this] { return shm_slots_busy == 0; });
+        if (bytes_size > shm_slot_size && !resizeSHM(bytes_size, shm_slot_busy.size())) {
+            return false;
+        }
+    }
+    shm_cv.wait(lock, [this] { return shm_slots_busy < shm_slot_busy.size(); });
+    size_t slot = 0;
+    while (shm_slot_busy[slot]) {
+        slot++;
     }
-    memcpy(shm_data, buf, bytes_size);
+    shm_slot_busy[slot] = true;
+    shm_slots_busy++;
+    *offset = slot * shm_slot_size;
+    return true;
+}
+
+void LookoutVisionInferenceClient::releaseSHMSlot(size_t offset) {
+    std::lock_guard<std::mutex> lock(shm_mutex);
+    shm_slot_busy[offset / shm_slot_size] = false;
+    shm_slots_busy--;
+    shm_cv.notify_all();
 }
 #endif
 
 LookoutVisionInferenceClient::OperationStatus LookoutVisionInferenceClient::StartModel(std::string model_component,
                                                                                        int model_status_timeout) {
-    AWS::LookoutVision::StartModelRequest request;
-    AWS::LookoutVision::StartModelResponse reply;
-    grpc::ClientContext context;
+    std::vector<std::shared_ptr<Endpoint>> started;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        started = createPool(model_component)->endpoints;
+    }
 
-    try {
-        request.set_model_component(model_component);
-        grpc::Status status = stub->StartModel(&context, request, &reply);
+    for (const std::shared_ptr<Endpoint>& endpoint : started) {
+        AWS::LookoutVision::StartModelRequest request;
+        AWS::LookoutVision::StartModelResponse reply;
+        grpc::ClientContext context;
+        setControlDeadline(context);
 
-        if (!status.ok()) {
-            std::cout << "StartModel returned error "
-            << status.error_code() << ": " << status.error_message() << std::endl;
+        try {
+            request.set_model_component(endpoint->model_component);
+            grpc::Status status = endpoint->agent->stub->StartModel(&context, request, &reply);
+
+            if (!status.ok()) {
+                std::cout << "StartModel returned error "
+                << status.error_code() << ": " << status.error_message() << std::endl;
+            }
+        } catch (std::exception& e) {
+            std::cout << "Exception: " << e.what() << std::endl;
         }
-    } catch (std::exception& e) {
-        std::cout << "Exception: " << e.what() << std::endl;
     }
 
-    if (waitForModelStatusWithTimeout(model_component, AWS::LookoutVision::ModelStatus::RUNNING,
-                                      model_status_timeout)) {
+    if (waitForModelStatusWithTimeout(started, AWS::LookoutVision::ModelStatus::RUNNING, model_status_timeout)) {
         return OperationStatus::SUCCESSFUL;
     } else {
         std::cout << "Model didn't reach RUNNING state within " << model_status_timeout << " seconds" << std::endl;
@@ -138,32 +736,97 @@ LookoutVisionInferenceClient::OperationStatus LookoutVisionInferenceClient::Star
     return OperationStatus::FAILED;
 }
 
-bool LookoutVisionInferenceClient::waitForModelStatusWithTimeout(std::string model_component,
-                                                                 AWS::LookoutVision::ModelStatus expected_status,
-                                                                 int timeout_in_seconds) {
+/*
+ * Drops the pool of model_component once its calls in flight finished, and with stop_model set, stops the model on
+ * every endpoint. Calls made afterwards create a fresh pool.
+ */
+LookoutVisionInferenceClient::OperationStatus LookoutVisionInferenceClient::ReleaseModel(std::string model_component,
+                                                                                         bool stop_model) {
+    std::vector<std::shared_ptr<Endpoint>> released;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        std::shared_ptr<Pool> pool = findPool(model_component);
+        if (!pool) {
+            return OperationStatus::SUCCESSFUL;
+        }
+        pools.erase(std::find(pools.begin(), pools.end(), pool));
+        released = pool->endpoints;
+        released_cv.wait(lock, [&released] {
+            for (const std::shared_ptr<Endpoint>& endpoint : released) {
+                if (endpoint->outstanding > 0) {
+                    return false;
+                }
+            }
+            return true;
+        });
+    }
+    if (!stop_model) {
+        return OperationStatus::SUCCESSFUL;
+    }
+
+    OperationStatus result = OperationStatus::SUCCESSFUL;
+    for (const std::shared_ptr<Endpoint>& endpoint : released) {
+        AWS::LookoutVision::StopModelRequest request;
+        AWS::LookoutVision::StopModelResponse reply;
+        grpc::ClientContext context;
+        setControlDeadline(context);
+
+        try {
+            request.set_model_component(endpoint->model_component);
+            grpc::Status status = endpoint->agent->stub->StopModel(&context, request, &reply);
+
+            if (!status.ok()) {
+                std::cout << "StopModel returned error "
+                << status.error_code() << ": " << status.error_message() << std::endl;
+                result = OperationStatus::FAILED;
+            }
+        } catch (std::exception& e) {
+            std::cout << "Exception: " << e.what() << std::endl;
+            result = OperationStatus::FAILED;
+        }
+    }
+    return result;
+}
+
+/*
+ * Returns once any endpoint reached the expected status. The others are ejected; health checks re-admit them once
+ * they get there too.
+ */
+bool LookoutVisionInferenceClient::waitForModelStatusWithTimeout(
+        const std::vector<std::shared_ptr<Endpoint>>& started, AWS::LookoutVision::ModelStatus expected_status,
+        int timeout_in_seconds) {
     std::time_t start_time = std::time(NULL);
 
     while (std::time(NULL) - start_time < timeout_in_seconds) {
-        AWS::LookoutVision::ModelStatus* model_status = getModelStatus(model_component);
-        if (model_status && *model_status == expected_status) {
+        std::vector<bool> reached(started.size());
+        bool any_reached = false;
+        for (size_t i = 0; i < started.size(); i++) {
+            AWS::LookoutVision::ModelStatus* model_status = getModelStatus(*started[i]);
+            reached[i] = model_status && *model_status == expected_status;
+            any_reached = any_reached || reached[i];
             delete model_status;
+        }
+        if (any_reached) {
+            for (size_t i = 0; i < started.size(); i++) {
+                setEndpointHealthy(started[i], reached[i]);
+            }
             return true;
         }
-        delete model_status;
         usleep(POLLING_INTERVAL_IN_SECONDS * 1000000);
     }
     return false;
 }
 
-AWS::LookoutVision::ModelStatus* LookoutVisionInferenceClient::getModelStatus(std::string model_component) {
+AWS::LookoutVision::ModelStatus* LookoutVisionInferenceClient::getModelStatus(const Endpoint& endpoint) {
     AWS::LookoutVision::DescribeModelRequest request;
     AWS::LookoutVision::DescribeModelResponse reply;
     grpc::ClientContext context;
+    setControlDeadline(context);
     AWS::LookoutVision::ModelStatus* model_status = NULL;
 
     try {
-        request.set_model_component(model_component);
-        grpc::Status status = stub->DescribeModel(&context, request, &reply);
+        request.set_model_component(endpoint.model_component);
+        grpc::Status status = endpoint.agent->stub->DescribeModel(&context, request, &reply);
 
         if (status.ok()) {
             model_status = new AWS::LookoutVision::ModelStatus{reply.model_description().status()};
@@ -5,9 +5,67 @@
 #define __LOOKOUTVISION_INFERENCE_CLIENT_H__
 
 #include <glib.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
 #include "Inference.grpc.pb.h"
 #include "gst/lookoutvisionmeta/gstlookoutvisionresult.h"
 
+typedef struct _EndpointStats {
+    std::string server_socket;
+    std::string model_component;
+    bool healthy;
+    guint outstanding;
+    guint64 requests;
+    guint64 failures;
+} EndpointStats;
+
+/**
+ * Client of one or more Lookout for Vision Edge Agents. server_socket and model_component may each be a comma
+ * separated list; every model component on every agent is an endpoint, so the same model deployed as several
+ * components or served by several agents forms a pool.
+ *
+ * DetectAnomalies may be called from several threads at once. Each call goes to the healthy endpoint with the fewest
+ * outstanding requests, ties broken round robin. An endpoint is ejected after EJECT_AFTER_FAILURES consecutive failed
+ * calls or when DescribeModel reports it is not RUNNING; with more than one endpoint, a background thread describes
+ * every endpoint each health check interval and re-admits the ones that are RUNNING again. While every endpoint is
+ * ejected, calls are spread over all of them rather than failed outright.
+ *
+ * Endpoints are pooled per model_component value, so a new model can be started with StartModel while calls keep
+ * going to the previous one, which ReleaseModel drops, and optionally stops, once its calls in flight finished.
+ *
+ * With an inference timeout set, every call gets a deadline and a DetectAnomalies call that misses it returns a TIMEOUT
+ * result. In adaptive mode the DetectAnomalies deadline follows the latency of recent calls to the same model_component
+ * instead: twice their p99, at least ADAPTIVE_TIMEOUT_FLOOR_IN_MS and at most the inference timeout, or
+ * ADAPTIVE_TIMEOUT_CEILING_IN_MS without one. A call that times out counts at its deadline and doubles it at once, so a
+ * deadline that became too tight recovers. Warm-up calls are left out.
+ *
+ * Each agent has a circuit breaker. It opens after BREAKER_OPEN_AFTER_FAILURES consecutive calls failed as UNAVAILABLE
+ * or missed the inference timeout; a call that missed an adaptive deadline only counts against the endpoint, since that
+ * deadline may just have been too tight. While open, calls that would go to the agent fail at once without touching
+ * the network. A background thread watches the channel's connectivity and half-opens the breaker once it is READY; the
+ * next call is a trial that closes the breaker on any reply from the agent and reopens it otherwise. Calls sent before
+ * the breaker opened that return meanwhile don't decide.
+ *
+ * CancelInflight cancels every DetectAnomalies call in flight, including those started but not sent yet; they return at
+ * once with a FAILED result and their shared memory slots are free again. A cancelled call counts neither for nor
+ * against its endpoint and agent.
+ *
+ * Ejections, re-admissions, breaker transitions, timeouts and failed calls are reported to the log handler, if one is
+ * set; they can come once per call, so callers pick where and at which level they go.
+ *
+ * DetectAnomalies also takes a function writing the frame itself, given where its bytes_size bytes go: straight into
+ * the shared memory slot, or into the request otherwise. Callers that convert frames save copying them once more. It
+ * only runs once an agent admitted the call. When the function returns false, nothing is sent and the result is FAILED.
+ *
+ * With shared memory, each client maps a segment of its own, named after the process and a per-process counter, and
+ * sends that name with every request.
+ */
 class LookoutVisionInferenceClient{
 public:
     typedef enum _OperationStatus {
@@ -15,33 +73,171 @@ public:
         FAILED = -1
     } OperationStatus;
 
+    typedef enum _LogLevel {
+        // Once per call
+        LEVEL_DEBUG,
+        // Once per change of an endpoint or agent
+        LEVEL_INFO,
+        LEVEL_WARNING
+    } LogLevel;
+
+    typedef std::function<void(LogLevel level, const std::string& message)> LogHandler;
+
+    static const int EJECT_AFTER_FAILURES;
+    static const int ADAPTIVE_TIMEOUT_FLOOR_IN_MS;
+    static const int ADAPTIVE_TIMEOUT_CEILING_IN_MS;
+    static const int BREAKER_OPEN_AFTER_FAILURES;
+
     LookoutVisionInferenceClient(std::string server_socket);
     LookoutVisionInferenceClient(AWS::LookoutVision::EdgeAgent::StubInterface* inference_stub);
     ~LookoutVisionInferenceClient();
     void setServerSocket(std::string server_socket);
+    void setHealthCheckInterval(guint health_check_interval_in_seconds);
+    // Returns false if the shared memory segment could not be resized
+    bool setMaxInflight(guint max_inflight);
+    void setInferenceTimeout(guint timeout_in_ms, bool adaptive);
+    // Must be set before the first call, it may be called from any thread, also with internal locks held
+    void setLogHandler(LogHandler handler);
     GstLookoutVisionResult* DetectAnomalies(std::string model_component, guint8* frame, size_t bytes_size, size_t width,
-                                            size_t height);
+                                            size_t height, bool warm_up = false);
+    GstLookoutVisionResult* DetectAnomalies(std::string model_component,
+                                            const std::function<bool(guint8*)>& write_frame, size_t bytes_size,
+                                            size_t width, size_t height, bool warm_up = false);
     OperationStatus StartModel(std::string model_component, int model_status_timeout);
+    OperationStatus ReleaseModel(std::string model_component, bool stop_model);
+    void CancelInflight();
+    std::vector<EndpointStats> GetEndpointStats();
 
 private:
+    typedef enum _BreakerState {
+        CLOSED,
+        OPEN,
+        HALF_OPEN
+    } BreakerState;
+
+    typedef enum _CallOutcome {
+        // The agent replied and the endpoint served the call, or rejected the request itself
+        SUCCEEDED,
+        // The agent replied with an error of the endpoint
+        ERRORED,
+        // The agent could not be reached
+        UNAVAILABLE,
+        // The endpoint missed the inference timeout, the agent is as good as unavailable
+        TIMED_OUT,
+        // The endpoint missed a deadline that followed its own recent latencies
+        MISSED_ADAPTIVE_DEADLINE,
+        // Cancelled by the caller or never sent, says nothing about the agent or the endpoint
+        CANCELLED
+    } CallOutcome;
+
+    typedef struct _Agent {
+        std::string server_socket;
+        std::shared_ptr<grpc::Channel> channel;
+        std::unique_ptr<AWS::LookoutVision::EdgeAgent::StubInterface> stub;
+        BreakerState breaker = BreakerState::CLOSED;
+        guint consecutive_unavailable = 0;
+        bool trial_in_flight = false;
+    } Agent;
+
+    typedef struct _LatencyWindow {
+        // Latencies of the last calls, a ring of ADAPTIVE_TIMEOUT_SAMPLES
+        std::vector<GstClockTime> latencies;
+        size_t next = 0;
+        size_t added = 0;
+        // 0 until ADAPTIVE_TIMEOUT_MIN_SAMPLES calls were seen
+        GstClockTime deadline = 0;
+    } LatencyWindow;
+
+    typedef struct _Endpoint {
+        std::shared_ptr<Agent> agent;
+        std::string model_component;
+        bool healthy;
+        guint outstanding;
+        guint consecutive_failures;
+        guint64 requests;
+        guint64 failures;
+        // Shared by the endpoints of a pool, guarded by latency_mutex
+        std::shared_ptr<LatencyWindow> latency_window;
+    } Endpoint;
+
+    typedef struct _Pool {
+        // As given to StartModel or DetectAnomalies
+        std::string model_component;
+        std::vector<std::shared_ptr<Endpoint>> endpoints;
+        size_t next_endpoint;
+        std::shared_ptr<LatencyWindow> latency_window;
+    } Pool;
+
     static const int POLLING_INTERVAL_IN_SECONDS;
+    static const size_t ADAPTIVE_TIMEOUT_SAMPLES;
+    static const size_t ADAPTIVE_TIMEOUT_MIN_SAMPLES;
+    static const int CONTROL_TIMEOUT_FLOOR_IN_MS;
+    static const int BREAKER_PROBE_INTERVAL_IN_MS;
     #ifdef SHARED_MEMORY
-    static const std::string SHM_NAME;
-    size_t shm_size = 1920*1920*3;
+    static const std::string SHM_NAME_PREFIX;
+    // Numbers the segments of the clients created in this process
+    static std::atomic<guint> shm_segments;
+    std::string shm_name;
+    // The segment holds one slot per request in flight, each slot_size bytes
+    size_t shm_slot_size = 1920*1920*3;
+    size_t shm_size = shm_slot_size;
     int shm_fd;
     uint8_t* shm_data;
+    std::vector<bool> shm_slot_busy;
+    guint shm_slots_busy = 0;
+    std::mutex shm_mutex;
+    std::condition_variable shm_cv;
     #endif
-    std::string server_socket;
-    std::shared_ptr<grpc::Channel> channel;
-    std::unique_ptr<AWS::LookoutVision::EdgeAgent::StubInterface> stub;
+
+    std::mutex mutex;
+    std::vector<std::shared_ptr<Agent>> agents;
+    std::vector<std::shared_ptr<Pool>> pools;
+    std::condition_variable released_cv;
+
+    guint health_check_interval = POLLING_INTERVAL_IN_SECONDS;
+    std::thread health_check_thread;
+    std::condition_variable health_check_cv;
+    std::thread breaker_thread;
+    std::condition_variable breaker_cv;
+    bool stopping = false;
+
+    LogHandler log_handler;
+
+    std::mutex inflight_mutex;
+    std::set<grpc::ClientContext*> inflight_contexts;
+    // Counts CancelInflight calls, so a call whose context was registered after one of them still gets cancelled
+    guint64 cancel_generation = 0;
+
+    // 0 means no deadline
+    std::atomic<guint> inference_timeout{0};
+    std::atomic<bool> adaptive_timeout{false};
+    std::mutex latency_mutex;
 
     #ifdef SHARED_MEMORY
-    void writeSHM(guint8* buf, size_t bytes_size);
+    bool acquireSHMSlot(size_t bytes_size, size_t* offset);
+    void releaseSHMSlot(size_t offset);
     void setupSHM();
+    bool resizeSHM(size_t slot_size, size_t slots);
     #endif
-    bool waitForModelStatusWithTimeout(std::string model_component,
+    std::shared_ptr<Pool> findPool(const std::string& model_component);
+    std::shared_ptr<Pool> createPool(const std::string& model_component);
+    std::shared_ptr<Endpoint> acquireEndpoint(const std::string& model_component, bool* trial);
+    void releaseEndpoint(const std::shared_ptr<Endpoint>& endpoint, CallOutcome outcome, bool trial);
+    void setEndpointHealthy(const std::shared_ptr<Endpoint>& endpoint, bool healthy);
+    GstClockTime inferenceDeadline(const LatencyWindow& window, bool* adaptive);
+    void recordLatency(LatencyWindow& window, GstClockTime latency, bool timed_out);
+    void setControlDeadline(grpc::ClientContext& context);
+    void log(LogLevel level, const std::string& message);
+    bool admitsCalls(const Agent& agent);
+    void setBreakerState(Agent& agent, BreakerState state);
+    void runBreakerProbes();
+    void startHealthChecks();
+    void stopBackgroundThreads();
+    void runHealthChecks();
+    bool waitForModelStatusWithTimeout(const std::vector<std::shared_ptr<Endpoint>>& started,
                                        AWS::LookoutVision::ModelStatus expected_status, int timeout_in_seconds);
-    AWS::LookoutVision::ModelStatus* getModelStatus(std::string model_component);
+    AWS::LookoutVision::ModelStatus* getModelStatus(const Endpoint& endpoint);
+    static std::vector<std::string> splitList(const std::string& list);
 };
 
 #endif
@@ -0,0 +1,110 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <gst/gst.h>
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <vector>
+#include "frame-quality/FrameQuality.h"
+
+static std::vector<uint8_t> checkerboard(size_t width, size_t height, size_t square) {
+    std::vector<uint8_t> frame(width * height * 3);
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < width; x++) {
+            uint8_t value = ((x / square + y / square) % 2) ? 200 : 40;
+            frame[(y * width + x) * 3] = value;
+            frame[(y * width + x) * 3 + 1] = value;
+            frame[(y * width + x) * 3 + 2] = value;
+        }
+    }
+    return frame;
+}
+
+/* Averages every pixel with its neighbours within radius, like a defocused lens */
+static std::vector<uint8_t> blur(const std::vector<uint8_t>& frame, size_t width, size_t height, int radius) {
+    std::vector<uint8_t> blurred(frame.size());
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < width; x++) {
+            for (size_t c = 0; c < 3; c++) {
+                int sum = 0, count = 0;
+                for (int dy = -radius; dy <= radius; dy++) {
+                    for (int dx = -radius; dx <= radius; dx++) {
+                        int sx = (int) x + dx, sy = (int) y + dy;
+                        if (sx >= 0 && sy >= 0 && sx < (int) width && sy < (int) height) {
+                            sum += frame[(sy * width + sx) * 3 + c];
+                            count++;
+                        }
+                    }
+                }
+                blurred[(y * width + x) * 3 + c] = sum / count;
+            }
+        }
+    }
+    return blurred;
+}
+
+TEST(FrameQualityTest, flat_frame_test) {
+    size_t width = 64, height = 48;
+    std::vector<uint8_t> frame(width * height * 3, 100);
+    FrameQuality::Statistics statistics = FrameQuality(width, height, width * 3).Measure(frame.data());
+    ASSERT_DOUBLE_EQ(statistics.sharpness, 0);
+    ASSERT_DOUBLE_EQ(statistics.brightness, 100);
+    ASSERT_DOUBLE_EQ(statistics.clipped, 0);
+}
+
+TEST(FrameQualityTest, blur_lowers_sharpness_test) {
+    size_t width = 160, height = 120;
+    std::vector<uint8_t> sharp = checkerboard(width, height, 5);
+    std::vector<uint8_t> blurred = blur(sharp, width, height, 3);
+    FrameQuality quality(width, height, width * 3);
+    double sharp_score = quality.Measure(sharp.data()).sharpness;
+    double blurred_score = quality.Measure(blurred.data()).sharpness;
+    ASSERT_GT(sharp_score, 0);
+    ASSERT_LT(blurred_score * 10, sharp_score);
+}
+
+TEST(FrameQualityTest, clipped_fraction_test) {
+    // Left half black, right half white
+    size_t width = 64, height = 48;
+    std::vector<uint8_t> frame(width * height * 3);
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < width * 3; x++) {
+            frame[y * width * 3 + x] = x < width * 3 / 2 ? 0 : 255;
+        }
+    }
+    FrameQuality::Statistics statistics = FrameQuality(width, height, width * 3).Measure(frame.data());
+    ASSERT_DOUBLE_EQ(statistics.clipped, 1);
+    ASSERT_NEAR(statistics.brightness, 127.5, 1);
+}
+
+TEST(FrameQualityTest, row_padding_is_skipped_test) {
+    // Rows padded with white must not count as clipped or bright pixels
+    size_t width = 30, height = 20, stride = 32 * 3;
+    std::vector<uint8_t> frame(stride * height, 255);
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < width * 3; x++) {
+            frame[y * stride + x] = 60;
+        }
+    }
+    FrameQuality::Statistics statistics = FrameQuality(width, height, stride).Measure(frame.data());
+    ASSERT_DOUBLE_EQ(statistics.sharpness, 0);
+    ASSERT_DOUBLE_EQ(statistics.brightness, 60);
+    ASSERT_DOUBLE_EQ(statistics.clipped, 0);
+}
+
+TEST(FrameQualityTest, frame_without_grid_points_test) {
+    std::vector<uint8_t> frame(2 * 2 * 3, 255);
+    FrameQuality::Statistics statistics = FrameQuality(2, 2, 2 * 3).Measure(frame.data());
+    ASSERT_DOUBLE_EQ(statistics.sharpness, 0);
+    ASSERT_DOUBLE_EQ(statistics.brightness, 0);
+    ASSERT_DOUBLE_EQ(statistics.clipped, 0);
+}
+
+int main(int argc, char *argv[]) {
+    gst_init(&argc, &argv);
+
+    testing::InitGoogleTest();
+    RUN_ALL_TESTS();
+
+    return 0;
+}
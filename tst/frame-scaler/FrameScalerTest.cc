@@ -0,0 +1,83 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <gst/gst.h>
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <vector>
+#include "frame-scaler/FrameScaler.h"
+
+TEST(FrameScalerTest, same_size_copies_test) {
+    std::vector<uint8_t> src(4 * 3 * 3);
+    for (size_t i = 0; i < src.size(); i++) {
+        src[i] = i * 7;
+    }
+    FrameScaler scaler(4, 3, 4 * 3, 4, 3);
+    std::vector<uint8_t> dst(scaler.DestinationSize());
+    scaler.Scale(src.data(), dst.data());
+    ASSERT_EQ(dst, src);
+}
+
+TEST(FrameScalerTest, halving_averages_blocks_test) {
+    // 4x2 frame, each 2x2 block averages to 10, 20, 30 and 100, 150, 200
+    std::vector<uint8_t> src = {
+        0, 10, 20,    20, 30, 40,    90, 140, 190,  110, 160, 210,
+        10, 20, 30,   10, 20, 30,    100, 150, 200, 100, 150, 200,
+    };
+    FrameScaler scaler(4, 2, 4 * 3, 2, 1);
+    std::vector<uint8_t> dst(scaler.DestinationSize());
+    scaler.Scale(src.data(), dst.data());
+    std::vector<uint8_t> expected = {10, 20, 30, 100, 150, 200};
+    ASSERT_EQ(dst, expected);
+}
+
+TEST(FrameScalerTest, flat_frame_stays_flat_test) {
+    // Uneven ratios must not let rounding drift the colour
+    size_t width = 383, height = 217;
+    std::vector<uint8_t> src(width * height * 3);
+    for (size_t i = 0; i < src.size(); i += 3) {
+        src[i] = 255;
+        src[i + 1] = 128;
+        src[i + 2] = 1;
+    }
+    FrameScaler scaler(width, height, width * 3, 100, 71);
+    std::vector<uint8_t> dst(scaler.DestinationSize());
+    scaler.Scale(src.data(), dst.data());
+    for (size_t i = 0; i < dst.size(); i += 3) {
+        ASSERT_EQ(dst[i], 255);
+        ASSERT_EQ(dst[i + 1], 128);
+        ASSERT_EQ(dst[i + 2], 1);
+    }
+}
+
+TEST(FrameScalerTest, row_padding_is_skipped_test) {
+    // 2x2 frame with rows padded to 8 bytes, the padding must never reach the output
+    std::vector<uint8_t> src = {
+        40, 40, 40,  40, 40, 40,  255, 255,
+        40, 40, 40,  40, 40, 40,  255, 255,
+    };
+    FrameScaler scaler(2, 2, 8, 1, 1);
+    std::vector<uint8_t> dst(scaler.DestinationSize());
+    scaler.Scale(src.data(), dst.data());
+    std::vector<uint8_t> expected = {40, 40, 40};
+    ASSERT_EQ(dst, expected);
+}
+
+TEST(FrameScalerTest, upscaling_interpolates_test) {
+    std::vector<uint8_t> src = {0, 0, 0, 200, 200, 200};
+    FrameScaler scaler(2, 1, 2 * 3, 4, 1);
+    std::vector<uint8_t> dst(scaler.DestinationSize());
+    scaler.Scale(src.data(), dst.data());
+    // Destination centers fall at -0.25, 0.25, 0.75 and 1.25 source pixels
+    std::vector<uint8_t> expected = {0, 0, 0, 50, 50, 50, 150, 150, 150, 200, 200, 200};
+    ASSERT_EQ(dst, expected);
+}
+
+int main(int argc, char *argv[]) {
+    gst_init(&argc, &argv);
+
+    testing::InitGoogleTest();
+    RUN_ALL_TESTS();
+
+    return 0;
+}
@@ -5,7 +5,10 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 #include <gst/check/gstharness.h>
+#include <gst/video/video.h>
+#include <vector>
 #include "utils/test-server/TestServer.h"
+#include "gst/lookoutvisionmeta/gstlookoutvisionmeta.h"
 
 using ::testing::HasSubstr;
 
@@ -35,6 +38,61 @@ TEST_F(gstlookoutvisiontest, plugin_init_test) {
     gst_object_unref(lookoutvision);
 }
 
+TEST_F(gstlookoutvisiontest, model_started_on_state_change_test) {
+    grpc_server = new TestServer();
+    grpc_server->RunServerInBackground("0.0.0.0:50051", "RUNNING");
+
+    GstElement* lookoutvision = gst_element_factory_make("lookoutvision", "infer");
+    ASSERT_NE(lookoutvision, nullptr);
+    g_object_set(lookoutvision, "server-socket", "0.0.0.0:50051", "model-component", "SampleModel", NULL);
+    ASSERT_EQ(grpc_server->GetStartModelCount(), 0);
+
+    ASSERT_EQ(gst_element_set_state(lookoutvision, GST_STATE_READY), GST_STATE_CHANGE_SUCCESS);
+    ASSERT_EQ(grpc_server->GetStartModelCount(), 0);
+    ASSERT_NE(gst_element_set_state(lookoutvision, GST_STATE_PAUSED), GST_STATE_CHANGE_FAILURE);
+    ASSERT_EQ(grpc_server->GetStartModelCount(), 1);
+
+    gst_element_set_state(lookoutvision, GST_STATE_NULL);
+    gst_object_unref(lookoutvision);
+}
+
+TEST_F(gstlookoutvisiontest, ready_only_properties_test) {
+    GstElement* lookoutvision = gst_element_factory_make("lookoutvision", "infer");
+    ASSERT_NE(lookoutvision, nullptr);
+    g_object_set(lookoutvision, "max-inflight", 4, NULL);
+    // Without model-component, going to PAUSED doesn't contact the Edge Agent
+    ASSERT_NE(gst_element_set_state(lookoutvision, GST_STATE_PAUSED), GST_STATE_CHANGE_FAILURE);
+
+    // trigger-mode 1 is external
+    g_object_set(lookoutvision, "max-inflight", 8, "trigger-mode", 1, "trigger-history", 16, NULL);
+    guint max_inflight, trigger_history;
+    gint trigger_mode;
+    g_object_get(lookoutvision, "max-inflight", &max_inflight, "trigger-mode", &trigger_mode, "trigger-history",
+                 &trigger_history, NULL);
+    ASSERT_EQ(max_inflight, 4u);
+    ASSERT_EQ(trigger_mode, 0);
+    ASSERT_EQ(trigger_history, 16u);
+
+    g_object_set(lookoutvision, "infer-regions", TRUE, "max-regions-inflight", 8, "region-type", "part", NULL);
+    gboolean infer_regions;
+    guint max_regions_inflight;
+    gchar *region_type;
+    g_object_get(lookoutvision, "infer-regions", &infer_regions, "max-regions-inflight", &max_regions_inflight,
+                 "region-type", &region_type, NULL);
+    ASSERT_FALSE(infer_regions);
+    ASSERT_EQ(max_regions_inflight, 4u);
+    ASSERT_STREQ(region_type, "part");
+    g_free(region_type);
+
+    ASSERT_EQ(gst_element_set_state(lookoutvision, GST_STATE_READY), GST_STATE_CHANGE_SUCCESS);
+    g_object_set(lookoutvision, "max-inflight", 8, NULL);
+    g_object_get(lookoutvision, "max-inflight", &max_inflight, NULL);
+    ASSERT_EQ(max_inflight, 8u);
+
+    gst_element_set_state(lookoutvision, GST_STATE_NULL);
+    gst_object_unref(lookoutvision);
+}
+
 TEST_F(gstlookoutvisiontest, element_linking_test) {
     GstElement *source, *sink, *lookoutvision;
 
@@ -537,6 +595,976 @@ TEST_F(gstlookoutvisiontest, pipeline_read_inference_meta_test) {
     ASSERT_THAT(output, HasSubstr("Confidence:"));
 }
 
+TEST_F(gstlookoutvisiontest, pipeline_run_with_max_inflight_test) {
+    testing::internal::CaptureStdout();
+
+    grpc_server = new TestServer();
+    grpc_server->RunServerInBackground("0.0.0.0:50051", "RUNNING");
+
+    GstElement *source, *sink, *lookoutvision, *consumer;
+    GstMessage *msg;
+    GstStateChangeReturn ret;
+
+    source = gst_element_factory_make("videotestsrc", "source");
+    lookoutvision = gst_element_factory_make("lookoutvision", "infer");
+    consumer = gst_element_factory_make("inferenceconsumer", "consumer");
+    sink = gst_element_factory_make("fakesink", "sink");
+    pipeline = gst_pipeline_new("pipeline");
+    ASSERT_NE(source, nullptr);
+    ASSERT_NE(lookoutvision, nullptr);
+    ASSERT_NE(consumer, nullptr);
+    ASSERT_NE(sink, nullptr);
+    ASSERT_NE(pipeline, nullptr);
+
+    gst_bin_add_many(GST_BIN(pipeline), source, lookoutvision, consumer, sink, NULL);
+    ASSERT_TRUE(gst_element_link_many(source, lookoutvision, consumer, sink, NULL));
+
+    g_object_set(source, "pattern", 0, "num-buffers", 10, NULL);
+
+    g_object_set(lookoutvision, "server-socket", "0.0.0.0:50051", "model-component", "SampleModel",
+                 "max-inflight", 4, NULL);
+
+    ret = gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    ASSERT_NE(ret, GST_STATE_CHANGE_FAILURE);
+
+    bus = gst_element_get_bus(pipeline);
+    msg = gst_bus_timed_pop_filtered(bus, GST_CLOCK_TIME_NONE, (GstMessageType) (GST_MESSAGE_ERROR | GST_MESSAGE_EOS));
+
+    if (msg != NULL) {
+        switch (GST_MESSAGE_TYPE (msg)) {
+            case GST_MESSAGE_ERROR:
+                FAIL();
+            case GST_MESSAGE_EOS:
+                break;
+        }
+        gst_message_unref(msg);
+    }
+
+    // Every frame reaches the consumer with its result before EOS
+    std::string output = testing::internal::GetCapturedStdout();
+    size_t results = 0;
+    for (size_t pos = output.find("Detect Anomaly Result"); pos != std::string::npos;
+         pos = output.find("Detect Anomaly Result", pos + 1)) {
+        results++;
+    }
+    ASSERT_EQ(results, 10u);
+}
+
+TEST_F(gstlookoutvisiontest, pipeline_swap_model_while_streaming_test) {
+    grpc_server = new TestServer();
+    grpc_server->RunServerInBackground("0.0.0.0:50051", "RUNNING");
+
+    GstElement *source, *sink, *lookoutvision;
+    GstMessage *msg;
+    GstStateChangeReturn ret;
+
+    source = gst_element_factory_make("videotestsrc", "source");
+    lookoutvision = gst_element_factory_make("lookoutvision", "infer");
+    sink = gst_element_factory_make("fakesink", "sink");
+    pipeline = gst_pipeline_new("pipeline");
+    ASSERT_NE(source, nullptr);
+    ASSERT_NE(lookoutvision, nullptr);
+    ASSERT_NE(sink, nullptr);
+    ASSERT_NE(pipeline, nullptr);
+
+    gst_bin_add_many(GST_BIN(pipeline), source, lookoutvision, sink, NULL);
+    ASSERT_TRUE(gst_element_link_many(source, lookoutvision, sink, NULL));
+
+    // About one second of live frames
+    g_object_set(source, "pattern", 0, "num-buffers", 30, "is-live", TRUE, NULL);
+
+    g_object_set(lookoutvision, "server-socket", "0.0.0.0:50051", "model-component", "SampleModel",
+                 "stop-previous-model", TRUE, NULL);
+
+    ret = gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    ASSERT_NE(ret, GST_STATE_CHANGE_FAILURE);
+    gst_element_get_state(pipeline, NULL, NULL, GST_CLOCK_TIME_NONE);
+
+    g_object_set(lookoutvision, "model-component", "NewModel", NULL);
+    // Reported right away, while it is still being started
+    gchar *model_component;
+    g_object_get(lookoutvision, "model-component", &model_component, NULL);
+    ASSERT_STREQ(model_component, "NewModel");
+    g_free(model_component);
+
+    bus = gst_element_get_bus(pipeline);
+    gboolean eos = FALSE, swapped = FALSE;
+    while (!eos) {
+        msg = gst_bus_timed_pop_filtered(bus, GST_CLOCK_TIME_NONE,
+                                         (GstMessageType) (GST_MESSAGE_ERROR | GST_MESSAGE_EOS | GST_MESSAGE_ELEMENT));
+        ASSERT_NE(msg, nullptr);
+        ASSERT_NE(GST_MESSAGE_TYPE(msg), GST_MESSAGE_ERROR);
+        if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_EOS) {
+            eos = TRUE;
+        } else if (gst_message_has_name(msg, "lookoutvision-model-swap")) {
+            const GstStructure *swap = gst_message_get_structure(msg);
+            ASSERT_STREQ(gst_structure_get_string(swap, "model-component"), "NewModel");
+            ASSERT_STREQ(gst_structure_get_string(swap, "previous-model-component"), "SampleModel");
+            ASSERT_TRUE(gst_structure_get_boolean(swap, "swapped", &swapped));
+        }
+        gst_message_unref(msg);
+    }
+    ASSERT_TRUE(swapped);
+
+    g_object_get(lookoutvision, "model-component", &model_component, NULL);
+    ASSERT_STREQ(model_component, "NewModel");
+    g_free(model_component);
+    ASSERT_EQ(grpc_server->GetStopModelCount(), 1);
+}
+
+TEST_F(gstlookoutvisiontest, pipeline_set_properties_while_streaming_test) {
+    testing::internal::CaptureStdout();
+
+    grpc_server = new TestServer();
+    grpc_server->RunServerInBackground("0.0.0.0:50051", "RUNNING");
+
+    GstElement *source, *sink, *lookoutvision;
+    GstMessage *msg = NULL;
+    GstStateChangeReturn ret;
+
+    source = gst_element_factory_make("videotestsrc", "source");
+    lookoutvision = gst_element_factory_make("lookoutvision", "infer");
+    sink = gst_element_factory_make("fakesink", "sink");
+    pipeline = gst_pipeline_new("pipeline");
+    ASSERT_NE(source, nullptr);
+    ASSERT_NE(lookoutvision, nullptr);
+    ASSERT_NE(sink, nullptr);
+    ASSERT_NE(pipeline, nullptr);
+
+    gst_bin_add_many(GST_BIN(pipeline), source, lookoutvision, sink, NULL);
+    ASSERT_TRUE(gst_element_link_many(source, lookoutvision, sink, NULL));
+
+    g_object_set(source, "pattern", 0, "num-buffers", 200, NULL);
+
+    g_object_set(lookoutvision, "server-socket", "0.0.0.0:50051", "model-component", "SampleModel",
+                 "max-inflight", 4, NULL);
+
+    ret = gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    ASSERT_NE(ret, GST_STATE_CHANGE_FAILURE);
+
+    // Every set publishes a new snapshot while frames are being inferred with the previous ones
+    bus = gst_element_get_bus(pipeline);
+    for (guint i = 0; msg == NULL; i++) {
+        gchar *model_component;
+        g_object_set(lookoutvision, "model-status-timeout", 100 + i % 100, NULL);
+        g_object_get(lookoutvision, "model-component", &model_component, NULL);
+        ASSERT_STREQ(model_component, "SampleModel");
+        g_free(model_component);
+        msg = gst_bus_pop_filtered(bus, (GstMessageType) (GST_MESSAGE_ERROR | GST_MESSAGE_EOS));
+    }
+
+    switch (GST_MESSAGE_TYPE (msg)) {
+        case GST_MESSAGE_ERROR:
+            FAIL();
+        default:
+            break;
+    }
+    gst_message_unref(msg);
+
+    ASSERT_EQ(grpc_server->GetDetectAnomaliesCount(), 200);
+    testing::internal::GetCapturedStdout();
+}
+
+TEST_F(gstlookoutvisiontest, pipeline_warm_up_model_test) {
+    testing::internal::CaptureStdout();
+
+    grpc_server = new TestServer();
+    grpc_server->RunServerInBackground("0.0.0.0:50051", "RUNNING");
+
+    GstElement *source, *sink, *lookoutvision;
+    GstMessage *msg;
+    GstStateChangeReturn ret;
+
+    source = gst_element_factory_make("videotestsrc", "source");
+    lookoutvision = gst_element_factory_make("lookoutvision", "infer");
+    sink = gst_element_factory_make("fakesink", "sink");
+    pipeline = gst_pipeline_new("pipeline");
+    ASSERT_NE(source, nullptr);
+    ASSERT_NE(lookoutvision, nullptr);
+    ASSERT_NE(sink, nullptr);
+    ASSERT_NE(pipeline, nullptr);
+
+    gst_bin_add_many(GST_BIN(pipeline), source, lookoutvision, sink, NULL);
+    ASSERT_TRUE(gst_element_link_many(source, lookoutvision, sink, NULL));
+
+    g_object_set(source, "pattern", 0, "num-buffers", 2, NULL);
+
+    g_object_set(lookoutvision, "server-socket", "0.0.0.0:50051", "model-component", "SampleModel",
+                 "warmup-frames", 3, NULL);
+
+    ret = gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    ASSERT_NE(ret, GST_STATE_CHANGE_FAILURE);
+
+    bus = gst_element_get_bus(pipeline);
+    msg = gst_bus_timed_pop_filtered(bus, GST_CLOCK_TIME_NONE, (GstMessageType) (GST_MESSAGE_ERROR | GST_MESSAGE_EOS));
+
+    if (msg != NULL) {
+        switch (GST_MESSAGE_TYPE (msg)) {
+            case GST_MESSAGE_ERROR:
+                FAIL();
+            case GST_MESSAGE_EOS:
+                break;
+        }
+        gst_message_unref(msg);
+    }
+
+    // Warm-up frames go out before the 2 real frames
+    ASSERT_EQ(grpc_server->GetDetectAnomaliesCount(), 5);
+    GstStructure *stats;
+    g_object_get(lookoutvision, "stats", &stats, NULL);
+    ASSERT_EQ(gst_value_array_get_size(gst_structure_get_value(stats, "warmup-latencies")), 3u);
+    guint64 first_frame_latency;
+    ASSERT_TRUE(gst_structure_get_uint64(stats, "first-frame-latency", &first_frame_latency));
+    ASSERT_GT(first_frame_latency, 0u);
+    gst_structure_free(stats);
+    std::string output = testing::internal::GetCapturedStdout();
+    ASSERT_THAT(output, HasSubstr("Warmed up SampleModel with 3 frames"));
+}
+
+TEST_F(gstlookoutvisiontest, pipeline_run_with_inference_timeout_test) {
+    testing::internal::CaptureStdout();
+
+    grpc_server = new TestServer();
+    grpc_server->SetInferenceLatency(500);
+    grpc_server->RunServerInBackground("0.0.0.0:50051", "RUNNING");
+
+    GstElement *source, *sink, *lookoutvision;
+    GstMessage *msg;
+    GstStateChangeReturn ret;
+
+    source = gst_element_factory_make("videotestsrc", "source");
+    lookoutvision = gst_element_factory_make("lookoutvision", "infer");
+    sink = gst_element_factory_make("fakesink", "sink");
+    pipeline = gst_pipeline_new("pipeline");
+    ASSERT_NE(source, nullptr);
+    ASSERT_NE(lookoutvision, nullptr);
+    ASSERT_NE(sink, nullptr);
+    ASSERT_NE(pipeline, nullptr);
+
+    gst_bin_add_many(GST_BIN(pipeline), source, lookoutvision, sink, NULL);
+    ASSERT_TRUE(gst_element_link_many(source, lookoutvision, sink, NULL));
+
+    g_object_set(source, "pattern", 0, "num-buffers", 3, NULL);
+
+    g_object_set(lookoutvision, "server-socket", "0.0.0.0:50051", "model-component", "SampleModel",
+                 "inference-timeout", 50, NULL);
+
+    ret = gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    ASSERT_NE(ret, GST_STATE_CHANGE_FAILURE);
+
+    bus = gst_element_get_bus(pipeline);
+    msg = gst_bus_timed_pop_filtered(bus, GST_CLOCK_TIME_NONE, (GstMessageType) (GST_MESSAGE_ERROR | GST_MESSAGE_EOS));
+
+    if (msg != NULL) {
+        switch (GST_MESSAGE_TYPE (msg)) {
+            case GST_MESSAGE_ERROR:
+                FAIL();
+            case GST_MESSAGE_EOS:
+                break;
+        }
+        gst_message_unref(msg);
+    }
+
+    // Frames keep flowing past the wedged agent
+    std::string output = testing::internal::GetCapturedStdout();
+    size_t timeouts = 0;
+    for (size_t pos = output.find("Inference call timed out"); pos != std::string::npos;
+         pos = output.find("Inference call timed out", pos + 1)) {
+        timeouts++;
+    }
+    ASSERT_EQ(timeouts, 3u);
+}
+
+TEST_F(gstlookoutvisiontest, pipeline_run_with_jpeg_input_test) {
+    grpc_server = new TestServer();
+    grpc_server->RunServerInBackground("0.0.0.0:50051", "RUNNING");
+
+    GstElement *source, *encoder, *sink, *lookoutvision;
+    GstMessage *msg;
+    GstStateChangeReturn ret;
+
+    source = gst_element_factory_make("videotestsrc", "source");
+    encoder = gst_element_factory_make("jpegenc", "encoder");
+    lookoutvision = gst_element_factory_make("lookoutvision", "infer");
+    sink = gst_element_factory_make("fakesink", "sink");
+    pipeline = gst_pipeline_new("pipeline");
+    ASSERT_NE(source, nullptr);
+    ASSERT_NE(encoder, nullptr);
+    ASSERT_NE(lookoutvision, nullptr);
+    ASSERT_NE(sink, nullptr);
+    ASSERT_NE(pipeline, nullptr);
+
+    gst_bin_add_many(GST_BIN(pipeline), source, encoder, lookoutvision, sink, NULL);
+    ASSERT_TRUE(gst_element_link_many(source, encoder, lookoutvision, sink, NULL));
+
+    g_object_set(source, "pattern", 0, "num-buffers", 2, NULL);
+
+    // videotestsrc defaults to 320x240, which a quarter scale decode lands on exactly
+    g_object_set(lookoutvision, "server-socket", "0.0.0.0:50051", "model-component", "SampleModel",
+                 "inference-width", 80, NULL);
+
+    ret = gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    ASSERT_NE(ret, GST_STATE_CHANGE_FAILURE);
+
+    bus = gst_element_get_bus(pipeline);
+    msg = gst_bus_timed_pop_filtered(bus, GST_CLOCK_TIME_NONE, (GstMessageType) (GST_MESSAGE_ERROR | GST_MESSAGE_EOS));
+
+    if (msg != NULL) {
+        switch (GST_MESSAGE_TYPE (msg)) {
+            case GST_MESSAGE_ERROR:
+                FAIL();
+            case GST_MESSAGE_EOS:
+                break;
+        }
+        gst_message_unref(msg);
+    }
+
+    ASSERT_EQ(grpc_server->GetDetectAnomaliesCount(), 2);
+    ASSERT_EQ(grpc_server->GetLastFrameWidth(), 80);
+    ASSERT_EQ(grpc_server->GetLastFrameHeight(), 60);
+    ASSERT_EQ(grpc_server->GetLastFrameBytes(), 80 * 60 * 3);
+
+    // Frames leave the element still compressed
+    GstPad *pad = gst_element_get_static_pad(lookoutvision, "src");
+    GstCaps *caps = gst_pad_get_current_caps(pad);
+    ASSERT_TRUE(gst_structure_has_name(gst_caps_get_structure(caps, 0), "image/jpeg"));
+    gst_caps_unref(caps);
+    gst_object_unref(pad);
+}
+
+TEST_F(gstlookoutvisiontest, pipeline_run_with_h264_keyframes_test) {
+    grpc_server = new TestServer();
+    grpc_server->RunServerInBackground("0.0.0.0:50051", "RUNNING");
+
+    GstElement *source, *convert, *encoder, *parser, *sink, *lookoutvision;
+    GstMessage *msg;
+    GstStateChangeReturn ret;
+
+    source = gst_element_factory_make("videotestsrc", "source");
+    convert = gst_element_factory_make("videoconvert", "convert");
+    encoder = gst_element_factory_make("x264enc", "encoder");
+    parser = gst_element_factory_make("h264parse", "parser");
+    lookoutvision = gst_element_factory_make("lookoutvision", "infer");
+    sink = gst_element_factory_make("fakesink", "sink");
+    pipeline = gst_pipeline_new("pipeline");
+    ASSERT_NE(source, nullptr);
+    ASSERT_NE(convert, nullptr);
+    ASSERT_NE(encoder, nullptr);
+    ASSERT_NE(parser, nullptr);
+    ASSERT_NE(lookoutvision, nullptr);
+    ASSERT_NE(sink, nullptr);
+    ASSERT_NE(pipeline, nullptr);
+
+    gst_bin_add_many(GST_BIN(pipeline), source, convert, encoder, parser, lookoutvision, sink, NULL);
+    ASSERT_TRUE(gst_element_link_many(source, convert, encoder, parser, lookoutvision, sink, NULL));
+
+    // Keyframes at 0, 10 and 20, of which every second one is inferred
+    g_object_set(source, "pattern", 0, "num-buffers", 30, NULL);
+    g_object_set(encoder, "key-int-max", 10, NULL);
+    g_object_set(parser, "config-interval", -1, NULL);
+
+    g_object_set(lookoutvision, "server-socket", "0.0.0.0:50051", "model-component", "SampleModel",
+                 "keyframe-interval", 2, NULL);
+
+    ret = gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    ASSERT_NE(ret, GST_STATE_CHANGE_FAILURE);
+
+    bus = gst_element_get_bus(pipeline);
+    msg = gst_bus_timed_pop_filtered(bus, GST_CLOCK_TIME_NONE, (GstMessageType) (GST_MESSAGE_ERROR | GST_MESSAGE_EOS));
+
+    if (msg != NULL) {
+        switch (GST_MESSAGE_TYPE (msg)) {
+            case GST_MESSAGE_ERROR:
+                FAIL();
+            case GST_MESSAGE_EOS:
+                break;
+        }
+        gst_message_unref(msg);
+    }
+
+    ASSERT_EQ(grpc_server->GetDetectAnomaliesCount(), 2);
+    ASSERT_EQ(grpc_server->GetLastFrameWidth(), 320);
+    ASSERT_EQ(grpc_server->GetLastFrameHeight(), 240);
+}
+
+/* Strips the SPS and PPS from every keyframe but the first, like a stream that only sends them once */
+static GstPadProbeReturn strip_parameter_sets(GstPad *pad, GstPadProbeInfo *info, gpointer user_data) {
+    gboolean *first_keyframe_seen = (gboolean*) user_data;
+    GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER(info);
+    if (GST_BUFFER_FLAG_IS_SET(buf, GST_BUFFER_FLAG_DELTA_UNIT)) {
+        return GST_PAD_PROBE_OK;
+    }
+    if (!*first_keyframe_seen) {
+        *first_keyframe_seen = TRUE;
+        return GST_PAD_PROBE_OK;
+    }
+    GstMapInfo map;
+    gst_buffer_map(buf, &map, GST_MAP_READ);
+    std::vector<guint8> stripped;
+    gsize start = map.size;
+    for (gsize i = 0; i <= map.size; i++) {
+        gboolean start_code = i + 3 <= map.size && map.data[i] == 0 && map.data[i + 1] == 0 && map.data[i + 2] == 1;
+        if (!start_code && i < map.size) {
+            continue;
+        }
+        guint type = start + 3 < i ? map.data[start + 3] & 0x1f : 0;
+        if (start < i && type != 7 && type != 8) {
+            stripped.insert(stripped.end(), map.data + start, map.data + i);
+        }
+        start = i;
+    }
+    gst_buffer_unmap(buf, &map);
+
+    GstBuffer *replacement = gst_buffer_new_allocate(NULL, stripped.size(), NULL);
+    gst_buffer_fill(replacement, 0, stripped.data(), stripped.size());
+    gst_buffer_copy_into(replacement, buf, (GstBufferCopyFlags) (GST_BUFFER_COPY_FLAGS | GST_BUFFER_COPY_TIMESTAMPS),
+                         0, -1);
+    gst_buffer_unref(buf);
+    GST_PAD_PROBE_INFO_DATA(info) = replacement;
+    return GST_PAD_PROBE_OK;
+}
+
+TEST_F(gstlookoutvisiontest, pipeline_run_with_h264_keyframes_without_parameter_sets_test) {
+    grpc_server = new TestServer();
+    grpc_server->RunServerInBackground("0.0.0.0:50051", "RUNNING");
+
+    GstElement *source, *convert, *encoder, *parser, *capsfilter, *sink, *lookoutvision;
+    GstMessage *msg;
+    GstStateChangeReturn ret;
+
+    source = gst_element_factory_make("videotestsrc", "source");
+    convert = gst_element_factory_make("videoconvert", "convert");
+    encoder = gst_element_factory_make("x264enc", "encoder");
+    parser = gst_element_factory_make("h264parse", "parser");
+    capsfilter = gst_element_factory_make("capsfilter", "caps");
+    lookoutvision = gst_element_factory_make("lookoutvision", "infer");
+    sink = gst_element_factory_make("fakesink", "sink");
+    pipeline = gst_pipeline_new("pipeline");
+    ASSERT_NE(source, nullptr);
+    ASSERT_NE(convert, nullptr);
+    ASSERT_NE(encoder, nullptr);
+    ASSERT_NE(parser, nullptr);
+    ASSERT_NE(capsfilter, nullptr);
+    ASSERT_NE(lookoutvision, nullptr);
+    ASSERT_NE(sink, nullptr);
+    ASSERT_NE(pipeline, nullptr);
+
+    gst_bin_add_many(GST_BIN(pipeline), source, convert, encoder, parser, capsfilter, lookoutvision, sink, NULL);
+    ASSERT_TRUE(gst_element_link_many(source, convert, encoder, parser, capsfilter, lookoutvision, sink, NULL));
+
+    // Keyframes at 0, 10 and 20, only the first one with parameter sets
+    g_object_set(source, "pattern", 0, "num-buffers", 30, NULL);
+    g_object_set(encoder, "key-int-max", 10, NULL);
+    GstCaps *caps = gst_caps_from_string("video/x-h264, stream-format=byte-stream, alignment=au");
+    g_object_set(capsfilter, "caps", caps, NULL);
+    gst_caps_unref(caps);
+    gboolean first_keyframe_seen = FALSE;
+    GstPad *pad = gst_element_get_static_pad(capsfilter, "src");
+    gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, strip_parameter_sets, &first_keyframe_seen, NULL);
+    gst_object_unref(pad);
+
+    g_object_set(lookoutvision, "server-socket", "0.0.0.0:50051", "model-component", "SampleModel", NULL);
+
+    ret = gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    ASSERT_NE(ret, GST_STATE_CHANGE_FAILURE);
+
+    bus = gst_element_get_bus(pipeline);
+    msg = gst_bus_timed_pop_filtered(bus, GST_CLOCK_TIME_NONE, (GstMessageType) (GST_MESSAGE_ERROR | GST_MESSAGE_EOS));
+
+    if (msg != NULL) {
+        switch (GST_MESSAGE_TYPE (msg)) {
+            case GST_MESSAGE_ERROR:
+                FAIL();
+            case GST_MESSAGE_EOS:
+                break;
+        }
+        gst_message_unref(msg);
+    }
+
+    // Every keyframe decodes, the later ones with the parameter sets of the first
+    ASSERT_TRUE(first_keyframe_seen);
+    ASSERT_EQ(grpc_server->GetDetectAnomaliesCount(), 3);
+}
+
+TEST_F(gstlookoutvisiontest, pipeline_stop_cancels_inflight_inference_test) {
+    grpc_server = new TestServer();
+    grpc_server->SetInferenceLatency(3000);
+    grpc_server->RunServerInBackground("0.0.0.0:50051", "RUNNING");
+
+    GstElement *source, *sink, *lookoutvision;
+    GstStateChangeReturn ret;
+
+    source = gst_element_factory_make("videotestsrc", "source");
+    lookoutvision = gst_element_factory_make("lookoutvision", "infer");
+    sink = gst_element_factory_make("fakesink", "sink");
+    pipeline = gst_pipeline_new("pipeline");
+    ASSERT_NE(source, nullptr);
+    ASSERT_NE(lookoutvision, nullptr);
+    ASSERT_NE(sink, nullptr);
+    ASSERT_NE(pipeline, nullptr);
+
+    gst_bin_add_many(GST_BIN(pipeline), source, lookoutvision, sink, NULL);
+    ASSERT_TRUE(gst_element_link_many(source, lookoutvision, sink, NULL));
+
+    g_object_set(source, "pattern", 0, "num-buffers", 10, NULL);
+
+    g_object_set(lookoutvision, "server-socket", "0.0.0.0:50051", "model-component", "SampleModel", NULL);
+
+    ret = gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    ASSERT_NE(ret, GST_STATE_CHANGE_FAILURE);
+
+    // The first frame is now waiting on the agent
+    g_usleep(500 * G_TIME_SPAN_MILLISECOND);
+    gint64 start = g_get_monotonic_time();
+    ret = gst_element_set_state(pipeline, GST_STATE_NULL);
+    ASSERT_NE(ret, GST_STATE_CHANGE_FAILURE);
+    ASSERT_LT(g_get_monotonic_time() - start, G_TIME_SPAN_SECOND);
+}
+
+TEST_F(gstlookoutvisiontest, pipeline_run_with_inference_size_test) {
+    grpc_server = new TestServer();
+    grpc_server->RunServerInBackground("0.0.0.0:50051", "RUNNING");
+
+    GstElement *source, *capsfilter, *sink, *lookoutvision;
+    GstMessage *msg;
+    GstStateChangeReturn ret;
+
+    source = gst_element_factory_make("videotestsrc", "source");
+    capsfilter = gst_element_factory_make("capsfilter", "caps");
+    lookoutvision = gst_element_factory_make("lookoutvision", "infer");
+    sink = gst_element_factory_make("fakesink", "sink");
+    pipeline = gst_pipeline_new("pipeline");
+    ASSERT_NE(source, nullptr);
+    ASSERT_NE(capsfilter, nullptr);
+    ASSERT_NE(lookoutvision, nullptr);
+    ASSERT_NE(sink, nullptr);
+    ASSERT_NE(pipeline, nullptr);
+
+    gst_bin_add_many(GST_BIN(pipeline), source, capsfilter, lookoutvision, sink, NULL);
+    ASSERT_TRUE(gst_element_link_many(source, capsfilter, lookoutvision, sink, NULL));
+
+    g_object_set(source, "pattern", 0, "num-buffers", 2, NULL);
+    GstCaps *caps = gst_caps_new_simple("video/x-raw",
+                                        "width", G_TYPE_INT, 1280,
+                                        "height", G_TYPE_INT, 720,
+                                        "format", G_TYPE_STRING, "RGB",
+                                        NULL);
+    g_object_set(capsfilter, "caps", caps, NULL);
+    gst_caps_unref(caps);
+
+    // The height follows the negotiated aspect ratio
+    g_object_set(lookoutvision, "server-socket", "0.0.0.0:50051", "model-component", "SampleModel",
+                 "inference-width", 320, NULL);
+
+    ret = gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    ASSERT_NE(ret, GST_STATE_CHANGE_FAILURE);
+
+    bus = gst_element_get_bus(pipeline);
+    msg = gst_bus_timed_pop_filtered(bus, GST_CLOCK_TIME_NONE, (GstMessageType) (GST_MESSAGE_ERROR | GST_MESSAGE_EOS));
+
+    if (msg != NULL) {
+        switch (GST_MESSAGE_TYPE (msg)) {
+            case GST_MESSAGE_ERROR:
+                FAIL();
+            case GST_MESSAGE_EOS:
+                break;
+        }
+        gst_message_unref(msg);
+    }
+
+    ASSERT_EQ(grpc_server->GetDetectAnomaliesCount(), 2);
+    ASSERT_EQ(grpc_server->GetLastFrameWidth(), 320);
+    ASSERT_EQ(grpc_server->GetLastFrameHeight(), 180);
+    ASSERT_EQ(grpc_server->GetLastFrameBytes(), 320 * 180 * 3);
+}
+
+TEST_F(gstlookoutvisiontest, pipeline_skip_dark_frames_test) {
+    testing::internal::CaptureStdout();
+
+    grpc_server = new TestServer();
+    grpc_server->RunServerInBackground("0.0.0.0:50051", "RUNNING");
+
+    GstElement *source, *capsfilter, *sink, *lookoutvision;
+    GstMessage *msg;
+    GstStateChangeReturn ret;
+
+    source = gst_element_factory_make("videotestsrc", "source");
+    capsfilter = gst_element_factory_make("capsfilter", "caps");
+    lookoutvision = gst_element_factory_make("lookoutvision", "infer");
+    sink = gst_element_factory_make("fakesink", "sink");
+    pipeline = gst_pipeline_new("pipeline");
+    ASSERT_NE(source, nullptr);
+    ASSERT_NE(capsfilter, nullptr);
+    ASSERT_NE(lookoutvision, nullptr);
+    ASSERT_NE(sink, nullptr);
+    ASSERT_NE(pipeline, nullptr);
+
+    gst_bin_add_many(GST_BIN(pipeline), source, capsfilter, lookoutvision, sink, NULL);
+    ASSERT_TRUE(gst_element_link_many(source, capsfilter, lookoutvision, sink, NULL));
+
+    // Black frames, as from a covered lens
+    g_object_set(source, "pattern", 2, "num-buffers", 2, NULL);
+    GstCaps *caps = gst_caps_new_simple("video/x-raw",
+                                        "width", G_TYPE_INT, 320,
+                                        "height", G_TYPE_INT, 240,
+                                        "format", G_TYPE_STRING, "RGB",
+                                        NULL);
+    g_object_set(capsfilter, "caps", caps, NULL);
+    gst_caps_unref(caps);
+
+    g_object_set(lookoutvision, "server-socket", "0.0.0.0:50051", "model-component", "SampleModel",
+                 "min-brightness", 20.0, NULL);
+
+    ret = gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    ASSERT_NE(ret, GST_STATE_CHANGE_FAILURE);
+
+    bus = gst_element_get_bus(pipeline);
+    msg = gst_bus_timed_pop_filtered(bus, GST_CLOCK_TIME_NONE, (GstMessageType) (GST_MESSAGE_ERROR | GST_MESSAGE_EOS));
+
+    if (msg != NULL) {
+        switch (GST_MESSAGE_TYPE (msg)) {
+            case GST_MESSAGE_ERROR:
+                FAIL();
+            case GST_MESSAGE_EOS:
+                break;
+        }
+        gst_message_unref(msg);
+    }
+
+    std::string output = testing::internal::GetCapturedStdout();
+    ASSERT_THAT(output, HasSubstr("Inference skipped: Brightness 0.0 below min-brightness"));
+    ASSERT_EQ(grpc_server->GetDetectAnomaliesCount(), 0);
+}
+
+TEST_F(gstlookoutvisiontest, pipeline_cascade_escalates_anomalies_test) {
+    grpc_server = new TestServer();
+    grpc_server->RunServerInBackground("0.0.0.0:50051", "RUNNING");
+
+    GstElement *source, *capsfilter, *sink, *lookoutvision;
+    GstMessage *msg;
+    GstStateChangeReturn ret;
+
+    source = gst_element_factory_make("videotestsrc", "source");
+    capsfilter = gst_element_factory_make("capsfilter", "caps");
+    lookoutvision = gst_element_factory_make("lookoutvision", "infer");
+    sink = gst_element_factory_make("fakesink", "sink");
+    pipeline = gst_pipeline_new("pipeline");
+    ASSERT_NE(source, nullptr);
+    ASSERT_NE(capsfilter, nullptr);
+    ASSERT_NE(lookoutvision, nullptr);
+    ASSERT_NE(sink, nullptr);
+    ASSERT_NE(pipeline, nullptr);
+
+    gst_bin_add_many(GST_BIN(pipeline), source, capsfilter, lookoutvision, sink, NULL);
+    ASSERT_TRUE(gst_element_link_many(source, capsfilter, lookoutvision, sink, NULL));
+
+    g_object_set(source, "pattern", 0, "num-buffers", 2, NULL);
+    GstCaps *caps = gst_caps_new_simple("video/x-raw",
+                                        "width", G_TYPE_INT, 320,
+                                        "height", G_TYPE_INT, 240,
+                                        "format", G_TYPE_STRING, "RGB",
+                                        NULL);
+    g_object_set(capsfilter, "caps", caps, NULL);
+    gst_caps_unref(caps);
+
+    // The test server answers with a confidence of 0.52559
+    g_object_set(lookoutvision, "server-socket", "0.0.0.0:50051", "model-component", "SampleModel",
+                 "screening-model-component", "ScreeningModel", "screening-width", 80, "screening-confidence", 0.5,
+                 NULL);
+
+    ret = gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    ASSERT_NE(ret, GST_STATE_CHANGE_FAILURE);
+
+    bus = gst_element_get_bus(pipeline);
+    msg = gst_bus_timed_pop_filtered(bus, GST_CLOCK_TIME_NONE, (GstMessageType) (GST_MESSAGE_ERROR | GST_MESSAGE_EOS));
+
+    if (msg != NULL) {
+        switch (GST_MESSAGE_TYPE (msg)) {
+            case GST_MESSAGE_ERROR:
+                FAIL();
+            case GST_MESSAGE_EOS:
+                break;
+        }
+        gst_message_unref(msg);
+    }
+
+    // Every frame was screened at 80x60, then inferred again at full resolution
+    ASSERT_EQ(grpc_server->GetStartModelCount(), 2);
+    ASSERT_EQ(grpc_server->GetDetectAnomaliesCount(), 4);
+    ASSERT_EQ(grpc_server->GetLastFrameWidth(), 320);
+    ASSERT_EQ(grpc_server->GetLastFrameHeight(), 240);
+
+    GstStructure *stats;
+    guint64 screened_frames, escalated_frames;
+    g_object_get(lookoutvision, "stats", &stats, NULL);
+    ASSERT_TRUE(gst_structure_get_uint64(stats, "screened-frames", &screened_frames));
+    ASSERT_TRUE(gst_structure_get_uint64(stats, "escalated-frames", &escalated_frames));
+    ASSERT_EQ(screened_frames, 2);
+    ASSERT_EQ(escalated_frames, 2);
+    gst_structure_free(stats);
+}
+
+TEST_F(gstlookoutvisiontest, pipeline_cascade_stops_at_confident_screening_test) {
+    grpc_server = new TestServer();
+    grpc_server->RunServerInBackground("0.0.0.0:50051", "RUNNING");
+    grpc_server->SetAnomalous(false);
+
+    GstElement *source, *capsfilter, *sink, *lookoutvision;
+    GstMessage *msg;
+    GstStateChangeReturn ret;
+
+    source = gst_element_factory_make("videotestsrc", "source");
+    capsfilter = gst_element_factory_make("capsfilter", "caps");
+    lookoutvision = gst_element_factory_make("lookoutvision", "infer");
+    sink = gst_element_factory_make("fakesink", "sink");
+    pipeline = gst_pipeline_new("pipeline");
+    ASSERT_NE(source, nullptr);
+    ASSERT_NE(capsfilter, nullptr);
+    ASSERT_NE(lookoutvision, nullptr);
+    ASSERT_NE(sink, nullptr);
+    ASSERT_NE(pipeline, nullptr);
+
+    gst_bin_add_many(GST_BIN(pipeline), source, capsfilter, lookoutvision, sink, NULL);
+    ASSERT_TRUE(gst_element_link_many(source, capsfilter, lookoutvision, sink, NULL));
+
+    g_object_set(source, "pattern", 0, "num-buffers", 2, NULL);
+    GstCaps *caps = gst_caps_new_simple("video/x-raw",
+                                        "width", G_TYPE_INT, 320,
+                                        "height", G_TYPE_INT, 240,
+                                        "format", G_TYPE_STRING, "RGB",
+                                        NULL);
+    g_object_set(capsfilter, "caps", caps, NULL);
+    gst_caps_unref(caps);
+
+    // The test server answers with a confidence of 0.52559
+    g_object_set(lookoutvision, "server-socket", "0.0.0.0:50051", "model-component", "SampleModel",
+                 "screening-model-component", "ScreeningModel", "screening-width", 80, "screening-confidence", 0.5,
+                 NULL);
+
+    ret = gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    ASSERT_NE(ret, GST_STATE_CHANGE_FAILURE);
+
+    bus = gst_element_get_bus(pipeline);
+    msg = gst_bus_timed_pop_filtered(bus, GST_CLOCK_TIME_NONE, (GstMessageType) (GST_MESSAGE_ERROR | GST_MESSAGE_EOS));
+
+    if (msg != NULL) {
+        switch (GST_MESSAGE_TYPE (msg)) {
+            case GST_MESSAGE_ERROR:
+                FAIL();
+            case GST_MESSAGE_EOS:
+                break;
+        }
+        gst_message_unref(msg);
+    }
+
+    // Confidently normal at 80x60, no frame reached the full-resolution model
+    ASSERT_EQ(grpc_server->GetStartModelCount(), 2);
+    ASSERT_EQ(grpc_server->GetDetectAnomaliesCount(), 2);
+    ASSERT_EQ(grpc_server->GetLastFrameWidth(), 80);
+    ASSERT_EQ(grpc_server->GetLastFrameHeight(), 60);
+
+    GstStructure *stats;
+    guint64 screened_frames, escalated_frames;
+    g_object_get(lookoutvision, "stats", &stats, NULL);
+    ASSERT_TRUE(gst_structure_get_uint64(stats, "screened-frames", &screened_frames));
+    ASSERT_TRUE(gst_structure_get_uint64(stats, "escalated-frames", &escalated_frames));
+    ASSERT_EQ(screened_frames, 2);
+    ASSERT_EQ(escalated_frames, 0);
+    gst_structure_free(stats);
+}
+
+/* Counts the frames passing a pad and triggers the element once the given frame comes by */
+typedef struct _TriggerProbe {
+    GstElement *lookoutvision;
+    guint frames;
+    guint trigger_frame;
+    GstClockTime triggered_pts;
+} TriggerProbe;
+
+/* Upstream of the element: the trigger signal names the running time of a frame the element hasn't seen yet */
+static GstPadProbeReturn trigger_signal_probe(GstPad *pad, GstPadProbeInfo *info, gpointer user_data) {
+    TriggerProbe *probe = (TriggerProbe*) user_data;
+    if (probe->frames++ == probe->trigger_frame) {
+        probe->triggered_pts = GST_BUFFER_PTS(GST_PAD_PROBE_INFO_BUFFER(info));
+        g_signal_emit_by_name(probe->lookoutvision, "trigger", (guint64) probe->triggered_pts);
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+/* Downstream of the element: a trigger event without timestamp picks the latest frame */
+static GstPadProbeReturn trigger_event_probe(GstPad *pad, GstPadProbeInfo *info, gpointer user_data) {
+    TriggerProbe *probe = (TriggerProbe*) user_data;
+    if (probe->frames++ == probe->trigger_frame) {
+        probe->triggered_pts = GST_BUFFER_PTS(GST_PAD_PROBE_INFO_BUFFER(info));
+        gst_pad_push_event(pad, gst_event_new_custom(GST_EVENT_CUSTOM_UPSTREAM,
+                                                     gst_structure_new_empty("lookoutvision-trigger")));
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+TEST_F(gstlookoutvisiontest, pipeline_run_with_external_trigger_test) {
+    grpc_server = new TestServer();
+    grpc_server->RunServerInBackground("0.0.0.0:50051", "RUNNING");
+
+    GstElement *source, *sink, *lookoutvision;
+    GstMessage *msg;
+    GstStateChangeReturn ret;
+
+    source = gst_element_factory_make("videotestsrc", "source");
+    lookoutvision = gst_element_factory_make("lookoutvision", "infer");
+    sink = gst_element_factory_make("fakesink", "sink");
+    pipeline = gst_pipeline_new("pipeline");
+    ASSERT_NE(source, nullptr);
+    ASSERT_NE(lookoutvision, nullptr);
+    ASSERT_NE(sink, nullptr);
+    ASSERT_NE(pipeline, nullptr);
+
+    gst_bin_add_many(GST_BIN(pipeline), source, lookoutvision, sink, NULL);
+    ASSERT_TRUE(gst_element_link_many(source, lookoutvision, sink, NULL));
+
+    g_object_set(source, "pattern", 0, "num-buffers", 10, NULL);
+    g_object_set(lookoutvision, "server-socket", "0.0.0.0:50051", "model-component", "SampleModel",
+                 "trigger-mode", 1, NULL);
+
+    TriggerProbe signal_probe = {lookoutvision, 0, 3, GST_CLOCK_TIME_NONE};
+    GstPad *source_pad = gst_element_get_static_pad(source, "src");
+    gst_pad_add_probe(source_pad, GST_PAD_PROBE_TYPE_BUFFER, trigger_signal_probe, &signal_probe, NULL);
+    gst_object_unref(source_pad);
+    TriggerProbe event_probe = {lookoutvision, 0, 7, GST_CLOCK_TIME_NONE};
+    GstPad *sink_pad = gst_element_get_static_pad(sink, "sink");
+    gst_pad_add_probe(sink_pad, GST_PAD_PROBE_TYPE_BUFFER, trigger_event_probe, &event_probe, NULL);
+    gst_object_unref(sink_pad);
+
+    ret = gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    ASSERT_NE(ret, GST_STATE_CHANGE_FAILURE);
+
+    bus = gst_element_get_bus(pipeline);
+    std::vector<GstClockTime> result_pts;
+    gboolean eos = FALSE;
+    while (!eos) {
+        msg = gst_bus_timed_pop_filtered(bus, GST_CLOCK_TIME_NONE,
+                                         (GstMessageType) (GST_MESSAGE_ERROR | GST_MESSAGE_EOS | GST_MESSAGE_ELEMENT));
+        ASSERT_NE(msg, nullptr);
+        ASSERT_NE(GST_MESSAGE_TYPE(msg), GST_MESSAGE_ERROR);
+        if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_EOS) {
+            eos = TRUE;
+        } else if (gst_message_has_name(msg, "lookoutvision-result")) {
+            guint64 pts;
+            ASSERT_TRUE(gst_structure_get_uint64(gst_message_get_structure(msg), "pts", &pts));
+            result_pts.push_back(pts);
+        }
+        gst_message_unref(msg);
+    }
+
+    // Only the two triggered frames were inferred, and their results were posted before EOS
+    ASSERT_EQ(grpc_server->GetDetectAnomaliesCount(), 2);
+    ASSERT_EQ(result_pts.size(), 2);
+    ASSERT_EQ(result_pts[0], signal_probe.triggered_pts);
+    ASSERT_EQ(result_pts[1], event_probe.triggered_pts);
+}
+
+/* Plays the upstream detector: tags regions on the first and third frame, one of them of a type not inferred */
+static GstPadProbeReturn add_regions_probe(GstPad *pad, GstPadProbeInfo *info, gpointer user_data) {
+    guint *frames = (guint*) user_data;
+    GstBuffer *buf = gst_buffer_make_writable(GST_PAD_PROBE_INFO_BUFFER(info));
+    GST_PAD_PROBE_INFO_DATA(info) = buf;
+    if (*frames == 0) {
+        gst_buffer_add_video_region_of_interest_meta(buf, "part", 10, 20, 100, 80)->id = 1;
+        // Runs over the right and bottom edges, inferred clipped to 20x30 and scaled up to 64x96
+        gst_buffer_add_video_region_of_interest_meta(buf, "part", 300, 210, 40, 40)->id = 2;
+        gst_buffer_add_video_region_of_interest_meta(buf, "label", 0, 0, 50, 50)->id = 3;
+    } else if (*frames == 2) {
+        gst_buffer_add_video_region_of_interest_meta(buf, "part", 0, 0, 32, 16)->id = 4;
+    }
+    (*frames)++;
+    return GST_PAD_PROBE_OK;
+}
+
+/* Records the region ids of each frame's result, an empty list for frames pushed without result */
+static GstPadProbeReturn region_results_probe(GstPad *pad, GstPadProbeInfo *info, gpointer user_data) {
+    std::vector<std::vector<gint>> *results = (std::vector<std::vector<gint>>*) user_data;
+    GstLookoutVisionMeta *meta = gst_buffer_get_lookout_vision_meta(GST_PAD_PROBE_INFO_BUFFER(info));
+    std::vector<gint> ids;
+    if (meta) {
+        EXPECT_TRUE(meta->result->is_anomalous);
+        for (const GstLookoutVisionRegion &region : meta->result->regions) {
+            EXPECT_EQ(region.result_status, GstLookoutVisionResultStatus::SUCCESSFUL);
+            ids.push_back(region.roi_id);
+        }
+    }
+    results->push_back(ids);
+    return GST_PAD_PROBE_OK;
+}
+
+TEST_F(gstlookoutvisiontest, pipeline_run_on_regions_of_interest_test) {
+    grpc_server = new TestServer();
+    grpc_server->RunServerInBackground("0.0.0.0:50051", "RUNNING");
+
+    GstElement *source, *capsfilter, *sink, *lookoutvision;
+    GstMessage *msg;
+    GstStateChangeReturn ret;
+
+    source = gst_element_factory_make("videotestsrc", "source");
+    capsfilter = gst_element_factory_make("capsfilter", "caps");
+    lookoutvision = gst_element_factory_make("lookoutvision", "infer");
+    sink = gst_element_factory_make("fakesink", "sink");
+    pipeline = gst_pipeline_new("pipeline");
+    ASSERT_NE(source, nullptr);
+    ASSERT_NE(capsfilter, nullptr);
+    ASSERT_NE(lookoutvision, nullptr);
+    ASSERT_NE(sink, nullptr);
+    ASSERT_NE(pipeline, nullptr);
+
+    gst_bin_add_many(GST_BIN(pipeline), source, capsfilter, lookoutvision, sink, NULL);
+    ASSERT_TRUE(gst_element_link_many(source, capsfilter, lookoutvision, sink, NULL));
+
+    g_object_set(source, "pattern", 0, "num-buffers", 4, NULL);
+    GstCaps *caps = gst_caps_new_simple("video/x-raw",
+                                        "width", G_TYPE_INT, 320,
+                                        "height", G_TYPE_INT, 240,
+                                        "format", G_TYPE_STRING, "RGB",
+                                        NULL);
+    g_object_set(capsfilter, "caps", caps, NULL);
+    gst_caps_unref(caps);
+    g_object_set(lookoutvision, "server-socket", "0.0.0.0:50051", "model-component", "SampleModel",
+                 "infer-regions", TRUE, "region-type", "part", NULL);
+
+    guint frames = 0;
+    GstPad *source_pad = gst_element_get_static_pad(source, "src");
+    gst_pad_add_probe(source_pad, GST_PAD_PROBE_TYPE_BUFFER, add_regions_probe, &frames, NULL);
+    gst_object_unref(source_pad);
+    std::vector<std::vector<gint>> results;
+    GstPad *sink_pad = gst_element_get_static_pad(sink, "sink");
+    gst_pad_add_probe(sink_pad, GST_PAD_PROBE_TYPE_BUFFER, region_results_probe, &results, NULL);
+    gst_object_unref(sink_pad);
+
+    ret = gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    ASSERT_NE(ret, GST_STATE_CHANGE_FAILURE);
+
+    bus = gst_element_get_bus(pipeline);
+    msg = gst_bus_timed_pop_filtered(bus, GST_CLOCK_TIME_NONE, (GstMessageType) (GST_MESSAGE_ERROR | GST_MESSAGE_EOS));
+
+    if (msg != NULL) {
+        switch (GST_MESSAGE_TYPE (msg)) {
+            case GST_MESSAGE_ERROR:
+                FAIL();
+            case GST_MESSAGE_EOS:
+                break;
+        }
+        gst_message_unref(msg);
+    }
+
+    // Only the three part regions were inferred, the last one scaled up from 32x16
+    ASSERT_EQ(grpc_server->GetDetectAnomaliesCount(), 3);
+    ASSERT_EQ(grpc_server->GetLastFrameWidth(), 128);
+    ASSERT_EQ(grpc_server->GetLastFrameHeight(), 64);
+    ASSERT_EQ(results.size(), 4);
+    ASSERT_EQ(results[0], std::vector<gint>({1, 2}));
+    ASSERT_TRUE(results[1].empty());
+    ASSERT_EQ(results[2], std::vector<gint>({4}));
+    ASSERT_TRUE(results[3].empty());
+}
+
 int main(int argc, char *argv[]) {
     gst_init(&argc, &argv);
 
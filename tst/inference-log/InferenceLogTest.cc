@@ -0,0 +1,203 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <gst/gst.h>
+#include <glib/gstdio.h>
+#include <gtest/gtest.h>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "inference-log/InferenceLog.h"
+#include "gst/lookoutvisionmeta/gstlookoutvisionresult.h"
+
+class InferenceLogTest : public testing::Test {
+protected:
+    std::string location;
+    GstElement *pipeline = nullptr;
+    GstBus *bus = nullptr;
+
+    void SetUp() override {
+        gchar* dir = g_dir_make_tmp("inference-log-XXXXXX", NULL);
+        ASSERT_NE(dir, nullptr);
+        location = dir;
+        g_free(dir);
+    }
+
+    void TearDown() override {
+        if (bus) {
+            gst_object_unref(bus);
+        }
+        if (pipeline) {
+            gst_element_set_state(pipeline, GST_STATE_NULL);
+            gst_object_unref(pipeline);
+        }
+        GDir* dir = g_dir_open(location.c_str(), 0, NULL);
+        if (dir) {
+            const gchar* name;
+            while ((name = g_dir_read_name(dir)) != NULL) {
+                std::string path = location + "/" + name;
+                g_remove(path.c_str());
+            }
+            g_dir_close(dir);
+        }
+        g_rmdir(location.c_str());
+    }
+
+    InferenceLogRecord makeRecord(uint64_t wall_time_ns, bool is_anomalous) {
+        InferenceLogRecord record = {};
+        record.wall_time_ns = wall_time_ns;
+        record.pts = wall_time_ns / 2;
+        record.inference_latency_ns = 1000;
+        record.confidence = 0.5;
+        record.is_anomalous = is_anomalous;
+        record.result_status = GstLookoutVisionResultStatus::SUCCESSFUL;
+        strncpy(record.model_component, "SampleModel", sizeof(record.model_component));
+        return record;
+    }
+
+    std::vector<uint64_t> query(uint64_t from, uint64_t to) {
+        std::vector<uint64_t> times;
+        InferenceLogReader reader(location);
+        reader.Query(from, to, [&](const InferenceLogRecord& record) {
+            times.push_back(record.wall_time_ns);
+            return true;
+        });
+        return times;
+    }
+};
+
+TEST_F(InferenceLogTest, append_and_query_across_segments_test) {
+    {
+        InferenceLogWriter writer(location, 100, 0, 0, 16);
+        for (uint64_t i = 1; i <= 1000; i++) {
+            writer.Append(makeRecord(i * 1000, i % 10 == 0));
+        }
+    }
+
+    ASSERT_EQ(query(0, UINT64_MAX).size(), 1000u);
+
+    std::vector<uint64_t> times = query(250 * 1000, 260 * 1000);
+    ASSERT_EQ(times.size(), 11u);
+    ASSERT_EQ(times.front(), 250u * 1000);
+    ASSERT_EQ(times.back(), 260u * 1000);
+}
+
+TEST_F(InferenceLogTest, reopen_continues_log_test) {
+    {
+        InferenceLogWriter writer(location, 64, 0, 0, 8);
+        for (uint64_t i = 1; i <= 40; i++) {
+            writer.Append(makeRecord(i, false));
+        }
+    }
+    {
+        InferenceLogWriter writer(location, 64, 0, 0, 8);
+        for (uint64_t i = 41; i <= 100; i++) {
+            writer.Append(makeRecord(i, false));
+        }
+    }
+
+    std::vector<uint64_t> times = query(0, UINT64_MAX);
+    ASSERT_EQ(times.size(), 100u);
+    for (uint64_t i = 0; i < times.size(); i++) {
+        ASSERT_EQ(times[i], i + 1);
+    }
+}
+
+TEST_F(InferenceLogTest, unsynced_records_are_recovered_test) {
+    InferenceLogWriter* writer = new InferenceLogWriter(location, 64, 0, 0, 8);
+    for (uint64_t i = 1; i <= 10; i++) {
+        writer->Append(makeRecord(i, false));
+    }
+
+    // Records are visible through the page cache before the writer syncs the segment header
+    ASSERT_EQ(query(0, UINT64_MAX).size(), 10u);
+    delete writer;
+}
+
+TEST_F(InferenceLogTest, max_segments_retention_test) {
+    {
+        InferenceLogWriter writer(location, 10, 3, 0, 0);
+        for (uint64_t i = 1; i <= 100; i++) {
+            writer.Append(makeRecord(i, false));
+        }
+    }
+
+    std::vector<uint64_t> times = query(0, UINT64_MAX);
+    ASSERT_EQ(times.size(), 30u);
+    ASSERT_EQ(times.front(), 71u);
+    ASSERT_EQ(times.back(), 100u);
+
+    // The index only keeps the entries of the retained segments
+    GStatBuf index_stat;
+    ASSERT_EQ(g_stat((location + "/index.lvidx").c_str(), &index_stat), 0);
+    ASSERT_EQ((size_t) index_stat.st_size, 3 * sizeof(InferenceLogIndexEntry));
+}
+
+TEST_F(InferenceLogTest, invalid_location_test) {
+    std::string error;
+    try {
+        InferenceLogWriter writer("/proc/inference-log", 10, 0, 0, 0);
+    } catch (std::runtime_error& e) {
+        error = e.what();
+    }
+    ASSERT_FALSE(error.empty());
+}
+
+TEST_F(InferenceLogTest, pipeline_logs_inference_results_test) {
+    GstElement *source, *sink, *lookoutvision, *log;
+    GstMessage *msg;
+    GstStateChangeReturn ret;
+
+    source = gst_element_factory_make("videotestsrc", "source");
+    lookoutvision = gst_element_factory_make("lookoutvision", "infer");
+    log = gst_element_factory_make("lookoutvisionlog", "log");
+    sink = gst_element_factory_make("fakesink", "sink");
+    pipeline = gst_pipeline_new("pipeline");
+    ASSERT_NE(source, nullptr);
+    ASSERT_NE(lookoutvision, nullptr);
+    ASSERT_NE(log, nullptr);
+    ASSERT_NE(sink, nullptr);
+    ASSERT_NE(pipeline, nullptr);
+
+    gst_bin_add_many(GST_BIN(pipeline), source, lookoutvision, log, sink, NULL);
+    ASSERT_TRUE(gst_element_link_many(source, lookoutvision, log, sink, NULL));
+
+    g_object_set(source, "pattern", 0, "num-buffers", 5, NULL);
+    g_object_set(log, "location", location.c_str(), "segment-records", 2, NULL);
+
+    ret = gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    ASSERT_NE(ret, GST_STATE_CHANGE_FAILURE);
+
+    bus = gst_element_get_bus(pipeline);
+    msg = gst_bus_timed_pop_filtered(bus, GST_CLOCK_TIME_NONE, (GstMessageType) (GST_MESSAGE_ERROR | GST_MESSAGE_EOS));
+
+    if (msg != NULL) {
+        switch (GST_MESSAGE_TYPE (msg)) {
+            case GST_MESSAGE_ERROR:
+                FAIL();
+            case GST_MESSAGE_EOS:
+                break;
+        }
+        gst_message_unref(msg);
+    }
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+
+    std::vector<InferenceLogRecord> records;
+    InferenceLogReader reader(location);
+    reader.Query(0, UINT64_MAX, [&](const InferenceLogRecord& record) {
+        records.push_back(record);
+        return true;
+    });
+    ASSERT_EQ(records.size(), 5u);
+    ASSERT_EQ(records[0].pts, 0u);
+    ASSERT_EQ(records[0].result_status, GstLookoutVisionResultStatus::FAILED);
+}
+
+int main(int argc, char *argv[]) {
+    gst_init(&argc, &argv);
+
+    testing::InitGoogleTest();
+    RUN_ALL_TESTS();
+
+    return 0;
+}
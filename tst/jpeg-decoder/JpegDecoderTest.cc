@@ -0,0 +1,112 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <gst/gst.h>
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include "jpeg-decoder/JpegDecoder.h"
+
+/* Encodes a frame of one colour */
+static std::vector<uint8_t> encode(size_t width, size_t height, uint8_t r, uint8_t g, uint8_t b) {
+    struct jpeg_compress_struct compress;
+    struct jpeg_error_mgr error_manager;
+    compress.err = jpeg_std_error(&error_manager);
+    jpeg_create_compress(&compress);
+    unsigned char* data = nullptr;
+    unsigned long size = 0;
+    jpeg_mem_dest(&compress, &data, &size);
+    compress.image_width = width;
+    compress.image_height = height;
+    compress.input_components = 3;
+    compress.in_color_space = JCS_RGB;
+    jpeg_set_defaults(&compress);
+    jpeg_set_quality(&compress, 95, TRUE);
+    jpeg_start_compress(&compress, TRUE);
+    std::vector<uint8_t> row(width * 3);
+    for (size_t x = 0; x < width; x++) {
+        row[3 * x] = r;
+        row[3 * x + 1] = g;
+        row[3 * x + 2] = b;
+    }
+    while (compress.next_scanline < height) {
+        JSAMPROW row_pointer = row.data();
+        jpeg_write_scanlines(&compress, &row_pointer, 1);
+    }
+    jpeg_finish_compress(&compress);
+    jpeg_destroy_compress(&compress);
+    std::vector<uint8_t> jpeg(data, data + size);
+    free(data);
+    return jpeg;
+}
+
+TEST(JpegDecoderTest, decodes_full_resolution_test) {
+    std::vector<uint8_t> jpeg = encode(64, 48, 200, 100, 50);
+    JpegDecoder decoder;
+    ASSERT_TRUE(decoder.ReadHeader(jpeg.data(), jpeg.size()));
+    ASSERT_EQ(decoder.SourceWidth(), 64u);
+    ASSERT_EQ(decoder.SourceHeight(), 48u);
+    ASSERT_EQ(decoder.Width(), 64u);
+    ASSERT_EQ(decoder.Height(), 48u);
+
+    std::vector<uint8_t> rgb(decoder.Width() * decoder.Height() * 3);
+    ASSERT_TRUE(decoder.Decode(rgb.data()));
+    for (size_t i = 0; i < rgb.size(); i += 3) {
+        ASSERT_NEAR(rgb[i], 200, 3);
+        ASSERT_NEAR(rgb[i + 1], 100, 3);
+        ASSERT_NEAR(rgb[i + 2], 50, 3);
+    }
+}
+
+TEST(JpegDecoderTest, scales_to_cover_test) {
+    std::vector<uint8_t> jpeg = encode(640, 480, 10, 20, 30);
+    JpegDecoder decoder;
+    ASSERT_TRUE(decoder.ReadHeader(jpeg.data(), jpeg.size()));
+
+    // 1/4 is the smallest scaling still covering 150x100
+    decoder.ScaleToCover(150, 100);
+    ASSERT_EQ(decoder.Width(), 160u);
+    ASSERT_EQ(decoder.Height(), 120u);
+
+    decoder.ScaleToCover(80, 60);
+    ASSERT_EQ(decoder.Width(), 80u);
+    ASSERT_EQ(decoder.Height(), 60u);
+
+    std::vector<uint8_t> rgb(decoder.Width() * decoder.Height() * 3);
+    ASSERT_TRUE(decoder.Decode(rgb.data()));
+    ASSERT_NEAR(rgb[0], 10, 3);
+    ASSERT_NEAR(rgb[1], 20, 3);
+    ASSERT_NEAR(rgb[2], 30, 3);
+}
+
+TEST(JpegDecoderTest, larger_than_source_decodes_full_resolution_test) {
+    std::vector<uint8_t> jpeg = encode(64, 48, 0, 0, 0);
+    JpegDecoder decoder;
+    ASSERT_TRUE(decoder.ReadHeader(jpeg.data(), jpeg.size()));
+    decoder.ScaleToCover(128, 96);
+    ASSERT_EQ(decoder.Width(), 64u);
+    ASSERT_EQ(decoder.Height(), 48u);
+}
+
+TEST(JpegDecoderTest, corrupt_frame_fails_test) {
+    std::vector<uint8_t> garbage(100, 0x42);
+    JpegDecoder decoder;
+    ASSERT_FALSE(decoder.ReadHeader(garbage.data(), garbage.size()));
+    ASSERT_FALSE(decoder.Error().empty());
+
+    // Cut off inside the header
+    std::vector<uint8_t> jpeg = encode(64, 48, 0, 0, 0);
+    JpegDecoder truncated;
+    ASSERT_FALSE(truncated.ReadHeader(jpeg.data(), 100));
+    ASSERT_FALSE(truncated.Error().empty());
+}
+
+int main(int argc, char *argv[]) {
+    gst_init(&argc, &argv);
+
+    testing::InitGoogleTest();
+    RUN_ALL_TESTS();
+
+    return 0;
+}
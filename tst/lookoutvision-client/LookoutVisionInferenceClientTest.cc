@@ -6,6 +6,17 @@
 #include <gtest/gtest.h>
 #include <fcntl.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include "Inference_mock.grpc.pb.h"
 #include "lookoutvision-client/LookoutVisionInferenceClient.h"
 #include "gst/lookoutvisionmeta/gstlookoutvisionresult.h"
@@ -21,6 +32,21 @@ protected:
     GstElement *pipeline = nullptr;
     GstBus *bus = nullptr;
     TestServer* grpc_server = nullptr;
+    std::mutex log_mutex;
+    std::string log_output;
+
+    void captureLog(LookoutVisionInferenceClient& inference_client) {
+        inference_client.setLogHandler([this](LookoutVisionInferenceClient::LogLevel level,
+                                              const std::string& message) {
+            std::lock_guard<std::mutex> lock(log_mutex);
+            log_output += message + "\n";
+        });
+    }
+
+    std::string getLog() {
+        std::lock_guard<std::mutex> lock(log_mutex);
+        return log_output;
+    }
 
     void TearDown() override {
         if (bus) {
@@ -43,12 +69,450 @@ TEST_F(LookoutVisionInferenceClientTest, grpc_calls_throw_exception_test) {
     ON_CALL(mock_stub, DetectAnomalies(_,_,_)).WillByDefault(Throw(std::runtime_error("DetectAnomalies failed")));
 
     LookoutVisionInferenceClient* inference_client = new LookoutVisionInferenceClient(&mock_stub);
+    captureLog(*inference_client);
     LookoutVisionInferenceClient::OperationStatus status = inference_client->StartModel("SampleModel", 5);
     ASSERT_EQ(status, LookoutVisionInferenceClient::OperationStatus::FAILED);
 
     guint8* buffer = new guint8[120]{};
     GstLookoutVisionResult* result = inference_client->DetectAnomalies("SampleModel", buffer, 120, 5, 8);
     ASSERT_EQ(result->error_message, "DetectAnomalies failed");
+    ASSERT_THAT(getLog(), HasSubstr("DetectAnomalies threw an exception: DetectAnomalies failed"));
+}
+
+TEST_F(LookoutVisionInferenceClientTest, balances_across_replicas_test) {
+    TestServer replica_1, replica_2;
+    replica_1.SetInferenceLatency(100);
+    replica_2.SetInferenceLatency(100);
+    replica_1.RunServerInBackground("0.0.0.0:50061", "RUNNING");
+    replica_2.RunServerInBackground("0.0.0.0:50062", "RUNNING");
+
+    LookoutVisionInferenceClient inference_client("0.0.0.0:50061,0.0.0.0:50062");
+    inference_client.setMaxInflight(4);
+    ASSERT_EQ(inference_client.StartModel("SampleModel", 30), LookoutVisionInferenceClient::OperationStatus::SUCCESSFUL);
+
+    // Each replica serves one call at a time, so 8 calls take 800 ms on one replica and about 400 ms on two
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+        threads.push_back(std::thread([&inference_client] {
+            guint8 buffer[120] = {};
+            for (int j = 0; j < 2; j++) {
+                GstLookoutVisionResult* result = inference_client.DetectAnomalies("SampleModel", buffer, 120, 5, 8);
+                EXPECT_EQ(result->result_status, GstLookoutVisionResultStatus::SUCCESSFUL);
+                delete result;
+            }
+        }));
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    replica_1.StopServer();
+    replica_2.StopServer();
+    ASSERT_EQ(replica_1.GetDetectAnomaliesCount() + replica_2.GetDetectAnomaliesCount(), 8);
+    ASSERT_GE(replica_1.GetDetectAnomaliesCount(), 2);
+    ASSERT_GE(replica_2.GetDetectAnomaliesCount(), 2);
+    ASSERT_LT(elapsed, std::chrono::milliseconds(700));
+}
+
+TEST_F(LookoutVisionInferenceClientTest, ejects_unavailable_replica_test) {
+    grpc_server = new TestServer();
+    grpc_server->RunServerInBackground("0.0.0.0:50063", "RUNNING");
+
+    // Nothing listens on 50064
+    LookoutVisionInferenceClient inference_client("0.0.0.0:50063,0.0.0.0:50064");
+    captureLog(inference_client);
+    ASSERT_EQ(inference_client.StartModel("SampleModel", 30), LookoutVisionInferenceClient::OperationStatus::SUCCESSFUL);
+
+    guint8 buffer[120] = {};
+    for (int i = 0; i < 10; i++) {
+        GstLookoutVisionResult* result = inference_client.DetectAnomalies("SampleModel", buffer, 120, 5, 8);
+        ASSERT_EQ(result->result_status, GstLookoutVisionResultStatus::SUCCESSFUL);
+        delete result;
+    }
+
+    std::vector<EndpointStats> stats = inference_client.GetEndpointStats();
+    ASSERT_EQ(stats.size(), 2u);
+    ASSERT_TRUE(stats[0].healthy);
+    ASSERT_EQ(stats[0].requests, 10u);
+    ASSERT_FALSE(stats[1].healthy);
+    ASSERT_EQ(stats[1].requests, 0u);
+    std::string output = getLog();
+    ASSERT_THAT(output, HasSubstr("Ejected SampleModel on 0.0.0.0:50064"));
+}
+
+TEST_F(LookoutVisionInferenceClientTest, readmits_replica_after_health_check_test) {
+    grpc_server = new TestServer();
+    grpc_server->RunServerInBackground("0.0.0.0:50065", "RUNNING");
+
+    LookoutVisionInferenceClient inference_client("0.0.0.0:50065,0.0.0.0:50066");
+    captureLog(inference_client);
+    inference_client.setHealthCheckInterval(1);
+    guint8 buffer[120] = {};
+    for (int i = 0; i < 2 * LookoutVisionInferenceClient::EJECT_AFTER_FAILURES; i++) {
+        delete inference_client.DetectAnomalies("SampleModel", buffer, 120, 5, 8);
+    }
+    ASSERT_FALSE(inference_client.GetEndpointStats()[1].healthy);
+
+    TestServer late_replica;
+    late_replica.RunServerInBackground("0.0.0.0:50066", "RUNNING");
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!inference_client.GetEndpointStats()[1].healthy && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    late_replica.StopServer();
+
+    std::string output = getLog();
+    ASSERT_THAT(output, HasSubstr("Re-admitted SampleModel on 0.0.0.0:50066"));
+}
+
+TEST_F(LookoutVisionInferenceClientTest, release_model_waits_for_calls_in_flight_test) {
+    grpc_server = new TestServer();
+    grpc_server->SetInferenceLatency(300);
+    grpc_server->RunServerInBackground("0.0.0.0:50067", "RUNNING");
+
+    LookoutVisionInferenceClient inference_client("0.0.0.0:50067");
+    ASSERT_EQ(inference_client.StartModel("SampleModel", 30), LookoutVisionInferenceClient::OperationStatus::SUCCESSFUL);
+    std::thread caller([&inference_client] {
+        guint8 buffer[120] = {};
+        GstLookoutVisionResult* result = inference_client.DetectAnomalies("SampleModel", buffer, 120, 5, 8);
+        EXPECT_EQ(result->result_status, GstLookoutVisionResultStatus::SUCCESSFUL);
+        delete result;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // The new model serves alongside the previous one until that is released
+    ASSERT_EQ(inference_client.StartModel("NewModel", 30), LookoutVisionInferenceClient::OperationStatus::SUCCESSFUL);
+    ASSERT_EQ(inference_client.GetEndpointStats().size(), 2u);
+    ASSERT_EQ(inference_client.ReleaseModel("SampleModel", true),
+              LookoutVisionInferenceClient::OperationStatus::SUCCESSFUL);
+    ASSERT_EQ(grpc_server->GetDetectAnomaliesCount(), 1);
+    caller.join();
+
+    std::vector<EndpointStats> stats = inference_client.GetEndpointStats();
+    ASSERT_EQ(stats.size(), 1u);
+    ASSERT_EQ(stats[0].model_component, "NewModel");
+    ASSERT_EQ(grpc_server->GetStopModelCount(), 1);
+}
+
+TEST_F(LookoutVisionInferenceClientTest, inference_timeout_test) {
+    grpc_server = new TestServer();
+    grpc_server->SetInferenceLatency(1000);
+    grpc_server->RunServerInBackground("0.0.0.0:50068", "RUNNING");
+
+    LookoutVisionInferenceClient inference_client("0.0.0.0:50068");
+    inference_client.setInferenceTimeout(100, false);
+    ASSERT_EQ(inference_client.StartModel("SampleModel", 30), LookoutVisionInferenceClient::OperationStatus::SUCCESSFUL);
+
+    guint8 buffer[120] = {};
+    auto start = std::chrono::steady_clock::now();
+    GstLookoutVisionResult* result = inference_client.DetectAnomalies("SampleModel", buffer, 120, 5, 8);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    ASSERT_EQ(result->result_status, GstLookoutVisionResultStatus::TIMEOUT);
+    ASSERT_EQ(result->error_message, "Timed out after 100 ms");
+    ASSERT_LT(elapsed, std::chrono::milliseconds(500));
+    delete result;
+}
+
+TEST_F(LookoutVisionInferenceClientTest, adaptive_timeout_test) {
+    grpc_server = new TestServer();
+    grpc_server->SetInferenceLatency(20);
+    grpc_server->RunServerInBackground("0.0.0.0:50069", "RUNNING");
+
+    LookoutVisionInferenceClient inference_client("0.0.0.0:50069");
+    inference_client.setInferenceTimeout(5000, true);
+    ASSERT_EQ(inference_client.StartModel("SampleModel", 30), LookoutVisionInferenceClient::OperationStatus::SUCCESSFUL);
+
+    guint8 buffer[120] = {};
+    for (int i = 0; i < 48; i++) {
+        GstLookoutVisionResult* result = inference_client.DetectAnomalies("SampleModel", buffer, 120, 5, 8);
+        ASSERT_EQ(result->result_status, GstLookoutVisionResultStatus::SUCCESSFUL);
+        delete result;
+    }
+
+    // An outlier is cut off well before the 5 second bound
+    grpc_server->SetInferenceLatency(1000);
+    auto start = std::chrono::steady_clock::now();
+    GstLookoutVisionResult* result = inference_client.DetectAnomalies("SampleModel", buffer, 120, 5, 8);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    ASSERT_EQ(result->result_status, GstLookoutVisionResultStatus::TIMEOUT);
+    ASSERT_LT(elapsed, std::chrono::milliseconds(500));
+    delete result;
+}
+
+TEST_F(LookoutVisionInferenceClientTest, adaptive_timeout_recovers_test) {
+    grpc_server = new TestServer();
+    grpc_server->RunServerInBackground("0.0.0.0:50073", "RUNNING");
+
+    LookoutVisionInferenceClient inference_client("0.0.0.0:50073");
+    inference_client.setInferenceTimeout(0, true);
+    ASSERT_EQ(inference_client.StartModel("SampleModel", 30), LookoutVisionInferenceClient::OperationStatus::SUCCESSFUL);
+
+    // Fast calls bring the deadline of SampleModel down to the 10 ms floor
+    guint8 buffer[120] = {};
+    for (int i = 0; i < 48; i++) {
+        GstLookoutVisionResult* result = inference_client.DetectAnomalies("SampleModel", buffer, 120, 5, 8);
+        ASSERT_EQ(result->result_status, GstLookoutVisionResultStatus::SUCCESSFUL);
+        delete result;
+    }
+
+    // Another model has a window of its own
+    grpc_server->SetInferenceLatency(30);
+    GstLookoutVisionResult* result = inference_client.DetectAnomalies("ScreeningModel", buffer, 120, 5, 8);
+    ASSERT_EQ(result->result_status, GstLookoutVisionResultStatus::SUCCESSFUL);
+    delete result;
+
+    // SampleModel got slower for good: each timeout doubles its deadline, from 10 to 20 and 40 ms
+    int timeouts = 0;
+    result = inference_client.DetectAnomalies("SampleModel", buffer, 120, 5, 8);
+    while (result->result_status == GstLookoutVisionResultStatus::TIMEOUT && timeouts < 5) {
+        timeouts++;
+        delete result;
+        result = inference_client.DetectAnomalies("SampleModel", buffer, 120, 5, 8);
+    }
+    ASSERT_EQ(result->result_status, GstLookoutVisionResultStatus::SUCCESSFUL);
+    ASSERT_GE(timeouts, 1);
+    ASSERT_LE(timeouts, 3);
+    delete result;
+}
+
+TEST_F(LookoutVisionInferenceClientTest, circuit_breaker_test) {
+    // Nothing listens on 50070 yet
+    LookoutVisionInferenceClient inference_client("0.0.0.0:50070");
+    captureLog(inference_client);
+    guint8 buffer[120] = {};
+    for (int i = 0; i < LookoutVisionInferenceClient::BREAKER_OPEN_AFTER_FAILURES; i++) {
+        delete inference_client.DetectAnomalies("SampleModel", buffer, 120, 5, 8);
+    }
+
+    // Open: frames fail without a call, and without being written
+    int written = 0;
+    for (int i = 0; i < 100; i++) {
+        GstLookoutVisionResult* result = inference_client.DetectAnomalies("SampleModel", [&written](guint8* frame) {
+            written++;
+            return true;
+        }, 120, 5, 8);
+        ASSERT_EQ(result->result_status, GstLookoutVisionResultStatus::FAILED);
+        ASSERT_EQ(result->error_message, "Edge Agent unavailable");
+        delete result;
+    }
+    ASSERT_EQ(written, 0);
+
+    grpc_server = new TestServer();
+    grpc_server->RunServerInBackground("0.0.0.0:50070", "RUNNING");
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    bool recovered = false;
+    while (!recovered && std::chrono::steady_clock::now() < deadline) {
+        GstLookoutVisionResult* result = inference_client.DetectAnomalies("SampleModel", buffer, 120, 5, 8);
+        recovered = result->result_status == GstLookoutVisionResultStatus::SUCCESSFUL;
+        delete result;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    ASSERT_TRUE(recovered);
+
+    std::string output = getLog();
+    ASSERT_THAT(output, HasSubstr("Circuit breaker opened for 0.0.0.0:50070 after 5 unavailable or timed out calls"));
+    ASSERT_THAT(output, HasSubstr("Circuit breaker half-open for 0.0.0.0:50070"));
+    ASSERT_THAT(output, HasSubstr("Circuit breaker closed for 0.0.0.0:50070"));
+}
+
+TEST_F(LookoutVisionInferenceClientTest, circuit_breaker_trial_test) {
+    // The first call is held by the agent until the breaker is half-open, the first trial until released
+    std::mutex agent_mutex;
+    std::condition_variable agent_cv;
+    bool reachable = false;
+    bool release_stale = false;
+    bool release_trial = false;
+    int calls = 0;
+    int trials = 0;
+    MockEdgeAgentStub* mock_stub = new MockEdgeAgentStub();
+    ON_CALL(*mock_stub, DetectAnomalies(_,_,_)).WillByDefault(Invoke(
+            [&](grpc::ClientContext*, const DetectAnomaliesRequest&, DetectAnomaliesResponse*) -> grpc::Status {
+                std::unique_lock<std::mutex> lock(agent_mutex);
+                calls++;
+                agent_cv.notify_all();
+                if (calls == 1) {
+                    agent_cv.wait(lock, [&] { return release_stale; });
+                    return grpc::Status::OK;
+                }
+                if (!reachable) {
+                    return grpc::Status(grpc::StatusCode::UNAVAILABLE, "Connection refused");
+                }
+                if (++trials == 1) {
+                    agent_cv.notify_all();
+                    agent_cv.wait(lock, [&] { return release_trial; });
+                }
+                return grpc::Status::OK;
+            }));
+    auto wait_for_agent = [&](const std::function<bool()>& condition) {
+        std::unique_lock<std::mutex> lock(agent_mutex);
+        return agent_cv.wait_for(lock, std::chrono::seconds(10), condition);
+    };
+
+    LookoutVisionInferenceClient inference_client(mock_stub);
+    inference_client.setMaxInflight(4);
+    guint8 buffer[120] = {};
+    GstLookoutVisionResult* stale = nullptr;
+    std::thread stale_call([&] {
+        stale = inference_client.DetectAnomalies("SampleModel", buffer, 120, 5, 8);
+    });
+    ASSERT_TRUE(wait_for_agent([&] { return calls == 1; }));
+
+    // Closed to open
+    for (int i = 0; i < LookoutVisionInferenceClient::BREAKER_OPEN_AFTER_FAILURES; i++) {
+        GstLookoutVisionResult* result = inference_client.DetectAnomalies("SampleModel", buffer, 120, 5, 8);
+        ASSERT_EQ(result->result_status, GstLookoutVisionResultStatus::FAILED);
+        delete result;
+    }
+    GstLookoutVisionResult* result = inference_client.DetectAnomalies("SampleModel", buffer, 120, 5, 8);
+    ASSERT_EQ(result->error_message, "Edge Agent unavailable");
+    delete result;
+
+    // Open to half-open after a probe interval, when the first call let through is the trial
+    {
+        std::lock_guard<std::mutex> lock(agent_mutex);
+        reachable = true;
+    }
+    GstLookoutVisionResult* trial = nullptr;
+    std::thread trial_call([&] {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        do {
+            delete trial;
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            trial = inference_client.DetectAnomalies("SampleModel", buffer, 120, 5, 8);
+        } while (trial->error_message == "Edge Agent unavailable" && std::chrono::steady_clock::now() < deadline);
+    });
+    ASSERT_TRUE(wait_for_agent([&] { return trials == 1; }));
+
+    // The call sent while closed returns during the trial, which still is the only call let through
+    {
+        std::lock_guard<std::mutex> lock(agent_mutex);
+        release_stale = true;
+        agent_cv.notify_all();
+    }
+    stale_call.join();
+    ASSERT_EQ(stale->result_status, GstLookoutVisionResultStatus::SUCCESSFUL);
+    delete stale;
+    result = inference_client.DetectAnomalies("SampleModel", buffer, 120, 5, 8);
+    ASSERT_EQ(result->error_message, "Edge Agent unavailable");
+    delete result;
+
+    // Half-open to closed once the trial succeeded
+    {
+        std::lock_guard<std::mutex> lock(agent_mutex);
+        release_trial = true;
+        agent_cv.notify_all();
+    }
+    trial_call.join();
+    ASSERT_EQ(trial->result_status, GstLookoutVisionResultStatus::SUCCESSFUL);
+    delete trial;
+    result = inference_client.DetectAnomalies("SampleModel", buffer, 120, 5, 8);
+    ASSERT_EQ(result->result_status, GstLookoutVisionResultStatus::SUCCESSFUL);
+    delete result;
+    ASSERT_EQ(trials, 2);
+}
+
+TEST_F(LookoutVisionInferenceClientTest, timeouts_open_circuit_breaker_test) {
+    // The agent answers the first successful_calls calls, then every call times out
+    std::atomic<int> calls{0};
+    int successful_calls = 0;
+    auto detect_anomalies = [&](grpc::ClientContext*, const DetectAnomaliesRequest&,
+                                DetectAnomaliesResponse*) -> grpc::Status {
+        if (++calls <= successful_calls) {
+            return grpc::Status::OK;
+        }
+        return grpc::Status(grpc::StatusCode::DEADLINE_EXCEEDED, "Deadline Exceeded");
+    };
+    guint8 buffer[120] = {};
+
+    // Missing the inference timeout counts toward the breaker
+    MockEdgeAgentStub* mock_stub = new MockEdgeAgentStub();
+    ON_CALL(*mock_stub, DetectAnomalies(_,_,_)).WillByDefault(Invoke(detect_anomalies));
+    LookoutVisionInferenceClient* inference_client = new LookoutVisionInferenceClient(mock_stub);
+    inference_client->setInferenceTimeout(100, false);
+    for (int i = 0; i < LookoutVisionInferenceClient::BREAKER_OPEN_AFTER_FAILURES; i++) {
+        GstLookoutVisionResult* result = inference_client->DetectAnomalies("SampleModel", buffer, 120, 5, 8);
+        ASSERT_EQ(result->result_status, GstLookoutVisionResultStatus::TIMEOUT);
+        delete result;
+    }
+    GstLookoutVisionResult* result = inference_client->DetectAnomalies("SampleModel", buffer, 120, 5, 8);
+    ASSERT_EQ(result->error_message, "Edge Agent unavailable");
+    delete result;
+    delete inference_client;
+
+    // Missing an adaptive deadline doesn't
+    calls = 0;
+    successful_calls = 48;
+    mock_stub = new MockEdgeAgentStub();
+    ON_CALL(*mock_stub, DetectAnomalies(_,_,_)).WillByDefault(Invoke(detect_anomalies));
+    inference_client = new LookoutVisionInferenceClient(mock_stub);
+    inference_client->setInferenceTimeout(100, true);
+    for (int i = 0; i < successful_calls; i++) {
+        delete inference_client->DetectAnomalies("SampleModel", buffer, 120, 5, 8);
+    }
+    for (int i = 0; i < 2 * LookoutVisionInferenceClient::BREAKER_OPEN_AFTER_FAILURES; i++) {
+        result = inference_client->DetectAnomalies("SampleModel", buffer, 120, 5, 8);
+        ASSERT_EQ(result->result_status, GstLookoutVisionResultStatus::TIMEOUT);
+        delete result;
+    }
+    delete inference_client;
+}
+
+TEST_F(LookoutVisionInferenceClientTest, cancel_inflight_test) {
+    grpc_server = new TestServer();
+    grpc_server->SetInferenceLatency(3000);
+    grpc_server->RunServerInBackground("0.0.0.0:50071", "RUNNING");
+
+    LookoutVisionInferenceClient inference_client("0.0.0.0:50071");
+    ASSERT_EQ(inference_client.StartModel("SampleModel", 30), LookoutVisionInferenceClient::OperationStatus::SUCCESSFUL);
+
+    guint8 buffer[120] = {};
+    GstLookoutVisionResult* result = nullptr;
+    auto start = std::chrono::steady_clock::now();
+    std::thread call([&]() {
+        result = inference_client.DetectAnomalies("SampleModel", buffer, 120, 5, 8);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    inference_client.CancelInflight();
+    call.join();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    ASSERT_EQ(result->result_status, GstLookoutVisionResultStatus::FAILED);
+    ASSERT_LT(elapsed, std::chrono::milliseconds(1000));
+    delete result;
+    // Counts neither for nor against the endpoint
+    std::vector<EndpointStats> stats = inference_client.GetEndpointStats();
+    ASSERT_EQ(stats[0].failures, 0u);
+    ASSERT_TRUE(stats[0].healthy);
+
+    // Later calls are not affected
+    grpc_server->SetInferenceLatency(0);
+    result = inference_client.DetectAnomalies("SampleModel", buffer, 120, 5, 8);
+    ASSERT_EQ(result->result_status, GstLookoutVisionResultStatus::SUCCESSFUL);
+    delete result;
+}
+
+TEST_F(LookoutVisionInferenceClientTest, unwritten_frame_is_not_sent_test) {
+    grpc_server = new TestServer();
+    grpc_server->RunServerInBackground("0.0.0.0:50072", "RUNNING");
+
+    LookoutVisionInferenceClient inference_client("0.0.0.0:50072");
+    ASSERT_EQ(inference_client.StartModel("SampleModel", 30), LookoutVisionInferenceClient::OperationStatus::SUCCESSFUL);
+
+    GstLookoutVisionResult* result = inference_client.DetectAnomalies("SampleModel", [](guint8* frame) {
+        return false;
+    }, 120, 5, 8);
+    ASSERT_EQ(result->result_status, GstLookoutVisionResultStatus::FAILED);
+    ASSERT_EQ(grpc_server->GetDetectAnomaliesCount(), 0);
+    delete result;
+
+    result = inference_client.DetectAnomalies("SampleModel", [](guint8* frame) {
+        memset(frame, 0, 120);
+        return true;
+    }, 120, 5, 8);
+    ASSERT_EQ(result->result_status, GstLookoutVisionResultStatus::SUCCESSFUL);
+    ASSERT_EQ(grpc_server->GetDetectAnomaliesCount(), 1);
+    delete result;
 }
 
 #ifdef SHARED_MEMORY
@@ -107,21 +571,85 @@ TEST_F(LookoutVisionInferenceClientTest, inference_on_large_size_frame_with_shar
     ASSERT_THAT(output, HasSubstr("Confidence:"));
 }
 
+TEST_F(LookoutVisionInferenceClientTest, clients_use_separate_segments_test) {
+    // Records each request's segment and whether the segment holds the frame the request points at
+    std::mutex agent_mutex;
+    std::vector<std::string> names;
+    std::vector<bool> covered;
+    auto detect_anomalies = [&](grpc::ClientContext*, const DetectAnomaliesRequest& request,
+                                DetectAnomaliesResponse*) -> grpc::Status {
+        const SharedMemoryHandle& handle = request.bitmap().shared_memory_handle();
+        struct stat segment_stat = {};
+        int fd = shm_open(handle.name().c_str(), O_RDONLY, 0);
+        if (fd >= 0) {
+            fstat(fd, &segment_stat);
+            close(fd);
+        }
+        std::lock_guard<std::mutex> lock(agent_mutex);
+        names.push_back(handle.name());
+        covered.push_back((guint64) segment_stat.st_size >= handle.offset() + handle.size());
+        return grpc::Status::OK;
+    };
+    MockEdgeAgentStub* mock_stub_1 = new MockEdgeAgentStub();
+    MockEdgeAgentStub* mock_stub_2 = new MockEdgeAgentStub();
+    ON_CALL(*mock_stub_1, DetectAnomalies(_,_,_)).WillByDefault(Invoke(detect_anomalies));
+    ON_CALL(*mock_stub_2, DetectAnomalies(_,_,_)).WillByDefault(Invoke(detect_anomalies));
+
+    LookoutVisionInferenceClient inference_client_1(mock_stub_1);
+    LookoutVisionInferenceClient inference_client_2(mock_stub_2);
+    ASSERT_TRUE(inference_client_1.setMaxInflight(1));
+    ASSERT_TRUE(inference_client_2.setMaxInflight(4));
+
+    // Growing the first client's slots leaves the second client's segment alone
+    size_t large_size = 2000 * 2000 * 3;
+    std::vector<guint8> large_frame(large_size);
+    GstLookoutVisionResult* result = inference_client_1.DetectAnomalies("SampleModel", large_frame.data(), large_size,
+                                                                        2000, 2000);
+    ASSERT_EQ(result->result_status, GstLookoutVisionResultStatus::SUCCESSFUL);
+    delete result;
+    guint8 buffer[120] = {};
+    result = inference_client_2.DetectAnomalies("SampleModel", buffer, 120, 5, 8);
+    ASSERT_EQ(result->result_status, GstLookoutVisionResultStatus::SUCCESSFUL);
+    delete result;
+
+    ASSERT_EQ(names.size(), 2u);
+    ASSERT_NE(names[0], names[1]);
+    ASSERT_TRUE(covered[0]);
+    ASSERT_TRUE(covered[1]);
+}
+
 TEST_F(LookoutVisionInferenceClientTest, shm_open_error_test) {
+    // Segments are named after the process and a counter, so the next client takes the one after the newest client's
+    std::string prefix = "gstreamer-lookoutvision-bitmap-" + std::to_string(getpid()) + "-";
+    gint64 newest = -1;
+    {
+        LookoutVisionInferenceClient inference_client(new MockEdgeAgentStub());
+        GDir* dir = g_dir_open("/dev/shm", 0, NULL);
+        ASSERT_NE(dir, nullptr);
+        const gchar* name;
+        while ((name = g_dir_read_name(dir)) != NULL) {
+            if (g_str_has_prefix(name, prefix.c_str())) {
+                newest = std::max(newest, (gint64) g_ascii_strtoll(name + prefix.size(), NULL, 10));
+            }
+        }
+        g_dir_close(dir);
+    }
+    ASSERT_GE(newest, 0);
+    std::string next_name = "/" + prefix + std::to_string(newest + 1);
+
     //make shm read-only so that it can't be opened by inference client
-    int shm_fd = shm_open("/gstreamer-lookoutvision-bitmap", O_CREAT | O_RDONLY, 0444);
+    int shm_fd = shm_open(next_name.c_str(), O_CREAT | O_RDONLY, 0444);
 
-    std::string error;
-    try {
-        gst_element_factory_make("lookoutvision", "infer");
-    } catch (std::runtime_error& e) {
-        error = e.what();
-    }
+    GstElement *lookoutvision = gst_element_factory_make("lookoutvision", "infer");
+    ASSERT_NE(lookoutvision, nullptr);
+    GstStateChangeReturn ret = gst_element_set_state(lookoutvision, GST_STATE_READY);
+    gst_element_set_state(lookoutvision, GST_STATE_NULL);
+    gst_object_unref(lookoutvision);
 
     close(shm_fd);
-    shm_unlink("/gstreamer-lookoutvision-bitmap");
+    shm_unlink(next_name.c_str());
 
-    ASSERT_EQ(error, "shm_open failed");
+    ASSERT_EQ(ret, GST_STATE_CHANGE_FAILURE);
 }
 #endif
 
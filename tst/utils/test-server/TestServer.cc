@@ -2,6 +2,8 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include <grpcpp/grpcpp.h>
+#include <chrono>
+#include <mutex>
 #include <string>
 #include "Inference.grpc.pb.h"
 #include "TestServer.h"
@@ -19,11 +21,33 @@ using namespace AWS::LookoutVision;
 class InferenceServiceImplementation final : public EdgeAgent::Service {
 
     AWS::LookoutVision::ModelStatus describe_model_status;
+    std::atomic<int>* inference_latency_in_ms = nullptr;
+    std::atomic<int>* detect_anomalies_count = nullptr;
+    std::atomic<int>* start_model_count = nullptr;
+    std::atomic<int>* stop_model_count = nullptr;
+    std::atomic<int>* last_frame_width = nullptr;
+    std::atomic<int>* last_frame_height = nullptr;
+    std::atomic<int>* last_frame_bytes = nullptr;
+    std::atomic<bool>* anomalous = nullptr;
+    std::mutex model_mutex;
 
     Status DetectAnomalies(ServerContext* context, const DetectAnomaliesRequest* request,
                            DetectAnomaliesResponse* reply) override {
+        if (inference_latency_in_ms && *inference_latency_in_ms > 0) {
+            std::lock_guard<std::mutex> lock(model_mutex);
+            std::this_thread::sleep_for(std::chrono::milliseconds(inference_latency_in_ms->load()));
+        }
+        if (detect_anomalies_count) {
+            (*detect_anomalies_count)++;
+        }
+        if (last_frame_width) {
+            *last_frame_width = request->bitmap().width();
+            *last_frame_height = request->bitmap().height();
+            *last_frame_bytes = request->bitmap().has_shared_memory_handle()
+                    ? request->bitmap().shared_memory_handle().size() : request->bitmap().byte_data().size();
+        }
         auto result = reply->mutable_detect_anomaly_result();
-        result->set_is_anomalous(1);
+        result->set_is_anomalous(!anomalous || *anomalous);
         result->set_confidence(0.52559);
 
         return Status::OK;
@@ -31,6 +55,9 @@ class InferenceServiceImplementation final : public EdgeAgent::Service {
 
     Status StartModel(ServerContext* context, const StartModelRequest* request,
                       StartModelResponse* reply) override {
+        if (start_model_count) {
+            (*start_model_count)++;
+        }
         reply->set_status(AWS::LookoutVision::ModelStatus::STARTING);
 
         return Status::OK;
@@ -38,6 +65,9 @@ class InferenceServiceImplementation final : public EdgeAgent::Service {
 
     Status StopModel(ServerContext* context, const StopModelRequest* request,
                      StopModelResponse* reply) override {
+        if (stop_model_count) {
+            (*stop_model_count)++;
+        }
         reply->set_status(AWS::LookoutVision::ModelStatus::STOPPING);
 
         return Status::OK;
@@ -60,6 +90,24 @@ public:
         }
     }
 
+    void setCounters(std::atomic<int>* inference_latency_in_ms, std::atomic<int>* detect_anomalies_count,
+                     std::atomic<int>* start_model_count, std::atomic<int>* stop_model_count) {
+        this->inference_latency_in_ms = inference_latency_in_ms;
+        this->detect_anomalies_count = detect_anomalies_count;
+        this->start_model_count = start_model_count;
+        this->stop_model_count = stop_model_count;
+    }
+
+    void setLastFrame(std::atomic<int>* width, std::atomic<int>* height, std::atomic<int>* bytes) {
+        this->last_frame_width = width;
+        this->last_frame_height = height;
+        this->last_frame_bytes = bytes;
+    }
+
+    void setVerdict(std::atomic<bool>* anomalous) {
+        this->anomalous = anomalous;
+    }
+
 };
 
 TestServer::TestServer() {}
@@ -67,6 +115,9 @@ TestServer::TestServer() {}
 void TestServer::RunServer(std::string server_address, std::string model_status) {
     InferenceServiceImplementation service;
     service.setDescribeModelStatus(model_status);
+    service.setCounters(&inference_latency_in_ms, &detect_anomalies_count, &start_model_count, &stop_model_count);
+    service.setLastFrame(&last_frame_width, &last_frame_height, &last_frame_bytes);
+    service.setVerdict(&anomalous);
 
     ServerBuilder builder;
     // Listen on the given address without any authentication mechanism
@@ -90,3 +141,35 @@ void TestServer::StopServer() {
     test_server->Shutdown();
     server_thread.join();
 }
+
+void TestServer::SetInferenceLatency(int latency_in_ms) {
+    inference_latency_in_ms = latency_in_ms;
+}
+
+void TestServer::SetAnomalous(bool is_anomalous) {
+    anomalous = is_anomalous;
+}
+
+int TestServer::GetDetectAnomaliesCount() {
+    return detect_anomalies_count;
+}
+
+int TestServer::GetStartModelCount() {
+    return start_model_count;
+}
+
+int TestServer::GetStopModelCount() {
+    return stop_model_count;
+}
+
+int TestServer::GetLastFrameWidth() {
+    return last_frame_width;
+}
+
+int TestServer::GetLastFrameHeight() {
+    return last_frame_height;
+}
+
+int TestServer::GetLastFrameBytes() {
+    return last_frame_bytes;
+}
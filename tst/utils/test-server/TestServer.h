@@ -5,6 +5,7 @@
 #define __TESTSERVER_H__
 
 #include <grpcpp/grpcpp.h>
+#include <atomic>
 #include <thread>
 #include "Inference.grpc.pb.h"
 
@@ -16,10 +17,29 @@ public:
     void RunServer(std::string server_address, std::string model_status);
     void RunServerInBackground(std::string server_address, std::string model_status);
     void StopServer();
+    // Makes DetectAnomalies take latency_in_ms, serving one call at a time like the Edge Agent does per model
+    void SetInferenceLatency(int latency_in_ms);
+    // Verdict of every DetectAnomalies call, anomalous unless set otherwise
+    void SetAnomalous(bool is_anomalous);
+    int GetDetectAnomaliesCount();
+    int GetStartModelCount();
+    int GetStopModelCount();
+    // Resolution and size of the last frame DetectAnomalies received
+    int GetLastFrameWidth();
+    int GetLastFrameHeight();
+    int GetLastFrameBytes();
 
 private:
     std::unique_ptr<Server> test_server;
     std::thread server_thread;
+    std::atomic<int> inference_latency_in_ms{0};
+    std::atomic<int> detect_anomalies_count{0};
+    std::atomic<int> start_model_count{0};
+    std::atomic<int> stop_model_count{0};
+    std::atomic<int> last_frame_width{0};
+    std::atomic<int> last_frame_height{0};
+    std::atomic<int> last_frame_bytes{0};
+    std::atomic<bool> anomalous{true};
 };
 
 #endif //__TESTSERVER_H__